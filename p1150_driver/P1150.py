@@ -24,17 +24,21 @@ SOFTWARE.
 
 This file should NOT BE ALTERED.
 """
+import math
 import os
 import struct
+import sys
+import weakref
 from dataclasses import dataclass
 from threading import Lock, Event
 import numpy as np
 from . import uclog
+from . import mp_serial
 import cbor2
 import serial
 import serial.tools.list_ports
 import hashlib
-from time import sleep
+from time import sleep, perf_counter_ns
 from timeit import default_timer as timer
 
 
@@ -179,6 +183,62 @@ class P1150API:
     ERROR_ACT_SENDLOG = (1 << 3)
 
 
+class PipelineStats(object):
+    """ Per stage timing of the ADC pipeline
+    - fixed-size log2 histograms in nanoseconds, bucket b counts durations < 2**b ns
+      (same layout as the native stats page histograms)
+    - callers only call add() when timing is enabled, disabled cost is one flag test per stage
+
+    """
+    DECODE, LPF, DIGITAL, APPEND, TRIGGER, SNAPSHOT, CALLBACK = range(7)
+    STAGES = ("decode", "lpf", "digital", "append", "trigger", "snapshot", "callback")
+    BUCKETS = 32
+
+    def __init__(self):
+        self.reset()
+
+    def reset(self) -> None:
+        n = len(self.STAGES)
+        self._count = [0] * n
+        self._sum = [0] * n
+        self._max = [0] * n
+        self._hist = [[0] * self.BUCKETS for _ in range(n)]
+
+    def add(self, stage: int, t0: int) -> int:
+        """ record stage duration since t0 (perf_counter_ns), returns now for the next stage """
+        t = perf_counter_ns()
+        ns = t - t0
+        self._count[stage] += 1
+        self._sum[stage] += ns
+        if ns > self._max[stage]: self._max[stage] = ns
+        b = ns.bit_length()
+        self._hist[stage][b if b < self.BUCKETS else self.BUCKETS - 1] += 1
+        return t
+
+    def _percentile_us(self, stage: int, q: float) -> float:
+        # upper edge of the bucket holding the q-th sample
+        target = q * self._count[stage]
+        cum = 0
+        for b, c in enumerate(self._hist[stage]):
+            cum += c
+            if c and cum >= target:
+                return min(1 << b, self._max[stage]) / 1000.0
+        return 0.0
+
+    def as_dict(self) -> dict:
+        d = {}
+        for k, name in enumerate(self.STAGES):
+            n = self._count[k]
+            d[name] = {"count": n,
+                       "mean_us": round(self._sum[k] / n / 1000.0, 3) if n else 0.0,
+                       "max_us": round(self._max[k] / 1000.0, 3),
+                       "p50_us": self._percentile_us(k, 0.50),
+                       "p99_us": self._percentile_us(k, 0.99),
+                       "total_ms": round(self._sum[k] / 1e6, 3),
+                       "buckets": list(self._hist[k])}
+        return d
+
+
 class UCLogger(object):
     """ ucLogger Instance
     - handles communications
@@ -190,6 +250,7 @@ class UCLogger(object):
                  cb_uclog_log = None,
                  cb_uclog_plot = None,
                  cb_uclog_async = None,
+                 cb_pipeline_pressure = None,
                  logger=StubLogger(),
                  **kw):
         super(UCLogger, self).__init__()
@@ -202,6 +263,7 @@ class UCLogger(object):
         self._cb_uclog_plot = cb_uclog_plot
         self._cb_uclog_async = cb_uclog_async
         self._cb_uclog_adc = None
+        self._cb_pipeline_pressure = cb_pipeline_pressure
         self._lock_responses = Lock()
         self._cmd_responses = {}
         self._result_event = Event()
@@ -210,6 +272,15 @@ class UCLogger(object):
         self._low_pass_filter_i_cache = [0.0, 0.0]
         self._low_pass_filter_isnk_cache = [0.0, 0.0]
 
+        # pipeline counters, published with the native stats when metrics_start() is used
+        self._metrics = False
+        # keep threads/buffers alive across USB re-enumeration (FW upload, glitches)
+        self._reconnect = kw.get('reconnect', True)
+        self._pipeline_counters = {"adc_frames": 0, "adc_frame_errors": 0, "adc_decode_errors": 0}
+        # per stage timing, see pipeline_stats()
+        self._stage_timing = False
+        self._stage_stats = PipelineStats()
+
         try:
             _t = self._port
             driver_dir = os.path.dirname(__file__)
@@ -238,7 +309,13 @@ class UCLogger(object):
                                                        0: self._uclog_cmdres,  # cmd/response
                                                        1: self._uclog_async,   # asynchronous messages
                                                        2: self._uclog_plot,    # debug plotter
-                                                       3: self._uclog_adc})    # adc stream
+                                                       3: self._uclog_adc},    # adc stream
+                                                      sn=kw.get('sn', None),
+                                                      reconnect=self._reconnect,
+                                                      sample_ring=kw.get('sample_ring_log2', 20),
+                                                      digital=kw.get('digital_log2', 23),
+                                                      decode_workers=kw.get('decode_workers', 0))
+            self._serial_manager().set_pressure_callback(self._on_pipeline_pressure)
 
             self.connected = True
 
@@ -256,6 +333,199 @@ class UCLogger(object):
     def is_connected(self):
         return self.connected
 
+    def _serial_manager(self):
+        """ native serial manager (mp_serial.MySerialManager), None if not connected """
+        try:
+            return self._ucLogServer.threads['serial'].msm
+        except (AttributeError, KeyError):
+            return None
+
+    def link_state(self) -> tuple[bool, dict]:
+        """ Serial link state
+        - the link survives USB re-enumeration when reconnect is enabled (default)
+
+        :return: success <True/False>,
+                 {"connected": <bool>, "port": <str>, "sn": <str>, "disconnects": <int>,
+                  "reconnects": <int>, "down_ms": <int>, "last_reconnect_ms": <int>,
+                  "max_reconnect_ms": <int>}
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        return True, msm.link_state()
+
+    def _wait_reconnect(self, reconnects: int, timeout: float) -> bool:
+        """ wait for the native reader to re-open the port in place """
+        msm = self._serial_manager()
+        start = timer()
+        while timer() - start < timeout:
+            state = msm.link_state()
+            if state["reconnects"] > reconnects and state["connected"]:
+                self._port = state["port"]
+                self._adc_frame_count = None
+                self.logger.info(f"port {self._port} reconnected in {state['last_reconnect_ms']} ms")
+                return True
+            sleep(0.01)
+        return False
+
+    def pipeline_pressure(self, history: int = 0) -> tuple[bool, dict]:
+        """ Backlog of the whole receive pipeline as one number
+        - sampled natively every 100 ms: firmware backlog (ADC frame "a" field),
+          native ring occupancy, deliver lag (frames not yet handed to Python) and
+          consumer lag (frames handed to Python, not yet processed)
+        - pressure is the worst of these as a fraction of its loss point, 0.0 idle .. 1.0 loss
+        - eta_ms is the predicted time to 1.0 from the trend of the last second, None if not rising
+
+        :param history: number of past samples (100 ms apart, max 600) to include, oldest first
+        :return: success <True/False>,
+                 {"pressure": <float>, "warn": <bool>, "slope_per_s": <float>, "eta_ms": <int|None>,
+                  "peak": <float>, "warn_events": <int>, "fw_backlog": <int>, "fw_backlog_peak": <int>,
+                  "ring_used_bytes": <int>, "ring_size_bytes": <int>,
+                  "deliver_lag_frames": <int>, "deliver_lag_ms": <float>,
+                  "consumer_lag_frames": <int>, "consumer_lag_ms": <float>,
+                  "frames_per_s": <float>, "t_ms": <int>,
+                  "history": {"t_ms": [], "fw_backlog": [], "ring_used": [], "deliver_lag": [],
+                              "consumer_lag": [], "pressure": []}}
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        return True, msm.pipeline_pressure(history=history)
+
+    def pipeline_pressure_config(self, **kw) -> tuple[bool, dict]:
+        """ Loss points and warning levels of pipeline_pressure()
+
+        :param fw_backlog_max: firmware backlog considered loss (default 65536)
+        :param consumer_lag_max: frames the consumer may fall behind (default 25000, 10 s)
+        :param warn_level: warning sets at/above this pressure (default 0.5)
+        :param clear_level: warning clears below this pressure (default 0.25)
+        :param horizon_ms: warning also sets when loss is predicted within this time (default 2000)
+        :return: success <True/False>, active configuration
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        try:
+            return True, msm.pressure_config(**kw)
+        except (TypeError, ValueError) as e:
+            return False, {"ERROR": str(e)}
+
+    def stream_consumer(self, name: str, policy: str = "overwrite",
+                        wake_samples: int = 50) -> tuple[bool, object]:
+        """ Independent reader of the ADC sample stream
+        - the native reader decodes every ADC frame once into a shared ring
+          (sample_ring_log2 kw, default 2**20 samples ~8 s), consumers read it in place
+        - each consumer has its own cursor, lag, overflow policy and wake-up, a slow
+          plotter cannot stall a recorder
+        - streams whenever the firmware streams, independent of acquisition_start()
+
+        :param name: shown in stream_info()
+        :param policy: "overwrite" (lapped when too slow) or "gate" (never loses samples,
+                       frames are dropped for everyone instead)
+        :param wake_samples: consumer.wait() returns once this many samples are available
+        :return: success <True/False>, mp_serial.RingConsumer or {"ERROR": <str>}
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        try:
+            return True, msm.consumer(name, policy, wake_samples)
+        except (RuntimeError, ValueError) as e:
+            return False, {"ERROR": str(e)}
+
+    def stream_info(self) -> tuple[bool, dict]:
+        """ Sample ring head, drops and per consumer lag/overrun """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        return True, msm.ring_info()
+
+    def pipeline_stats_enable(self, enable: bool = True, reset: bool = True) -> tuple[bool, None]:
+        """ Turn per stage timing of the ADC pipeline on/off, see pipeline_stats() """
+        if reset: self._stage_stats.reset()
+        self._stage_timing = bool(enable)
+        return True, None
+
+    def pipeline_stats(self, reset: bool = False) -> tuple[bool, dict]:
+        """ ADC pipeline stage timing and counters
+        - stages: decode, lpf, digital (d0/d1 expansion), append, trigger (search),
+          snapshot (acquisition copy) and callback (cb_acquisition_get_data)
+        - timing is only recorded while enabled by pipeline_stats_enable()
+
+        :param reset: clear the histograms after reading
+        :return: success <True/False>,
+                 {"enabled": <bool>, "counters": {"adc_frames": <int>, ...},
+                  "stages": {<stage>: {"count", "mean_us", "max_us", "p50_us", "p99_us",
+                                       "total_ms", "buckets": [32 x <int>, bucket b < 2**b ns]}}}
+        """
+        d = {"enabled": self._stage_timing,
+             "counters": dict(self._pipeline_counters),
+             "stages": self._stage_stats.as_dict()}
+        if reset: self._stage_stats.reset()
+        return True, d
+
+    def decode_stats(self) -> tuple[bool, dict | None]:
+        """ Native decode worker pool (decode_workers kw)
+
+        :return: success <True/False>, {"workers", "slots", "in_flight", "batches", "frames", "adc_frames",
+                 "samples", "decode_s", "collect_wait_s", "bytes"}, None when the pool is off
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        return True, msm.decode_stats()
+
+    def _on_pipeline_pressure(self, info: dict) -> None:
+        """ native pressure warning set/cleared, called from the deliver thread """
+        if info["warn"]:
+            self.logger.warning(f"pipeline pressure {info['pressure']:.2f}, eta {info['eta_ms']} ms, "
+                                f"fw backlog {info['fw_backlog']}, consumer lag {info['consumer_lag_frames']}")
+        else:
+            self.logger.info(f"pipeline pressure cleared {info['pressure']:.2f}")
+        if self._cb_pipeline_pressure:
+            self._cb_pipeline_pressure(info)
+
+    def metrics_start(self, shm_name: str | None = None, listen: str | None = None,
+                      period_ms: int = 250) -> tuple[bool, dict]:
+        """ Start out-of-band metrics
+        - native counters/histograms are published into a shared memory stats page
+          (see mp_serial.read_stats_page) and optionally served as Prometheus text
+        - neither the page nor the exporter call into Python, scraping does not
+          perturb acquisition
+        - pipeline counters (adc frames, frame errors, ...) are pushed at ~1 Hz
+
+        :param shm_name: stats page name, None for default per-port name
+        :param listen: "unix:/path" or "tcp:127.0.0.1:9150", None for no exporter
+        :param period_ms: stats page refresh period
+        :return: success <True/False>, {"shm_name": <str>} or {"ERROR": <str>}
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+
+        try:
+            name = msm.start_metrics(shm_name=shm_name, listen=listen, period_ms=period_ms)
+        except OSError as e:
+            self.logger.error(f"metrics_start: {e}")
+            return False, {"ERROR": str(e)}
+
+        self._metrics = True
+        self._metrics_publish()
+        return True, {"shm_name": name}
+
+    def metrics_stop(self) -> tuple[bool, None]:
+        self._metrics = False
+        msm = self._serial_manager()
+        if msm is not None:
+            msm.stop_metrics()
+        return True, None
+
+    def _metrics_publish(self) -> None:
+        msm = self._serial_manager()
+        if msm is None: return
+        for k, v in self._pipeline_counters.items():
+            msm.stats_set(k, v, counter=True)
+
     def _uclog_plot(self, item):
         """ ucLogger Plot stream default handler
 
@@ -316,42 +586,57 @@ class UCLogger(object):
 
         if self._cb_uclog_adc is None: return
 
+        st = self._stage_stats if self._stage_timing else None
+        if st: t0 = perf_counter_ns()
+
         #print(len(_item))
         try:
-            item = cbor2.loads(_item)
+            if isinstance(_item, dict):
+                # already decoded by the native worker pool (decode_workers)
+                item = _item
+            else:
+                item = cbor2.loads(_item)
 
-            # Convert the list of bytes back to int32 and scale to mAmps (float) using numpy
-            item["i"] = np.frombuffer(item["i"], dtype='<f4').copy()
-            item["i"] = np.round(item["i"] / 1000000.0, 6)
+                # Convert the list of bytes back to int32 and scale to mAmps (float) using numpy
+                item["i"] = np.frombuffer(item["i"], dtype='<f4').copy()
+                item["i"] = np.round(item["i"] / 1000000.0, 6)
 
-            # Convert the list of bytes back to int32 and scale to mAmps (float) using numpy
-            item["isnk"] = np.frombuffer(item["isnk"], dtype='<f4').copy()
-            item["isnk"] = np.round(item["isnk"] / 1000000.0, 6)
+                # Convert the list of bytes back to int32 and scale to mAmps (float) using numpy
+                item["isnk"] = np.frombuffer(item["isnk"], dtype='<f4').copy()
+                item["isnk"] = np.round(item["isnk"] / 1000000.0, 6)
 
-            # Convert the list of bytes back to uint16 using numpy
-            item["a0"] = np.frombuffer(item["a0"], dtype='<u2').copy().astype(float)
-            item["a0"] = np.round(item["a0"], 0)
+                # Convert the list of bytes back to uint16 using numpy
+                item["a0"] = np.frombuffer(item["a0"], dtype='<u2').copy().astype(float)
+                item["a0"] = np.round(item["a0"], 0)
 
-            # Convert the list of bytes back to uint8 using numpy
-            item["d01"] = np.frombuffer(item["d01"], dtype='u1').copy()
+                # Convert the list of bytes back to uint8 using numpy
+                item["d01"] = np.frombuffer(item["d01"], dtype='u1').copy()
 
-            # Convert the list of bytes back to char and then to string list
-            # Note: numpy isn't significantly faster for string/object conversions, but we keep it consistent
-            item["d0s"] = struct.unpack('<cccccccccccccccccccccccccccccccccccccccccccccccccc', item["d0s"])
-            item["d0s"] = [i.decode('utf-8') for i in item["d0s"]]
+                # Convert the list of bytes back to char and then to string list
+                # Note: numpy isn't significantly faster for string/object conversions, but we keep it consistent
+                item["d0s"] = struct.unpack('<cccccccccccccccccccccccccccccccccccccccccccccccccc', item["d0s"])
+                item["d0s"] = [i.decode('utf-8') for i in item["d0s"]]
 
             # check frame counter, to detect missing packets
             if self._adc_frame_count is None:
                 self._adc_frame_count = item['c']
             elif item['c'] != self._adc_frame_count + 1:
+                self._pipeline_counters["adc_frame_errors"] += 1
                 self.logger.error(f"frame count error at {self._adc_frame_count}")
 
         except Exception as e:
+            self._pipeline_counters["adc_decode_errors"] += 1
             self.logger.exception(e)
             self.logger.error(f"last good frame {self._adc_frame_count}")
             self.logger.error(_item)
             return
 
+        if st: t0 = st.add(PipelineStats.DECODE, t0)
+
+        self._pipeline_counters["adc_frames"] += 1
+        if self._metrics and self._pipeline_counters["adc_frames"] % 2500 == 0:
+            self._metrics_publish()  # ~1Hz at full stream rate
+
         if self._low_pass_filter:
             def lpf(x: np.ndarray, z: list) -> tuple[np.ndarray, list]:
                 # Initialize cache if first run
@@ -377,15 +662,12 @@ class UCLogger(object):
                 lpf(item["i"], self._low_pass_filter_i_cache)
             item["isnk"], self._low_pass_filter_isnk_cache = \
                 lpf(item["isnk"], self._low_pass_filter_isnk_cache)
+            if st: st.add(PipelineStats.LPF, t0)
 
         self._adc_frame_count = item['c']
         #if self._adc_frame_count % 5000 == 0:
         #    self.logger.info(f"frame count {self._adc_frame_count}")  # i[0] {item['i'][0]}")
-        ra = item['a']
-        if ra > 32768:
-            self.logger.warning(f">>>>>>>>>>>>> {ra}")
-        elif ra > 4096:
-            self.logger.info(f">>>>>>>>>>>>> {ra}")
+        # item['a'] (firmware backlog) is tracked natively, see pipeline_pressure()
 
         self._cb_uclog_adc(item)  # this calls P1125:adc_stream_in
 
@@ -480,9 +762,132 @@ class UCLogger(object):
             self._cb_uclog_plot = None
             self._cb_uclog_cmdres = None
             self._cb_uclog_async = None
+            self._cb_pipeline_pressure = None
         self.logger.info("closed")
 
 
+class Acquisition(dict):
+    """ Acquisition data (dict of arrays)
+    - the sample columns live in one contiguous columnar block, allocated once per
+      acquisition: the float64 rows COLUMNS (one per channel, n samples each) followed
+      by d0s (<U1); the dict values are views into it
+    - the block is exported without copying: __array_interface__ / __dlpack__ give the
+      (channels, n) float64 rows (np.asarray(), torch.from_dlpack(), ...), to_numpy_struct()
+      and to_pandas() wrap the same memory
+    - derived channels declared with P1150.derived_config() are computed by one fused
+      native pass on first access of any of them, and cached (separate arrays)
+    """
+
+    COLUMNS = ("t", "i", "isnk", "a0", "d0", "d1")
+    # one sample as packed: a float64 per COLUMNS row, then its d0s character; pack()
+    # lays the block out from it, P1150 memory accounting sizes acquisitions with it
+    SAMPLE_DTYPE = np.dtype([(c, "<f8") for c in COLUMNS] + [("d0s", "<U1")])
+
+    def __init__(self, data: dict, derived: dict | None = None):
+        super().__init__(data)
+        self._derived = derived
+        self._raw = None
+        self._block = None
+        self._names = ()
+
+    @classmethod
+    def pack(cls, columns: dict, meta: dict, derived: dict | None = None) -> "Acquisition":
+        """ Copy the sample columns (any of COLUMNS, plus "d0s") into one new block """
+        names = tuple(c for c in cls.COLUMNS if c in columns)
+        n = len(columns[names[0]])
+        row, d0s = cls.SAMPLE_DTYPE[names[0]], cls.SAMPLE_DTYPE["d0s"]
+        fbytes = len(names) * n * row.itemsize
+        raw = np.empty(fbytes + (n * d0s.itemsize if "d0s" in columns else 0), dtype=np.uint8)
+        block = raw[:fbytes].view(row).reshape(len(names), n)
+        data = {}
+        for k, c in enumerate(names):
+            block[k] = columns[c]
+            data[c] = block[k]
+        if "d0s" in columns:
+            data["d0s"] = raw[fbytes:].view(d0s)
+            data["d0s"][:] = columns["d0s"]
+        a = cls({**data, **meta}, derived)
+        a._raw, a._block, a._names = raw, block, names
+        return a
+
+    def __missing__(self, key):
+        if self._derived and key in self._derived["channels"]:
+            self.compute()
+            return dict.__getitem__(self, key)
+        raise KeyError(key)
+
+    def compute(self) -> None:
+        """ compute the pending derived channels now """
+        if self._derived:
+            self.update(mp_serial.derive(dict.__getitem__(self, "i"), dict.get(self, "isnk"),
+                                         dict.get(self, "a0"), **self._derived))
+            self._derived = None
+
+    def get(self, key, default=None):
+        try:
+            return self[key]
+        except KeyError:
+            return default
+
+    def pending(self) -> tuple:
+        """ declared derived channels not computed yet """
+        return tuple(self._derived["channels"]) if self._derived else ()
+
+    # ----------------- Zero-copy export -----------------
+
+    def _packed(self) -> np.ndarray:
+        if self._block is None:
+            raise ValueError("acquisition is not packed, see Acquisition.pack()")
+        return self._block
+
+    @property
+    def columns(self) -> tuple:
+        """ names of the rows of the float64 block, in order """
+        return self._names
+
+    @property
+    def __array_interface__(self) -> dict:
+        return self._packed().__array_interface__
+
+    def __dlpack__(self, **kwargs):
+        return self._packed().__dlpack__(**kwargs)
+
+    def __dlpack_device__(self):
+        return self._packed().__dlpack_device__()
+
+    def to_numpy_struct(self) -> np.ndarray:
+        """ The block as one 0-d structured record with an (n,) field per column (and d0s),
+            a view: a.to_numpy_struct()["i"] is a["i"] """
+        block = self._packed()
+        n = block.shape[1]
+        fields = [(c, np.float64, (n,)) for c in self._names]
+        if "d0s" in self:
+            fields.append(("d0s", "<U1", (n,)))
+        return np.ndarray((), dtype=np.dtype(fields), buffer=self._raw)
+
+    def to_pandas(self, derived: bool = True, d0s: bool = True):
+        """ DataFrame over the block, the float64 columns are wrapped, not copied
+            (as are computed derived channels with derived=True, which computes the
+            pending ones); d0s=True adds d0s, the one column pandas converts (to str objects)
+        """
+        import pandas as pd
+        block = self._packed()
+        cols = {c: block[k] for k, c in enumerate(self._names)}
+        if derived:
+            self.compute()
+            cols.update({k: v for k, v in self.items()
+                         if k not in cols and k != "d0s" and isinstance(v, np.ndarray) and v.shape == block.shape[1:]})
+        if d0s and "d0s" in self:
+            cols["d0s"] = dict.__getitem__(self, "d0s").astype(object)
+        return pd.DataFrame(cols, copy=False)
+
+
+# live P1150 instances and the process-wide memory budget, see P1150.memory_process()
+_devices = weakref.WeakSet()
+_devices_lock = Lock()
+_process_budget = None
+
+
 class P1150(UCLogger):
     """ P1150 Class
 
@@ -511,6 +916,13 @@ class P1150(UCLogger):
 
     ADC_SAMPLE_RATE = 125000.0
 
+    # default history_config() levels, (rate_hz, seconds)
+    HISTORY_LEVELS = ((1000.0, 3600.0), (10.0, 3 * 86400.0))
+
+    # acquisition bytes per sample: the _adc float64 columns and d0s list slot, the time
+    # axis and the packed Acquisition handed out
+    ACQ_SAMPLE_BYTES = len(Acquisition.COLUMNS) * 8 + 8 + 8 + Acquisition.SAMPLE_DTYPE.itemsize
+
     TBASE_MAP = {
         P1150API.TBASE_SPAN_10MS: 0.010,
         P1150API.TBASE_SPAN_20MS: 0.020,
@@ -529,16 +941,32 @@ class P1150(UCLogger):
     def __init__(self, cb_acquisition_get_data=None, **kw):
         """ Init
 
+        cb_acquisition_get_data(d) gets an Acquisition like acquisition_get_data(), plus
+        "d0s"; "t" and "d0s" are numpy arrays, not lists (d["t"].tolist() for the old type)
+
         args:
         : param  port="COM1"
         : param  cb_uclog_log = None,
         : param  cb_uclog_cmdres = None,
         : param  cb_uclog_plot = None,
         : param  cb_uclog_async = None,
+        : param  cb_pipeline_pressure = None, cb(info: dict) when pipeline_pressure() warning sets/clears
         : param  cb_uclog_adc = None,
         : param  logger
+        : param  decode_workers = 0, decode the frame batches on N native threads before
+                 they reach Python (ADC frames arrive decoded), see decode_stats()
+        : param  history = None, True or [(rate_hz, seconds), ...] keeps decimated min/max/mean
+                 histories of i/isnk from the start, see history_config()
+        : param  plot = None, True or {"channels", "points", "forward"} decodes the debug plotter
+                 stream natively from the start, see plot_config()
+        : param  memory_budget = None, bytes this device may hold, the sample ring and the
+                 configurations below are scaled down to fit, see memory_budget()
 
         """
+        self.logger = kw.get('logger', StubLogger())
+        self._memory_budget = kw.pop('memory_budget', None)
+        self._memory_degraded = {}
+        kw = self._memory_fit_stream(kw)
         super(P1150, self).__init__(**kw)
         self._lock = Lock()
         self._lock_stream = Lock()
@@ -546,12 +974,18 @@ class P1150(UCLogger):
 
         self._cb_uclog_adc = self.adc_stream_in
         self.cb_acquisition_get_data = cb_acquisition_get_data
+        self._pipeline_counters["acquisitions"] = 0
 
         self._buffered_adc_frame_count = None
         self._acquire = False
         self._acquire_mode = P1150API.ACQUIRE_MODE_RUN
         self._acquire_triggered = Event()
         self._acquire_datardy = Event()
+        self._acquire_stamp = {"sample0": None, "t0_unix_ns": None}
+        self._derived_cfg = None
+        self._vout_mv = None
+        self._mask_tests = 0
+        self._control_fired = 0
         self._trigger_level = 1
         self._trigger_pos = P1150API.TRIG_POS_CENTER
         self._trigger_slope = P1150API.TRIG_SLOPE_RISE
@@ -593,6 +1027,21 @@ class P1150(UCLogger):
             "len": 0  # track current fill level
         }
 
+        with _devices_lock:
+            _devices.add(self)
+
+        history = kw.get('history', None)
+        if history and self.connected:
+            success, result = self.history_config(None if history is True else history)
+            if not success:
+                self.logger.error(f"history: {result['ERROR']}")
+
+        plot = kw.get('plot', None)
+        if plot and self.connected:
+            success, result = self.plot_config(**({} if plot is True else plot))
+            if not success:
+                self.logger.error(f"plot: {result['ERROR']}")
+
     def adc_stream_in(self, item) -> None:
         if not self._acquire:
             return
@@ -611,9 +1060,11 @@ class P1150(UCLogger):
           to the buffer, and the trigger setup/condition is checked.
 
         Performance
-        - when collecting samples, function takes ~30 usec
+        - per stage timing (digital, append, trigger, snapshot, callback) is
+          recorded when enabled, see pipeline_stats()
         """
-        #start = timer()
+        st = self._stage_stats if self._stage_timing else None
+        if st: t0 = perf_counter_ns()
 
         # extract d0/1 from the byte of d01 using batch operations and local bindings
         d01 = item['d01']
@@ -623,11 +1074,15 @@ class P1150(UCLogger):
         # Vectorized digital channel calculation
         item["d0"] = (d01 & 0x1) * d0_vh + d0_vl
         item["d1"] = ((d01 >> 1) & 0x1) * d1_vh + d1_vl
+        if st: t0 = st.add(PipelineStats.DIGITAL, t0)
 
-        def _append_and_trigger(item: dict, trig_src: str, level: float | int | str, slope: str) -> None:
+        def _append_and_trigger(item: dict, trig_src: str, level: float | int | str, slope: str,
+                                start: int) -> int:
             """ Append data and trigger
             - self._adc is a fixed length deque, the length of the queue
               is set for one full timebase
+            - samples before start were already appended by the initial fill
+            - returns the samples of item now in the buffer, the last one ends it
             """
             adc = self._adc
             li, la0, ld0, ld1, lisnk = item['i'], item['a0'], item['d0'], item['d1'], item['isnk']
@@ -643,7 +1098,8 @@ class P1150(UCLogger):
 
             # Process samples one-by-one to maintain perfect alignment
             n = len(li)
-            for i in range(n):
+            used = n
+            for i in range(start, n):
                 # Slice the arrays to shift left by 1 without full np.roll
                 for key in ["i", "a0", "d0", "d1", "isnk"]:
                     adc[key][:-1] = adc[key][1:]
@@ -665,19 +1121,23 @@ class P1150(UCLogger):
                             if val < level_num: precond = True
                         elif val > level_num:
                             triggered_event.set()
+                            used = i + 1
                             break
                     else:  # slope == P1150API.TRIG_SLOPE_FALL:
                         if not precond:
                             if val > level_num: precond = True
                         elif val < level_num:
                             triggered_event.set()
+                            used = i + 1
                             break
                 elif isinstance(level_num, str):
                     if val == level_num:
                         triggered_event.set()
+                        used = i + 1
                         break
 
             self._trigger_idx_precond = precond
+            return used
 
         if self._acquire_datardy.is_set():
             # Buffer new data into _adc_buf if GUI hasn't picked up previous trigger
@@ -695,9 +1155,12 @@ class P1150(UCLogger):
                 self.logger.error(f"adc frame count {item['c']}")
             self._buffered_adc_frame_count = item['c'] + 1
 
+            if st: st.add(PipelineStats.APPEND, t0)
             return
 
+        appended = False
         if self._adc_buf['len'] > 0:
+            appended = True
             # Consume buffered data
             n = self._adc_buf['len']
             for key in ["i", "a0", "d0", "d1", "isnk"]:
@@ -712,8 +1175,12 @@ class P1150(UCLogger):
             self.logger.warning(f"adc frame count {item['c']}")
         self._buffered_adc_frame_count = item['c'] + 1
 
+        # samples of this frame in the buffer, the last one ends it (see _acquisition_stamp())
+        used = 0
+
         # fill up the buffer initial state
         if self._adc["fill"] < self.NUM_SAMPLES:
+            appended = True
             n = len(item['i'])
             cur = self._adc["fill"]
             end = min(cur + n, self.NUM_SAMPLES)
@@ -723,10 +1190,14 @@ class P1150(UCLogger):
                 self._adc[key][cur:end] = item[key][:take]
             self._adc["d0s"][cur:end] = item["d0s"][:take]
             self._adc["fill"] = end
+            used = take
 
             if self._adc["fill"] < self.NUM_SAMPLES:
+                if st: st.add(PipelineStats.APPEND, t0)
                 return
 
+        if st and appended: t0 = st.add(PipelineStats.APPEND, t0)
+
         # At this point there is a full buffer of data representing the TIMEBASE setting
         #self.logger.info(f"self._adc len {len(self._adc['i'])}, mode {self._acquire_mode}, _acquire_triggered {self._acquire_triggered.is_set()}")
 
@@ -739,7 +1210,9 @@ class P1150(UCLogger):
                 # trigger detection on each incoming batch of 50 samples
                 if not self._acquire_triggered.is_set():
                     src = self._trig_src_map[self._trigger_src]
-                    _append_and_trigger(item, src, self._trigger_level, self._trigger_slope)
+                    if st: t0 = perf_counter_ns()
+                    used = _append_and_trigger(item, src, self._trigger_level, self._trigger_slope, used)
+                    if st: st.add(PipelineStats.TRIGGER, t0)
 
             if self._acquire_triggered.is_set():
                 # fill in time values
@@ -767,24 +1240,40 @@ class P1150(UCLogger):
         if self._acquire_triggered.is_set() and not self._acquire_datardy.is_set():
             self._acquire_datardy.set()
             self._trigger_idx_precond = False
+            self._pipeline_counters["acquisitions"] += 1
+            self._acquire_stamp = self._acquisition_stamp(item['c'], used)
 
             if self.cb_acquisition_get_data:
-                d = {"t": [*self._adc["t"]],
-                     "i": self._adc["i"].copy(),
-                     "a0": self._adc["a0"].copy(),
-                     "d0": self._adc["d0"].copy(),
-                     "d0s": self._adc["d0s"].copy(),
-                     "d1": self._adc["d1"].copy(),
-                     "isnk": self._adc["isnk"].copy()}
+                if st: t0 = perf_counter_ns()
+                d = Acquisition.pack({c: self._adc[c] for c in Acquisition.COLUMNS + ("d0s",)},
+                                     self._acquire_stamp, self._derived_params())
+                if self._derived_cfg and self._derived_cfg["eager"]: d.compute()
+                if st: t0 = st.add(PipelineStats.SNAPSHOT, t0)
 
                 self.cb_acquisition_get_data(d)
+                if st: st.add(PipelineStats.CALLBACK, t0)
                 self._event_clear_datardy()
 
-        #delta = timer() - start
-        #self.logger.info(f"transfered {delta:0.6f}")
+    def _acquisition_stamp(self, c: int, used: int) -> dict:
+        """ Absolute sample index and host time of the first acquisition sample, the
+            buffer ends with sample used - 1 of frame c (0: with the frame before it) """
+        msm = self._serial_manager()
+        fr = msm.sample_clock_frame(c) if msm is not None else None
+        if fr is None:
+            return {"sample0": None, "t0_unix_ns": None}
+        sample0 = fr[0] + used - self.NUM_SAMPLES
+        return {"sample0": sample0, "t0_unix_ns": msm.sample_to_unix_ns(sample0)}
+
+    def _derived_params(self) -> dict | None:
+        """ mp_serial.derive() arguments for the next acquisition, VOUT as set now """
+        cfg = self._derived_cfg
+        if not cfg:
+            return None
+        vout_mv = cfg["vout_mv"] if cfg["vout_mv"] is not None else self._vout_mv
+        return {"channels": cfg["channels"], "vout_v": (vout_mv or 0) / 1000.0,
+                "a0_gain": cfg["a0_gain"], "a0_offset": cfg["a0_offset"], "dt": 1.0 / self.ADC_SAMPLE_RATE}
 
     def _event_clear_datardy(self) -> None:
-        # takes ~11 usec
         self.NUM_SAMPLES = int(self.ADC_SAMPLE_RATE * self._timebase_span)
 
         self._adc = {
@@ -905,7 +1394,10 @@ class P1150(UCLogger):
         """
         with self._lock:
             payload = {"f": "cmd_vout", "mv": value_mv}  # in mV
-            return self.uclog_response(payload)
+            success, result = self.uclog_response(payload)
+            if success:
+                self._vout_mv = value_mv
+            return success, result
 
     def set_vout_remote_sense(self, en: bool=False) -> tuple[bool, list[dict] | None]:
         """ Enable/Disable Pseudo Remote Sense on VOUT
@@ -930,15 +1422,19 @@ class P1150(UCLogger):
     def set_timebase(self, span: str) -> tuple[bool, list[dict] | None]:
         """ Set Timebase
 
+        - under a memory budget (memory_budget()) the longest span whose acquisition buffers
+          fit is used instead, result {"span", "degraded"}
+
         :param span: <one of TBASE_SPAN_LIST>
         :return:  success <True/False>, result <json/None>
         """
         with self._lock_stream:
+            span, degraded = self._memory_fit_timebase(span)
             self._timebase_span = self.TBASE_MAP[span]
             # abort the current acquisition
             self._event_clear_datardy()
             self._set_trigger_idx()
-            return True, None
+            return True, {"span": span, "degraded": degraded} if degraded else None
 
     def set_trigger(self,
                     src: str=P1150API.TRIG_SRC_NONE,
@@ -1060,6 +1556,11 @@ class P1150(UCLogger):
 
         NOTE: The returned data must be of deepcopy type,as the
               adc buffer is needed here for the next acquisition
+        NOTE: the columns are numpy views into one packed block (see Acquisition).  In the
+              cb_acquisition_get_data dict "t" used to be a list and "d0s" a list of str,
+              they are now a float64 array and a <U1 array: index/slice/compare them as
+              arrays (== is elementwise), d["t"].tolist() / d["d0s"].tolist() give the
+              old lists
 
         :return: success <True/False>, result <json/None>
         """
@@ -1070,21 +1571,1027 @@ class P1150(UCLogger):
             self.logger.error("No data to get")
             return False, {"ERROR": "No data to get"}
 
-        # Return copies of the numpy arrays
-        d = {
-            "t": self._adc["t"].copy(),
-            "i": self._adc["i"].copy(),
-            "a0": self._adc["a0"].copy(),
-            "d0": self._adc["d0"].copy(),
-            "d1": self._adc["d1"].copy(),
-            "isnk": self._adc["isnk"].copy()
-        }
+        # Return copies of the numpy arrays, one columnar block
+        d = Acquisition.pack({c: self._adc[c] for c in Acquisition.COLUMNS},
+                             self._acquire_stamp, self._derived_params())
+        if self._derived_cfg and self._derived_cfg["eager"]: d.compute()
 
         self._event_clear_datardy()
         #delta = timer() - self._tmr_start
         #self.logger.info(f"{delta}")
         return True, d
 
+    DIGITAL_LINES = {"d0": 0, "d1": 1}
+
+    def _digital(self, ch: str):
+        """ (serial manager, line) for "d0"/"d1", raises ValueError/RuntimeError """
+        if ch not in self.DIGITAL_LINES:
+            raise ValueError(f"ch must be one of {list(self.DIGITAL_LINES)}")
+        msm = self._serial_manager()
+        if msm is None:
+            raise RuntimeError("not connected")
+        return msm, self.DIGITAL_LINES[ch]
+
+    def digital_info(self) -> tuple[bool, dict]:
+        """ D0/D1 edge storage state
+        - "samples" is the current stream sample index (125 kS/s since connect), all
+          digital_* methods take and return stream sample indexes
+        - bits are retained for the last "bits_capacity" samples (digital_log2 kw,
+          default 2**23 ~67 s), edges for the last "edges_capacity" edges per line
+
+        :return: success <True/False>, {"samples", "oldest", "bits_capacity", "edges_capacity",
+                                       "edges": (d0, d1), "state": (d0, d1) or None}
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        return True, msm.digital_info()
+
+    def digital_edges(self, ch: str, start: int = 0, end: int | None = None) -> tuple[bool, dict]:
+        """ D0/D1 transitions in [start, end), cost proportional to the edge count
+
+        :param ch: "d0" or "d1"
+        :return: success <True/False>, {"index": uint64 array, "state": uint8 array (new state)}
+        """
+        try:
+            msm, line = self._digital(ch)
+            idx, st = msm.digital_edges(line, start, end)
+        except (RuntimeError, ValueError) as e:
+            return False, {"ERROR": str(e)}
+        return True, {"index": idx, "state": st}
+
+    def digital_find_edge(self, ch: str, start: int, slope: str = P1150API.TRIG_SLOPE_RISE) -> tuple[bool, dict]:
+        """ Trigger lookup: first D0/D1 edge at/after a stream sample index
+
+        :param ch: "d0" or "d1"
+        :param slope: TRIG_SLOPE_RISE/FALL/EITHER
+        :return: success <True/False>, {"index": <int>, "state": <0/1>} or {"index": None}
+        """
+        slopes = {P1150API.TRIG_SLOPE_RISE: 1, P1150API.TRIG_SLOPE_FALL: -1, P1150API.TRIG_SLOPE_EITHER: 0}
+        if slope not in slopes:
+            return False, {"ERROR": f"slope must be one of {P1150API.TRIG_SLOPE_LIST}"}
+        try:
+            msm, line = self._digital(ch)
+            e = msm.digital_find_edge(line, start, slopes[slope])
+        except (RuntimeError, ValueError) as e:
+            return False, {"ERROR": str(e)}
+        if e is None:
+            return True, {"index": None}
+        return True, {"index": e[0], "state": e[1]}
+
+    def digital_steps(self, ch: str, start: int, end: int) -> tuple[bool, dict]:
+        """ Plot ready D0/D1 step outline of [start, end), built from edges on demand
+        - y uses the same levels as acquisition data (D0/D1 VLOW/VHIGH)
+
+        :return: success <True/False>, {"x": sample index array, "y": level array}
+        """
+        try:
+            msm, line = self._digital(ch)
+        except (RuntimeError, ValueError) as e:
+            return False, {"ERROR": str(e)}
+        vlow, vhigh = (self.D0_VLOW, self.D0_VHIGH) if line == 0 else (self.D1_VLOW, self.D1_VHIGH)
+        x, y = msm.digital_steps(line, start, end, vlow, vhigh)
+        return True, {"x": x, "y": y}
+
+    def gated_config(self, ch: str = "d0", active: int = 1, source: str = "i",
+                     min_samples: int = 1) -> tuple[bool, dict]:
+        """ Configure D0/D1 gated current statistics, clears all results
+        - every ADC sample is accumulated natively per D0/D1 state, and into the
+          current pulse while the gate line ch is at the active level
+
+        :param ch: gate line "d0" or "d1"
+        :param active: level that marks a pulse, 1 high / 0 low
+        :param source: "i", "isnk" or "net" (i - isnk)
+        :param min_samples: shorter pulses are counted as glitches, not reported
+        :return: success <True/False>, active configuration
+        """
+        try:
+            msm, line = self._digital(ch)
+            return True, msm.gated_config(line=line, active=active, source=source, min_samples=min_samples)
+        except (RuntimeError, ValueError) as e:
+            return False, {"ERROR": str(e)}
+
+    def gated_stats(self, reset: bool = False) -> tuple[bool, dict]:
+        """ Current statistics per D0/D1 state since gated_config()/last reset
+        - "d0"/"d1": {"low", "high"}, "states": by d01 value 0..3, "open": pulse in progress
+        - each: {"samples", "charge_uc", "mean_ma", "rms_ma", "peak_ma", "min_ma"}
+
+        :param reset: clear results after reading
+        :return: success <True/False>, dict
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        return True, msm.gated_stats(reset)
+
+    def gated_pulses(self, since: int = 0) -> tuple[bool, dict]:
+        """ Completed pulses, incrementally: pass the returned "next" as since
+
+        :return: success <True/False>, {"next": <int>, "pulses": structured array
+                 (number, start, n, charge_uc, mean_ma, peak_ma, min_ma)}
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        nxt, pulses = msm.gated_pulses(since)
+        return True, {"next": nxt, "pulses": pulses}
+
+    def current_hist(self, ch: str = "i", window_s: float = 0.0) -> tuple[bool, dict]:
+        """ Distribution of the current, counted natively for every sample
+        - 20 log bins per decade from 1 nA to 10 A, no samples are stored,
+          time spent in a bin is count / ADC_SAMPLE_RATE
+
+        :param ch: "i" or "isnk"
+        :param window_s: 0 for everything since current_hist_reset(), else the last window_s seconds
+        :return: success <True/False>, {"counts", "edges_ma", "ccdf", "underflow", "overflow",
+                                       "samples", "seconds", ...}
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        try:
+            return True, msm.current_hist(ch, window_s, ccdf=True)
+        except ValueError as e:
+            return False, {"ERROR": str(e)}
+
+    def history_config(self, levels: list[tuple[float, float]] | None = None) -> tuple[bool, dict]:
+        """ Multi-rate history of i/isnk, kept natively from now on without a recorder
+        - the full rate short-term history is the sample ring (sample_ring_log2), on top of it
+          each level is a preallocated ring of min/max/mean blocks (16 bytes each), built
+          incrementally from the level before
+        - levels [(rate_hz, seconds), ...] (max 4, each rate dividing the one before, which
+          must divide ADC_SAMPLE_RATE), default HISTORY_LEVELS: 1 kS/s for 1 h, 10 S/s for 3 days
+          (about 100 MB); [] turns the history off
+        - under a memory budget all spans are shortened alike to fit, "degraded" in the result
+
+        :return: success <True/False>, {"bytes", "samples", "levels": [{"rate_hz", "span_s", "done", ...}]}
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        if levels is None:
+            levels = self.HISTORY_LEVELS
+        try:
+            native = []
+            for rate_hz, seconds in levels:
+                decim = round(self.ADC_SAMPLE_RATE / rate_hz)
+                if decim < 1 or abs(self.ADC_SAMPLE_RATE / decim - rate_hz) > 1e-9 * rate_hz:
+                    raise ValueError(f"history rate {rate_hz} Hz must divide {self.ADC_SAMPLE_RATE}")
+                native.append((decim, max(1, math.ceil(seconds * rate_hz))))
+            native, degraded = self._memory_fit_history(msm, native)
+            result = msm.history_config(native)
+            if degraded: result["degraded"] = degraded
+            return True, result
+        except (MemoryError, TypeError, ValueError) as e:
+            return False, {"ERROR": str(e)}
+
+    def history(self, level: int = 0, last_s: float | None = None, since: int | None = None) -> tuple[bool, dict]:
+        """ Look back across the run in a decimated history level (see history_config())
+
+        :param level: index into the configured levels, 0 is the fastest
+        :param last_s: only the newest last_s seconds, None everything retained
+        :param since: block number to continue from (the "next" of the previous call), overrides last_s
+        :return: success <True/False>, {"rate_hz", "t_s": block start, seconds on the stream axis,
+                 "blocks": structured array (i_mean, i_min, i_max, isnk_mean) mA, "first", "next"}
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        try:
+            info = msm.history_info()
+            if not 0 <= level < len(info["levels"]):
+                raise ValueError(f"history level {level} not configured, see history_config()")
+            lv = info["levels"][level]
+            if since is None and last_s is not None:
+                since = max(0, lv["done"] - math.ceil(last_s * lv["rate_hz"]))
+            elif since is None:
+                since = 0
+            first, blocks = msm.history_read(level, since, lv["capacity"])
+        except (TypeError, ValueError) as e:
+            return False, {"ERROR": str(e)}
+        seq = info["base"] + (first + np.arange(len(blocks), dtype=np.uint64)) * lv["decim"]
+        return True, {"rate_hz": lv["rate_hz"], "t_s": seq / self.ADC_SAMPLE_RATE, "blocks": blocks,
+                      "first": first, "next": first + len(blocks)}
+
+    def plot_config(self, channels: int = 16, points: int = 65536, forward: bool | None = None) -> tuple[bool, dict]:
+        """ Decode the firmware debug plotter stream (port 2) natively into named channels
+        - every item ({name: number | [numbers] | <f4 bytes>, ...}) is decoded by the reader
+          thread into a preallocated ring of points per name, bound on first sight, stamped
+          on the stream sample axis of the ADC channels (samples sent together are spread
+          over the time since the channel's previous item)
+        - forward=False (default unless cb_uclog_plot is set) keeps the items away from Python
+          altogether, _uclog_plot() / cb_uclog_plot are not called
+        - channels=0 turns it off, a new configuration drops all points
+        - under a memory budget fewer points per channel are kept, "degraded" in the result
+
+        :return: success <True/False>, plot_channels() dict
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        if forward is None:
+            forward = self._cb_uclog_plot is not None
+        try:
+            points, degraded = self._memory_fit_plot(msm, channels, points)
+            result = msm.plot_config(channels, points, forward)
+            if degraded: result["degraded"] = degraded
+            return True, result
+        except (MemoryError, OverflowError, TypeError, ValueError) as e:
+            return False, {"ERROR": str(e)}
+
+    def plot_channels(self) -> tuple[bool, dict]:
+        """ {"items", "errors", "unbound" (samples of names beyond the channels), "bytes",
+             "channels": [{"name", "points", "items", "last_seq"}]} """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        return True, msm.plot_info()
+
+    def plot_get(self, name: str, last_s: float | None = None, since: int | None = None) -> tuple[bool, dict]:
+        """ Points of a debug plotter channel (see plot_config())
+
+        :param last_s: only the points of the newest last_s seconds of the stream, None everything retained
+        :param since: point number to continue from (the "next" of the previous call), overrides last_s
+        :return: success <True/False>, {"t_s": seconds on the stream axis (as history()), "value",
+                 "item": port 2 item number, "first", "next"}
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        try:
+            info = msm.plot_info()
+            first, pts = msm.plot_read(name, since if since is not None else 0, info["capacity"])
+        except (KeyError, TypeError, ValueError) as e:
+            return False, {"ERROR": str(e)}
+        if since is None and last_s is not None and len(pts):
+            k = int(np.searchsorted(pts["seq"], int(pts["seq"][-1]) - int(last_s * self.ADC_SAMPLE_RATE)))
+            first, pts = first + k, pts[k:]
+        return True, {"t_s": pts["seq"] / self.ADC_SAMPLE_RATE, "value": pts["value"], "item": pts["item"],
+                      "first": first, "next": first + len(pts)}
+
+    def plot_lod(self, names: list[str] | None = None, t0_s: float | None = None, t1_s: float | None = None,
+                 buckets: int = 1000) -> tuple[bool, dict]:
+        """ Level of detail of debug plotter channels for drawing: min/max/mean per bucket, computed
+            natively over the retained points, on the stream axis of history() and the ADC channels
+
+        :param names: channels, None all
+        :param t0_s: start on the stream axis, None the oldest retained point
+        :param t1_s: end, None the newest sample of the stream
+        :return: success <True/False>, {"t_s": bucket starts, name: structured array (min, max, mean, n)}
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        rate = self.ADC_SAMPLE_RATE
+        try:
+            if names is None:
+                names = [c["name"] for c in msm.plot_info()["channels"]]
+            if t0_s is None:
+                heads = [msm.plot_read(n, 0, 1)[1]["seq"] for n in names]
+                seq0 = min((int(h[0]) for h in heads if len(h)), default=0)
+            else:
+                seq0 = int(t0_s * rate)
+            seq1 = int(t1_s * rate) if t1_s is not None else msm.plot_info()["stream_samples"] + 1
+            seq1 = max(seq1, seq0 + buckets)
+            res = {"t_s": (seq0 + (seq1 - seq0) * np.arange(buckets) / buckets) / rate}
+            for n in names:
+                res[n] = msm.plot_lod(n, seq0, seq1, buckets)[1]
+        except (KeyError, TypeError, ValueError) as e:
+            return False, {"ERROR": str(e)}
+        return True, res
+
+    def segment_config(self, **kw) -> tuple[bool, dict]:
+        """ Configure and restart the native power state segmentation of i
+        - block means (block samples, default 25 = 200 us) are compared in log10 by a
+          two sided CUSUM against the open segment mean, a change is declared when it
+          exceeds h decades (default 1.0) with k decades (default 0.05) drift allowance
+        - floor_ma (default 1e-4) clamps the noise floor, min_blocks (default 4)
+          is the shortest segment before changes are tested
+
+        :return: success <True/False>, active configuration
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        try:
+            return True, msm.segment_config(**kw)
+        except (TypeError, ValueError) as e:
+            return False, {"ERROR": str(e)}
+
+    def segments(self, since: int = 0) -> tuple[bool, dict]:
+        """ Power state segments closed so far, incrementally: pass the returned "next" as since
+        - the last 16384 segments are retained
+
+        :return: success <True/False>, {"next": <int>, "segments": structured array
+                 (number, start, n, charge_uc, mean_ma, peak_ma, min_ma), "open": dict or None}
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        nxt, segs = msm.segments(since)
+        return True, {"next": nxt, "segments": segs, "open": msm.segment_info()["open"]}
+
+    def recorder_start(self, path: str, triggers: list[dict], pre_s: float = 0.1, post_s: float = 0.1,
+                       background_hz: float = 10.0) -> tuple[bool, dict]:
+        """ Event-triggered recording for long soak tests
+        - a native thread evaluates the triggers at full rate on the sample ring and writes
+          only [trigger - pre_s, trigger + post_s) windows plus a decimated background
+          (i min/max/mean, isnk mean) to path, read it back with mp_serial.read_recording()
+        - pre_s + post_s must fit in half the sample ring (sample_ring_log2); under a memory
+          budget both are shortened alike to fit, "degraded" in the result
+
+        :param triggers: OR-ed list (max 8) of {"src": "i"/"isnk", "level": <mA>, "slope": TRIG_SLOPE_*},
+                         {"src": "d0"/"d1", "slope": TRIG_SLOPE_*} or {"src": "d0s", "level": <char>}
+        :return: success <True/False>, recorder_info() dict
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        try:
+            native = [self._native_trigger(t) for t in triggers]
+            rate = self.ADC_SAMPLE_RATE
+            pre, post, degraded = self._memory_fit_recorder(msm, int(pre_s * rate), int(post_s * rate))
+            result = msm.recorder_start(path, native, pre, post, max(1, int(rate / background_hz)))
+            if degraded: result["degraded"] = degraded
+            return True, result
+        except (KeyError, OSError, RuntimeError, TypeError, ValueError) as e:
+            return False, {"ERROR": str(e)}
+
+    def recording_search(self, path: str, triggers: list[dict], context_s: float = 0.0, workers: int = 0,
+                         background: bool = False, max_hits: int = 0) -> tuple[bool, dict]:
+        """ Offline trigger search over a file written by recorder_start(), no device needed
+        - native and chunk-parallel over the mapped file, each trigger is followed on its own with
+          the recorder's semantics and every crossing/edge/character start is a hit
+        - background=True also searches the decimated background between events (i triggers,
+          block resolution, flagged mp_serial.SEARCH_HIT_BACKGROUND)
+
+        :param triggers: list (max 8) in the recorder_start() format
+        :param context_s: adds [hit - context_s, hit + context_s) of each hit's event window
+        :param workers: threads, 0 one per CPU
+        :param max_hits: keep the first max_hits hits, 0 all
+        :return: success <True/False>, {"hits": structured array (seq, event, chunk, index, n, trigger, flags,
+                 value), "t_s": seconds from the start of the recording per hit, "context": dict of 2-D arrays
+                 or None, "stats": dict}
+        """
+        try:
+            native = [self._native_trigger(t) for t in triggers]
+            ctx = int(context_s * self.ADC_SAMPLE_RATE)
+            res = mp_serial.search_recording(path, native, pre=ctx, post=ctx, workers=workers,
+                                             background=background, max_hits=max_hits)
+        except (KeyError, OSError, TypeError, ValueError) as e:
+            return False, {"ERROR": str(e)}
+        hits = res["hits"]
+        t_s = (hits["seq"] - np.uint64(res["start_seq"])).astype(np.float64) / res["sample_rate"]
+        return True, {"hits": hits, "t_s": t_s, "context": res["context"], "stats": res["stats"]}
+
+    def _native_trigger(self, t: dict) -> dict:
+        """ {"src", "level", "slope": TRIG_SLOPE_*} as a mp_serial trigger dict, raises KeyError/ValueError """
+        slopes = {P1150API.TRIG_SLOPE_RISE: 1, P1150API.TRIG_SLOPE_FALL: -1, P1150API.TRIG_SLOPE_EITHER: 0}
+        src, slope = t.get("src"), slopes[t.get("slope", P1150API.TRIG_SLOPE_RISE)]
+        if src in ("i", "isnk"):
+            return {"kind": "current", "source": src, "level_ma": t["level"], "slope": slope}
+        if src in self.DIGITAL_LINES:
+            return {"kind": "digital", "line": self.DIGITAL_LINES[src], "slope": slope}
+        if src == "d0s":
+            return {"kind": "d0s", "char": t["level"]}
+        raise ValueError(f"unknown trigger src {src!r}")
+
+    def recorder_stop(self) -> tuple[bool, dict]:
+        """ Flush and close the recording, returns the final recorder_info() """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        return True, msm.recorder_stop()
+
+    def recorder_info(self) -> tuple[bool, dict]:
+        """ {"running", "pending", "events", "truncated", "bg_blocks", "bytes", "lost", "error", ...} """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        return True, msm.recorder_info()
+
+    def sequence_start(self, triggers: list[dict], pre_s: float = 0.001, post_s: float = 0.009,
+                       segments: int = 100, continuous: bool = False) -> tuple[bool, dict]:
+        """ Segmented memory capture for high trigger rates
+        - a native thread evaluates the triggers at full rate on the sample ring and copies the
+          [trigger - pre_s, trigger + post_s) window of each into the next slot of one preallocated
+          sequence, re-armed at the end of the window: no callback, buffer refill or allocation
+          between segments, so the trigger rate is only limited by the window length
+        - the sequence is taken as one object with sequence_get(); continuous=True keeps capturing
+          into a second preallocated sequence meanwhile (triggers while both are full are counted
+          as "missed")
+        - pre_s + post_s must fit in half the sample ring (sample_ring_log2); under a memory
+          budget fewer segments are taken per sequence, "degraded" in the result
+
+        :param triggers: OR-ed list (max 8) in the recorder_start() format
+        :return: success <True/False>, sequence_info() dict
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        try:
+            native = [self._native_trigger(t) for t in triggers]
+            rate = self.ADC_SAMPLE_RATE
+            pre, post = int(pre_s * rate), int(post_s * rate)
+            segments, degraded = self._memory_fit_sequence(msm, pre, post, segments, continuous)
+            result = msm.seqcap_start(native, pre, post, segments, continuous)
+            if degraded: result["degraded"] = degraded
+            return True, result
+        except (KeyError, MemoryError, RuntimeError, TypeError, ValueError) as e:
+            return False, {"ERROR": str(e)}
+
+    def sequence_get(self, timeout_s: float = 0.0) -> tuple[bool, dict]:
+        """ The oldest completed sequence (a partly filled one after sequence_stop())
+
+        :param timeout_s: wait up to this long for one
+        :return: success <True/False>, {"number", "t_s": (pre + post,) seconds from the trigger,
+                 "i", "isnk" (mA), "a0", "d01", "d0s" as (segments, pre + post) arrays,
+                 "seg": structured array (trigger_seq, host_ns, number, trigger, flags, reserved),
+                 "trigger_unix_ns": per segment, sample clock time of the trigger (host time when
+                 the trigger was seen before the clock is valid)}
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        d = msm.seqcap_take(int(timeout_s * 1000))
+        if d is None:
+            return False, {"ERROR": "no sequence ready"}
+        d["t_s"] = (np.arange(d["pre"] + d["post"]) - d["pre"]) / self.ADC_SAMPLE_RATE
+        ck = msm.sample_clock()
+        if ck["valid"]:
+            idx = np.array([msm.stream_to_abs(int(k)) for k in d["seg"]["trigger_seq"]], dtype=np.int64)
+            d["trigger_unix_ns"] = msm.sample_to_unix_ns(idx, ck)
+        else:
+            d["trigger_unix_ns"] = d["seg"]["host_ns"].astype(np.int64)
+        return True, d
+
+    def sequence_stop(self) -> tuple[bool, dict]:
+        """ Stop capturing, returns the final sequence_info() """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        return True, msm.seqcap_stop()
+
+    def sequence_info(self) -> tuple[bool, dict]:
+        """ {"running", "armed", "segments", "sequences", "ready", "fill", "missed", "truncated",
+             "lost", "min_interval", "segments_per_s", "busy_s", ...} """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        return True, msm.seqcap_info()
+
+    def mask_config(self, rules: list[dict], trigger: dict | None = None) -> tuple[bool, dict | None]:
+        """ Pass/fail mask test, evaluated natively on every frame as it arrives
+        - the first violation fails the test at once (early abort), it passes as soon as
+          the last rule window has closed; no acquisition or copy is involved
+        - rule windows are relative to the trigger, t0 may be negative (pre-trigger)
+
+        :param rules: up to 32 of {"type": "envelope"/"mean"/"peak"/"min"/"charge",
+                      "src": "i"/"isnk"/"net", "t0": <s>, "t1": <s>, "lower": <mA|uC>, "upper": <mA|uC>},
+                      "envelope" limits every sample, several build a piecewise mask,
+                      a missing limit is not checked
+        :param trigger: {"src": "i"/"isnk", "level": <mA>, "slope": TRIG_SLOPE_*}, {"src": "d0"/"d1", "slope"}
+                        or {"src": "d0s", "level": <char>}; None starts at mask_arm()
+        :return: success <True/False>, None or {"ERROR"}
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        rate = self.ADC_SAMPLE_RATE
+        try:
+            native = [{"kind": ru["type"], "source": ru.get("src", "i"),
+                       "start": int(round(ru["t0"] * rate)), "end": int(round(ru["t1"] * rate)),
+                       "lower": ru.get("lower"), "upper": ru.get("upper")} for ru in rules]
+            msm.mask_config(native, self._native_trigger(trigger) if trigger else None)
+        except (KeyError, TypeError, ValueError) as e:
+            return False, {"ERROR": str(e)}
+        return True, None
+
+    def mask_arm(self, repeat: bool = False) -> tuple[bool, dict | None]:
+        """ Arm the mask test; with repeat it re-arms after every verdict (production line) """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        try:
+            self._mask_tests = msm.mask_status()["tests"]
+            msm.mask_arm(repeat)
+        except RuntimeError as e:
+            return False, {"ERROR": str(e)}
+        return True, None
+
+    def mask_disarm(self) -> tuple[bool, dict | None]:
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        msm.mask_disarm()
+        return True, None
+
+    def mask_wait(self, timeout: float = 10.0) -> tuple[bool, dict]:
+        """ Wait for the next verdict since mask_arm() / the previous mask_wait()
+
+        :return: success <True/False>, {"pass": bool, "rule": <failing rule or -1>, "at_s": <s after trigger>,
+                 "value": <failing value>, "trigger": <stream sample index>, "latency_ms": <trigger to verdict>}
+                 or {"ERROR"} on timeout
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        after = self._mask_tests
+        if msm.mask_wait(after, timeout) <= after:
+            return False, {"ERROR": "no verdict"}
+        _, v = msm.mask_verdicts(after, 1)
+        if not len(v):
+            return False, {"ERROR": "verdict overwritten"}
+        v = v[0]
+        self._mask_tests = after + 1
+        return True, {"pass": bool(v["pass"]), "rule": int(v["rule"]), "at_s": int(v["at"]) / self.ADC_SAMPLE_RATE,
+                      "value": float(v["value"]), "trigger": int(v["trigger"]),
+                      "latency_ms": int(v["latency_ns"]) / 1e6}
+
+    def mask_status(self) -> tuple[bool, dict]:
+        """ {"state", "tests", "passed", "failed", "rules": [{"n", "mean", "peak", "min", "charge_uc"}], ...} """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        return True, msm.mask_status()
+
+    def control_config(self, rules: list[dict]) -> tuple[bool, dict | None]:
+        """ Closed-loop control: react to the measured current within a millisecond
+        - rules are evaluated natively on every sample as frames arrive, a rule that fires
+          writes its command (CBOR encoded and framed here, once) straight to the port from
+          the reader thread, no Python or uclog_response() round trip is involved
+        - the firmware response arrives as usual and is logged, nothing waits for it
+        - disarms, call control_arm() to start
+
+        :param rules: up to 16 of {"src": "i"/"isnk"/"net", "above"|"below": <mA>, "action": {"f": "cmd_*", ...},
+                      "hold_s": <condition must hold, default one sample>, "hysteresis": <mA>,
+                      "holdoff_s": <quiet time after firing>, "once": <bool>}
+                      or {"src": "d0"/"d1", "state": 0/1, "action": ...} for a digital line
+        :return: success <True/False>, None or {"ERROR"}
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        rate = self.ADC_SAMPLE_RATE
+        try:
+            native, payloads = [], []
+            for ru in rules:
+                src = ru.get("src", "i")
+                if src in self.DIGITAL_LINES:
+                    cond, level = ("above", 0.5) if ru.get("state", 1) else ("below", 0.5)
+                else:
+                    cond = "above" if "above" in ru else "below"
+                    level = ru[cond]
+                native.append({"source": src, "cond": cond, "level": level,
+                               "hold": max(1, int(round(ru.get("hold_s", 0.0) * rate))),
+                               "holdoff": int(round(ru.get("holdoff_s", 0.0) * rate)),
+                               "hysteresis": ru.get("hysteresis", 0.0), "once": ru.get("once", False)})
+                payloads.append(cbor2.dumps(ru["action"]))
+            msm.control_config(native, payloads)
+        except (KeyError, TypeError, ValueError, cbor2.CBOREncodeError) as e:
+            return False, {"ERROR": str(e)}
+        # the responses to the actions are expected, not stray
+        with self._lock_responses:
+            for ru in rules:
+                self._cmd_responses.setdefault(ru["action"].get("f"), [])
+        return True, None
+
+    def control_arm(self) -> tuple[bool, dict | None]:
+        """ Start evaluating the control rules, re-enables "once" rules that fired """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        try:
+            self._control_fired = msm.control_status()["fired"]
+            msm.control_arm()
+        except RuntimeError as e:
+            return False, {"ERROR": str(e)}
+        return True, None
+
+    def control_disarm(self) -> tuple[bool, dict | None]:
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        msm.control_disarm()
+        return True, None
+
+    def control_wait(self, timeout: float = 10.0) -> tuple[bool, dict]:
+        """ Wait for the next rule firing since control_arm() / the previous control_wait()
+
+        :return: success <True/False>, {"rule": <index>, "sample": <stream sample index>, "value": <mA or 0/1>,
+                 "written": bool, "detect_us": <frame arrival to decision>, "latency_us": <frame arrival to
+                 the command written>, "blocked": bool, "wait_us": <of latency_us, waiting for the TX writer
+                 or a full port>, "lag_us": <firmware batching after the sample>} or {"ERROR"} on timeout
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        after = self._control_fired
+        if msm.control_wait(after, timeout) <= after:
+            return False, {"ERROR": "no firing"}
+        _, ev = msm.control_events(after, 1)
+        if not len(ev):
+            return False, {"ERROR": "firing overwritten"}
+        e = ev[0]
+        self._control_fired = after + 1
+        return True, {"rule": int(e["rule"]), "sample": int(e["sample"]), "value": float(e["value"]),
+                      "written": int(e["rc"]) == 0, "detect_us": int(e["detect_ns"]) / 1e3,
+                      "latency_us": int(e["write_ns"]) / 1e3, "blocked": int(e["wait_ns"]) > 0,
+                      "wait_us": int(e["wait_ns"]) / 1e3, "lag_us": int(e["lag"]) * 1e6 / self.ADC_SAMPLE_RATE}
+
+    def control_status(self) -> tuple[bool, dict]:
+        """ {"armed", "fired", "failed", "blocked", "wait_max_us", "latency_min_us", "latency_mean_us",
+             "latency_max_us", "latency_p50_us", "latency_p99_us", "rules": [{"fired", "enabled"}]}
+        - latency is frame arrival to the command written to the port, percentiles over
+          the last 1024 firings
+        - blocked counts firings whose write waited for the TX writer or a full port
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        st = msm.control_status()
+        _, ev = msm.control_events(0)
+        w = ev["write_ns"][ev["rc"] == 0]
+        st["latency_p50_us"] = float(np.percentile(w, 50)) / 1e3 if len(w) else float("nan")
+        st["latency_p99_us"] = float(np.percentile(w, 99)) / 1e3 if len(w) else float("nan")
+        return True, st
+
+    def vout_sweep(self, mv: list[int], settle_s: float = 0.005, window_s: float = 0.02,
+                   ack_timeout_s: float = 0.5, wait: bool = True, timeout_s: float | None = None) -> tuple[bool, dict]:
+        """ VOUT sweep with a capture window per step, run natively on the stream
+        - the reader thread writes each step's cmd_vout the moment the previous step's window
+          closed, marks the stream sample index at which it was sent and at which the response
+          arrived, skips settle_s after the response and folds the next window_s of samples
+          into the step statistics: no set_vout()/acquisition round trip per step
+        - a step whose response does not come within ack_timeout_s is flagged (NOACK) and
+          measured from there
+        - the ADC stream must be running, it paces the sweep
+
+        :param mv: VOUT per step (max 65536 steps)
+        :param wait: block until the sweep is over, else return at once and use vout_sweep_status()
+        :param timeout_s: wait limit, default the worst case of all steps timing out
+        :return: success <True/False>, vout_sweep_result() dict (wait) or vout_sweep_status() dict
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        rate = self.ADC_SAMPLE_RATE
+        try:
+            payloads = [cbor2.dumps({"f": "cmd_vout", "mv": int(v)}) for v in mv]
+            with self._lock_responses:
+                # the responses are expected, not stray
+                self._cmd_responses.setdefault("cmd_vout", [])
+            st = msm.sweep_start(payloads, [int(v) for v in mv], int(round(settle_s * rate)),
+                                 max(1, int(round(window_s * rate))), max(1, int(round(ack_timeout_s * rate))))
+        except (MemoryError, TypeError, ValueError, OverflowError) as e:
+            return False, {"ERROR": str(e)}
+        if not wait:
+            return True, st
+        if timeout_s is None:
+            timeout_s = 1.0 + len(mv) * (ack_timeout_s + settle_s + window_s + 0.05)
+        if not msm.sweep_wait(timeout_s):
+            msm.sweep_abort()
+            _, res = self.vout_sweep_result()
+            res["ERROR"] = "sweep timeout, ADC stream not running?"
+            return False, res
+        return self.vout_sweep_result()
+
+    def vout_sweep_result(self) -> tuple[bool, dict]:
+        """ Steps of the last vout_sweep() completed so far
+
+        :return: success <True/False>, {"state", "duration_s", "noack", "mv", "i_mean", "i_rms", "i_min", "i_max",
+                 "isnk_mean", "a0_mean" (per step arrays, mA), "charge_uc", "ack_ms" (command written to the
+                 response, NaN none), "t_sent_s" (from the first command), "flags" (SWEEP_STEP_*),
+                 "steps": the raw SWEEP_STEP_DTYPE records (stream sample indexes)}
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        st = msm.sweep_status()
+        steps = msm.sweep_results(0)
+        acked = steps["ack"] != np.iinfo(np.uint64).max
+        res = {"state": st["state"], "duration_s": st["elapsed_s"], "noack": st["noack"],
+               "mv": steps["mv"].astype(np.int64), "flags": steps["flags"].copy(), "steps": steps,
+               "ack_ms": np.where(acked, (steps["ack_ns"].astype(np.float64) - steps["sent_ns"]) / 1e6, np.nan),
+               "t_sent_s": (steps["sent_ns"].astype(np.float64) - (steps["sent_ns"][0] if len(steps) else 0)) / 1e9}
+        for k in ("i_mean", "i_rms", "i_min", "i_max", "isnk_mean", "a0_mean", "charge_uc"):
+            res[k] = steps[k].astype(np.float64)
+        if len(steps) and st["state"] == "done" and not (steps["flags"][-1] & mp_serial.SWEEP_STEP_UNSENT):
+            self._vout_mv = int(steps["mv"][-1])
+        with self._lock_responses:
+            self._cmd_responses.get("cmd_vout", []).clear()
+        return True, res
+
+    def vout_sweep_status(self) -> tuple[bool, dict]:
+        """ {"state": "idle"/"send"/"ack"/"settle"/"window"/"done"/"aborted", "steps", "done", "noack", "elapsed_s"} """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        return True, msm.sweep_status()
+
+    def vout_sweep_abort(self) -> tuple[bool, dict]:
+        """ Abort the sweep, the step in progress is dropped; VOUT stays at the last value sent """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        return True, msm.sweep_abort()
+
+    # ----------------- Memory accounting and budgets -----------------
+
+    def _memory_python(self, native: dict | None) -> dict:
+        """ Bytes of the Python side buffers, safe before the connection is made """
+        def nbytes(cols, seen):
+            n = 0
+            for v in (cols or {}).values():
+                if id(v) in seen: continue
+                seen.add(id(v))
+                if isinstance(v, np.ndarray): n += v.nbytes
+                elif isinstance(v, list): n += sys.getsizeof(v)
+            return n
+
+        seen = set()
+        adc = getattr(self, "_adc", None)
+        osc_t = getattr(self, "_osc_t", None)
+        acquisition = nbytes(adc, seen)
+        if isinstance(osc_t, np.ndarray) and id(osc_t) not in seen: acquisition += osc_t.nbytes
+        # the Acquisition handed out per trigger, held by the application
+        packed = getattr(self, "NUM_SAMPLES", 0) * Acquisition.SAMPLE_DTYPE.itemsize
+
+        queue = 0
+        frame_mean = (native or {}).get("frame_mean", 0)
+        if frame_mean:
+            try:
+                frames = self._ucLogServer.threads['serial'].q_out.qsize()
+            except (AttributeError, KeyError, NotImplementedError):
+                frames = 0
+            queue = frames * (frame_mean + sys.getsizeof(b""))
+
+        d = {"acquisition": acquisition, "acquisition_copy": packed,
+             "adc_buf": nbytes(getattr(self, "_adc_buf", None), set()), "queue_backlog": queue}
+        d["total"] = sum(d.values())
+        return d
+
+    def _memory_device(self) -> dict:
+        msm = self._serial_manager()
+        native = msm.memory() if msm is not None else {}
+        python = self._memory_python(native)
+        return {"native": native, "python": python, "total": native.get("total", 0) + python["total"]}
+
+    def _memory_room(self, held: int = 0) -> int | None:
+        """ Bytes a buffer holding `held` now may take under the device and process budgets,
+            None when there is no budget """
+        if self._memory_budget is None and _process_budget is None:
+            return None
+        mine = self._memory_device()["total"]
+        room = None
+        if self._memory_budget is not None:
+            room = self._memory_budget - (mine - held)
+        if _process_budget is not None:
+            with _devices_lock:
+                others = [d for d in _devices if d is not self]
+            total = mine + sum(d._memory_device()["total"] for d in others)
+            r = _process_budget - (total - held)
+            room = r if room is None else min(room, r)
+        return max(0, room)
+
+    def _memory_note(self, name: str, want: int, got: int) -> dict | None:
+        """ Record that name got fewer bytes than asked for, None when it got all """
+        if got >= want:
+            self._memory_degraded.pop(name, None)
+            return None
+        d = {"requested_bytes": want, "granted_bytes": got}
+        self._memory_degraded[name] = d
+        self.logger.warning(f"memory budget: {name} reduced from {want} to {got} bytes")
+        return d
+
+    def _memory_fit_stream(self, kw: dict) -> dict:
+        """ Lower sample_ring_log2 and digital_log2, the larger first, until the stream buffers
+            take at most half the room, the rest is left to the configurations made later """
+        ring, dig = kw.get('sample_ring_log2', 20), kw.get('digital_log2', 23)
+
+        def size(r, g):
+            return ((mp_serial.SR_SAMPLE_BYTES << r) if r else 0) + \
+                   ((mp_serial.DIG_EDGE_BYTES + (2 << g) // 8) if g else 0) + \
+                   mp_serial.QUEUE_BYTES + mp_serial.TX_BYTES
+
+        room = self._memory_room()
+        want = size(ring, dig)
+        if room is None or want <= room // 2:
+            return kw
+        while size(ring, dig) > room // 2:
+            can_ring, can_dig = ring > mp_serial.SR_MIN_LOG2, dig > mp_serial.DIG_MIN_LOG2
+            if not can_ring and not can_dig: break
+            if can_ring and (not can_dig or mp_serial.SR_SAMPLE_BYTES << ring >= (2 << dig) // 8): ring -= 1
+            else: dig -= 1
+        degraded = self._memory_note("stream", want, size(ring, dig))
+        if degraded: degraded.update(sample_ring_log2=ring, digital_log2=dig)
+        return dict(kw, sample_ring_log2=ring, digital_log2=dig)
+
+    def _memory_fit_history(self, msm, levels: list[tuple[int, int]]) -> tuple[list, dict | None]:
+        """ Shorten all history levels alike until they fit """
+        block = mp_serial.REC_BG_DTYPE.itemsize
+        want = sum(c for _, c in levels) * block
+        room = self._memory_room(msm.memory()["history"])
+        if room is None or want <= room:
+            self._memory_degraded.pop("history", None)
+            return levels, None
+        scale = room / want
+        levels = [(decim, max(1, int(c * scale))) for decim, c in levels]
+        return levels, self._memory_note("history", want, sum(c for _, c in levels) * block)
+
+    def _memory_fit_plot(self, msm, channels: int, points: int) -> tuple[int, dict | None]:
+        """ Fewer points per plotter channel until they fit """
+        per = channels * mp_serial.PLOT_POINT_DTYPE.itemsize
+        room = self._memory_room(msm.memory()["plot"])
+        if room is None or channels <= 0 or points * per <= room:
+            self._memory_degraded.pop("plot", None)
+            return points, None
+        got = max(1, room // per)
+        return got, self._memory_note("plot", points * per, got * per)
+
+    def _memory_fit_recorder(self, msm, pre: int, post: int) -> tuple[int, int, dict | None]:
+        """ Shorten the event window, pre and post alike, until the recorder buffers fit """
+        per = mp_serial.REC_EVENT_BYTES_PER_SAMPLE
+        want = (pre + post) * per + mp_serial.REC_BG_BYTES
+        room = self._memory_room(msm.memory()["recorder"])
+        if room is None or want <= room or pre + post == 0:
+            self._memory_degraded.pop("recorder", None)
+            return pre, post, None
+        window = max(1, (room - mp_serial.REC_BG_BYTES) // per)
+        pre, post = pre * window // (pre + post), max(1, post * window // (pre + post))
+        return pre, post, self._memory_note("recorder", want, (pre + post) * per + mp_serial.REC_BG_BYTES)
+
+    def _memory_fit_sequence(self, msm, pre: int, post: int, segments: int,
+                             continuous: bool) -> tuple[int, dict | None]:
+        """ Fewer segments per sequence until the sequence blocks fit """
+        per = (2 if continuous else 1) * ((pre + post) * mp_serial.REC_EVENT_BYTES_PER_SAMPLE
+                                          + mp_serial.SEQCAP_SEG_BYTES)
+        room = self._memory_room(msm.memory()["seqcap"])
+        if room is None or segments * per <= room:
+            self._memory_degraded.pop("seqcap", None)
+            return segments, None
+        got = max(1, room // per)
+        return got, self._memory_note("seqcap", segments * per, got * per)
+
+    def _memory_fit_timebase(self, span: str) -> tuple[str, dict | None]:
+        """ Longest span up to span whose acquisition buffers fit, the shortest if none does """
+        def size(k):
+            return int(self.ADC_SAMPLE_RATE * self.TBASE_MAP[k]) * self.ACQ_SAMPLE_BYTES
+
+        py = self._memory_python(None)
+        room = self._memory_room(py["acquisition"] + py["acquisition_copy"])
+        if room is None or size(span) <= room:
+            self._memory_degraded.pop("acquisition", None)
+            return span, None
+        spans = sorted((k for k in self.TBASE_MAP if self.TBASE_MAP[k] <= self.TBASE_MAP[span]),
+                       key=lambda k: self.TBASE_MAP[k])
+        got = spans[0]
+        for k in spans:
+            if size(k) <= room: got = k
+        degraded = self._memory_note("acquisition", size(span), size(got))
+        if degraded: degraded["span"] = span
+        return got, degraded
+
+    def memory(self) -> tuple[bool, dict]:
+        """ Bytes held by this device, per subsystem
+        - native: the preallocated native buffers and I/O thread stack buffers, see
+          mp_serial.MySerialManager.memory() ("frame_mean" is not held, it sizes "queue")
+        - python: acquisition working buffers and time axis, the Acquisition handed out per
+          trigger (acquisition_copy, held by the application), the _adc_buf holding buffer and
+          the frames queued for the Python consumer (estimated from their mean size)
+        - degraded: the configurations scaled down to fit a budget, {subsystem: {"requested_bytes",
+          "granted_bytes", ...}}, subsystems "stream", "history", "plot", "recorder", "seqcap",
+          "acquisition"
+
+        :return: success <True/False>, {"native": {...}, "python": {...}, "total", "budget", "degraded"}
+        """
+        d = self._memory_device()
+        d["budget"] = self._memory_budget
+        d["degraded"] = {k: dict(v) for k, v in self._memory_degraded.items()}
+        return True, d
+
+    def memory_budget(self, budget: int | None) -> tuple[bool, dict]:
+        """ Bytes this device may hold, None unlimited
+        - respected by the configurations made from then on: the sample ring (constructor
+          memory_budget kw), history_config(), plot_config(), recorder_start(), sequence_start()
+          and set_timebase() scale down to fit (shorter history/windows/spans, fewer points or
+          segments) rather than fail, noting it as "degraded"; buffers already held are kept
+        - a process-wide budget over all devices is set with P1150.memory_budget_process()
+
+        :return: success <True/False>, memory() dict
+        """
+        if budget is not None and budget < 0:
+            return False, {"ERROR": "budget must be None or >= 0 bytes"}
+        self._memory_budget = budget
+        return self.memory()
+
+    @staticmethod
+    def memory_budget_process(budget: int | None) -> tuple[bool, dict]:
+        """ Bytes all P1150 devices of this process may hold together, None unlimited,
+            respected like memory_budget()
+
+        :return: success <True/False>, memory_process() dict
+        """
+        global _process_budget
+        if budget is not None and budget < 0:
+            return False, {"ERROR": "budget must be None or >= 0 bytes"}
+        _process_budget = budget
+        return P1150.memory_process()
+
+    @staticmethod
+    def memory_process() -> tuple[bool, dict]:
+        """ Bytes held by all P1150 devices of this process
+
+        :return: success <True/False>, {"devices": {port: memory() dict}, "subsystems": {name: bytes
+                 summed over the devices}, "total", "budget"}
+        """
+        with _devices_lock:
+            devices = list(_devices)
+        d = {"devices": {}, "subsystems": {}, "total": 0, "budget": _process_budget}
+        for dev in devices:
+            _, m = dev.memory()
+            d["devices"][dev._port] = m
+            for part in ("native", "python"):
+                for k, v in m[part].items():
+                    if k in ("total", "frame_mean"): continue
+                    d["subsystems"][k] = d["subsystems"].get(k, 0) + v
+            d["total"] += m["total"]
+        return True, d
+
+    def derived_config(self, channels=mp_serial.DERIVED_CHANNELS, vout_mv: int | None = None,
+                       a0_gain: float = 1.0, a0_offset: float = 0.0, eager: bool = False) -> tuple[bool, dict]:
+        """ Declare derived channels of acquisitions
+        - "power" (mW, i * VOUT), "energy" (mJ, cumulative from t[0]), "net" (mA, i - isnk),
+          "a0s" (a0 * a0_gain + a0_offset)
+        - computed together by one fused native pass, on first access of any of them
+          (eager=False) or when the acquisition is taken (eager=True)
+        - VOUT is vout_mv, or the last set_vout() when None, at the time of the acquisition
+
+        :param channels: subset of the above, empty to disable
+        :return: success <True/False>, the configuration
+        """
+        channels = tuple(channels)
+        bad = set(channels) - set(mp_serial.DERIVED_CHANNELS)
+        if bad:
+            return False, {"ERROR": f"unknown derived channels {sorted(bad)}"}
+        if vout_mv is None and self._vout_mv is None and {"power", "energy"} & set(channels):
+            return False, {"ERROR": "power/energy need vout_mv or a prior set_vout()"}
+        self._derived_cfg = {"channels": channels, "vout_mv": vout_mv, "a0_gain": float(a0_gain),
+                             "a0_offset": float(a0_offset), "eager": bool(eager)} if channels else None
+        return True, dict(self._derived_cfg or {"channels": ()})
+
+    def sample_clock(self) -> tuple[bool, dict]:
+        """ Device sample clock and its fit to host time
+        - the ADC frame counter is unwrapped into an absolute sample index (125 kS/s since
+          the first frame); lost frames advance it by their samples ("lost_frames",
+          "lost_samples"), a counter restart (device reset) starts a new "epoch"
+        - host_s = device_s + offset_s + drift * device_s, from the earliest arrival per
+          second of the last 64 s; "jitter_s" is the scatter of those arrivals around the fit
+        - acquisitions carry "sample0" (absolute index of t[0]) and "t0_unix_ns",
+          sample_to_unix_ns()/unix_ns_to_sample() put log records (record.created) and
+          external events (time.time_ns()) on the same time base
+
+        :return: success <True/False>, {"frames", "c", "abs", "epoch", "wraps", "lost_frames",
+                 "lost_samples", "origin_unix_ns", "valid", "points", "offset_s", "drift",
+                 "jitter_s", "latency_s", ...}
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        return True, msm.sample_clock()
+
+    def sample_to_unix_ns(self, idx) -> tuple[bool, dict]:
+        """ Host Unix time of absolute sample indexes (int or array)
+
+        :return: success <True/False>, {"t_unix_ns": int or int64 array}
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        return True, {"t_unix_ns": msm.sample_to_unix_ns(idx)}
+
+    def unix_ns_to_sample(self, t_ns) -> tuple[bool, dict]:
+        """ Absolute sample index at host Unix times in ns (int or array)
+        - e.g. a log record: int(record.created * 1e9), an external event: time.time_ns()
+
+        :return: success <True/False>, {"sample": float or float array}
+        """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        return True, {"sample": msm.unix_ns_to_sample(t_ns)}
+
+    def current_hist_reset(self, slot_ms: int = 0) -> tuple[bool, dict | None]:
+        """ Clear the current histograms, slot_ms sets the window granularity (default 1000 ms) """
+        msm = self._serial_manager()
+        if msm is None:
+            return False, {"ERROR": "not connected"}
+        try:
+            msm.current_hist_reset(slot_ms)
+        except ValueError as e:
+            return False, {"ERROR": str(e)}
+        return True, None
+
     def probe(self, ch: int=1, connect: bool=True, hard_connect: bool=False, rs_comp: bool=False) -> tuple[bool, list[dict] | None]:
         """ Set Probe Connect
 
@@ -1199,6 +2706,9 @@ class P1150(UCLogger):
         """ Connect to P1150, upload AFI if necessary, Calibrate if necessary
         - hides all the details of connecting to P1150
         - if success False, the client should close()
+        - with reconnect enabled (default) the port is re-opened in place after the AFI
+          upload and connecting continues with the application, else the client must
+          re-connect when the response "app" is "a51"
 
         :param sn: <serial number>
         :param progress_callback: <function> called with progress percentage and message
@@ -1249,12 +2759,26 @@ class P1150(UCLogger):
                     return False, {"ERROR": "bootloader_block failed", "response": result}
                 # logger.info(f"bootloader_block {result}")
 
+            msm = self._serial_manager()
+            reconnects = msm.link_state()["reconnects"] if (msm and self._reconnect) else None
+
             success, result = self.bootloader_done()
             if not success:
                 self.logger.error(f"bootloader_done {result}")
                 return False, {"ERROR": "bootloader_done failed", "response": result}
 
             # the P1150 is rebooting and will re-enumerate with USB
+            if reconnects is not None:
+                if progress_callback is not None:
+                    progress_callback(2, "Reconnect")
+
+                # threads, buffers and callbacks stay alive, the native reader re-opens the port
+                if self._wait_reconnect(reconnects, self.TIME_RECONNECT_AFTER_FWLOAD_S):
+                    sleep(0.2)  # allow application FW to start its command handler
+                    return self.ez_connect(sn, progress_callback)
+
+                self.logger.warning(f"P1150 {self._port} in-place reconnect timeout, reopening")
+
             self.close()
             sleep(0.200)  # allow time for device to disconnect/reboot
 
@@ -63,7 +63,7 @@ typedef enum {
 // Forward declarations
 static PyObject* cbor_item_to_pyobject(cbor_item_t * item);
 static PyObject* process_fmts(cbor_item_t* fmts_item);
-static PyObject* LogData_decode(LogDataObject *self, PyObject *args);
+static PyObject* LogData_decode(LogDataObject *self, PyObject *args, PyObject *kwds);
 static PyObject* extract_vals_from_frame(LogDataObject *logdata, PyObject* frame, PyObject* parser_list);
 static PyObject* LogData_target(LogDataObject *self, PyObject *Py_UNUSED(ignored));
 
@@ -571,17 +571,29 @@ LogData_target(LogDataObject *self, PyObject *Py_UNUSED(ignored)) {
     return PyLong_FromLong(target_val);
 }
 
+// decode(item, count=None): count numbers the message instead of the instance's own
+// counter, which is then left alone (shared instances, see uclog.DeviceLogData)
 static PyObject *
-LogData_decode(LogDataObject *self, PyObject *args) {
+LogData_decode(LogDataObject *self, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"item", "count", NULL};
     PyObject *item_tuple = NULL;
+    PyObject *count_obj = Py_None;
     long target, addr;
     PyObject *frame;
 
-    if (!PyArg_ParseTuple(args, "O!", &PyTuple_Type, &item_tuple) ||
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!|O", kwlist, &PyTuple_Type, &item_tuple, &count_obj) ||
         !PyArg_ParseTuple(item_tuple, "llO", &target, &addr, &frame)) {
         return NULL;
     }
 
+    long count;
+    if (count_obj != Py_None) {
+        count = PyLong_AsLong(count_obj);
+        if (count == -1 && PyErr_Occurred()) return NULL;
+    } else {
+        count = ++self->count;
+    }
+
     long kind = addr & 3;
     long clean_addr = addr & ~3;
 
@@ -606,8 +618,6 @@ LogData_decode(LogDataObject *self, PyObject *args) {
     }
 #endif
 
-    self->count++;
-
     PyObject *addr_key = PyLong_FromLong(clean_addr);
     PyObject *fmt_tuple = PyDict_GetItem(self->fmts, addr_key); // Borrowed
     Py_DECREF(addr_key);
@@ -616,7 +626,7 @@ LogData_decode(LogDataObject *self, PyObject *args) {
         PyObject *hex_frame = PyObject_CallMethod(frame, "hex", NULL);
         PyObject *text = PyUnicode_FromFormat("UNDECODED: TGT=%ld ADDR=0x%lX FRAME=%S", target, addr, hex_frame);
         Py_DECREF(hex_frame);
-        PyObject* result = Py_BuildValue("(ldssiO)", self->count, ts, "RAW", "?", 0, text);
+        PyObject* result = Py_BuildValue("(ldssiO)", count, ts, "RAW", "?", 0, text);
         Py_DECREF(text);
         return result;
     }
@@ -656,7 +666,7 @@ LogData_decode(LogDataObject *self, PyObject *args) {
         Py_DECREF(py_line);
 
         const char *level_str = (level_val >= 0 && level_val < 6) ? level_map[level_val] : "<bad level>";
-        result_tuple = Py_BuildValue("(ldOOlO)", self->count, ts, PyUnicode_FromString(level_str), fname, line_val, text);
+        result_tuple = Py_BuildValue("(ldOOlO)", count, ts, PyUnicode_FromString(level_str), fname, line_val, text);
         Py_DECREF(text);
     } else {
         PyObject *hex_frame = PyObject_CallMethod(frame, "hex", NULL);
@@ -674,7 +684,7 @@ LogData_decode(LogDataObject *self, PyObject *args) {
         Py_DECREF(py_line);
 
         const char *level_str = (level_val >= 0 && level_val < 6) ? level_map[level_val] : "<bad level>";
-        result_tuple = Py_BuildValue("(ldOOlO)", self->count, ts, PyUnicode_FromString(level_str), fname, line_val, text);
+        result_tuple = Py_BuildValue("(ldOOlO)", count, ts, PyUnicode_FromString(level_str), fname, line_val, text);
         Py_DECREF(text);
     }
 
@@ -757,16 +767,21 @@ extract_vals_from_frame(LogDataObject *logdata, PyObject* frame, PyObject* parse
     return Py_BuildValue("ON", vals_tuple, Py_None);
 }
 
+// Read-only: instances are shared between devices (uclog.shared_logdata()), which decode
+// with count= so the instance's message counter is not touched either
 static PyMemberDef LogData_members[] = {
-    {"enums", T_OBJECT_EX, offsetof(LogDataObject, enums), 0, "enums table"},
-    {"tdenums", T_OBJECT_EX, offsetof(LogDataObject, tdenums), 0, "tdenums table"},
-    {"variables", T_OBJECT_EX, offsetof(LogDataObject, variables), 0, "variables table"},
-    {"functions", T_OBJECT_EX, offsetof(LogDataObject, functions), 0, "functions table"},
+    {"enums", T_OBJECT_EX, offsetof(LogDataObject, enums), READONLY, "enums table"},
+    {"tdenums", T_OBJECT_EX, offsetof(LogDataObject, tdenums), READONLY, "tdenums table"},
+    {"variables", T_OBJECT_EX, offsetof(LogDataObject, variables), READONLY, "variables table"},
+    {"functions", T_OBJECT_EX, offsetof(LogDataObject, functions), READONLY, "functions table"},
+    {"filename", T_OBJECT_EX, offsetof(LogDataObject, filename), READONLY, "file the tables were loaded from"},
     {NULL}
 };
 
 static PyMethodDef LogData_methods[] = {
-    {"decode", (PyCFunction)LogData_decode, METH_VARARGS, "Decodes a log item."},
+    {"decode", (PyCFunction)LogData_decode, METH_VARARGS | METH_KEYWORDS,
+     "decode(item, count=None): decodes a log item.  With count the message is numbered count and\n"
+     "the instance's own counter is left unchanged."},
     {"target", (PyCFunction)LogData_target, METH_NOARGS, "Returns the target ID."},
     {NULL}
 };
@@ -4,26 +4,122 @@ Sistemi Corporation, copyright, all rights reserved, 2024-2025
 Martin Guthrie
 
 """
+import mmap
+import os
+import struct
+import sys
+from typing import NamedTuple
+import numpy as np
 import mp_serial_ext
 
+# native buffer sizes behind MySerialManager.memory(), to size configurations to a budget
+SR_SAMPLE_BYTES = mp_serial_ext.SR_SAMPLE_BYTES            # sample ring, per sample
+SR_MIN_LOG2 = mp_serial_ext.SR_MIN_LOG2
+DIG_MIN_LOG2 = mp_serial_ext.DIG_MIN_LOG2
+DIG_EDGE_BYTES = mp_serial_ext.DIG_EDGE_BYTES              # digital edge lists, + 2 bits per sample
+QUEUE_BYTES = mp_serial_ext.QUEUE_BYTES                    # raw frame queue
+TX_BYTES = mp_serial_ext.TX_BYTES
+REC_EVENT_BYTES_PER_SAMPLE = mp_serial_ext.REC_EVENT_BYTES_PER_SAMPLE
+REC_BG_BYTES = mp_serial_ext.REC_BG_BYTES                  # recorder background blocks
+SEQCAP_SEG_BYTES = mp_serial_ext.SEQCAP_SEG_BYTES          # per segment, + its samples
+
+
+# gated_pulse_t records returned by gated_pulses()
+GATED_PULSE_DTYPE = np.dtype([("number", "<u8"), ("start", "<u8"), ("n", "<u8"), ("charge_uc", "<f8"),
+                              ("mean_ma", "<f8"), ("peak_ma", "<f4"), ("min_ma", "<f4")])
+
+# seg_record_t records returned by segments(), same layout
+SEGMENT_DTYPE = GATED_PULSE_DTYPE
+
+# mask_verdict_t records returned by mask_verdicts()
+MASK_VERDICT_DTYPE = np.dtype([("number", "<u8"), ("trigger", "<u8"), ("at", "<i8"), ("value", "<f8"),
+                               ("latency_ns", "<u8"), ("pass", "<i4"), ("rule", "<i4")])
+
+# dpool_adc_t records of a natively decoded batch, see expand_decoded()
+DECODED_ADC_DTYPE = np.dtype([("c", "<u8"), ("a", "<u8"), ("start", "<u4"), ("n", "<u4"),
+                              ("present", "<u4"), ("frame", "<u4")])
+_ADC_HAS_A = 0x02
+ADC_PORT = 3
+
+
+class DecodedFrame(NamedTuple):
+    """ A frame decoded by the native worker pool: the item its ucLog port handler gets """
+    port: int
+    item: dict
+
+
+def expand_decoded(batch: tuple) -> list:
+    """ A decoded batch from qout (decode_workers > 0) as the frames in arrival order:
+        bytes for frames left raw, DecodedFrame for ADC frames, whose item has the form the
+        ADC handler used to build itself (i, isnk in mA as float32, a0 float64, d01 uint8,
+        d0s list of chars, c, a), arrays are views into the batch columns """
+    items, table, ci, cs, ca, cd, c0 = batch
+    recs = np.frombuffer(table, dtype=DECODED_ADC_DTYPE).tolist()
+    ci = np.frombuffer(ci, dtype="<f4")
+    cs = np.frombuffer(cs, dtype="<f4")
+    ca = np.frombuffer(ca, dtype="<f8")
+    cd = np.frombuffer(cd, dtype="u1")
+    c0 = c0.decode("ascii")
+    out = []
+    for it in items:
+        if isinstance(it, bytes):
+            out.append(it)
+            continue
+        c, a, s, n, present, _ = recs[it]
+        e = s + n
+        item = {"c": c, "i": ci[s:e], "isnk": cs[s:e], "a0": ca[s:e], "d01": cd[s:e], "d0s": list(c0[s:e])}
+        if present & _ADC_HAS_A:
+            item["a"] = a
+        out.append(DecodedFrame(ADC_PORT, item))
+    return out
+
+
+# ctl_event_t records returned by control_events()
+CONTROL_EVENT_DTYPE = np.dtype([("number", "<u8"), ("sample", "<u8"), ("value", "<f8"), ("detect_ns", "<u8"),
+                                ("write_ns", "<u8"), ("wait_ns", "<u8"), ("lag", "<u4"), ("rule", "<i2"),
+                                ("rc", "<i2")])
+
+# sweep_step_t records returned by sweep_results()
+SWEEP_STEP_DTYPE = np.dtype([("sent", "<u8"), ("ack", "<u8"), ("start", "<u8"), ("n", "<u8"), ("sent_ns", "<u8"),
+                             ("ack_ns", "<u8"), ("i_mean", "<f8"), ("i_rms", "<f8"), ("isnk_mean", "<f8"),
+                             ("charge_uc", "<f8"), ("i_min", "<f4"), ("i_max", "<f4"), ("a0_mean", "<f4"),
+                             ("mv", "<u4"), ("flags", "<u2"), ("reserved", "<u2"), ("reserved2", "<u4")])
+SWEEP_STEP_NOACK = 0x0001
+SWEEP_STEP_NAK = 0x0002
+SWEEP_STEP_UNSENT = 0x0004
+
 
 class MySerialManager:
     """
     Drop-in wrapper around mp_serial_ext.SerialManager
 
     Constructor (timeout removed; non-blocking reads are used internally):
-      MySerialManager(serial_port, qin, qout, *, baud=115200)
+      MySerialManager(serial_port, qin, qout, *, baud=115200, sn=None, reconnect=False, sample_ring=0,
+                      digital=0, decode_workers=0)
 
     Notes:
       - Baud defaults to 115200 (can be adjusted via 'baud' kwarg).
       - Call start() to launch I/O threads.
       - To stop, call shutdown().
+      - With reconnect=True a disconnect (read error/EOF) does not stop the threads,
+        the same device (USB serial number 'sn', looked up from sysfs if not given)
+        is re-opened in place when it comes back.  See link_state().
+      - sample_ring=N (log2 samples, 10..26) decodes ADC frames natively into a shared
+        sample ring, read in place by any number of consumers.  See consumer().
+      - digital=N (log2 samples, 13..30) keeps D0/D1 natively as edge lists plus packed
+        bits, indexed by stream sample index.  See digital_edges().
+      - decode_workers=N (1..16) decodes the frame batches on N native worker threads
+        before they reach Python: qout then carries decoded batches, see expand_decoded().
     """
 
-    def __init__(self, serial_port: str, qin, qout, *, baud: int = 115200):
+    def __init__(self, serial_port: str, qin, qout, *, baud: int = 115200,
+                 sn: str | None = None, reconnect: bool = False, sample_ring: int = 0,
+                 digital: int = 0, decode_workers: int = 0):
         self._qin = qin
         self._qout = qout
-        self._impl = mp_serial_ext.SerialManager(serial_port, qin, qout, baud=baud)
+        self._impl = mp_serial_ext.SerialManager(serial_port, qin, qout, baud=baud,
+                                                 sn=sn, reconnect=reconnect, sample_ring=sample_ring,
+                                                 digital=digital, decode_workers=decode_workers)
 
     def start(self) -> None:
         self._impl.start()
@@ -37,3 +133,792 @@ class MySerialManager:
 
     def get_perf_stats(self) -> dict:
         return self._impl.get_perf_stats()
+
+    def decode_stats(self) -> dict | None:
+        """ {"workers", "slots", "in_flight", "batches", "frames", "adc_frames", "samples",
+             "decode_s", "collect_wait_s", "bytes"} of the decode worker pool, None when off """
+        return self._impl.decode_stats()
+
+    def memory(self) -> dict:
+        """ Bytes held natively per subsystem: {"ring", "digital", "queue", "tx", "threads",
+            "history", "recorder", "seqcap", "plot", "sweep", "device", "decode_pool", "total"},
+            plus "frame_mean", the mean bytes of the frames delivered to Python """
+        return self._impl.memory()
+
+    def link_state(self) -> dict:
+        """ {"connected", "port", "sn", "disconnects", "reconnects", "down_ms",
+             "last_reconnect_ms", "max_reconnect_ms"} """
+        return self._impl.link_state()
+
+    def set_link_callback(self, cb) -> None:
+        """ cb(link_state: dict) on disconnect and reconnect, None to remove """
+        self._impl.set_link_callback(cb)
+
+    def pipeline_pressure(self, history: int = 0) -> dict:
+        """ Backlog telemetry, sampled natively every 100 ms
+
+        :param history: number of past samples to include (max 600 = 60 s), oldest first
+        :return: {"pressure", "warn", "slope_per_s", "eta_ms", "peak", "warn_events",
+                  "fw_backlog", "fw_backlog_peak", "ring_used_bytes", "ring_size_bytes",
+                  "deliver_lag_frames", "deliver_lag_ms", "consumer_lag_frames",
+                  "consumer_lag_ms", "frames_per_s", "t_ms"[, "history": {column: list}]}
+        """
+        return self._impl.pipeline_pressure(history=history)
+
+    def pressure_config(self, **kw) -> dict:
+        """ fw_backlog_max, consumer_lag_max, warn_level, clear_level, horizon_ms;
+            omitted values are kept, returns the active configuration """
+        return self._impl.pressure_config(**kw)
+
+    def set_pressure_callback(self, cb) -> None:
+        """ cb(pipeline_pressure: dict) when the pressure warning sets or clears, None to remove """
+        self._impl.set_pressure_callback(cb)
+
+    def consumed(self, n: int) -> None:
+        """ acknowledge n frames taken from qout (enables consumer lag tracking) """
+        self._impl.consumed(n)
+
+    def consumer(self, name: str, policy: str = "overwrite", wake: int = 1) -> "RingConsumer":
+        """ Attach a consumer to the shared sample ring, see RingConsumer """
+        return RingConsumer(self._impl, name, policy, wake)
+
+    def ring_info(self) -> dict:
+        """ {"capacity", "head", "dropped", "bytes",
+             "consumers": [{"id", "name", "policy", "cursor", "lag", "max_lag", "overrun", "consumed", "wake"}]} """
+        return self._impl.ring_info()
+
+    def digital_edges(self, line: int, start: int = 0, end: int | None = None,
+                      max_edges: int = 65536) -> tuple[np.ndarray, np.ndarray]:
+        """ Edges of D0 (line 0) / D1 (line 1) with start <= index < end
+
+        The first edge ever recorded holds the initial state, not a transition.
+        :return: (sample index uint64 array, new state uint8 array)
+        """
+        end = (1 << 64) - 1 if end is None else end
+        e = np.frombuffer(self._impl.digital_edges(line, start, end, max_edges), dtype='<u8')
+        return e >> 1, (e & 1).astype(np.uint8)
+
+    def digital_state_at(self, line: int, index: int) -> int | None:
+        """ 0/1 state of a line at a stream sample index, None if not retained """
+        return self._impl.digital_state_at(line, index)
+
+    def digital_find_edge(self, line: int, start: int, slope: int = 1) -> tuple[int, int] | None:
+        """ First edge at/after start, slope +1 rising, -1 falling, 0 either;
+            (sample index, new state) or None """
+        return self._impl.digital_find_edge(line, start, slope)
+
+    def digital_steps(self, line: int, start: int, end: int,
+                      vlow: float = 0.0, vhigh: float = 1.0) -> tuple[np.ndarray, np.ndarray]:
+        """ Plot ready step outline of [start, end) built from the edges only,
+            2 points per edge instead of one value per sample
+
+        :return: (x sample index, y vlow + state * vhigh), empty if start is not retained
+        """
+        s0 = self._impl.digital_state_at(line, start)
+        if s0 is None or end <= start:
+            return np.empty(0, dtype=np.uint64), np.empty(0)
+        idx, st = self.digital_edges(line, start + 1, end)
+        x = np.repeat(np.concatenate(([start], idx, [end])).astype(np.uint64), 2)[1:-1]
+        y = np.repeat(np.concatenate(([s0], st)), 2) * vhigh + vlow
+        return x, y
+
+    def digital_bits(self, line: int, start: int, n: int) -> tuple[int, np.ndarray]:
+        """ Per sample 0/1 values of [start, start + n), clipped to what is retained
+
+        :return: (actual start, uint8 array)
+        """
+        start, n, b = self._impl.digital_bits(line, start, n)
+        return start, np.unpackbits(np.frombuffer(b, dtype=np.uint8), count=n, bitorder='little')
+
+    def digital_info(self) -> dict:
+        """ {"samples", "oldest", "bits_capacity", "edges_capacity", "edges": (d0, d1),
+             "state": (d0, d1) or None} """
+        return self._impl.digital_info()
+
+    def gated_config(self, **kw) -> dict:
+        """ line (0 D0, 1 D1), active (level 0/1), source ("i", "isnk", "net" = i - isnk),
+            min_samples (shorter pulses count as glitches); omitted values are kept,
+            clears all results, returns the active configuration """
+        return self._impl.gated_config(**kw)
+
+    def gated_stats(self, reset: bool = False) -> dict:
+        """ {"line", "active", "source", "min_samples", "since", "pulses", "glitches",
+             "states": [4 x acc] by d01 & 3, "d0"/"d1": {"low": acc, "high": acc},
+             "open": acc + "start" or None}, acc = {"samples", "charge_uc", "mean_ma",
+             "rms_ma", "peak_ma", "min_ma"} """
+        return self._impl.gated_stats(reset=reset)
+
+    def gated_pulses(self, since: int = 0, max_pulses: int = 4096) -> tuple[int, np.ndarray]:
+        """ Completed pulses numbered >= since, (next since, GATED_PULSE_DTYPE array) """
+        nxt, b = self._impl.gated_pulses(since, max_pulses)
+        return nxt, np.frombuffer(b, dtype=GATED_PULSE_DTYPE)
+
+    def current_hist(self, channel: str = "i", window_s: float = 0.0, ccdf: bool = False) -> dict:
+        """ Log-binned current distribution (20 bins/decade, 1 nA .. 10 A)
+
+        :param channel: "i" or "isnk"
+        :param window_s: 0 since the last reset, else the last window_s seconds (whole slots)
+        :param ccdf: add "ccdf", the fraction of samples >= each edge
+        :return: {"counts": uint64[200], "edges_ma": float[201], "underflow" (< 1 nA, incl. <= 0),
+                  "overflow", "samples", "seconds", "since", "window_slots", "slot_ms"[, "ccdf"]}
+        """
+        d = self._impl.current_hist(channel, window_s)
+        d["counts"] = np.asarray(d["counts"], dtype=np.uint64)
+        d["edges_ma"] = np.asarray(d["edges_ma"])
+        if ccdf:
+            above = np.cumsum(d["counts"][::-1])[::-1] + d["overflow"]
+            total = max(int(above[0]) + d["underflow"], 1)
+            d["ccdf"] = np.append(above, d["overflow"]) / total
+        return d
+
+    def current_hist_reset(self, slot_ms: int = 0) -> None:
+        """ Clear the histograms; slot_ms (1..60000, default 1000) is the window granularity,
+            256 slots are kept, 0 keeps the current value """
+        self._impl.current_hist_reset(slot_ms)
+
+    def history_config(self, levels: list[tuple[int, int]]) -> dict:
+        """ Decimated history levels [(decim, capacity blocks), ...] (max 4, each decim a multiple of
+            the one before), [] turns the history off; always starts over, returns history_info() """
+        return self._impl.history_config([(int(d), int(c)) for d, c in levels])
+
+    def history_info(self) -> dict:
+        """ {"base", "samples", "bytes", "levels": [{"decim", "capacity", "done", "rate_hz", "span_s"}]} """
+        return self._impl.history_info()
+
+    def history_read(self, level: int, since: int | None = None, max_blocks: int = 65536) -> tuple[int, np.ndarray]:
+        """ Completed blocks of a level numbered >= since (None: the newest max_blocks),
+            (number of the first block, REC_BG_DTYPE array); block b starts at stream sample
+            base + b * decim """
+        first, b = self._impl.history_read(level, since, max_blocks)
+        return first, np.frombuffer(b, dtype=REC_BG_DTYPE)
+
+    def plot_config(self, channels: int = 16, capacity: int = 65536, forward: bool = False) -> dict:
+        """ Decode the debug plotter stream (port 2) natively into up to channels rings of capacity
+            points, bound to names on first sight; forward also delivers the items to Python;
+            0 channels turns it off.  Always starts over, returns plot_info() """
+        return self._impl.plot_config(channels, capacity, forward)
+
+    def plot_info(self) -> dict:
+        """ {"max_channels", "capacity", "items", "errors", "unbound", "bytes", "stream_samples", "forward",
+             "channels": [{"name", "points", "items", "last_seq"}]} """
+        return self._impl.plot_info()
+
+    def plot_read(self, name: str, since: int | None = None, max_points: int = 65536) -> tuple[int, np.ndarray]:
+        """ Points of a channel numbered >= since (None: the newest max_points),
+            (number of the first point, PLOT_POINT_DTYPE array) """
+        first, b = self._impl.plot_read(name, since, max_points)
+        return first, np.frombuffer(b, dtype=PLOT_POINT_DTYPE)
+
+    def plot_lod(self, name: str, seq0: int, seq1: int, buckets: int) -> tuple[int, np.ndarray]:
+        """ Points of a channel in stream samples [seq0, seq1) folded into equal buckets,
+            (points, PLOT_BUCKET_DTYPE array), empty buckets are NaN with n 0 """
+        n, b = self._impl.plot_lod(name, int(seq0), int(seq1), buckets)
+        return n, np.frombuffer(b, dtype=PLOT_BUCKET_DTYPE)
+
+    def segment_config(self, **kw) -> dict:
+        """ block (samples averaged), k (drift, decades), h (threshold, decades), floor_ma,
+            min_blocks; omitted values are kept, always restarts the segmentation """
+        return self._impl.segment_config(**kw)
+
+    def segments(self, since: int = 0, max_segments: int = 16384) -> tuple[int, np.ndarray]:
+        """ Closed segments numbered >= since, (next since, SEGMENT_DTYPE array) """
+        nxt, b = self._impl.segments(since, max_segments)
+        return nxt, np.frombuffer(b, dtype=SEGMENT_DTYPE)
+
+    def segment_info(self) -> dict:
+        """ {"segments", "retained", "since", "cusum_up", "cusum_down",
+             "open": {"number", "start", "samples", "charge_uc", "mean_ma", "peak_ma", "min_ma"} or None} """
+        return self._impl.segment_info()
+
+    def recorder_start(self, path: str, triggers: list[dict], pre: int = 12500, post: int = 12500,
+                       decim: int = 12500) -> dict:
+        """ Event-triggered recording to path, see read_recording()
+
+        :param triggers: OR-ed, up to 8 of
+                         {"kind": "current", "source": "i"/"isnk", "level_ma": float, "slope": 1/-1/0}
+                         {"kind": "digital", "line": 0/1, "slope": 1/-1/0}
+                         {"kind": "d0s", "char": str}
+        :param pre: samples kept before the trigger
+        :param post: samples recorded from the trigger on (re-armed after the window)
+        :param decim: samples per background block (min/max/mean of i, mean of isnk)
+        :return: recorder_info()
+        """
+        return self._impl.recorder_start(path, pack_triggers(triggers), pre, post, decim)
+
+    def recorder_stop(self) -> dict:
+        """ Flush and close the recording, returns the final recorder_info() """
+        return self._impl.recorder_stop()
+
+    def recorder_info(self) -> dict:
+        """ {"running", "pending", "start_seq", "seq", "events", "truncated", "bg_blocks",
+             "bytes", "lost", "error"} """
+        return self._impl.recorder_info()
+
+    def seqcap_start(self, triggers: list[dict], pre: int = 125, post: int = 1125, segments: int = 100,
+                     continuous: bool = False) -> dict:
+        """ Segmented memory capture: the [trigger - pre, trigger + post) window of each of the
+            next `segments` triggers into one preallocated sequence, re-armed at the end of the
+            window, see seqcap_take()
+
+        :param triggers: OR-ed, 1 to 8 recorder trigger dicts (see recorder_start)
+        :param continuous: keep capturing sequences (two are preallocated) until seqcap_stop()
+        :return: seqcap_info()
+        """
+        return self._impl.seqcap_start(pack_triggers(triggers), pre, post, segments, continuous)
+
+    def seqcap_stop(self) -> dict:
+        """ Stop capturing, a partly filled sequence can still be taken; the final seqcap_info() """
+        return self._impl.seqcap_stop()
+
+    def seqcap_info(self) -> dict:
+        """ {"running", "armed", "start_seq", "seq", "segments", "sequences", "taken", "ready", "fill",
+             "missed", "truncated", "lost", "min_interval", "segments_per_s", "busy_s", "bytes"} """
+        return self._impl.seqcap_info()
+
+    def seqcap_take(self, timeout_ms: int = 0) -> dict | None:
+        """ The oldest completed sequence, None if there is none within timeout_ms
+
+        :return: {"number", "pre", "post", "i", "isnk" (mA, float32), "a0" (uint16), "d01", "d0s" (uint8)
+                 as (segments, pre + post) arrays, sample pre is the trigger, "seg": SEQCAP_SEG_DTYPE
+                 array}, all views into one block
+        """
+        r = self._impl.seqcap_take(timeout_ms)
+        if r is None:
+            return None
+        number, n, slots, pre, post, block = r
+        return {"number": number, "pre": pre, "post": post, **seqcap_columns(block, n, slots, pre + post)}
+
+    def mask_config(self, rules: list[dict], trigger: dict | None = None) -> None:
+        """ Pass/fail mask test evaluated natively on every frame, see pack_mask_rules()
+
+        :param trigger: one recorder trigger dict (see recorder_start), None: the first
+                        sample after mask_arm()
+        """
+        self._impl.mask_config(pack_triggers([trigger]) if trigger else b"", pack_mask_rules(rules))
+
+    def mask_arm(self, repeat: bool = False) -> None:
+        self._impl.mask_arm(repeat=repeat)
+
+    def mask_disarm(self) -> None:
+        self._impl.mask_disarm()
+
+    def mask_wait(self, after: int = 0, timeout: float = 1.0) -> int:
+        """ Wait (GIL released) until more than after tests are decided, returns tests decided """
+        return self._impl.mask_wait(after, timeout)
+
+    def mask_status(self) -> dict:
+        """ {"state", "repeat", "tests", "passed", "failed", "trigger", "offset",
+             "rules": [{"n", "mean", "peak", "min", "charge_uc"}]} of the running/last test """
+        return self._impl.mask_status()
+
+    def mask_verdicts(self, since: int = 0, max_verdicts: int = 1024) -> tuple[int, np.ndarray]:
+        """ Verdicts numbered >= since, (next since, MASK_VERDICT_DTYPE array) """
+        nxt, b = self._impl.mask_verdicts(since, max_verdicts)
+        return nxt, np.frombuffer(b, dtype=MASK_VERDICT_DTYPE)
+
+    def control_config(self, rules: list[dict], payloads: list[bytes], port: int = 0) -> None:
+        """ Closed-loop control rules evaluated natively per sample, see pack_control_rules()
+
+        :param payloads: one command payload (CBOR) per rule, framed once here and written
+                         to ucLog port `port` by the reader thread when the rule fires
+        """
+        self._impl.control_config(pack_control_rules(rules), list(payloads), port)
+
+    def control_arm(self) -> None:
+        self._impl.control_arm()
+
+    def control_disarm(self) -> None:
+        self._impl.control_disarm()
+
+    def control_wait(self, after: int = 0, timeout: float = 1.0) -> int:
+        """ Wait (GIL released) until more than after firings, returns firings """
+        return self._impl.control_wait(after, timeout)
+
+    def control_status(self) -> dict:
+        """ {"armed", "fired", "failed", "blocked", "wait_max_us", "latency_min_us", "latency_mean_us",
+             "latency_max_us", "rules": [{"fired", "enabled"}]}, latency from frame arrival to the command
+             written, blocked counts writes that waited for the TX writer or a full port """
+        return self._impl.control_status()
+
+    def control_events(self, since: int = 0, max_events: int = 1024) -> tuple[int, np.ndarray]:
+        """ Firings numbered >= since, (next since, CONTROL_EVENT_DTYPE array) """
+        nxt, b = self._impl.control_events(since, max_events)
+        return nxt, np.frombuffer(b, dtype=CONTROL_EVENT_DTYPE)
+
+    def sweep_start(self, payloads: list[bytes], mv: list[int], settle: int, window: int, ack_timeout: int,
+                    ack: str = "cmd_vout", port: int = 0) -> dict:
+        """ Native sweep: one CBOR payload per step, sent when the previous step's window closed;
+            settle, window and ack_timeout in samples, ack the response "f" of the payloads """
+        return self._impl.sweep_start(payloads, mv, settle, window, ack_timeout, ack, port)
+
+    def sweep_abort(self) -> dict:
+        return self._impl.sweep_abort()
+
+    def sweep_status(self) -> dict:
+        """ {"state": "idle" | "send" | "ack" | "settle" | "window" | "done" | "aborted",
+             "steps", "done", "noack", "elapsed_s"} """
+        return self._impl.sweep_status()
+
+    def sweep_wait(self, timeout: float = 1.0) -> bool:
+        """ True once the sweep is over (done or aborted), False on timeout """
+        return self._impl.sweep_wait(timeout)
+
+    def sweep_results(self, since: int = 0) -> np.ndarray:
+        """ Completed steps numbered >= since, SWEEP_STEP_DTYPE array """
+        return np.frombuffer(self._impl.sweep_results(since), dtype=SWEEP_STEP_DTYPE)
+
+    def sample_clock(self) -> dict:
+        """ Frame counter unwrap state and the device to host clock fit:
+            host_s = device_s + offset_s + drift * device_s, relative to origin_mono_ns /
+            origin_unix_ns (arrival of the first frame); device_s = abs index / sample_rate """
+        return self._impl.sample_clock()
+
+    def sample_clock_frame(self, c: int) -> tuple[int, int] | None:
+        """ (absolute index of the first sample, samples) of a recent frame by its counter """
+        return self._impl.sample_clock_frame(c)
+
+    def stream_to_abs(self, idx: int) -> int:
+        """ Absolute sample index of a stream sample index (digital/gated/segment indexes) """
+        return self._impl.stream_to_abs(idx)
+
+    def sample_to_unix_ns(self, idx, clock: dict | None = None):
+        """ Host Unix time (ns, int64) of absolute sample indexes, scalar or array
+
+        :param clock: a sample_clock() snapshot, to convert many batches consistently
+        """
+        ck = clock or self._impl.sample_clock()
+        dev = np.asarray(idx, dtype=np.float64) / ck["sample_rate"]
+        rel = np.rint((dev * (1.0 + ck["drift"]) + ck["offset_s"]) * 1e9).astype(np.int64)
+        t = rel + np.int64(ck["origin_unix_ns"])
+        return int(t) if t.ndim == 0 else t
+
+    def unix_ns_to_sample(self, t_ns, clock: dict | None = None):
+        """ Absolute sample index (float) at host Unix times in ns, scalar or array;
+            inverse of sample_to_unix_ns() """
+        ck = clock or self._impl.sample_clock()
+        rel = (np.asarray(t_ns, dtype=np.int64) - np.int64(ck["origin_unix_ns"])).astype(np.float64) / 1e9
+        idx = (rel - ck["offset_s"]) / (1.0 + ck["drift"]) * ck["sample_rate"]
+        return float(idx) if idx.ndim == 0 else idx
+
+    def start_metrics(self, shm_name: str | None = None, listen: str | None = None,
+                      period_ms: int = 250) -> str:
+        """ Publish native counters/histograms out-of-band, no GIL involved
+
+        :param shm_name: shared memory page name, None for the default per-port name,
+                         "" to keep the page private (exporter only)
+        :param listen: Prometheus exporter socket, "unix:/path" or "tcp:host:port"
+        :param period_ms: stats page refresh period
+        :return: the shared memory page name
+        """
+        return self._impl.start_metrics(shm_name=shm_name, listen=listen, period_ms=period_ms)
+
+    def stop_metrics(self) -> None:
+        self._impl.stop_metrics()
+
+    def stats_set(self, name: str, value: float, counter: bool = False) -> None:
+        self._impl.stats_set(name, value, counter)
+
+    def get_metrics_text(self) -> str:
+        return self._impl.get_metrics_text()
+
+
+class RingConsumer:
+    """ One independent reader of the shared sample ring
+
+    - columns: i, isnk (mA, float32), a0 (uint16), d01 (uint8, D0 bit 0, D1 bit 1), d0s (S1)
+    - samples are numbered from 0 since start, seq is that absolute index
+    - views returned by peek()/read() point into the ring itself, nothing is copied
+    - policy "overwrite": never holds up the producer, a consumer that falls a full ring
+      behind is lapped (see overrun in stats()); commit() tells if samples just read were
+      overwritten meanwhile
+    - policy "gate": the producer never overwrites samples this consumer has not committed,
+      when it is full new frames are dropped (ring_info()["dropped"]) - use for recorders
+    - wake: wait() returns once this many samples are available
+
+    Each consumer must be used from one thread at a time.
+    """
+
+    def __init__(self, impl, name: str, policy: str = "overwrite", wake: int = 1):
+        self._impl = impl
+        self.name = name
+        self.id = impl.ring_attach(name, policy=policy, wake=wake)
+        self._cols = {c: np.asarray(impl.ring_column(c)) for c in ("i", "isnk", "a0", "d01", "d0s")}
+        self.capacity = len(self._cols["i"])
+        self._mask = self.capacity - 1
+
+    def close(self) -> None:
+        if self.id is not None:
+            self._impl.ring_detach(self.id)
+            self.id = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __del__(self):
+        try:
+            self.close()
+        except Exception:
+            pass
+
+    def wait(self, min_samples: int = 0, timeout: float = 1.0) -> int:
+        """ block (GIL released) until min_samples (0: wake) are readable, returns count or 0 """
+        return self._impl.ring_wait(self.id, min_samples, timeout)
+
+    def available(self) -> int:
+        return self._impl.ring_poll(self.id)[1]
+
+    def peek(self, max_samples: int | None = None) -> list[tuple[int, dict]]:
+        """ readable samples as zero-copy column views, [(seq, {col: ndarray}), ...]
+            (two segments when the range wraps around the end of the ring) """
+        seq, n = self._impl.ring_poll(self.id)
+        if max_samples is not None:
+            n = min(n, max_samples)
+        segs = []
+        while n > 0:
+            a = seq & self._mask
+            m = min(n, self.capacity - a)
+            segs.append((seq, {k: v[a:a + m] for k, v in self._cols.items()}))
+            seq += m
+            n -= m
+        return segs
+
+    def commit(self, n: int) -> int:
+        """ release n samples, returns how many of them were overwritten while read """
+        return self._impl.ring_commit(self.id, n)
+
+    def read(self, max_samples: int | None = None, timeout: float | None = None) -> tuple[int, dict, int]:
+        """ wait (optional), take and commit readable samples
+
+        :return: (seq, {col: ndarray}, overwritten) - views when contiguous, copied only
+                 when the range wraps; overwritten > 0 means the first samples are not valid
+        """
+        if timeout is not None:
+            self.wait(0, timeout)
+        segs = self.peek(max_samples)
+        if not segs:
+            return self._impl.ring_poll(self.id)[0], {k: v[:0] for k, v in self._cols.items()}, 0
+        seq = segs[0][0]
+        if len(segs) == 1:
+            cols = segs[0][1]
+        else:
+            cols = {k: np.concatenate([s[1][k] for s in segs]) for k in self._cols}
+        return seq, cols, self.commit(len(cols["i"]))
+
+    def stats(self) -> dict:
+        for c in self._impl.ring_info()["consumers"]:
+            if c["id"] == self.id:
+                return c
+        return {}
+
+
+# Layout of stats_page.h, version 1
+_STATS_HDR = struct.Struct("<IIIIIIQQ64s")
+_STATS_ENTRY = struct.Struct("<40sIId")
+_STATS_HIST = struct.Struct("<40sQQ32Q")
+_STATS_MAX_ENTRIES = 64
+_STATS_MAX_HISTS = 8
+_STATS_PAGE_BYTES = 8192
+_STATS_MAGIC = 0x50313135
+
+
+def read_stats_page(shm_name: str, retries: int = 100) -> dict:
+    """ Read a stats page published by start_metrics() from any process
+
+    - does not need the serial port or the driver instance, only the page name
+    - follows the seqlock protocol, retries while the writer is mid-update
+
+    :param shm_name: name returned by start_metrics()
+    :return: {"port": str, "pid": int, "update_ms": int, "stats": {name: value},
+              "hists": {name: {"count", "sum", "buckets"}}}
+    """
+    if sys.platform == "win32":
+        mm = mmap.mmap(-1, _STATS_PAGE_BYTES, tagname=shm_name, access=mmap.ACCESS_READ)
+    else:
+        fd = os.open(os.path.join("/dev/shm", shm_name.lstrip("/")), os.O_RDONLY)
+        try:
+            mm = mmap.mmap(fd, _STATS_PAGE_BYTES, access=mmap.ACCESS_READ)
+        finally:
+            os.close(fd)
+
+    try:
+        for _ in range(retries):
+            seq1 = struct.unpack_from("<I", mm, 8)[0]
+            if seq1 & 1:
+                continue
+            raw = mm[:_STATS_PAGE_BYTES]
+            if struct.unpack_from("<I", mm, 8)[0] == seq1:
+                break
+        else:
+            raise RuntimeError(f"stats page {shm_name} busy")
+    finally:
+        mm.close()
+
+    magic, version, _, n_entries, n_hists, pid, update_ms, _, port = _STATS_HDR.unpack_from(raw, 0)
+    if magic != _STATS_MAGIC or version != 1:
+        raise ValueError(f"stats page {shm_name} invalid magic/version")
+
+    stats = {}
+    off = _STATS_HDR.size
+    for k in range(min(n_entries, _STATS_MAX_ENTRIES)):
+        name, _, _, value = _STATS_ENTRY.unpack_from(raw, off + k * _STATS_ENTRY.size)
+        stats[name.split(b"\0", 1)[0].decode()] = value
+
+    hists = {}
+    off += _STATS_MAX_ENTRIES * _STATS_ENTRY.size
+    for k in range(min(n_hists, _STATS_MAX_HISTS)):
+        v = _STATS_HIST.unpack_from(raw, off + k * _STATS_HIST.size)
+        hists[v[0].split(b"\0", 1)[0].decode()] = {"count": v[1], "sum": v[2], "buckets": list(v[3:])}
+
+    return {"port": port.split(b"\0", 1)[0].decode(), "pid": pid, "update_ms": update_ms,
+            "stats": stats, "hists": hists}
+
+
+DERIVED_CHANNELS = ("power", "energy", "net", "a0s")
+
+
+def derive(i, isnk=None, a0=None, channels=DERIVED_CHANNELS, vout_v: float = 0.0, a0_gain: float = 1.0,
+           a0_offset: float = 0.0, dt: float = 1.0 / 125000, energy0: float = 0.0) -> dict:
+    """ Derived channels computed in one native pass (see derived.h), no temporaries
+
+        power  mW  i * vout_v
+        energy mJ  energy0 + cumulative power * dt
+        net    mA  i - isnk
+        a0s        a0 * a0_gain + a0_offset
+
+    :return: {channel: float64 array}
+    """
+    bad = set(channels) - set(DERIVED_CHANNELS)
+    if bad:
+        raise ValueError(f"unknown derived channels {sorted(bad)}, expected {DERIVED_CHANNELS}")
+    i = np.ascontiguousarray(i, dtype=np.float64)
+    out = {c: np.empty(len(i)) for c in channels}
+    isnk = np.ascontiguousarray(isnk, dtype=np.float64) if "net" in out else None
+    a0 = np.ascontiguousarray(a0, dtype=np.float64) if "a0s" in out else None
+    mp_serial_ext.derive(i, isnk, a0, power=out.get("power"), energy=out.get("energy"), net=out.get("net"),
+                         a0s=out.get("a0s"), vout_v=vout_v, dt=dt, energy0=energy0,
+                         a0_gain=a0_gain, a0_offset=a0_offset)
+    return out
+
+
+# Layout of recording.h, version 1
+_REC_TRIGGER = struct.Struct("<BBbBf8x")
+_REC_HEADER = struct.Struct("<8sIIIIIIQQI12x")
+_REC_CHUNK = struct.Struct("<II")
+_REC_EVENT = struct.Struct("<QQQIHHQ")
+_REC_BACKGROUND = struct.Struct("<QII")
+_REC_END = struct.Struct("<QQQQQ")
+_REC_MAX_TRIGGERS = 8
+_REC_KINDS = {"current": 1, "digital": 2, "d0s": 3}
+REC_EVENT_TRUNCATED = 0x0001
+REC_BG_DTYPE = np.dtype([("i_mean", "<f4"), ("i_min", "<f4"), ("i_max", "<f4"), ("isnk_mean", "<f4")])
+
+# plot_point_t / plot_bucket_t records of plot_read() / plot_lod()
+PLOT_POINT_DTYPE = np.dtype([("seq", "<u8"), ("value", "<f4"), ("item", "<u4")])
+PLOT_BUCKET_DTYPE = np.dtype([("min", "<f4"), ("max", "<f4"), ("mean", "<f4"), ("n", "<u4")])
+
+# rs_hit_t records of search_recording()
+SEARCH_HIT_DTYPE = np.dtype([("seq", "<u8"), ("event", "<u8"), ("chunk", "<u8"), ("index", "<u4"), ("n", "<u4"),
+                             ("trigger", "<u2"), ("flags", "<u2"), ("value", "<f4")])
+SEARCH_HIT_BACKGROUND = 0x0001
+SEARCH_HIT_TRUNCATED = 0x0002
+
+
+# seqcap_seg_t records of seqcap_take()
+SEQCAP_SEG_DTYPE = np.dtype([("trigger_seq", "<u8"), ("host_ns", "<u8"), ("number", "<u8"), ("trigger", "<u2"),
+                             ("flags", "<u2"), ("reserved", "<u4")])
+
+
+def seqcap_columns(block, n: int, slots: int, width: int) -> dict:
+    """ Views of the first n segments of a sequence block of slots segments (seqcap.h) """
+    m = slots * width
+    cols = {}
+    off = 0
+    for name, dt in (("i", "<f4"), ("isnk", "<f4"), ("a0", "<u2"), ("d01", "u1"), ("d0s", "u1")):
+        es = np.dtype(dt).itemsize
+        cols[name] = np.frombuffer(block, dtype=dt, count=n * width, offset=off).reshape(n, width)
+        off += m * es
+    off = (off + 7) & ~7
+    cols["seg"] = np.frombuffer(block, dtype=SEQCAP_SEG_DTYPE, count=n, offset=off)
+    return cols
+
+
+def pack_triggers(triggers: list[dict]) -> bytes:
+    """ recorder trigger dicts (see MySerialManager.recorder_start) as rec_trigger_t records """
+    if len(triggers) > _REC_MAX_TRIGGERS:
+        raise ValueError(f"at most {_REC_MAX_TRIGGERS} triggers")
+    out = b""
+    for t in triggers:
+        kind = t.get("kind")
+        if kind == "current":
+            src = {"i": 0, "isnk": 1}[t.get("source", "i")]
+            out += _REC_TRIGGER.pack(1, src, int(t.get("slope", 1)), 0, float(t["level_ma"]))
+        elif kind == "digital":
+            out += _REC_TRIGGER.pack(2, int(t.get("line", 0)) & 1, int(t.get("slope", 1)), 0, 0.0)
+        elif kind == "d0s":
+            out += _REC_TRIGGER.pack(3, 0, 0, ord(t["char"]), 0.0)
+        else:
+            raise ValueError(f"unknown trigger kind {kind!r}")
+    return out
+
+
+_MASK_RULE = struct.Struct("<BB2xii4xdd")
+_MASK_MAX_RULES = 32
+_MASK_KINDS = {"envelope": 1, "mean": 2, "peak": 3, "min": 4, "charge": 5}
+_MASK_SOURCES = {"i": 0, "isnk": 1, "net": 2}
+
+
+def pack_mask_rules(rules: list[dict]) -> bytes:
+    """ mask rule dicts as mask_rule_t records
+
+        {"kind": "envelope"/"mean"/"peak"/"min"/"charge", "source": "i"/"isnk"/"net",
+         "start": <samples from the trigger>, "end": <exclusive>, "lower": <mA|uC>, "upper": ...}
+        a missing or None limit is not checked
+    """
+    if len(rules) > _MASK_MAX_RULES:
+        raise ValueError(f"at most {_MASK_MAX_RULES} rules")
+    nan = float("nan")
+    out = b""
+    for ru in rules:
+        kind, src = ru.get("kind"), ru.get("source", "i")
+        if kind not in _MASK_KINDS or src not in _MASK_SOURCES:
+            raise ValueError(f"rule kind must be one of {list(_MASK_KINDS)}, source one of {list(_MASK_SOURCES)}")
+        lower, upper = ru.get("lower"), ru.get("upper")
+        out += _MASK_RULE.pack(_MASK_KINDS[kind], _MASK_SOURCES[src],
+                               int(ru["start"]), int(ru["end"]),
+                               nan if lower is None else float(lower), nan if upper is None else float(upper))
+    return out
+
+
+_CONTROL_RULE = struct.Struct("<BBB1xII4xdd")
+_CONTROL_MAX_RULES = 16
+_CONTROL_SOURCES = {"i": 0, "isnk": 1, "net": 2, "d0": 3, "d1": 4}
+_CONTROL_CONDS = {"above": 0, "below": 1}
+
+
+def pack_control_rules(rules: list[dict]) -> bytes:
+    """ control rule dicts as ctl_rule_t records
+
+        {"source": "i"/"isnk"/"net"/"d0"/"d1", "cond": "above"/"below", "level": <mA, 0/1 for d0/d1>,
+         "hold": <samples>, "holdoff": <samples>, "hysteresis": <mA>, "once": <bool>}
+    """
+    if len(rules) > _CONTROL_MAX_RULES:
+        raise ValueError(f"at most {_CONTROL_MAX_RULES} rules")
+    out = b""
+    for ru in rules:
+        src, cond = ru.get("source", "i"), ru.get("cond", "above")
+        if src not in _CONTROL_SOURCES or cond not in _CONTROL_CONDS:
+            raise ValueError(f"rule source must be one of {list(_CONTROL_SOURCES)}, cond one of {list(_CONTROL_CONDS)}")
+        out += _CONTROL_RULE.pack(_CONTROL_SOURCES[src], _CONTROL_CONDS[cond], bool(ru.get("once", False)),
+                                  int(ru.get("hold", 1)), int(ru.get("holdoff", 0)),
+                                  float(ru["level"]), float(ru.get("hysteresis", 0.0)))
+    return out
+
+
+def _unpack_trigger(raw: bytes) -> dict:
+    kind, src, slope, ch, level = _REC_TRIGGER.unpack(raw)
+    if kind == 1:
+        return {"kind": "current", "source": ("i", "isnk")[src & 1], "level_ma": level, "slope": slope}
+    if kind == 2:
+        return {"kind": "digital", "line": src, "slope": slope}
+    if kind == 3:
+        return {"kind": "d0s", "char": chr(ch)}
+    return {"kind": None}
+
+
+def read_recording(path: str) -> dict:
+    """ Parse a file written by the event-triggered recorder (recording.h)
+
+    :return: {"header": {"sample_rate", "pre", "post", "decim", "start_seq", "start_unix_ns"},
+              "triggers": [dict], "events": [{"number", "trigger_seq", "start_seq", "trigger",
+              "truncated", "host_ns", "i", "isnk", "a0", "d01", "d0s"}],
+              "background": {"seq": uint64 array, "blocks": REC_BG_DTYPE array},
+              "end": {"end_seq", "events", "truncated", "bg_blocks", "lost"} or None if not closed cleanly}
+    """
+    with open(path, "rb") as f:
+        raw = f.read()
+    mv = memoryview(raw)
+
+    magic, version, header_size, rate, pre, post, decim, start_seq, start_ns, n_trig = _REC_HEADER.unpack_from(raw, 0)
+    if magic != b"P1150REC" or version != 1:
+        raise ValueError(f"{path}: not a P1150 recording (magic/version)")
+    trig_off = _REC_HEADER.size
+    triggers = [_unpack_trigger(raw[trig_off + k * _REC_TRIGGER.size: trig_off + (k + 1) * _REC_TRIGGER.size])
+                for k in range(min(n_trig, _REC_MAX_TRIGGERS))]
+
+    events, bg_seq, bg_blocks, end = [], [], [], None
+    off = header_size
+    while off + _REC_CHUNK.size <= len(raw):
+        ctype, size = _REC_CHUNK.unpack_from(raw, off)
+        off += _REC_CHUNK.size
+        if off + size > len(raw):
+            break  # cut short, e.g. the process was killed mid-write
+        if ctype == 1:
+            number, trig_seq, ev_start, n, trig, flags, host_ns = _REC_EVENT.unpack_from(raw, off)
+            p = off + _REC_EVENT.size
+            ev = {"number": number, "trigger_seq": trig_seq, "start_seq": ev_start, "trigger": trig,
+                  "truncated": bool(flags & REC_EVENT_TRUNCATED), "host_ns": host_ns}
+            for name, dt in (("i", "<f4"), ("isnk", "<f4"), ("a0", "<u2"), ("d01", "u1"), ("d0s", "S1")):
+                a = np.frombuffer(mv[p:p + n * np.dtype(dt).itemsize], dtype=dt)
+                ev[name] = a
+                p += a.nbytes
+            events.append(ev)
+        elif ctype == 2:
+            first, blocks, bdecim = _REC_BACKGROUND.unpack_from(raw, off)
+            p = off + _REC_BACKGROUND.size
+            bg_blocks.append(np.frombuffer(mv[p:p + blocks * REC_BG_DTYPE.itemsize], dtype=REC_BG_DTYPE))
+            bg_seq.append(first + np.arange(blocks, dtype=np.uint64) * bdecim)
+        elif ctype == 3:
+            end = dict(zip(("end_seq", "events", "truncated", "bg_blocks", "lost"), _REC_END.unpack_from(raw, off)))
+        off += size
+
+    return {"header": {"sample_rate": rate, "pre": pre, "post": post, "decim": decim,
+                       "start_seq": start_seq, "start_unix_ns": start_ns},
+            "triggers": triggers, "events": events,
+            "background": {"seq": np.concatenate(bg_seq) if bg_seq else np.empty(0, np.uint64),
+                           "blocks": np.concatenate(bg_blocks) if bg_blocks else np.empty(0, REC_BG_DTYPE)},
+            "end": end}
+
+
+def search_recording(path: str, triggers: list[dict], pre: int = 0, post: int = 0, workers: int = 0,
+                     background: bool = False, max_hits: int = 0) -> dict:
+    """ Trigger search over a file written by the event-triggered recorder, natively and
+        chunk-parallel over the mapped file (see rec_search.h)
+    - triggers are recorder trigger dicts (see pack_triggers), each one is followed on its own with
+      the recorder's semantics: level crossing with slope, D0/D1 edge, start of a d0s character
+    - every crossing in the event windows is a hit, sorted by sample index; with background the
+      decimated background blocks outside the windows are searched too (i triggers, block resolution)
+    - pre/post > 0 adds [index - pre, index + post) of each hit's window, NaN/0 outside it
+
+    :param workers: threads, 0 one per CPU
+    :param max_hits: keep the first max_hits hits, 0 all
+    :return: {"sample_rate", "start_seq", "hits": SEARCH_HIT_DTYPE array,
+              "context": {"i", "isnk", "a0", "d01", "d0s": 2-D arrays, one row per hit} or None,
+              "stats": {"bytes", "events", "samples", "bg_blocks", "hits", "limited", "workers", "units",
+                        "index_s", "search_s"}}
+    """
+    packed = pack_triggers(triggers)
+    if not packed:
+        raise ValueError("at least one trigger")
+    workers = workers or os.cpu_count() or 1
+    with open(path, "rb") as f:
+        size = os.fstat(f.fileno()).st_size
+        data = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) if size else b""
+    try:
+        raw, stats = mp_serial_ext.search_recording(data, packed, workers=min(workers, 64),
+                                                    background=background, max_hits=max_hits)
+        header = _REC_HEADER.unpack_from(data, 0)   # checked by the search
+        rate, start_seq = header[3], header[7]
+        hits = np.frombuffer(raw, dtype=SEARCH_HIT_DTYPE)
+        context = None
+        if pre + post > 0:
+            cols = mp_serial_ext.search_context(data, raw, pre, post)
+            w = pre + post
+            context = {name: np.frombuffer(c, dtype=dt).reshape(len(hits), w)
+                       for name, c, dt in zip(("i", "isnk", "a0", "d01", "d0s"), cols, ("<f4", "<f4", "<u2", "u1", "S1"))}
+    finally:
+        if size:
+            data.close()
+    return {"sample_rate": rate, "start_seq": start_seq, "hits": hits, "context": context, "stats": stats}
@@ -0,0 +1,235 @@
+// adc_frame.c
+#include "adc_frame.h"
+
+#include <math.h>
+#include <string.h>
+
+// Minimal CBOR reader, only what the firmware emits (definite lengths)
+
+typedef struct {
+    const uint8_t* p;
+    const uint8_t* end;
+} cbor_rd_t;
+
+// Read an item head; returns major type (0..7) or -1
+static int cbor_head(cbor_rd_t* r, uint64_t* arg) {
+    if (r->p >= r->end) return -1;
+    uint8_t ib = *r->p++;
+    int major = ib >> 5;
+    uint8_t ai = ib & 0x1f;
+
+    if (ai < 24) { *arg = ai; return major; }
+
+    size_t n;
+    switch (ai) {
+        case 24: n = 1; break;
+        case 25: n = 2; break;
+        case 26: n = 4; break;
+        case 27: n = 8; break;
+        default: return -1;  // indefinite length / reserved
+    }
+    if ((size_t)(r->end - r->p) < n) return -1;
+    uint64_t v = 0;
+    for (size_t k = 0; k < n; k++) v = (v << 8) | r->p[k];
+    r->p += n;
+    *arg = v;
+    return major;
+}
+
+static int cbor_skip(cbor_rd_t* r, int depth) {
+    uint64_t arg;
+    if (depth > 8) return -1;
+    int major = cbor_head(r, &arg);
+    switch (major) {
+        case 0: case 1: case 7:
+            return 0;  // ints, simple values and floats carry their payload in the head
+        case 2: case 3:
+            if ((uint64_t)(r->end - r->p) < arg) return -1;
+            r->p += arg;
+            return 0;
+        case 4:
+            for (uint64_t k = 0; k < arg; k++) if (cbor_skip(r, depth + 1) != 0) return -1;
+            return 0;
+        case 5:
+            for (uint64_t k = 0; k < 2 * arg; k++) if (cbor_skip(r, depth + 1) != 0) return -1;
+            return 0;
+        case 6:
+            return cbor_skip(r, depth + 1);
+        default:
+            return -1;
+    }
+}
+
+// Half precision float (major 7, ai 25)
+static double half_to_double(uint16_t h) {
+    int e = (h >> 10) & 0x1f;
+    double m = h & 0x3ff;
+    double v;
+    if (e == 0) v = ldexp(m, -24);
+    else if (e == 31) v = m == 0 ? INFINITY : NAN;
+    else v = ldexp(m + 1024.0, e - 25);
+    return (h & 0x8000) ? -v : v;
+}
+
+// A number item whose head was read; 0 ok, -1 not a number
+static int cbor_number(int major, uint64_t arg, int ai, double* out) {
+    if (major == 0) { *out = (double)arg; return 0; }
+    if (major == 1) { *out = -1.0 - (double)arg; return 0; }
+    if (major != 7) return -1;
+    if (ai == 20 || ai == 21) { *out = ai - 20; return 0; }   // false / true
+    if (ai == 25) { *out = half_to_double((uint16_t)arg); return 0; }
+    if (ai == 26) {
+        uint32_t b = (uint32_t)arg;
+        float f;
+        memcpy(&f, &b, 4);
+        *out = f;
+        return 0;
+    }
+    if (ai == 27) { memcpy(out, &arg, 8); return 0; }
+    return -1;
+}
+
+static int key_is(const uint8_t* k, uint64_t n, const char* s) {
+    size_t sl = strlen(s);
+    return n == sl && memcmp(k, s, sl) == 0;
+}
+
+int adc_frame_parse(const uint8_t* buf, size_t len, adc_frame_t* f) {
+    cbor_rd_t r = { buf, buf + len };
+    uint64_t npairs, arg;
+
+    memset(f, 0, sizeof(*f));
+    if (cbor_head(&r, &npairs) != 5) return -1;
+
+    for (uint64_t k = 0; k < npairs; k++) {
+        if (cbor_head(&r, &arg) != 3 || (uint64_t)(r.end - r.p) < arg) return -1;
+        const uint8_t* key = r.p;
+        uint64_t klen = arg;
+        r.p += arg;
+
+        const uint8_t* vstart = r.p;
+        int major = cbor_head(&r, &arg);
+        if (major == 0) {
+            if (key_is(key, klen, "c"))      { f->c = arg; f->present |= ADC_HAS_C; }
+            else if (key_is(key, klen, "a")) { f->a = arg; f->present |= ADC_HAS_A; }
+            continue;
+        }
+        if (major == 2) {
+            if ((uint64_t)(r.end - r.p) < arg) return -1;
+            adc_bytes_t b = { r.p, (size_t)arg };
+            r.p += arg;
+            if (key_is(key, klen, "i"))         { f->i = b;    f->present |= ADC_HAS_I; }
+            else if (key_is(key, klen, "isnk")) { f->isnk = b; f->present |= ADC_HAS_ISNK; }
+            else if (key_is(key, klen, "a0"))   { f->a0 = b;   f->present |= ADC_HAS_A0; }
+            else if (key_is(key, klen, "d01"))  { f->d01 = b;  f->present |= ADC_HAS_D01; }
+            else if (key_is(key, klen, "d0s"))  { f->d0s = b;  f->present |= ADC_HAS_D0S; }
+            continue;
+        }
+
+        r.p = vstart;  // anything else: skip the whole value
+        if (cbor_skip(&r, 0) != 0) return -1;
+    }
+    return 0;
+}
+
+int cmd_response_parse(const uint8_t* buf, size_t len, cmd_response_t* out) {
+    cbor_rd_t r = { buf, buf + len };
+    uint64_t npairs, arg;
+
+    memset(out, 0, sizeof(*out));
+    out->s = -1;
+    if (cbor_head(&r, &npairs) != 5) return -1;
+
+    for (uint64_t k = 0; k < npairs; k++) {
+        if (cbor_head(&r, &arg) != 3 || (uint64_t)(r.end - r.p) < arg) return -1;
+        const uint8_t* key = r.p;
+        uint64_t klen = arg;
+        r.p += arg;
+
+        const uint8_t* vstart = r.p;
+        int major = cbor_head(&r, &arg);
+        if (major == 3 && key_is(key, klen, "f")) {
+            if ((uint64_t)(r.end - r.p) < arg) return -1;
+            out->f.p = r.p;
+            out->f.n = (size_t)arg;
+            r.p += arg;
+            continue;
+        }
+        if (major == 7 && (arg == 20 || arg == 21) && key_is(key, klen, "s")) {
+            out->s = arg == 21;
+            continue;
+        }
+
+        r.p = vstart;
+        if (cbor_skip(&r, 0) != 0) return -1;
+    }
+    return out->f.p ? 0 : -1;
+}
+
+int plot_item_parse(const uint8_t* buf, size_t len, plot_value_fn fn, void* ctx) {
+    cbor_rd_t r = { buf, buf + len };
+    uint64_t npairs, arg;
+    float v[PLOT_ITEM_BATCH];
+
+    if (cbor_head(&r, &npairs) != 5) return -1;
+
+    for (uint64_t k = 0; k < npairs; k++) {
+        if (cbor_head(&r, &arg) != 3 || (uint64_t)(r.end - r.p) < arg) return -1;
+        const uint8_t* key = r.p;
+        size_t klen = (size_t)arg;
+        r.p += arg;
+
+        const uint8_t* vstart = r.p;
+        int ai = r.p < r.end ? (*r.p & 0x1f) : 0;
+        int major = cbor_head(&r, &arg);
+        double x;
+        if (major < 0) return -1;
+        if (cbor_number(major, arg, ai, &x) == 0) {
+            v[0] = (float)x;
+            fn(ctx, key, klen, v, 1, 0, 1);
+            continue;
+        }
+        if (major == 2) {
+            if ((uint64_t)(r.end - r.p) < arg) return -1;
+            const size_t total = (size_t)arg / 4;
+            const uint8_t* p = r.p;
+            r.p += arg;
+            for (size_t at = 0; at < total;) {
+                size_t m = total - at < PLOT_ITEM_BATCH ? total - at : PLOT_ITEM_BATCH;
+                memcpy(v, p + at * 4, m * 4);
+                fn(ctx, key, klen, v, m, at, total);
+                at += m;
+            }
+            continue;
+        }
+        if (major == 4) {
+            // every element takes at least one byte, bounds the count before trusting it
+            if ((uint64_t)(r.end - r.p) < arg) return -1;
+            const size_t total = (size_t)arg;
+            size_t m = 0, at = 0;
+            for (size_t q = 0; q < total; q++) {
+                const uint8_t* estart = r.p;
+                int eai = r.p < r.end ? (*r.p & 0x1f) : 0;
+                uint64_t earg;
+                int emaj = cbor_head(&r, &earg);
+                if (emaj < 0) return -1;
+                if (cbor_number(emaj, earg, eai, &x) != 0) {
+                    r.p = estart;
+                    if (cbor_skip(&r, 1) != 0) return -1;
+                    x = NAN;
+                }
+                v[m++] = (float)x;
+                if (m == PLOT_ITEM_BATCH || q + 1 == total) {
+                    fn(ctx, key, klen, v, m, at, total);
+                    at += m;
+                    m = 0;
+                }
+            }
+            continue;
+        }
+
+        r.p = vstart;
+        if (cbor_skip(&r, 0) != 0) return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,90 @@
+// adc_frame.h
+// Native parser for the P1150 ADC stream frame (ucLog port 3).
+//
+// A frame is one mux byte ((3 << 2) | LOG_TYPE_PORT) followed by a CBOR map:
+//   "c"    uint   frame counter
+//   "a"    uint   firmware side backlog
+//   "i"    bytes  <f4[N] source current, nA (/ 1e6: mA)
+//   "isnk" bytes  <f4[N] sink current, nA (/ 1e6: mA)
+//   "a0"   bytes  <u2[N] analog input
+//   "d01"  bytes  u1[N]  D0 (bit 0) / D1 (bit 1)
+//   "d0s"  bytes  N chars status
+// Unknown keys are skipped.  Byte strings are returned as views into the frame,
+// nothing is copied or allocated.
+#ifndef MP_SERIAL_ADC_FRAME_H
+#define MP_SERIAL_ADC_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ADC_FRAME_PORT       3
+#define ADC_FRAME_MUX_BYTE   ((ADC_FRAME_PORT << 2) | 3)
+#define ADC_SAMPLE_RATE_HZ   125000
+
+// adc_frame_t.present bits
+#define ADC_HAS_C     0x01u
+#define ADC_HAS_A     0x02u
+#define ADC_HAS_I     0x04u
+#define ADC_HAS_ISNK  0x08u
+#define ADC_HAS_A0    0x10u
+#define ADC_HAS_D01   0x20u
+#define ADC_HAS_D0S   0x40u
+
+typedef struct {
+    const uint8_t* p;
+    size_t         n;
+} adc_bytes_t;
+
+typedef struct {
+    uint32_t    present;
+    uint64_t    c;
+    uint64_t    a;
+    adc_bytes_t i;
+    adc_bytes_t isnk;
+    adc_bytes_t a0;
+    adc_bytes_t d01;
+    adc_bytes_t d0s;
+} adc_frame_t;
+
+// Parse the CBOR map (mux byte already stripped); 0 on success, -1 if malformed
+int adc_frame_parse(const uint8_t* buf, size_t len, adc_frame_t* f);
+
+// Number of samples in the frame (from "i"), 0 if absent
+static inline size_t adc_frame_samples(const adc_frame_t* f) {
+    return (f->present & ADC_HAS_I) ? f->i.n / 4u : 0u;
+}
+
+// Command response on ucLog port 0, a CBOR map {"f": "cmd_*", "s": bool, ...}
+typedef struct {
+    adc_bytes_t f;              // view into the frame
+    int         s;              // 1 true, 0 false, -1 absent
+} cmd_response_t;
+
+// Parse the CBOR map (mux byte already stripped); 0 on success, -1 if malformed or no "f"
+int cmd_response_parse(const uint8_t* buf, size_t len, cmd_response_t* r);
+
+// Debug plotter item on ucLog port 2, a CBOR map of channel name to
+//   number             one sample (int, float or bool)
+//   [number, ...]      samples, oldest first (elements that are no number are NaN)
+//   bytes              <f4[N] samples
+// Values of other types are skipped.  fn is called per channel with samples
+// [off, off + n) of total, converted to float, at most PLOT_ITEM_BATCH per call
+// (v is only valid during the call).
+#define PLOT_ITEM_BATCH  256
+
+typedef void (*plot_value_fn)(void* ctx, const uint8_t* name, size_t name_len, const float* v, size_t n,
+                              size_t off, size_t total);
+
+// Parse the CBOR map (mux byte already stripped); 0 on success, -1 if malformed (fn may
+// have been called for the channels before the error)
+int plot_item_parse(const uint8_t* buf, size_t len, plot_value_fn fn, void* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_ADC_FRAME_H
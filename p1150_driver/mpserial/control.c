@@ -0,0 +1,216 @@
+// control.c
+#include "control.h"
+
+#include <math.h>
+#include <string.h>
+
+#define CTL_EVENTS_CAP   ((uint64_t)1 << CTL_EVENTS_LOG2)
+#define CTL_EVENTS_MASK  (CTL_EVENTS_CAP - 1)
+
+int ctl_init(ctl_t* c, ctl_emit_fn emit, void* ctx) {
+    memset(c, 0, sizeof(*c));
+    mp_mutex_init(&c->mx);
+    mp_cond_init(&c->cv);
+    c->emit = emit;
+    c->emit_ctx = ctx;
+    c->events = (ctl_event_t*)calloc((size_t)CTL_EVENTS_CAP, sizeof(ctl_event_t));
+    return c->events ? 0 : -1;
+}
+
+void ctl_free(ctl_t* c) {
+    free(c->events);
+    c->events = NULL;
+    mp_cond_destroy(&c->cv);
+    mp_mutex_destroy(&c->mx);
+}
+
+// lock held
+static void reset_rules(ctl_t* c) {
+    for (uint32_t r = 0; r < c->n_rules; r++) {
+        c->ready[r] = 1;
+        c->run[r] = 0;
+        c->quiet_until[r] = 0;
+        c->st.rule_enabled[r] = 1;
+    }
+}
+
+int ctl_config(ctl_t* c, const ctl_rule_t* rules, const ctl_action_t* actions, uint32_t n_rules) {
+    if (n_rules > CTL_MAX_RULES) return -1;
+    for (uint32_t r = 0; r < n_rules; r++) {
+        const ctl_rule_t* ru = &rules[r];
+        if (ru->source > CTL_SRC_D1 || ru->cond > CTL_BELOW || isnan(ru->level) ||
+            !(ru->hysteresis >= 0.0) || actions[r].n == 0 || actions[r].n > CTL_ACTION_MAX) {
+            return -1;
+        }
+    }
+
+    mp_mutex_lock(&c->mx);
+    c->active = 0;
+    memcpy(c->rules, rules, n_rules * sizeof(ctl_rule_t));
+    memcpy(c->actions, actions, n_rules * sizeof(ctl_action_t));
+    c->n_rules = n_rules;
+    c->st.armed = 0;
+    c->st.n_rules = n_rules;
+    memset(c->st.rule_fired, 0, sizeof(c->st.rule_fired));
+    memset(c->st.rule_enabled, 0, sizeof(c->st.rule_enabled));
+    reset_rules(c);
+    mp_cond_broadcast(&c->cv);
+    mp_mutex_unlock(&c->mx);
+    return 0;
+}
+
+int ctl_arm(ctl_t* c) {
+    mp_mutex_lock(&c->mx);
+    int rv = c->n_rules ? 0 : -1;
+    if (rv == 0) {
+        reset_rules(c);
+        c->st.armed = 1;
+        c->active = 1;
+    }
+    mp_mutex_unlock(&c->mx);
+    return rv;
+}
+
+void ctl_disarm(ctl_t* c) {
+    mp_mutex_lock(&c->mx);
+    c->active = 0;
+    c->st.armed = 0;
+    mp_cond_broadcast(&c->cv);
+    mp_mutex_unlock(&c->mx);
+}
+
+// ----------------- Evaluation (reader thread, lock held) -----------------
+
+static void fire(ctl_t* c, uint32_t r, uint64_t sample, double v, uint32_t lag, uint64_t rx_ns) {
+    uint64_t t0 = mp_now_ns(), wait = 0;
+    int rc = c->emit(c->emit_ctx, c->actions[r].b, c->actions[r].n, &wait);
+    uint64_t t1 = mp_now_ns();
+
+    ctl_event_t* e = &c->events[c->st.fired & CTL_EVENTS_MASK];
+    e->number = c->st.fired;
+    e->sample = sample;
+    e->value = v;
+    e->detect_ns = t0 > rx_ns ? t0 - rx_ns : 0;
+    e->write_ns = t1 > rx_ns ? t1 - rx_ns : 0;
+    e->wait_ns = wait;
+    e->lag = lag;
+    e->rule = (int16_t)r;
+    e->rc = (int16_t)rc;
+
+    c->st.fired++;
+    c->st.rule_fired[r]++;
+    if (wait) {
+        c->st.blocked++;
+        if (wait > c->st.wait_max_ns) c->st.wait_max_ns = wait;
+    }
+    if (rc == 0) {
+        uint64_t w = e->write_ns;
+        if (c->st.fired - c->st.failed == 1 || w < c->st.lat_min_ns) c->st.lat_min_ns = w;
+        if (w > c->st.lat_max_ns) c->st.lat_max_ns = w;
+        c->st.lat_sum_ns += (double)w;
+    } else {
+        c->st.failed++;
+    }
+    mp_cond_broadcast(&c->cv);
+}
+
+static inline int value_at(const ctl_rule_t* ru, const adc_frame_t* f, size_t k, double* v) {
+    float a = 0.0f, b = 0.0f;
+    const int has_i = (k + 1) * 4 <= f->i.n;
+    const int has_s = (f->present & ADC_HAS_ISNK) && (k + 1) * 4 <= f->isnk.n;
+    switch (ru->source) {
+    case CTL_SRC_D0:
+    case CTL_SRC_D1:
+        if (!(f->present & ADC_HAS_D01) || k >= f->d01.n) return 0;
+        *v = (double)((f->d01.p[k] >> (ru->source - CTL_SRC_D0)) & 1u);
+        return 1;
+    case CTL_SRC_I:
+        if (!has_i) return 0;
+        memcpy(&a, f->i.p + k * 4, 4);
+        break;
+    case CTL_SRC_ISNK:
+        if (!has_s) return 0;
+        memcpy(&a, f->isnk.p + k * 4, 4);
+        break;
+    default:
+        if (!has_i || !has_s) return 0;
+        memcpy(&a, f->i.p + k * 4, 4);
+        memcpy(&b, f->isnk.p + k * 4, 4);
+        break;
+    }
+    *v = ((double)a - (double)b) / 1000000.0;
+    return 1;
+}
+
+void ctl_feed(ctl_t* c, uint64_t base, const adc_frame_t* f, uint64_t rx_ns) {
+    if (!c->active) return;
+    size_t n = adc_frame_samples(f);
+    if (n == 0) return;
+
+    mp_mutex_lock(&c->mx);
+    for (uint32_t r = 0; r < c->n_rules && c->active; r++) {
+        if (!c->st.rule_enabled[r]) continue;
+        const ctl_rule_t* ru = &c->rules[r];
+        const uint32_t hold = ru->hold ? ru->hold : 1;
+        const int above = ru->cond == CTL_ABOVE;
+        const double rearm = above ? ru->level - ru->hysteresis : ru->level + ru->hysteresis;
+
+        for (size_t k = 0; k < n; k++) {
+            double v;
+            if (!value_at(ru, f, k, &v)) break;
+            uint64_t idx = base + k;
+            if (c->ready[r]) {
+                if (above ? v > ru->level : v < ru->level) {
+                    if (++c->run[r] < hold) continue;
+                    fire(c, r, idx, v, (uint32_t)(n - 1 - k), rx_ns);
+                    c->ready[r] = 0;
+                    c->run[r] = 0;
+                    c->quiet_until[r] = idx + 1 + ru->holdoff;
+                    if (ru->once) {
+                        c->st.rule_enabled[r] = 0;
+                        break;
+                    }
+                } else {
+                    c->run[r] = 0;
+                }
+            } else if (idx >= c->quiet_until[r] && (above ? v <= rearm : v >= rearm)) {
+                c->ready[r] = 1;
+            }
+        }
+    }
+    mp_mutex_unlock(&c->mx);
+}
+
+// ----------------- Readers -----------------
+
+uint64_t ctl_wait(ctl_t* c, uint64_t after, unsigned timeout_ms) {
+    uint64_t deadline = mp_now_ns() / 1000000u + timeout_ms;
+    mp_mutex_lock(&c->mx);
+    while (c->st.fired <= after && c->st.armed) {
+        uint64_t now = mp_now_ns() / 1000000u;
+        if (now >= deadline) break;
+        mp_cond_wait_ms(&c->cv, &c->mx, (unsigned)(deadline - now));
+    }
+    uint64_t fired = c->st.fired;
+    mp_mutex_unlock(&c->mx);
+    return fired;
+}
+
+void ctl_status(ctl_t* c, ctl_status_t* out) {
+    mp_mutex_lock(&c->mx);
+    *out = c->st;
+    mp_mutex_unlock(&c->mx);
+}
+
+size_t ctl_events(ctl_t* c, uint64_t since, ctl_event_t* out, size_t cap, uint64_t* next) {
+    size_t cnt = 0;
+    mp_mutex_lock(&c->mx);
+    uint64_t lo = c->st.fired > CTL_EVENTS_CAP ? c->st.fired - CTL_EVENTS_CAP : 0;
+    uint64_t k = since < lo ? lo : since;
+    for (; k < c->st.fired && cnt < cap; k++) {
+        out[cnt++] = c->events[k & CTL_EVENTS_MASK];
+    }
+    *next = k;
+    mp_mutex_unlock(&c->mx);
+    return cnt;
+}
@@ -0,0 +1,122 @@
+// control.h
+// Closed-loop control: rules evaluated per sample in the reader thread, each with a
+// pre-encoded command that is written to the port the moment the rule fires.
+//
+// A rule compares i, isnk, i - isnk (mA) or D0/D1 (0/1) against a level.  It fires when
+// the condition has held for `hold` consecutive samples, then stays quiet until the
+// value is back beyond the level by `hysteresis` and `holdoff` samples have passed.
+// A `once` rule is disabled after it fired.  The action is an already framed byte
+// string (see p1150_frame()), nothing is encoded or allocated on the hot path.
+//
+// Every firing is logged with its reaction time measured from the arrival of the
+// frame (read() returned) to the decision and to the command written to the port,
+// plus the samples that followed the firing one in its frame (firmware batching,
+// which the host cannot see).
+#ifndef MP_SERIAL_CONTROL_H
+#define MP_SERIAL_CONTROL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mp_platform.h"
+#include "adc_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CTL_MAX_RULES     16
+#define CTL_ACTION_MAX    256         // framed command bytes
+#define CTL_EVENTS_LOG2   10          // firings kept
+
+enum { CTL_SRC_I, CTL_SRC_ISNK, CTL_SRC_NET, CTL_SRC_D0, CTL_SRC_D1 };
+enum { CTL_ABOVE, CTL_BELOW };
+
+typedef struct {                // 32 bytes, packed by Python
+    uint8_t  source;            // CTL_SRC_*
+    uint8_t  cond;              // CTL_ABOVE: value > level, CTL_BELOW: value < level
+    uint8_t  once;              // disable the rule after it fired
+    uint8_t  reserved;
+    uint32_t hold;              // consecutive samples the condition must hold, 0 = 1
+    uint32_t holdoff;           // samples after firing before the rule can re-arm
+    uint32_t reserved2;
+    double   level;             // mA, 0/1 for D0/D1
+    double   hysteresis;        // re-arms at level -/+ hysteresis
+} ctl_rule_t;
+
+typedef struct {
+    uint16_t n;
+    uint8_t  b[CTL_ACTION_MAX];
+} ctl_action_t;
+
+typedef struct {                // 56 bytes
+    uint64_t number;
+    uint64_t sample;            // stream sample index that fired
+    double   value;
+    uint64_t detect_ns;         // frame arrival to decision
+    uint64_t write_ns;          // frame arrival to the command written
+    uint64_t wait_ns;           // of write_ns, blocked on the TX writer or a full port
+    uint32_t lag;               // samples after the firing one in its frame
+    int16_t  rule;
+    int16_t  rc;                // 0 written, else the P1150_E* code of the write
+} ctl_event_t;
+
+typedef struct {
+    int       armed;
+    uint32_t  n_rules;
+    uint64_t  fired;
+    uint64_t  failed;           // fired but not written (link down, write error)
+    uint64_t  blocked;          // the write had to wait (wait_ns > 0)
+    uint64_t  wait_max_ns;
+    uint64_t  lat_min_ns;       // write_ns of the written commands
+    uint64_t  lat_max_ns;
+    double    lat_sum_ns;
+    uint64_t  rule_fired[CTL_MAX_RULES];
+    uint8_t   rule_enabled[CTL_MAX_RULES];
+} ctl_status_t;
+
+// Writes one framed command; 0 or a negative P1150_E* code.  *wait_ns (may be NULL)
+// gets the time the write was blocked, 0 when it went straight out.
+typedef int (*ctl_emit_fn)(void* ctx, const uint8_t* p, size_t n, uint64_t* wait_ns);
+
+typedef struct {
+    ctl_rule_t     rules[CTL_MAX_RULES];
+    ctl_action_t   actions[CTL_MAX_RULES];
+    uint32_t       n_rules;
+
+    // per rule evaluation state
+    uint8_t        ready[CTL_MAX_RULES];     // condition may fire
+    uint32_t       run[CTL_MAX_RULES];       // consecutive samples the condition held
+    uint64_t       quiet_until[CTL_MAX_RULES];
+
+    volatile int   active;      // armed with rules, read without the lock by the reader
+    ctl_status_t   st;
+    ctl_event_t*   events;
+    ctl_emit_fn    emit;
+    void*          emit_ctx;
+    mp_mutex_t     mx;          // reader thread feeds, Python configures/reads
+    mp_cond_t      cv;          // events
+} ctl_t;
+
+int  ctl_init(ctl_t* c, ctl_emit_fn emit, void* ctx);
+void ctl_free(ctl_t* c);
+
+// Replace the rules (disarms); -1 bad rule or action
+int  ctl_config(ctl_t* c, const ctl_rule_t* rules, const ctl_action_t* actions, uint32_t n_rules);
+int  ctl_arm(ctl_t* c);         // -1 without rules; re-enables fired once rules
+void ctl_disarm(ctl_t* c);
+
+// Reader thread: one frame starting at stream sample index base, arrived at rx_ns
+void ctl_feed(ctl_t* c, uint64_t base, const adc_frame_t* f, uint64_t rx_ns);
+
+// Block until more than after firings are logged, disarm or timeout; returns firings
+uint64_t ctl_wait(ctl_t* c, uint64_t after, unsigned timeout_ms);
+
+void   ctl_status(ctl_t* c, ctl_status_t* out);
+size_t ctl_events(ctl_t* c, uint64_t since, ctl_event_t* out, size_t cap, uint64_t* next);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_CONTROL_H
@@ -0,0 +1,95 @@
+// current_hist.c
+#include "current_hist.h"
+
+#include <math.h>
+#include <string.h>
+
+#define SLOT_WORDS  ((size_t)CHIST_CHANNELS * CHIST_NBINS)
+
+int chist_init(chist_t* h) {
+    memset(h, 0, sizeof(*h));
+    mp_mutex_init(&h->mx);
+    h->slots = (uint32_t*)calloc((size_t)CHIST_SLOTS * SLOT_WORDS, sizeof(uint32_t));
+    if (!h->slots) return -1;
+    h->slot_samples = (uint64_t)CHIST_SLOT_MS_DEFAULT * ADC_SAMPLE_RATE_HZ / 1000u;
+    return 0;
+}
+
+void chist_free(chist_t* h) {
+    free(h->slots);
+    h->slots = NULL;
+    mp_mutex_destroy(&h->mx);
+}
+
+void chist_reset(chist_t* h, uint32_t slot_ms, uint64_t base) {
+    mp_mutex_lock(&h->mx);
+    memset(h->total, 0, sizeof(h->total));
+    memset(h->slots, 0, (size_t)CHIST_SLOTS * SLOT_WORDS * sizeof(uint32_t));
+    if (slot_ms) h->slot_samples = (uint64_t)slot_ms * ADC_SAMPLE_RATE_HZ / 1000u;
+    h->slot_fill = 0;
+    h->slots_done = 0;
+    h->samples = 0;
+    h->since = base;
+    mp_mutex_unlock(&h->mx);
+}
+
+double chist_edge_ma(int b) {
+    return pow(10.0, CHIST_DECADE_MIN + (double)(b - 1) / CHIST_BINS_PER_DECADE);
+}
+
+static inline int bin_of(float ma) {
+    if (!(ma >= 1e-6f)) return 0;   // also NaN
+    int b = 1 + (int)floorf((log10f(ma) - (float)CHIST_DECADE_MIN) * CHIST_BINS_PER_DECADE);
+    if (b < 1) b = 1;               // rounding at the lowest edge
+    return b > CHIST_LOG_BINS ? CHIST_NBINS - 1 : b;
+}
+
+void chist_feed(chist_t* h, const adc_frame_t* f) {
+    size_t n = adc_frame_samples(f);
+    if (n == 0) return;
+    const adc_bytes_t* src[CHIST_CHANNELS] = { &f->i, &f->isnk };
+
+    mp_mutex_lock(&h->mx);
+    for (size_t k = 0; k < n; k++) {
+        uint32_t* slot = h->slots + (size_t)(h->slots_done % CHIST_SLOTS) * SLOT_WORDS;
+        for (int c = 0; c < CHIST_CHANNELS; c++) {
+            const adc_bytes_t* b = src[c];
+            if (!b->p || (k + 1) * 4 > b->n) continue;
+            float v;
+            memcpy(&v, b->p + k * 4, 4);
+            int bin = bin_of((float)((double)v / 1000000.0));
+            h->total[c][bin]++;
+            slot[c * CHIST_NBINS + bin]++;
+        }
+        h->samples++;
+        if (++h->slot_fill >= h->slot_samples) {
+            h->slot_fill = 0;
+            h->slots_done++;
+            memset(h->slots + (size_t)(h->slots_done % CHIST_SLOTS) * SLOT_WORDS, 0, SLOT_WORDS * sizeof(uint32_t));
+        }
+    }
+    mp_mutex_unlock(&h->mx);
+}
+
+uint64_t chist_query(chist_t* h, int ch, uint32_t window, uint64_t* out) {
+    uint64_t covered;
+    memset(out, 0, CHIST_NBINS * sizeof(uint64_t));
+    if (ch < 0 || ch >= CHIST_CHANNELS) return 0;
+
+    mp_mutex_lock(&h->mx);
+    if (window == 0) {
+        memcpy(out, h->total[ch], sizeof(h->total[ch]));
+        covered = h->samples;
+    } else {
+        uint64_t have = h->slots_done + 1;   // completed + current
+        if (window > CHIST_SLOTS) window = CHIST_SLOTS;
+        if (window > have) window = (uint32_t)have;
+        for (uint32_t w = 0; w < window; w++) {
+            const uint32_t* slot = h->slots + (size_t)((h->slots_done - w) % CHIST_SLOTS) * SLOT_WORDS + ch * CHIST_NBINS;
+            for (int b = 0; b < CHIST_NBINS; b++) out[b] += slot[b];
+        }
+        covered = h->slot_fill + (uint64_t)(window - 1) * h->slot_samples;
+    }
+    mp_mutex_unlock(&h->mx);
+    return covered;
+}
@@ -0,0 +1,64 @@
+// current_hist.h
+// Log-binned current distribution of i and isnk, for days of streaming.
+//
+// Every ADC sample is counted into one of CHIST_NBINS bins per channel:
+//   bin 0                     below 1 nA, including zero and negative values
+//   bin 1 .. CHIST_LOG_BINS   CHIST_BINS_PER_DECADE log spaced bins per decade, 1 nA .. 10 A
+//   bin CHIST_NBINS - 1       10 A and above
+// Counts go to a total since the last reset (uint64, never wraps in practice) and to a
+// ring of time slots, so a window over the last N slots can be queried as well.
+// Nothing per sample is stored; histograms and CCDFs are built from the counts.
+#ifndef MP_SERIAL_CURRENT_HIST_H
+#define MP_SERIAL_CURRENT_HIST_H
+
+#include <stdint.h>
+
+#include "mp_platform.h"
+#include "adc_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHIST_CHANNELS          2     // i, isnk
+#define CHIST_DECADE_MIN        (-6)  // 1e-6 mA = 1 nA
+#define CHIST_DECADES           10
+#define CHIST_BINS_PER_DECADE   20
+#define CHIST_LOG_BINS          (CHIST_DECADES * CHIST_BINS_PER_DECADE)
+#define CHIST_NBINS             (CHIST_LOG_BINS + 2)
+#define CHIST_SLOTS             256
+#define CHIST_SLOT_MS_DEFAULT   1000
+#define CHIST_SLOT_MS_MAX       60000
+
+typedef struct {
+    uint64_t   total[CHIST_CHANNELS][CHIST_NBINS];
+    uint32_t*  slots;             // [CHIST_SLOTS][CHIST_CHANNELS][CHIST_NBINS]
+    uint64_t   slot_samples;      // samples per slot
+    uint64_t   slot_fill;         // samples in the current slot
+    uint64_t   slots_done;        // completed slots since reset
+    uint64_t   samples;           // since reset
+    uint64_t   since;             // stream sample index of the last reset
+    mp_mutex_t mx;                // reader thread feeds, Python reads
+} chist_t;
+
+int  chist_init(chist_t* h);      // 0 on success
+void chist_free(chist_t* h);
+
+// Reader thread: count the samples of one frame
+void chist_feed(chist_t* h, const adc_frame_t* f);
+
+// Clear all counts; slot_ms 0 keeps the slot length
+void chist_reset(chist_t* h, uint32_t slot_ms, uint64_t base);
+
+// Counts of channel ch into out[CHIST_NBINS]: window 0 = since reset, else the
+// current slot plus the last window - 1 completed ones.  Returns samples covered.
+uint64_t chist_query(chist_t* h, int ch, uint32_t window, uint64_t* out);
+
+// Lower edge of log bin b (1 .. CHIST_LOG_BINS + 1) in mA
+double chist_edge_ma(int b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_CURRENT_HIST_H
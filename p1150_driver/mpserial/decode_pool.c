@@ -0,0 +1,241 @@
+// decode_pool.c
+#include "decode_pool.h"
+
+#include <math.h>
+#include <string.h>
+
+static void batch_free(dpool_batch_t* b) {
+    free(b->in);
+    free(b->adc);
+    free(b->i);
+    free(b->isnk);
+    free(b->a0);
+    free(b->d01);
+    free(b->d0s);
+}
+
+static int batch_alloc(dpool_batch_t* b) {
+    memset(b, 0, sizeof(*b));
+    b->cap = DPOOL_BATCH_BYTES / 4u;  // "i" alone takes 4 bytes per sample
+    b->in = (uint8_t*)malloc(DPOOL_BATCH_BYTES);
+    b->adc = (dpool_adc_t*)malloc(DPOOL_BATCH_FRAMES * sizeof(dpool_adc_t));
+    b->i = (float*)malloc(b->cap * sizeof(float));
+    b->isnk = (float*)malloc(b->cap * sizeof(float));
+    b->a0 = (double*)malloc(b->cap * sizeof(double));
+    b->d01 = (uint8_t*)malloc(b->cap);
+    b->d0s = (char*)malloc(b->cap);
+    return b->in && b->adc && b->i && b->isnk && b->a0 && b->d01 && b->d0s ? 0 : -1;
+}
+
+// ----------------- Decoding -----------------
+
+// nA float32 to mA rounded to 6 decimals, in float32 like numpy's np.round(x / 1e6, 6)
+static inline float na_to_ma(const uint8_t* p) {
+    float v;
+    memcpy(&v, p, 4);
+    v = v / 1000000.0f;
+    return rintf(v * 1000000.0f) / 1000000.0f;
+}
+
+// The complete frame form the Python pipeline expects, otherwise it stays raw
+static int adc_complete(const adc_frame_t* f, size_t n) {
+    const uint32_t need = ADC_HAS_C | ADC_HAS_I | ADC_HAS_ISNK | ADC_HAS_A0 | ADC_HAS_D01 | ADC_HAS_D0S;
+    if ((f->present & need) != need || n == 0) return 0;
+    if (f->isnk.n != n * 4 || f->a0.n != n * 2 || f->d01.n != n || f->d0s.n != n) return 0;
+    for (size_t k = 0; k < n; k++) {
+        if (f->d0s.p[k] & 0x80) return 0;   // one char per sample
+    }
+    return 1;
+}
+
+void dpool_decode(dpool_batch_t* b) {
+    uint64_t t0 = mp_now_ns();
+    size_t at = 0;
+    b->n_adc = 0;
+    b->samples = 0;
+
+    for (uint32_t fi = 0; fi < b->frames && at + 2 <= b->in_len; fi++) {
+        uint16_t len;
+        memcpy(&len, b->in + at, 2);
+        const uint8_t* fr = b->in + at + 2;
+        at += 2u + len;
+        if (len < 2 || fr[0] != ADC_FRAME_MUX_BYTE || b->n_adc >= DPOOL_BATCH_FRAMES) continue;
+
+        adc_frame_t f;
+        if (adc_frame_parse(fr + 1, (size_t)len - 1, &f) != 0) continue;
+        size_t n = adc_frame_samples(&f);
+        if (!adc_complete(&f, n) || b->samples + n > b->cap) continue;
+
+        size_t s0 = b->samples;
+        for (size_t k = 0; k < n; k++) {
+            uint16_t a0;
+            b->i[s0 + k] = na_to_ma(f.i.p + k * 4);
+            b->isnk[s0 + k] = na_to_ma(f.isnk.p + k * 4);
+            memcpy(&a0, f.a0.p + k * 2, 2);
+            b->a0[s0 + k] = (double)a0;
+        }
+        memcpy(b->d01 + s0, f.d01.p, n);
+        memcpy(b->d0s + s0, f.d0s.p, n);
+
+        dpool_adc_t* r = &b->adc[b->n_adc++];
+        r->c = f.c;
+        r->a = f.a;
+        r->start = (uint32_t)s0;
+        r->n = (uint32_t)n;
+        r->present = f.present;
+        r->frame = fi;
+        b->samples += n;
+    }
+    b->decode_ns = mp_now_ns() - t0;
+}
+
+// ----------------- Pool -----------------
+
+static void* worker_fn(void* param) {
+    dpool_t* p = (dpool_t*)param;
+    mp_mutex_lock(&p->mx);
+    while (p->alive) {
+        dpool_batch_t* b = NULL;
+        for (uint64_t s = p->next_collect; s < p->next_fill; s++) {
+            dpool_batch_t* c = &p->slots[s % p->n_slots];
+            if (c->state == DPOOL_QUEUED) {
+                b = c;
+                break;
+            }
+        }
+        if (!b) {
+            mp_cond_wait_ms(&p->work_cv, &p->mx, 100);
+            continue;
+        }
+        b->state = DPOOL_DECODING;
+        mp_mutex_unlock(&p->mx);
+
+        dpool_decode(b);
+
+        mp_mutex_lock(&p->mx);
+        b->state = DPOOL_DONE;
+        p->st.batches++;
+        p->st.frames += b->frames;
+        p->st.adc_frames += b->n_adc;
+        p->st.samples += b->samples;
+        p->st.decode_ns += b->decode_ns;
+        mp_cond_broadcast(&p->done_cv);
+    }
+    mp_mutex_unlock(&p->mx);
+    return NULL;
+}
+
+int dpool_init(dpool_t* p, unsigned workers, unsigned slots) {
+    memset(p, 0, sizeof(*p));
+    if (workers < 1 || workers > DPOOL_MAX_WORKERS) return -1;
+    if (slots == 0) slots = 2 * workers;
+    if (slots < workers) return -1;
+
+    p->slots = (dpool_batch_t*)calloc(slots, sizeof(dpool_batch_t));
+    if (!p->slots) return -2;
+    p->n_slots = slots;
+    for (unsigned s = 0; s < slots; s++) {
+        if (batch_alloc(&p->slots[s]) != 0) {
+            for (unsigned k = 0; k <= s; k++) batch_free(&p->slots[k]);
+            free(p->slots);
+            p->slots = NULL;
+            return -2;
+        }
+    }
+    mp_mutex_init(&p->mx);
+    mp_cond_init(&p->work_cv);
+    mp_cond_init(&p->done_cv);
+    p->st.slots = slots;
+    const uint64_t cap = p->slots[0].cap;
+    p->st.bytes = (uint64_t)slots * (sizeof(dpool_batch_t) + DPOOL_BATCH_BYTES
+                                     + DPOOL_BATCH_FRAMES * sizeof(dpool_adc_t)
+                                     + cap * (sizeof(float) * 2 + sizeof(double) + 2));
+
+    p->alive = 1;
+    for (unsigned w = 0; w < workers; w++) {
+        if (mp_thread_start(&p->threads[w], worker_fn, p) != 0) {
+            dpool_free(p);
+            return -2;
+        }
+        p->n_workers++;
+    }
+    p->st.workers = workers;
+    return 0;
+}
+
+void dpool_free(dpool_t* p) {
+    if (!p->slots) return;
+    mp_mutex_lock(&p->mx);
+    p->alive = 0;
+    mp_cond_broadcast(&p->work_cv);
+    mp_cond_broadcast(&p->done_cv);
+    mp_mutex_unlock(&p->mx);
+    for (uint32_t w = 0; w < p->n_workers; w++) mp_thread_join(&p->threads[w]);
+    p->n_workers = 0;
+
+    for (uint32_t s = 0; s < p->n_slots; s++) batch_free(&p->slots[s]);
+    free(p->slots);
+    p->slots = NULL;
+    mp_cond_destroy(&p->done_cv);
+    mp_cond_destroy(&p->work_cv);
+    mp_mutex_destroy(&p->mx);
+}
+
+dpool_batch_t* dpool_acquire(dpool_t* p) {
+    dpool_batch_t* b = NULL;
+    mp_mutex_lock(&p->mx);
+    dpool_batch_t* c = &p->slots[p->next_fill % p->n_slots];
+    if (p->alive && c->state == DPOOL_FREE) {
+        b = c;
+        b->state = DPOOL_FILLING;
+        b->seq = p->next_fill++;
+        b->in_len = 0;
+        b->frames = 0;
+    }
+    mp_mutex_unlock(&p->mx);
+    return b;
+}
+
+void dpool_submit(dpool_t* p, dpool_batch_t* b) {
+    mp_mutex_lock(&p->mx);
+    b->state = DPOOL_QUEUED;
+    mp_cond_broadcast(&p->work_cv);
+    mp_mutex_unlock(&p->mx);
+}
+
+dpool_batch_t* dpool_collect(dpool_t* p, unsigned timeout_ms) {
+    uint64_t t0 = mp_now_ns();
+    uint64_t deadline = t0 / 1000000u + timeout_ms;
+    dpool_batch_t* b = NULL;
+
+    mp_mutex_lock(&p->mx);
+    while (p->next_collect < p->next_fill) {
+        dpool_batch_t* c = &p->slots[p->next_collect % p->n_slots];
+        if (c->state == DPOOL_DONE) {
+            c->state = DPOOL_COLLECTED;
+            p->next_collect++;
+            b = c;
+            break;
+        }
+        uint64_t now = mp_now_ns() / 1000000u;
+        if (!p->alive || now >= deadline) break;
+        mp_cond_wait_ms(&p->done_cv, &p->mx, (unsigned)(deadline - now));
+    }
+    p->st.collect_wait_ns += mp_now_ns() - t0;
+    mp_mutex_unlock(&p->mx);
+    return b;
+}
+
+void dpool_release(dpool_t* p, dpool_batch_t* b) {
+    mp_mutex_lock(&p->mx);
+    b->state = DPOOL_FREE;
+    mp_cond_broadcast(&p->done_cv);
+    mp_mutex_unlock(&p->mx);
+}
+
+void dpool_stats(dpool_t* p, dpool_stats_t* out) {
+    mp_mutex_lock(&p->mx);
+    *out = p->st;
+    out->in_flight = (uint32_t)(p->next_fill - p->next_collect);
+    mp_mutex_unlock(&p->mx);
+}
@@ -0,0 +1,111 @@
+// decode_pool.h
+// Worker pool that decodes batches of popped frames in parallel and hands them back in
+// submission order.
+//
+// The consumer fills a batch with <u16 len><frame> records (p1150_frames_pop()) and
+// submits it; any idle worker decodes it: ADC frames into columns in the form the Python
+// pipeline used to compute per frame with cbor2 and numpy (i, isnk in mA rounded to 1 nA
+// as float32, a0 as float64, d01, d0s), everything else is left raw.  dpool_collect()
+// returns batches strictly in submission order, however the workers finish, so frames
+// keep their arrival order.  A batch slot is reused after dpool_release().
+#ifndef MP_SERIAL_DECODE_POOL_H
+#define MP_SERIAL_DECODE_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mp_platform.h"
+#include "adc_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DPOOL_MAX_WORKERS   16
+#define DPOOL_BATCH_FRAMES  256
+#define DPOOL_BATCH_BYTES   (256u * 1024u)
+
+enum { DPOOL_FREE, DPOOL_FILLING, DPOOL_QUEUED, DPOOL_DECODING, DPOOL_DONE, DPOOL_COLLECTED };
+
+typedef struct {                // 32 bytes, read by Python
+    uint64_t c;                 // frame counter
+    uint64_t a;                 // firmware backlog
+    uint32_t start;             // first sample in the batch columns
+    uint32_t n;                 // samples
+    uint32_t present;           // ADC_HAS_*
+    uint32_t frame;             // index of the frame in the batch
+} dpool_adc_t;
+
+typedef struct {
+    // input: <u16 len><frame> records, filled between dpool_acquire() and dpool_submit()
+    uint8_t*     in;
+    size_t       in_len;
+    uint32_t     frames;
+
+    // output
+    uint32_t     n_adc;
+    dpool_adc_t* adc;           // DPOOL_BATCH_FRAMES
+    float*       i;             // mA
+    float*       isnk;
+    double*      a0;
+    uint8_t*     d01;
+    char*        d0s;
+    size_t       samples;
+    size_t       cap;           // samples per column
+
+    uint64_t     seq;
+    int          state;         // DPOOL_*
+    uint64_t     decode_ns;
+} dpool_batch_t;
+
+typedef struct {
+    uint64_t batches;
+    uint64_t frames;
+    uint64_t adc_frames;
+    uint64_t samples;
+    uint64_t decode_ns;         // summed over the workers
+    uint64_t collect_wait_ns;   // consumer blocked on the oldest batch
+    uint32_t workers;
+    uint32_t slots;
+    uint32_t in_flight;         // submitted, not yet collected
+    uint64_t bytes;             // batch buffers over all slots
+} dpool_stats_t;
+
+typedef struct {
+    dpool_batch_t* slots;
+    uint32_t       n_slots;
+    mp_thread_t    threads[DPOOL_MAX_WORKERS];
+    uint32_t       n_workers;
+    volatile int   alive;
+
+    uint64_t       next_fill;   // seq of the next slot handed out
+    uint64_t       next_collect;
+    dpool_stats_t  st;
+    mp_mutex_t     mx;
+    mp_cond_t      work_cv;     // batches queued
+    mp_cond_t      done_cv;     // batches decoded / released
+} dpool_t;
+
+// workers 1..DPOOL_MAX_WORKERS, slots 0: 2 * workers; -1 bad argument, -2 allocation
+// or thread failure
+int  dpool_init(dpool_t* p, unsigned workers, unsigned slots);
+void dpool_free(dpool_t* p);                  // stops the workers
+
+// Next slot in sequence to fill, NULL when it is still in use
+dpool_batch_t* dpool_acquire(dpool_t* p);
+void dpool_submit(dpool_t* p, dpool_batch_t* b);
+
+// Oldest submitted batch once decoded; NULL on timeout or nothing submitted
+dpool_batch_t* dpool_collect(dpool_t* p, unsigned timeout_ms);
+void dpool_release(dpool_t* p, dpool_batch_t* b);
+
+// Decode one batch in the calling thread (what a worker does)
+void dpool_decode(dpool_batch_t* b);
+
+void dpool_stats(dpool_t* p, dpool_stats_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_DECODE_POOL_H
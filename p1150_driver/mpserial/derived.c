@@ -0,0 +1,26 @@
+// derived.c
+#include "derived.h"
+
+double derived_compute(const double* i, const double* isnk, const double* a0, size_t n,
+                       const derived_cfg_t* cfg, const derived_out_t* out) {
+    const double v = cfg->vout_v, edt = cfg->vout_v * cfg->dt_s;
+    const double g = cfg->a0_gain, o = cfg->a0_offset;
+    double* restrict pw = out->power;
+    double* restrict en = out->energy;
+    double* restrict nt = out->net;
+    double* restrict as = out->a0s;
+
+    // energy is accumulated as charge (sum of i) and scaled on store, which keeps the
+    // loop free of a dependency through the power value
+    const double e0 = cfg->energy0_mj;
+    double q = 0.0;
+    for (size_t k = 0; k < n; k++) {
+        const double ik = i[k];
+        if (nt) nt[k] = ik - isnk[k];
+        if (as) as[k] = a0[k] * g + o;
+        if (pw) pw[k] = ik * v;
+        q += ik;
+        if (en) en[k] = e0 + q * edt;
+    }
+    return e0 + q * edt;
+}
@@ -0,0 +1,44 @@
+// derived.h
+// Derived acquisition channels computed in one fused pass.
+//
+// power, cumulative energy, net current and scaled a0 used to be separate numpy
+// expressions over the acquisition, each allocating full length temporaries.  Here
+// every sample is read once and each requested output written once:
+//   net    = i - isnk                          mA
+//   power  = i * vout                          mW (vout in V)
+//   energy = energy0 + sum(power) * dt         mJ, running sum from the first sample
+//   a0s    = a0 * a0_gain + a0_offset          caller's unit
+// Outputs that are NULL are skipped; inputs not needed by any output may be NULL.
+#ifndef MP_SERIAL_DERIVED_H
+#define MP_SERIAL_DERIVED_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    double vout_v;
+    double dt_s;          // sample period
+    double energy0_mj;    // energy before the first sample
+    double a0_gain;
+    double a0_offset;
+} derived_cfg_t;
+
+typedef struct {
+    double* power;
+    double* energy;
+    double* net;
+    double* a0s;
+} derived_out_t;
+
+// Returns the energy after the last sample (energy0 + sum(power) * dt)
+double derived_compute(const double* i, const double* isnk, const double* a0, size_t n,
+                       const derived_cfg_t* cfg, const derived_out_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_DERIVED_H
@@ -0,0 +1,173 @@
+// digital.c
+#include "digital.h"
+
+#include <string.h>
+
+#define DIG_EDGES_CAP   ((uint64_t)1 << DIG_EDGES_LOG2)
+#define DIG_EDGES_MASK  (DIG_EDGES_CAP - 1)
+
+int digital_init(digital_t* d, unsigned bits_log2) {
+    memset(d, 0, sizeof(*d));
+    mp_mutex_init(&d->mx);
+    if (bits_log2 == 0) return 0;  // disabled
+    if (bits_log2 < DIG_MIN_LOG2 || bits_log2 > DIG_MAX_LOG2) return -1;
+
+    d->bits_capacity = (uint64_t)1 << bits_log2;
+    for (int l = 0; l < DIG_LINES; l++) {
+        d->edges[l] = (uint64_t*)malloc((size_t)DIG_EDGES_CAP * sizeof(uint64_t));
+        d->bits[l] = (uint8_t*)calloc((size_t)(d->bits_capacity / 8), 1);
+        if (!d->edges[l] || !d->bits[l]) {
+            digital_free(d);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void digital_free(digital_t* d) {
+    for (int l = 0; l < DIG_LINES; l++) {
+        free(d->edges[l]);
+        free(d->bits[l]);
+        d->edges[l] = NULL;
+        d->bits[l] = NULL;
+    }
+    d->bits_capacity = 0;
+    mp_mutex_destroy(&d->mx);
+}
+
+static inline void push_edge(digital_t* d, int l, uint64_t idx, unsigned st) {
+    d->edges[l][d->n_edges[l] & DIG_EDGES_MASK] = DIG_EDGE(idx, st);
+    d->n_edges[l]++;
+}
+
+static inline unsigned get_bit(const digital_t* d, int l, uint64_t idx) {
+    uint64_t b = idx & (d->bits_capacity - 1);
+    return (d->bits[l][b >> 3] >> (b & 7)) & 1u;
+}
+
+void digital_append(digital_t* d, const uint8_t* d01, size_t n) {
+    if (!d->bits_capacity || n == 0) return;
+    uint64_t mask = d->bits_capacity - 1;
+
+    mp_mutex_lock(&d->mx);
+    if (!d->primed && d01) {
+        // edge 0 of each line records the initial state, not a transition
+        for (int l = 0; l < DIG_LINES; l++) {
+            d->state[l] = (d01[0] >> l) & 1u;
+            push_edge(d, l, d->n_samples, d->state[l]);
+        }
+        d->primed = 1;
+    }
+
+    for (size_t k = 0; k < n; k++) {
+        uint64_t idx = d->n_samples + k;
+        uint64_t b = idx & mask;
+        uint8_t bit = (uint8_t)(1u << (b & 7));
+        for (int l = 0; l < DIG_LINES; l++) {
+            unsigned v = d01 ? (d01[k] >> l) & 1u : d->state[l];
+            if (v) d->bits[l][b >> 3] |= bit;
+            else   d->bits[l][b >> 3] &= (uint8_t)~bit;
+            if (v != d->state[l]) {
+                d->state[l] = (uint8_t)v;
+                push_edge(d, l, idx, v);
+            }
+        }
+    }
+    d->n_samples += n;
+    mp_mutex_unlock(&d->mx);
+}
+
+// ----------------- Queries (lock held) -----------------
+
+static inline uint64_t edges_lo(const digital_t* d, int l) {
+    return d->n_edges[l] > DIG_EDGES_CAP ? d->n_edges[l] - DIG_EDGES_CAP : 0;
+}
+
+static inline uint64_t edge_at(const digital_t* d, int l, uint64_t k) {
+    return d->edges[l][k & DIG_EDGES_MASK];
+}
+
+// First retained edge number with sample index >= idx
+static uint64_t lower_bound(const digital_t* d, int l, uint64_t idx) {
+    uint64_t lo = edges_lo(d, l), hi = d->n_edges[l];
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (DIG_EDGE_IDX(edge_at(d, l, mid)) < idx) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static inline uint64_t bits_oldest(const digital_t* d) {
+    return d->n_samples > d->bits_capacity ? d->n_samples - d->bits_capacity : 0;
+}
+
+uint64_t digital_oldest(digital_t* d) {
+    mp_mutex_lock(&d->mx);
+    uint64_t o = bits_oldest(d);
+    mp_mutex_unlock(&d->mx);
+    return o;
+}
+
+size_t digital_edges(digital_t* d, int line, uint64_t start, uint64_t end, uint64_t* out, size_t cap) {
+    size_t cnt = 0;
+    if (line < 0 || line >= DIG_LINES || !d->bits_capacity) return 0;
+    mp_mutex_lock(&d->mx);
+    for (uint64_t k = lower_bound(d, line, start); k < d->n_edges[line] && cnt < cap; k++) {
+        uint64_t e = edge_at(d, line, k);
+        if (DIG_EDGE_IDX(e) >= end) break;
+        out[cnt++] = e;
+    }
+    mp_mutex_unlock(&d->mx);
+    return cnt;
+}
+
+int digital_state_at(digital_t* d, int line, uint64_t idx) {
+    int st = -1;
+    if (line < 0 || line >= DIG_LINES || !d->bits_capacity) return -1;
+    mp_mutex_lock(&d->mx);
+    if (idx < d->n_samples) {
+        uint64_t k = lower_bound(d, line, idx + 1);   // first edge after idx
+        if (k > edges_lo(d, line)) {
+            st = (int)DIG_EDGE_STATE(edge_at(d, line, k - 1));
+        } else if (idx >= bits_oldest(d)) {
+            st = (int)get_bit(d, line, idx);
+        }
+    }
+    mp_mutex_unlock(&d->mx);
+    return st;
+}
+
+int digital_find_edge(digital_t* d, int line, uint64_t idx, int slope, uint64_t* edge) {
+    int found = 0;
+    if (line < 0 || line >= DIG_LINES || !d->bits_capacity) return 0;
+    mp_mutex_lock(&d->mx);
+    for (uint64_t k = lower_bound(d, line, idx); k < d->n_edges[line]; k++) {
+        if (k == 0) continue;  // initial state marker
+        uint64_t e = edge_at(d, line, k);
+        unsigned st = DIG_EDGE_STATE(e);
+        if (slope == 0 || (slope > 0 && st == 1) || (slope < 0 && st == 0)) {
+            *edge = e;
+            found = 1;
+            break;
+        }
+    }
+    mp_mutex_unlock(&d->mx);
+    return found;
+}
+
+uint64_t digital_bits(digital_t* d, int line, uint64_t* start, uint64_t n, uint8_t* out) {
+    if (line < 0 || line >= DIG_LINES || !d->bits_capacity) return 0;
+    mp_mutex_lock(&d->mx);
+    uint64_t s = *start, o = bits_oldest(d);
+    if (s < o) s = o;
+    uint64_t avail = d->n_samples > s ? d->n_samples - s : 0;
+    if (n > avail) n = avail;
+    memset(out, 0, (size_t)((n + 7) / 8));
+    for (uint64_t j = 0; j < n; j++) {
+        if (get_bit(d, line, s + j)) out[j >> 3] |= (uint8_t)(1u << (j & 7));
+    }
+    mp_mutex_unlock(&d->mx);
+    *start = s;
+    return n;
+}
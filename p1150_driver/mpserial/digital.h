@@ -0,0 +1,73 @@
+// digital.h
+// D0/D1 storage as edge lists plus packed bits.
+//
+// Digital lines change rarely, so instead of one value per sample each line keeps
+//   edges - (sample index << 1) | new state, appended as the stream arrives,
+//           sorted by construction, binary searched for O(log n + edges) queries
+//   bits  - 1 bit per sample, for bit-exact windows when they are really needed
+// both as rings (the oldest edges/bits are forgotten).  Sample index is the stream
+// sample index: samples of all parsed ADC frames since start.
+#ifndef MP_SERIAL_DIGITAL_H
+#define MP_SERIAL_DIGITAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mp_platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DIG_LINES        2
+#define DIG_EDGES_LOG2   16          // edges kept per line
+#define DIG_MIN_LOG2     13
+#define DIG_MAX_LOG2     30
+
+#define DIG_EDGE(idx, st)   (((uint64_t)(idx) << 1) | (uint64_t)((st) & 1u))
+#define DIG_EDGE_IDX(e)     ((e) >> 1)
+#define DIG_EDGE_STATE(e)   ((unsigned)((e) & 1u))
+
+typedef struct {
+    uint64_t*  edges[DIG_LINES];
+    uint64_t   n_edges[DIG_LINES];  // edges ever recorded
+    uint8_t*   bits[DIG_LINES];
+    uint64_t   bits_capacity;       // samples, power of two
+    uint64_t   n_samples;           // samples ever recorded
+    uint8_t    state[DIG_LINES];
+    int        primed;              // first sample seen, initial states known
+    mp_mutex_t mx;                  // reader thread appends, queries from Python
+} digital_t;
+
+int  digital_init(digital_t* d, unsigned bits_log2);   // 0 off, else DIG_MIN_LOG2..DIG_MAX_LOG2
+void digital_free(digital_t* d);
+static inline int digital_enabled(const digital_t* d) { return d->bits_capacity != 0; }
+
+// Reader thread: append n d01 bytes (bit 0 = D0, bit 1 = D1), d01 NULL holds the
+// current states (frame without digital data, keeps the sample index aligned)
+void digital_append(digital_t* d, const uint8_t* d01, size_t n);
+
+// All queries take the lock.  Ranges are clipped to what is still retained.
+
+// Oldest sample index whose bits / edge history is still retained
+uint64_t digital_oldest(digital_t* d);
+
+// Copy edges with start <= idx < end into out (max cap); returns count written
+size_t digital_edges(digital_t* d, int line, uint64_t start, uint64_t end, uint64_t* out, size_t cap);
+
+// Line state at sample idx (from edges, falls back to bits); -1 if not retained
+int digital_state_at(digital_t* d, int line, uint64_t idx);
+
+// First edge at or after idx with slope +1 rise, -1 fall, 0 either;
+// returns 1 and *edge on success, 0 if none yet
+int digital_find_edge(digital_t* d, int line, uint64_t idx, int slope, uint64_t* edge);
+
+// Packed bits (LSB first) of samples [start, start + n) into out (n / 8 rounded up bytes);
+// returns samples copied after clipping *start to the retained range
+uint64_t digital_bits(digital_t* d, int line, uint64_t* start, uint64_t n, uint8_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_DIGITAL_H
@@ -0,0 +1,153 @@
+// decode_bench.cpp
+// Replay benchmark of the decode worker pool (decode_pool.h), no device needed:
+// synthetic firmware frames (50 sample ADC frames with a log record every 8th frame)
+// are replayed through the pool with 1, 2, 4 ... workers, the frames/s reached and the
+// arrival order of the collected batches are checked.
+//
+//   make bench
+//   ./build/decode_bench [frames] [max_workers]
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "p1150.h"
+
+namespace {
+
+constexpr size_t kSamples = 50;
+
+void put_key(std::vector<uint8_t>& o, const char* k) {
+    size_t n = std::strlen(k);
+    o.push_back(static_cast<uint8_t>(0x60 | n));
+    o.insert(o.end(), k, k + n);
+}
+
+void put_uint(std::vector<uint8_t>& o, uint32_t v) {
+    o.push_back(0x1a);
+    for (int s = 24; s >= 0; s -= 8) o.push_back(static_cast<uint8_t>(v >> s));
+}
+
+void put_bytes(std::vector<uint8_t>& o, const void* p, size_t n) {
+    o.push_back(0x58);
+    o.push_back(static_cast<uint8_t>(n));
+    const uint8_t* b = static_cast<const uint8_t*>(p);
+    o.insert(o.end(), b, b + n);
+}
+
+// The firmware's ADC frame: mux byte + CBOR map, see adc_frame.h
+std::vector<uint8_t> adc_frame(uint32_t c) {
+    float i[kSamples], isnk[kSamples];
+    uint16_t a0[kSamples];
+    uint8_t d01[kSamples];
+    char d0s[kSamples];
+    for (size_t k = 0; k < kSamples; k++) {
+        i[k] = 1000.0f * static_cast<float>((c * kSamples + k) % 977);
+        isnk[k] = 0.0f;
+        a0[k] = static_cast<uint16_t>(k);
+        d01[k] = static_cast<uint8_t>((c + k) & 3);
+        d0s[k] = '-';
+    }
+    std::vector<uint8_t> o{ADC_FRAME_MUX_BYTE, 0xa7};
+    put_key(o, "c");    put_uint(o, c);
+    put_key(o, "a");    put_uint(o, 0);
+    put_key(o, "i");    put_bytes(o, i, sizeof(i));
+    put_key(o, "isnk"); put_bytes(o, isnk, sizeof(isnk));
+    put_key(o, "a0");   put_bytes(o, a0, sizeof(a0));
+    put_key(o, "d01");  put_bytes(o, d01, sizeof(d01));
+    put_key(o, "d0s");  put_bytes(o, d0s, sizeof(d0s));
+    return o;
+}
+
+// A log record: format address (mux byte is its low byte) + arguments
+std::vector<uint8_t> log_frame(uint32_t n) {
+    std::vector<uint8_t> o{0x00, 0x10, 0x00, 0x08};
+    for (int k = 0; k < 12; k++) o.push_back(static_cast<uint8_t>(n + k));
+    return o;
+}
+
+void append_record(std::vector<uint8_t>& stream, const std::vector<uint8_t>& f) {
+    uint16_t len = static_cast<uint16_t>(f.size());
+    uint8_t l[2];
+    std::memcpy(l, &len, 2);
+    stream.insert(stream.end(), l, l + 2);
+    stream.insert(stream.end(), f.begin(), f.end());
+}
+
+// Replay the stream through the pool in batches of up to DPOOL_BATCH_FRAMES frames;
+// returns frames/s, or a negative value when the order was not kept
+double replay(const std::vector<uint8_t>& stream, size_t frames, unsigned workers, uint64_t* adc_frames) {
+    dpool_t pool;
+    if (dpool_init(&pool, workers, 0) != 0) return 0.0;
+
+    size_t at = 0, fed = 0;
+    uint64_t next_c = 0;
+    bool ordered = true;
+    *adc_frames = 0;
+    auto t0 = std::chrono::steady_clock::now();
+
+    for (;;) {
+        dpool_batch_t* b;
+        while (fed < frames && (b = dpool_acquire(&pool)) != nullptr) {
+            b->in_len = 0;
+            b->frames = 0;
+            while (fed < frames && b->frames < DPOOL_BATCH_FRAMES) {
+                uint16_t len;
+                std::memcpy(&len, stream.data() + at, 2);
+                if (b->in_len + 2u + len > DPOOL_BATCH_BYTES) break;
+                std::memcpy(b->in + b->in_len, stream.data() + at, 2u + len);
+                b->in_len += 2u + len;
+                at += 2u + len;
+                b->frames++;
+                fed++;
+            }
+            dpool_submit(&pool, b);
+        }
+        b = dpool_collect(&pool, 1000);
+        if (!b) break;
+        for (uint32_t k = 0; k < b->n_adc; k++) {
+            if (b->adc[k].c != next_c++) ordered = false;
+        }
+        *adc_frames += b->n_adc;
+        dpool_release(&pool, b);
+    }
+
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    dpool_free(&pool);
+    return ordered ? static_cast<double>(frames) / s : -1.0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const size_t frames = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    unsigned max_workers = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : std::thread::hardware_concurrency();
+    if (max_workers < 1) max_workers = 1;
+    if (max_workers > DPOOL_MAX_WORKERS) max_workers = DPOOL_MAX_WORKERS;
+
+    std::vector<uint8_t> stream;
+    uint32_t c = 0;
+    for (size_t k = 0; k < frames; k++) {
+        append_record(stream, k % 8 == 7 ? log_frame(static_cast<uint32_t>(k)) : adc_frame(c++));
+    }
+    std::printf("%zu frames (%u ADC), %.1f MB, %u cores\n", frames, c, stream.size() / 1e6,
+                std::thread::hardware_concurrency());
+
+    double base = 0.0;
+    for (unsigned w = 1; w <= max_workers; w *= 2) {
+        uint64_t adc = 0;
+        double fps = replay(stream, frames, w, &adc);
+        if (fps < 0.0) {
+            std::printf("workers %2u: order violated\n", w);
+            return 1;
+        }
+        if (w == 1) base = fps;
+        std::printf("workers %2u: %10.0f frames/s  %7.2f MS/s  x%.2f  (%" PRIu64 " ADC frames decoded)\n",
+                    w, fps, fps * kSamples * 7 / 8 / 1e6, fps / base, adc);
+        if (w * 2 > max_workers && w != max_workers) w = max_workers / 2;
+    }
+    return 0;
+}
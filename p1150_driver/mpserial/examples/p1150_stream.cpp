@@ -0,0 +1,117 @@
+// p1150_stream.cpp
+// libp1150 from C++, no interpreter: stream the ADC at full rate and print
+// throughput and current statistics once per second.
+//
+//   make example
+//   ./build/p1150_stream /dev/ttyACM0 [seconds]
+//
+// Samples are read in place from the sample ring columns, the reader thread of the
+// core decodes the stream, this thread only waits, scans and commits.
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+
+#include "p1150.h"
+
+namespace {
+
+struct DeviceDeleter {
+    void operator()(p1150_t* d) const { p1150_destroy(d); }
+};
+using Device = std::unique_ptr<p1150_t, DeviceDeleter>;
+
+struct Window {
+    uint64_t n = 0;
+    double   sum = 0.0;
+    float    lo = 0.0f;
+    float    hi = 0.0f;
+
+    void add(float v) {
+        if (n == 0 || v < lo) lo = v;
+        if (n == 0 || v > hi) hi = v;
+        sum += v;
+        n++;
+    }
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <port> [seconds]\n", argv[0]);
+        return 2;
+    }
+    const double seconds = argc > 2 ? std::atof(argv[2]) : 10.0;
+
+    p1150_config_t cfg;
+    p1150_config_default(&cfg);
+    cfg.sample_ring_log2 = 20;   // 8 s at 125 kS/s
+    cfg.queue_adc = 0;           // samples come from the ring, only responses are queued
+
+    p1150_t* raw = nullptr;
+    int rc = p1150_create(&raw, argv[1], &cfg);
+    if (rc != 0) {
+        std::fprintf(stderr, "p1150_create: %s\n", p1150_strerror(rc));
+        return 1;
+    }
+    Device dev(raw);
+    if ((rc = p1150_start(dev.get())) != 0) {
+        std::fprintf(stderr, "p1150_start %s: %s\n", argv[1], p1150_strerror(rc));
+        return 1;
+    }
+
+    sample_ring_t* ring = p1150_sample_ring(dev.get());
+    const int id = sample_ring_attach(ring, "p1150_stream", SR_POLICY_OVERWRITE, 1250);
+    const float* col_i = static_cast<const float*>(ring->col[SR_COL_I]);
+    p1150_cmd_adc(dev.get(), 1);
+
+    using clock = std::chrono::steady_clock;
+    const auto t0 = clock::now();
+    auto next = t0 + std::chrono::seconds(1);
+    Window win;
+    uint64_t total = 0, overwritten = 0;
+    uint8_t frame[P1150_FRAME_MAX];
+
+    while (clock::now() - t0 < std::chrono::duration<double>(seconds)) {
+        if (sample_ring_wait(ring, id, 0, 100)) {
+            uint64_t start = 0;
+            uint64_t n = sample_ring_poll(ring, id, &start);
+            for (uint64_t k = 0; k < n; k++) win.add(col_i[(start + k) & ring->mask]);
+            overwritten += sample_ring_commit(ring, id, n);
+            total += n;
+        }
+
+        // command responses and logs, keep the queue drained
+        int len;
+        while ((len = p1150_frame_pop(dev.get(), frame, sizeof(frame))) != 0) {
+            p1150_mux_t m;
+            if (len > 0 && p1150_mux_split(frame, static_cast<size_t>(len), &m) == 0 && m.type != P1150_MUX_PORT) {
+                std::printf("log target %u addr 0x%08" PRIx32 " (%zu bytes)\n", m.target, m.addr, m.n);
+            }
+        }
+
+        const auto now = clock::now();
+        if (now >= next) {
+            p1150_perf_t perf;
+            p1150_perf(dev.get(), &perf);
+            std::printf("%7" PRIu64 " S/s  i mean %9.4f mA  min %9.4f  max %9.4f  overrun %" PRIu64
+                        "  dropped %" PRIu64 "  parse errors %" PRIu64 "\n",
+                        win.n, win.n ? win.sum / static_cast<double>(win.n) : 0.0, win.lo, win.hi,
+                        ring->cons[id].overrun, ring->dropped, perf.adc_parse_errors);
+            win = Window();
+            next += std::chrono::seconds(1);
+        }
+    }
+
+    p1150_cmd_adc(dev.get(), 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const double dt = std::chrono::duration<double>(clock::now() - t0).count();
+    std::printf("%" PRIu64 " samples in %.2f s, %.0f S/s, %" PRIu64 " overwritten while read\n", total, dt,
+                static_cast<double>(total) / dt, overwritten);
+    sample_ring_detach(ring, id);
+    return 0;
+}
@@ -0,0 +1,135 @@
+// seqcap_bench.cpp
+// Segment rate benchmark of the sequence capture (seqcap.h), no device needed: a
+// current pulse every `period` samples is published into a sample ring as fast as
+// possible while the capture thread triggers on every rising edge and a taker thread
+// collects the full sequences.  Reported per period: segments/s reached, the capture
+// thread cost per segment and what that leaves at the device rate (125 kS/s, where
+// re-arming at the end of the window caps the rate at 125000 / post triggers/s).
+//
+//   make bench
+//   ./build/seqcap_bench [samples] [segments]
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "p1150.h"
+
+namespace {
+
+constexpr size_t kSamples = 50;
+
+struct Result {
+    double   seg_per_s;
+    double   ns_per_seg;
+    double   msps;
+    uint64_t segments;
+    uint64_t sequences;
+    uint64_t missed;
+    uint64_t lost;
+    uint64_t min_interval;
+};
+
+bool run(uint64_t samples, uint32_t period, uint32_t segments, Result* res) {
+    sample_ring_t ring;
+    if (sample_ring_init(&ring, 20) != 0) return false;
+    seqcap_t sc;
+    seqcap_init(&sc);
+
+    seqcap_cfg_t cfg;
+    std::memset(&cfg, 0, sizeof(cfg));
+    cfg.pre = period / 4;
+    cfg.post = period / 2;
+    cfg.segments = segments;
+    cfg.flags = SEQCAP_CONTINUOUS;
+    cfg.n_trig = 1;
+    cfg.trig[0].kind = REC_TRIG_CURRENT;
+    cfg.trig[0].slope = 1;
+    cfg.trig[0].level_ma = 5.0f;
+    if (seqcap_start(&sc, &ring, &cfg) != 0) {
+        seqcap_free(&sc);
+        sample_ring_free(&ring);
+        return false;
+    }
+
+    std::atomic<bool> done{false};
+    std::vector<uint8_t> out(seqcap_bytes(&cfg));
+    std::thread taker([&] {
+        uint64_t number;
+        uint32_t n;
+        while (!done.load() || seqcap_take(&sc, out.data(), out.size(), &number, &n) == 1) {
+            if (seqcap_wait(&sc, 10)) (void)seqcap_take(&sc, out.data(), out.size(), &number, &n);
+        }
+    });
+
+    // firmware units: nA, 10 mA for the first tenth of each period
+    float i[kSamples], isnk[kSamples] = {};
+    uint16_t a0[kSamples] = {};
+    uint8_t d01[kSamples] = {};
+    char d0s[kSamples];
+    std::memset(d0s, '-', sizeof(d0s));
+    adc_frame_t f;
+    std::memset(&f, 0, sizeof(f));
+    f.present = ADC_HAS_I | ADC_HAS_ISNK | ADC_HAS_A0 | ADC_HAS_D01 | ADC_HAS_D0S;
+    f.i = {reinterpret_cast<const uint8_t*>(i), sizeof(i)};
+    f.isnk = {reinterpret_cast<const uint8_t*>(isnk), sizeof(isnk)};
+    f.a0 = {reinterpret_cast<const uint8_t*>(a0), sizeof(a0)};
+    f.d01 = {d01, sizeof(d01)};
+    f.d0s = {reinterpret_cast<const uint8_t*>(d0s), sizeof(d0s)};
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint64_t s = 0; s < samples; s += kSamples) {
+        for (size_t k = 0; k < kSamples; k++) i[k] = (s + k) % period < period / 10 ? 1.0e7f : 0.0f;
+        f.c = s / kSamples;
+        (void)sample_ring_publish(&ring, &f);
+    }
+    seqcap_stop(&sc);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    done.store(true);
+    taker.join();
+
+    seqcap_stats_t st;
+    seqcap_stats(&sc, &st);
+    res->segments = st.segments;
+    res->sequences = st.sequences;
+    res->missed = st.missed;
+    res->lost = st.lost;
+    res->min_interval = st.min_interval;
+    res->seg_per_s = static_cast<double>(st.segments) / secs;
+    res->ns_per_seg = st.segments ? static_cast<double>(st.busy_ns) / static_cast<double>(st.segments) : 0.0;
+    res->msps = static_cast<double>(samples) / secs / 1e6;
+
+    seqcap_free(&sc);
+    sample_ring_free(&ring);
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const uint64_t samples = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 50000000ull;
+    const uint32_t segments = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 1000u;
+    std::printf("%" PRIu64 " samples, %u segments per sequence, %u cores\n", samples, segments,
+                std::thread::hardware_concurrency());
+
+    const uint32_t periods[] = {64, 256, 1250, 12500};
+    for (uint32_t p : periods) {
+        Result r;
+        if (!run(samples, p, segments, &r)) {
+            std::printf("period %5u: seqcap_start failed\n", p);
+            return 1;
+        }
+        const double dev_rate = ADC_SAMPLE_RATE_HZ / static_cast<double>(p);
+        const double dev_load = r.ns_per_seg * dev_rate / 1e9;
+        std::printf("period %5u (window %5u): %9.0f segments/s  %6.0f ns/segment  %6.1f MS/s  "
+                    "min interval %" PRIu64 "  missed %" PRIu64 "  lost %" PRIu64 "  (%" PRIu64 " sequences)\n"
+                    "      at 125 kS/s: %.0f triggers/s, %.2f%% of a core\n",
+                    p, p / 4 + p / 2, r.seg_per_s, r.ns_per_seg, r.msps, r.min_interval, r.missed, r.lost,
+                    r.sequences, dev_rate, dev_load * 100.0);
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+// gated.c
+#include "gated.h"
+
+#include <string.h>
+
+#define GATED_PULSES_CAP   ((uint64_t)1 << GATED_PULSES_LOG2)
+#define GATED_PULSES_MASK  (GATED_PULSES_CAP - 1)
+
+static inline void acc_clear(gated_acc_t* a) {
+    memset(a, 0, sizeof(*a));
+}
+
+static inline void acc_add(gated_acc_t* a, float v) {
+    if (a->n == 0 || v > a->peak) a->peak = v;
+    if (a->n == 0 || v < a->min) a->min = v;
+    a->n++;
+    a->sum += v;
+    a->sumsq += (double)v * v;
+}
+
+int gated_init(gated_t* g) {
+    memset(g, 0, sizeof(*g));
+    mp_mutex_init(&g->mx);
+    g->pulses = (gated_pulse_t*)calloc((size_t)GATED_PULSES_CAP, sizeof(gated_pulse_t));
+    if (!g->pulses) return -1;
+    g->cfg.line = 0;
+    g->cfg.active = 1;
+    g->cfg.source = GATED_SRC_I;
+    g->cfg.min_samples = 1;
+    return 0;
+}
+
+void gated_free(gated_t* g) {
+    free(g->pulses);
+    g->pulses = NULL;
+    mp_mutex_destroy(&g->mx);
+}
+
+void gated_reset(gated_t* g, const gated_cfg_t* cfg, uint64_t base) {
+    mp_mutex_lock(&g->mx);
+    if (cfg) g->cfg = *cfg;
+    for (int s = 0; s < GATED_STATES; s++) acc_clear(&g->state[s]);
+    acc_clear(&g->open);
+    g->in_pulse = 0;
+    g->n_pulses = 0;
+    g->glitches = 0;
+    g->since = base;
+    mp_mutex_unlock(&g->mx);
+}
+
+// lock held
+static void pulse_end(gated_t* g) {
+    if (g->open.n < g->cfg.min_samples) {
+        g->glitches++;
+    } else {
+        gated_pulse_t* p = &g->pulses[g->n_pulses & GATED_PULSES_MASK];
+        p->number = g->n_pulses;
+        p->start = g->open_start;
+        p->n = g->open.n;
+        p->charge_uc = g->open.sum * 1000.0 / ADC_SAMPLE_RATE_HZ;
+        p->mean_ma = g->open.sum / (double)g->open.n;
+        p->peak_ma = g->open.peak;
+        p->min_ma = g->open.min;
+        g->n_pulses++;
+    }
+    acc_clear(&g->open);
+    g->in_pulse = 0;
+}
+
+static inline float f4_at(const adc_bytes_t* b, size_t k) {
+    float v = 0.0f;
+    if (b->p && (k + 1) * 4 <= b->n) memcpy(&v, b->p + k * 4, 4);
+    return v;
+}
+
+void gated_feed(gated_t* g, uint64_t base, const adc_frame_t* f) {
+    size_t n = adc_frame_samples(f);
+    if (n == 0) return;
+
+    mp_mutex_lock(&g->mx);
+    const int line = g->cfg.line, active = g->cfg.active, src = g->cfg.source;
+    const int has_d01 = (f->present & ADC_HAS_D01) != 0;
+
+    for (size_t k = 0; k < n; k++) {
+        if (has_d01 && k < f->d01.n) g->d01 = f->d01.p[k];
+
+        double v;
+        if (src == GATED_SRC_I)         v = f4_at(&f->i, k);
+        else if (src == GATED_SRC_ISNK) v = f4_at(&f->isnk, k);
+        else                            v = (double)f4_at(&f->i, k) - f4_at(&f->isnk, k);
+        float ma = (float)(v / 1000000.0);
+
+        acc_add(&g->state[g->d01 & 3u], ma);
+
+        int on = (int)((g->d01 >> line) & 1u) == active;
+        if (on) {
+            if (!g->in_pulse) {
+                g->in_pulse = 1;
+                g->open_start = base + k;
+            }
+            acc_add(&g->open, ma);
+        } else if (g->in_pulse) {
+            pulse_end(g);
+        }
+    }
+    mp_mutex_unlock(&g->mx);
+}
+
+size_t gated_pulses(gated_t* g, uint64_t since, gated_pulse_t* out, size_t cap, uint64_t* next) {
+    size_t cnt = 0;
+    mp_mutex_lock(&g->mx);
+    uint64_t lo = g->n_pulses > GATED_PULSES_CAP ? g->n_pulses - GATED_PULSES_CAP : 0;
+    uint64_t k = since < lo ? lo : since;
+    for (; k < g->n_pulses && cnt < cap; k++) {
+        out[cnt++] = g->pulses[k & GATED_PULSES_MASK];
+    }
+    *next = k;
+    mp_mutex_unlock(&g->mx);
+    return cnt;
+}
@@ -0,0 +1,96 @@
+// gated.h
+// Current statistics gated by the D0/D1 lines.
+//
+// Firmware marks activities (radio TX, sleep, ...) on D0/D1.  The reader thread folds
+// every ADC frame into
+//   states - one accumulator per combined D0/D1 state (d01 & 3): samples, charge,
+//            mean, rms, peak, min.  Per line high/low results are sums of two states.
+//   pulses - contiguous runs of the gate line at its active level, numbered in order,
+//            completed ones kept in a ring for incremental readout by pulse number.
+// Current is in mA (firmware value / 1e6, as everywhere else), charge in uC.
+#ifndef MP_SERIAL_GATED_H
+#define MP_SERIAL_GATED_H
+
+#include <stdint.h>
+
+#include "mp_platform.h"
+#include "adc_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GATED_STATES       4
+#define GATED_PULSES_LOG2  12          // completed pulses retained
+
+// Current source
+enum { GATED_SRC_I, GATED_SRC_ISNK, GATED_SRC_NET };   // NET = i - isnk
+
+typedef struct {
+    uint64_t n;
+    double   sum;        // mA * samples
+    double   sumsq;
+    float    peak;
+    float    min;
+} gated_acc_t;
+
+// Completed pulse as handed to Python, fixed little-endian layout (48 bytes)
+typedef struct {
+    uint64_t number;     // 0, 1, 2 ... in order of completion
+    uint64_t start;      // stream sample index of the first active sample
+    uint64_t n;          // samples
+    double   charge_uc;
+    double   mean_ma;
+    float    peak_ma;
+    float    min_ma;
+} gated_pulse_t;
+
+typedef struct {
+    int         line;           // gate line 0 = D0, 1 = D1
+    int         active;         // active level 1 = high, 0 = low
+    int         source;         // GATED_SRC_*
+    uint32_t    min_samples;    // shorter pulses are counted as glitches only
+} gated_cfg_t;
+
+typedef struct {
+    gated_cfg_t    cfg;
+    gated_acc_t    state[GATED_STATES];
+    uint8_t        d01;           // last d01 value, held across frames without d01
+    int            in_pulse;
+    uint64_t       open_start;
+    gated_acc_t    open;          // pulse in progress
+    gated_pulse_t* pulses;
+    uint64_t       n_pulses;      // completed pulses ever
+    uint64_t       glitches;
+    uint64_t       since;         // stream sample index of the last reset
+    mp_mutex_t     mx;            // reader thread feeds, Python reads
+} gated_t;
+
+// a += b (per line high/low results from two combined states)
+static inline void gated_acc_merge(gated_acc_t* a, const gated_acc_t* b) {
+    if (b->n == 0) return;
+    if (a->n == 0 || b->peak > a->peak) a->peak = b->peak;
+    if (a->n == 0 || b->min < a->min) a->min = b->min;
+    a->n += b->n;
+    a->sum += b->sum;
+    a->sumsq += b->sumsq;
+}
+
+int  gated_init(gated_t* g);      // 0 on success
+void gated_free(gated_t* g);
+
+// Reader thread: fold one frame starting at stream sample index base
+void gated_feed(gated_t* g, uint64_t base, const adc_frame_t* f);
+
+// Clear all results (pulse numbers restart at 0); cfg NULL keeps the configuration
+void gated_reset(gated_t* g, const gated_cfg_t* cfg, uint64_t base);
+
+// Completed pulses with number >= since still retained, at most cap, oldest first;
+// *next is the number to pass as since on the next call
+size_t gated_pulses(gated_t* g, uint64_t since, gated_pulse_t* out, size_t cap, uint64_t* next);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_GATED_H
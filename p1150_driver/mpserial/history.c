@@ -0,0 +1,154 @@
+// history.c
+#include "history.h"
+
+#include <string.h>
+
+void hist_init(hist_t* h) {
+    memset(h, 0, sizeof(*h));
+    mp_mutex_init(&h->mx);
+}
+
+static void free_levels(hist_t* h) {
+    for (uint32_t l = 0; l < HIST_MAX_LEVELS; l++) {
+        free(h->level[l].blocks);
+        memset(&h->level[l], 0, sizeof(hist_level_t));
+    }
+    h->n_levels = 0;
+}
+
+void hist_free(hist_t* h) {
+    free_levels(h);
+    mp_mutex_destroy(&h->mx);
+}
+
+int hist_config(hist_t* h, const uint32_t* decim, const uint64_t* capacity, uint32_t n, uint64_t base) {
+    if (n > HIST_MAX_LEVELS) return -1;
+    for (uint32_t l = 0; l < n; l++) {
+        if (decim[l] == 0 || capacity[l] == 0 || capacity[l] > SIZE_MAX / sizeof(rec_bg_block_t)) return -1;
+        if (l > 0 && (decim[l] <= decim[l - 1] || decim[l] % decim[l - 1] != 0)) return -1;
+    }
+
+    // allocate outside the lock, the reader thread keeps feeding the old levels meanwhile
+    rec_bg_block_t* blocks[HIST_MAX_LEVELS] = { NULL, NULL, NULL, NULL };
+    for (uint32_t l = 0; l < n; l++) {
+        blocks[l] = (rec_bg_block_t*)malloc((size_t)capacity[l] * sizeof(rec_bg_block_t));
+        if (!blocks[l]) {
+            for (uint32_t k = 0; k < l; k++) free(blocks[k]);
+            mp_mutex_lock(&h->mx);
+            free_levels(h);
+            mp_mutex_unlock(&h->mx);
+            return -2;
+        }
+    }
+
+    mp_mutex_lock(&h->mx);
+    free_levels(h);
+    for (uint32_t l = 0; l < n; l++) {
+        h->level[l].decim = decim[l];
+        h->level[l].capacity = capacity[l];
+        h->level[l].blocks = blocks[l];
+    }
+    h->n_levels = n;
+    h->base = base;
+    h->samples = 0;
+    mp_mutex_unlock(&h->mx);
+    return 0;
+}
+
+// ----------------- Feeding (reader thread, lock held) -----------------
+
+// A completed block of level l - 1 folded into level l, cascading up
+static void fold(hist_t* h, uint32_t l, float i_min, float i_max, double i_mean, double isnk_mean) {
+    while (l < h->n_levels) {
+        hist_level_t* v = &h->level[l];
+        if (v->fill == 0 || i_min < v->i_min) v->i_min = i_min;
+        if (v->fill == 0 || i_max > v->i_max) v->i_max = i_max;
+        v->i_sum += i_mean;
+        v->isnk_sum += isnk_mean;
+        if (++v->fill < v->decim / h->level[l - 1].decim) return;
+
+        i_mean = v->i_sum / v->fill;
+        isnk_mean = v->isnk_sum / v->fill;
+        i_min = v->i_min;
+        i_max = v->i_max;
+        rec_bg_block_t* b = &v->blocks[v->done % v->capacity];
+        b->i_mean = (float)i_mean;
+        b->i_min = i_min;
+        b->i_max = i_max;
+        b->isnk_mean = (float)isnk_mean;
+        v->done++;
+        v->fill = 0;
+        v->i_sum = v->isnk_sum = 0.0;
+        l++;
+    }
+}
+
+void hist_feed(hist_t* h, const adc_frame_t* f) {
+    if (!h->n_levels) return;
+    size_t n = adc_frame_samples(f);
+    if (n == 0) return;
+    const int has_s = (f->present & ADC_HAS_ISNK) != 0;
+
+    mp_mutex_lock(&h->mx);
+    hist_level_t* v = &h->level[0];
+    for (size_t k = 0; h->n_levels && k < n; k++) {
+        float a = 0.0f, b = 0.0f;
+        if ((k + 1) * 4 <= f->i.n) memcpy(&a, f->i.p + k * 4, 4);
+        if (has_s && (k + 1) * 4 <= f->isnk.n) memcpy(&b, f->isnk.p + k * 4, 4);
+        const float i = (float)((double)a / 1000000.0);
+        const double s = (double)b / 1000000.0;
+
+        if (v->fill == 0 || i < v->i_min) v->i_min = i;
+        if (v->fill == 0 || i > v->i_max) v->i_max = i;
+        v->i_sum += i;
+        v->isnk_sum += s;
+        if (++v->fill < v->decim) continue;
+
+        rec_bg_block_t* blk = &v->blocks[v->done % v->capacity];
+        const double i_mean = v->i_sum / v->decim, isnk_mean = v->isnk_sum / v->decim;
+        blk->i_mean = (float)i_mean;
+        blk->i_min = v->i_min;
+        blk->i_max = v->i_max;
+        blk->isnk_mean = (float)isnk_mean;
+        v->done++;
+        v->fill = 0;
+        v->i_sum = v->isnk_sum = 0.0;
+        fold(h, 1, blk->i_min, blk->i_max, i_mean, isnk_mean);
+    }
+    h->samples += n;
+    mp_mutex_unlock(&h->mx);
+}
+
+// ----------------- Readers -----------------
+
+size_t hist_read(hist_t* h, uint32_t level, uint64_t since, rec_bg_block_t* out, size_t cap, uint64_t* first) {
+    size_t cnt = 0;
+    mp_mutex_lock(&h->mx);
+    *first = 0;
+    if (level < h->n_levels) {
+        const hist_level_t* v = &h->level[level];
+        const uint64_t lo = v->done > v->capacity ? v->done - v->capacity : 0;
+        uint64_t k = since;
+        if (since == HIST_LAST) k = v->done > cap ? v->done - cap : 0;
+        if (k < lo) k = lo;
+        *first = k;
+        for (; k < v->done && cnt < cap; k++) out[cnt++] = v->blocks[k % v->capacity];
+    }
+    mp_mutex_unlock(&h->mx);
+    return cnt;
+}
+
+void hist_info(hist_t* h, hist_info_t* out) {
+    memset(out, 0, sizeof(*out));
+    mp_mutex_lock(&h->mx);
+    out->n_levels = h->n_levels;
+    out->base = h->base;
+    out->samples = h->samples;
+    for (uint32_t l = 0; l < h->n_levels; l++) {
+        out->level[l].decim = h->level[l].decim;
+        out->level[l].capacity = h->level[l].capacity;
+        out->level[l].done = h->level[l].done;
+        out->bytes += h->level[l].capacity * sizeof(rec_bg_block_t);
+    }
+    mp_mutex_unlock(&h->mx);
+}
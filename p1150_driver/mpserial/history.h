@@ -0,0 +1,83 @@
+// history.h
+// Multi-rate in-memory history of i and isnk, to look back across a whole run without
+// a recorder.
+//
+// The full rate short-term history is the sample ring.  On top of it up to
+// HIST_MAX_LEVELS decimated levels are kept, each a ring of min/max/mean blocks
+// preallocated by hist_config() (the recorder's background block, rec_bg_block_t).
+// Level 0 is built from the samples, every further level from the completed blocks of
+// the level before, so its decimation must be a multiple of the previous one and each
+// sample is touched once however many levels there are.  Block b of a level covers the
+// stream samples [base + b * decim, base + (b + 1) * decim).
+#ifndef MP_SERIAL_HISTORY_H
+#define MP_SERIAL_HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mp_platform.h"
+#include "adc_frame.h"
+#include "recording.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HIST_MAX_LEVELS   4
+#define HIST_LAST         UINT64_MAX     // hist_read(): the newest blocks
+
+typedef struct {
+    uint32_t        decim;      // samples per block
+    uint64_t        capacity;   // blocks kept
+    uint64_t        done;       // blocks completed since base
+    rec_bg_block_t* blocks;
+
+    // open block: samples (level 0) or blocks of the level below
+    uint32_t        fill;
+    float           i_min, i_max;
+    double          i_sum, isnk_sum;
+} hist_level_t;
+
+typedef struct {
+    uint32_t n_levels;
+    uint64_t base;              // stream sample index of block 0 of every level
+    uint64_t samples;           // fed since base
+    uint64_t bytes;             // preallocated blocks
+    struct {
+        uint32_t decim;
+        uint64_t capacity;
+        uint64_t done;
+    } level[HIST_MAX_LEVELS];
+} hist_info_t;
+
+typedef struct {
+    hist_level_t level[HIST_MAX_LEVELS];
+    uint32_t     n_levels;
+    uint64_t     base;
+    uint64_t     samples;
+    mp_mutex_t   mx;            // reader thread feeds, Python configures/reads
+} hist_t;
+
+void hist_init(hist_t* h);
+void hist_free(hist_t* h);
+
+// Replace the levels and start over at stream sample index base; n 0 turns the history
+// off.  0, -1 bad levels (decim 0, not a multiple of the previous level, capacity 0),
+// -2 allocation (history off)
+int  hist_config(hist_t* h, const uint32_t* decim, const uint64_t* capacity, uint32_t n, uint64_t base);
+static inline int hist_enabled(const hist_t* h) { return h->n_levels != 0; }
+
+// Reader thread: the samples of one frame
+void hist_feed(hist_t* h, const adc_frame_t* f);
+
+// Completed blocks of a level numbered since and later (HIST_LAST: the newest cap),
+// clipped to the retained ones; *first is the number of out[0].  Returns the count.
+size_t hist_read(hist_t* h, uint32_t level, uint64_t since, rec_bg_block_t* out, size_t cap, uint64_t* first);
+
+void hist_info(hist_t* h, hist_info_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_HISTORY_H
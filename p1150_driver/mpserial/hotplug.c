@@ -0,0 +1,149 @@
+// hotplug.c
+#include "hotplug.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__linux__)
+  #include <unistd.h>
+  #include <errno.h>
+  #include <dirent.h>
+  #include <limits.h>
+  #include <stdlib.h>
+  #include <sys/socket.h>
+  #include <sys/select.h>
+  #include <linux/netlink.h>
+#elif defined(_WIN32)
+  #define WIN32_LEAN_AND_MEAN
+  #include <windows.h>
+#else
+  #include <unistd.h>
+#endif
+
+#if defined(__linux__)
+
+void hotplug_open(hotplug_t* hp) {
+    hp->fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (hp->fd < 0) return;
+
+    struct sockaddr_nl sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.nl_family = AF_NETLINK;
+    sa.nl_groups = 1;  // kernel uevents
+    if (bind(hp->fd, (struct sockaddr*)&sa, sizeof(sa)) != 0) {
+        close(hp->fd);
+        hp->fd = -1;   // no events, caller polls sysfs
+    }
+}
+
+void hotplug_close(hotplug_t* hp) {
+    if (hp->fd >= 0) close(hp->fd);
+    hp->fd = -1;
+}
+
+int hotplug_wait(hotplug_t* hp, int timeout_ms) {
+    if (hp->fd < 0) {
+        usleep((useconds_t)timeout_ms * 1000u);
+        return 0;
+    }
+
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    FD_SET(hp->fd, &rfds);
+    struct timeval tv = { timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
+    if (select(hp->fd + 1, &rfds, NULL, NULL, &tv) <= 0) return 0;
+
+    // Drain everything queued; uevent payload is "action@devpath\0KEY=VAL\0..."
+    int seen = 0;
+    char buf[4096];
+    for (;;) {
+        ssize_t n = recv(hp->fd, buf, sizeof(buf) - 1, 0);
+        if (n <= 0) break;
+        buf[n] = 0;
+        if (strncmp(buf, "add@", 4) != 0) continue;
+        for (ssize_t off = 0; off < n; off += (ssize_t)strlen(buf + off) + 1) {
+            if (strcmp(buf + off, "SUBSYSTEM=tty") == 0) { seen = 1; break; }
+        }
+    }
+    return seen;
+}
+
+static const char* tty_basename(const char* port) {
+    const char* b = strrchr(port, '/');
+    return b ? b + 1 : port;
+}
+
+// Walk up from the tty's device node until a USB device with a "serial" attribute
+static int sn_for_tty_name(const char* tty, char* sn, size_t cap) {
+    char link[PATH_MAX], path[PATH_MAX];
+    snprintf(link, sizeof(link), "/sys/class/tty/%s/device", tty);
+    if (!realpath(link, path)) return -1;
+
+    for (int depth = 0; depth < 4; depth++) {
+        char attr[PATH_MAX + 8];
+        snprintf(attr, sizeof(attr), "%s/serial", path);
+        FILE* f = fopen(attr, "r");
+        if (f) {
+            int ok = fgets(sn, (int)cap, f) != NULL;
+            fclose(f);
+            if (!ok) return -1;
+            sn[strcspn(sn, "\r\n")] = 0;
+            return 0;
+        }
+        char* slash = strrchr(path, '/');
+        if (!slash || slash == path) break;
+        *slash = 0;
+    }
+    return -1;
+}
+
+int hotplug_sn_for_port(const char* port, char* sn, size_t cap) {
+    return sn_for_tty_name(tty_basename(port), sn, cap);
+}
+
+int hotplug_find_port(const char* sn, char* port, size_t cap) {
+    DIR* d = opendir("/sys/class/tty");
+    if (!d) return -1;
+
+    int rc = -1;
+    struct dirent* e;
+    char cand[128];
+    while ((e = readdir(d)) != NULL) {
+        if (strncmp(e->d_name, "ttyACM", 6) != 0 && strncmp(e->d_name, "ttyUSB", 6) != 0) continue;
+        if (sn_for_tty_name(e->d_name, cand, sizeof(cand)) != 0) continue;
+        if (strcmp(cand, sn) == 0) {
+            snprintf(port, cap, "/dev/%s", e->d_name);
+            rc = 0;
+            break;
+        }
+    }
+    closedir(d);
+    return rc;
+}
+
+#else  // no uevents / sysfs
+
+void hotplug_open(hotplug_t* hp)  { hp->fd = -1; }
+void hotplug_close(hotplug_t* hp) { hp->fd = -1; }
+
+int hotplug_wait(hotplug_t* hp, int timeout_ms) {
+    (void)hp;
+#ifdef _WIN32
+    Sleep((DWORD)timeout_ms);
+#else
+    usleep((useconds_t)timeout_ms * 1000u);
+#endif
+    return 0;
+}
+
+int hotplug_sn_for_port(const char* port, char* sn, size_t cap) {
+    (void)port; (void)sn; (void)cap;
+    return -1;
+}
+
+int hotplug_find_port(const char* sn, char* port, size_t cap) {
+    (void)sn; (void)port; (void)cap;
+    return -1;
+}
+
+#endif
@@ -0,0 +1,38 @@
+// hotplug.h
+// USB serial hot-plug helpers used by the reader thread to re-find a P1150 by its
+// USB serial number after a disconnect (firmware upload, USB glitch).
+//
+// Linux: kernel uevents (NETLINK_KOBJECT_UEVENT) wake the watcher, sysfs maps
+//        /sys/class/tty/<tty>/device -> USB device "serial" attribute.
+// Other: no event source, hotplug_wait() is a plain timed sleep and the caller
+//        falls back to re-opening the last known port name.
+#ifndef MP_SERIAL_HOTPLUG_H
+#define MP_SERIAL_HOTPLUG_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    int fd;          // netlink socket, -1 when unavailable
+} hotplug_t;
+
+void hotplug_open(hotplug_t* hp);
+void hotplug_close(hotplug_t* hp);
+
+// Wait up to timeout_ms; returns 1 if a tty add event was seen, 0 otherwise
+int  hotplug_wait(hotplug_t* hp, int timeout_ms);
+
+// USB serial number of the device behind a tty path ("/dev/ttyACM0"); 0 on success
+int  hotplug_sn_for_port(const char* port, char* sn, size_t cap);
+
+// Find the tty path of the device with USB serial number sn; 0 on success
+int  hotplug_find_port(const char* sn, char* port, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_HOTPLUG_H
@@ -0,0 +1,354 @@
+// mask.c
+#include "mask.h"
+
+#include <math.h>
+#include <string.h>
+
+#define MASK_VERDICTS_CAP   ((uint64_t)1 << MASK_VERDICTS_LOG2)
+#define MASK_VERDICTS_MASK  (MASK_VERDICTS_CAP - 1)
+#define MASK_BLOCK          64
+
+int mask_init(mask_t* m) {
+    memset(m, 0, sizeof(*m));
+    mp_mutex_init(&m->mx);
+    mp_cond_init(&m->cv);
+    m->verdicts = (mask_verdict_t*)calloc((size_t)MASK_VERDICTS_CAP, sizeof(mask_verdict_t));
+    return m->verdicts ? 0 : -1;
+}
+
+void mask_free(mask_t* m) {
+    free(m->verdicts);
+    free(m->hist_i);
+    free(m->hist_isnk);
+    m->verdicts = NULL;
+    m->hist_i = m->hist_isnk = NULL;
+    mp_cond_destroy(&m->cv);
+    mp_mutex_destroy(&m->mx);
+}
+
+int mask_config(mask_t* m, const rec_trigger_t* trig, const mask_rule_t* rules, uint32_t n_rules) {
+    if (n_rules > MASK_MAX_RULES || trig->kind > REC_TRIG_D0S) return -1;
+    int64_t first = 0, last = 0;
+    for (uint32_t r = 0; r < n_rules; r++) {
+        const mask_rule_t* ru = &rules[r];
+        if (ru->kind < MASK_RULE_ENVELOPE || ru->kind > MASK_RULE_CHARGE || ru->source > MASK_SRC_NET ||
+            ru->start >= ru->end) {
+            return -1;
+        }
+        if (r == 0 || ru->start < first) first = ru->start;
+        if (r == 0 || ru->end > last) last = ru->end;
+    }
+    if (first < -((int64_t)1 << MASK_PRE_MAX_LOG2)) return -1;
+
+    uint64_t cap = 0;
+    float *hi = NULL, *hs = NULL;
+    if (first < 0) {
+        // the frame block being searched for the trigger is already in the history
+        for (cap = MASK_BLOCK; cap < (uint64_t)-first + MASK_BLOCK; cap <<= 1) {}
+        hi = (float*)malloc((size_t)cap * sizeof(float));
+        hs = (float*)malloc((size_t)cap * sizeof(float));
+        if (!hi || !hs) {
+            free(hi);
+            free(hs);
+            return -2;
+        }
+    }
+
+    mp_mutex_lock(&m->mx);
+    float *old_i = m->hist_i, *old_s = m->hist_isnk;
+    m->trig = *trig;
+    memcpy(m->rules, rules, n_rules * sizeof(mask_rule_t));
+    m->n_rules = n_rules;
+    m->first = first;
+    m->last = last;
+    m->hist_i = hi;
+    m->hist_isnk = hs;
+    m->hist_cap = cap;
+    m->hist_head = 0;
+    memset(&m->st, 0, sizeof(m->st));
+    m->st.n_rules = n_rules;
+    mp_cond_broadcast(&m->cv);
+    mp_mutex_unlock(&m->mx);
+
+    free(old_i);
+    free(old_s);
+    return 0;
+}
+
+int mask_arm(mask_t* m, int repeat) {
+    mp_mutex_lock(&m->mx);
+    int rv = m->n_rules ? 0 : -1;
+    if (rv == 0) {
+        m->st.state = MASK_ARMED;
+        m->st.repeat = repeat;
+    }
+    mp_mutex_unlock(&m->mx);
+    return rv;
+}
+
+void mask_disarm(mask_t* m) {
+    mp_mutex_lock(&m->mx);
+    m->st.state = MASK_IDLE;
+    mp_cond_broadcast(&m->cv);
+    mp_mutex_unlock(&m->mx);
+}
+
+// ----------------- Evaluation (lock held) -----------------
+
+static inline float src_val(int src, float i, float s) {
+    return src == MASK_SRC_I ? i : (src == MASK_SRC_ISNK ? s : i - s);
+}
+
+static void conclude(mask_t* m, int pass, int64_t at, double value, int rule) {
+    mask_verdict_t* v = &m->verdicts[m->st.tests & MASK_VERDICTS_MASK];
+    v->number = m->st.tests;
+    v->trigger = m->st.trigger;
+    v->at = at;
+    v->value = value;
+    v->latency_ns = mp_now_ns() - m->trig_ns;
+    v->pass = pass;
+    v->rule = rule;
+    m->st.tests++;
+    if (pass) m->st.passed++;
+    else m->st.failed++;
+    m->st.state = m->st.repeat ? MASK_ARMED : MASK_IDLE;
+    mp_cond_broadcast(&m->cv);
+}
+
+static double aggregate(const mask_acc_t* a, int kind) {
+    switch (kind) {
+    case MASK_RULE_MEAN:   return a->n ? a->sum / (double)a->n : NAN;
+    case MASK_RULE_PEAK:   return a->n ? a->peak : NAN;
+    case MASK_RULE_MIN:    return a->n ? a->min : NAN;
+    case MASK_RULE_CHARGE: return a->sum * 1000.0 / ADC_SAMPLE_RATE_HZ;
+    default:               return NAN;
+    }
+}
+
+// Samples at offsets [o0, o0 + n) from the trigger; returns how many were used, fewer
+// than n when the verdict falls inside
+static size_t eval(mask_t* m, int64_t o0, const float* vi, const float* vs, size_t n) {
+    const int64_t o1 = o0 + (int64_t)n;
+    int64_t fail_at = INT64_MAX;
+    int fail_rule = -1;
+    double fail_v = NAN;
+
+    for (uint32_t r = 0; r < m->n_rules; r++) {
+        const mask_rule_t* ru = &m->rules[r];
+        mask_acc_t* a = &m->st.acc[r];
+        const int lo = !isnan(ru->lower), hi = !isnan(ru->upper);
+        int64_t s = ru->start > o0 ? ru->start : o0;
+        int64_t e = ru->end < o1 ? ru->end : o1;
+        if (e > fail_at) e = fail_at;
+
+        for (int64_t o = s; o < e; o++) {
+            float v = src_val(ru->source, vi[o - o0], vs[o - o0]);
+            if (a->n == 0 || v > a->peak) a->peak = v;
+            if (a->n == 0 || v < a->min) a->min = v;
+            a->n++;
+            a->sum += v;
+
+            int bad = 0;
+            if (ru->kind == MASK_RULE_ENVELOPE) bad = (lo && v < ru->lower) || (hi && v > ru->upper);
+            else if (ru->kind == MASK_RULE_PEAK) bad = hi && v > ru->upper;
+            else if (ru->kind == MASK_RULE_MIN)  bad = lo && v < ru->lower;
+            if (bad) {
+                fail_at = o;
+                fail_rule = (int)r;
+                fail_v = v;
+                break;
+            }
+        }
+
+        // aggregate limits once the window has closed
+        if (ru->kind != MASK_RULE_ENVELOPE && !m->closed[r] && ru->end <= o1 && ru->end - 1 < fail_at) {
+            m->closed[r] = 1;
+            double g = aggregate(a, ru->kind);
+            if ((lo && !(g >= ru->lower)) || (hi && !(g <= ru->upper))) {
+                fail_at = ru->end - 1;
+                fail_rule = (int)r;
+                fail_v = g;
+            }
+        }
+    }
+
+    if (fail_rule >= 0) {
+        conclude(m, 0, fail_at, fail_v, fail_rule);
+        return fail_at >= o0 ? (size_t)(fail_at - o0 + 1) : 0;
+    }
+    if (o1 >= m->last) {
+        conclude(m, 1, m->last - 1, NAN, -1);
+        return m->last > o0 ? (size_t)(m->last - o0) : 0;
+    }
+    return n;
+}
+
+// Trigger at stream index t: evaluate the retained pre-trigger samples
+static void start(mask_t* m, uint64_t t) {
+    m->st.state = MASK_RUNNING;
+    m->st.trigger = t;
+    m->trig_ns = mp_now_ns();
+    memset(m->st.acc, 0, sizeof(m->st.acc));
+    memset(m->closed, 0, sizeof(m->closed));
+
+    if (m->first < 0) {
+        uint64_t oldest = m->hist_head > m->hist_cap ? m->hist_head - m->hist_cap : 0;
+        uint64_t from = t >= (uint64_t)-m->first ? t + (uint64_t)m->first : 0;
+        if (from < oldest) from = oldest;
+        float vi[MASK_BLOCK], vs[MASK_BLOCK];
+        for (uint64_t idx = from; idx < t && m->st.state == MASK_RUNNING; ) {
+            size_t bn = t - idx < MASK_BLOCK ? (size_t)(t - idx) : MASK_BLOCK;
+            for (size_t j = 0; j < bn; j++) {
+                vi[j] = m->hist_i[(idx + j) & (m->hist_cap - 1)];
+                vs[j] = m->hist_isnk[(idx + j) & (m->hist_cap - 1)];
+            }
+            (void)eval(m, (int64_t)idx - (int64_t)t, vi, vs, bn);
+            idx += bn;
+        }
+    }
+    // closes windows that ended before the trigger without retained samples
+    if (m->st.state == MASK_RUNNING) (void)eval(m, 0, NULL, NULL, 0);
+    m->st.offset = 0;
+}
+
+static size_t trig_find(const mask_t* m, const float* ci, const float* cs, const uint8_t* cd,
+                        const uint8_t* cc, size_t k, size_t n) {
+    const rec_trigger_t* t = &m->trig;
+    if (t->kind == REC_TRIG_NONE) return k;
+    if (k == 0 && !m->have_last) k = 1;
+    switch (t->kind) {
+    case REC_TRIG_CURRENT: {
+        const float* c = t->source ? cs : ci;
+        const float l = t->level_ma;
+        float prev = k ? c[k - 1] : (t->source ? m->last_isnk : m->last_i);
+        for (; k < n; k++) {
+            float v = c[k];
+            if ((t->slope >= 0 && prev < l && v >= l) || (t->slope <= 0 && prev >= l && v < l)) return k;
+            prev = v;
+        }
+        return n;
+    }
+    case REC_TRIG_DIGITAL: {
+        const unsigned sh = t->source & 1u;
+        unsigned prev = ((k ? cd[k - 1] : m->last_d01) >> sh) & 1u;
+        for (; k < n; k++) {
+            unsigned v = (cd[k] >> sh) & 1u;
+            if (v != prev && (t->slope == 0 || (t->slope > 0) == (v == 1u))) return k;
+            prev = v;
+        }
+        return n;
+    }
+    case REC_TRIG_D0S:
+        for (; k < n; k++) {
+            if (cc[k] == t->ch && (k ? cc[k - 1] : m->last_d0s) != t->ch) return k;
+        }
+        return n;
+    default:
+        return n;
+    }
+}
+
+static inline float f4_ma(const adc_bytes_t* b, size_t k) {
+    float v = 0.0f;
+    if (b->p && (k + 1) * 4 <= b->n) memcpy(&v, b->p + k * 4, 4);
+    return (float)((double)v / 1000000.0);
+}
+
+void mask_feed(mask_t* m, uint64_t base, const adc_frame_t* f) {
+    size_t n = adc_frame_samples(f);
+    if (n == 0) return;
+
+    mp_mutex_lock(&m->mx);
+    if (m->st.state == MASK_IDLE && !m->hist_cap) {
+        // keep the trigger's previous sample current for the next arm
+        m->last_i = f4_ma(&f->i, n - 1);
+        m->last_isnk = f4_ma(&f->isnk, n - 1);
+        if ((f->present & ADC_HAS_D01) && f->d01.n >= n) m->last_d01 = f->d01.p[n - 1];
+        if ((f->present & ADC_HAS_D0S) && f->d0s.n >= n) m->last_d0s = f->d0s.p[n - 1];
+        m->have_last = 1;
+        mp_mutex_unlock(&m->mx);
+        return;
+    }
+
+    float vi[MASK_BLOCK], vs[MASK_BLOCK];
+    uint8_t vd[MASK_BLOCK], vc[MASK_BLOCK];
+    for (size_t k0 = 0; k0 < n; k0 += MASK_BLOCK) {
+        size_t bn = n - k0 < MASK_BLOCK ? n - k0 : MASK_BLOCK;
+        uint8_t d = m->last_d01, c = m->last_d0s;
+        for (size_t j = 0; j < bn; j++) {
+            size_t k = k0 + j;
+            vi[j] = f4_ma(&f->i, k);
+            vs[j] = f4_ma(&f->isnk, k);
+            if ((f->present & ADC_HAS_D01) && k < f->d01.n) d = f->d01.p[k];
+            if ((f->present & ADC_HAS_D0S) && k < f->d0s.n) c = f->d0s.p[k];
+            vd[j] = d;
+            vc[j] = c;
+        }
+        if (m->hist_cap) {
+            for (size_t j = 0; j < bn; j++) {
+                m->hist_i[(base + k0 + j) & (m->hist_cap - 1)] = vi[j];
+                m->hist_isnk[(base + k0 + j) & (m->hist_cap - 1)] = vs[j];
+            }
+            m->hist_head = base + k0 + bn;
+        }
+
+        size_t j = 0;
+        while (j < bn && m->st.state != MASK_IDLE) {
+            if (m->st.state == MASK_ARMED) {
+                size_t h = trig_find(m, vi, vs, vd, vc, j, bn);
+                if (h >= bn) break;
+                start(m, base + k0 + h);
+                j = h;
+                if (m->st.state != MASK_RUNNING) {
+                    j = h + 1;   // decided from pre-trigger samples alone
+                    continue;
+                }
+            }
+            int64_t o0 = (int64_t)(base + k0 + j - m->st.trigger);
+            size_t used = eval(m, o0, vi + j, vs + j, bn - j);
+            j += used ? used : 1;
+            if (m->st.state == MASK_RUNNING) m->st.offset = o0 + (int64_t)used;
+        }
+
+        m->last_i = vi[bn - 1];
+        m->last_isnk = vs[bn - 1];
+        m->last_d01 = vd[bn - 1];
+        m->last_d0s = vc[bn - 1];
+        m->have_last = 1;
+    }
+    mp_mutex_unlock(&m->mx);
+}
+
+// ----------------- Readers -----------------
+
+uint64_t mask_wait(mask_t* m, uint64_t after, unsigned timeout_ms) {
+    uint64_t deadline = mp_now_ns() / 1000000u + timeout_ms;
+    mp_mutex_lock(&m->mx);
+    while (m->st.tests <= after && m->st.state != MASK_IDLE) {
+        uint64_t now = mp_now_ns() / 1000000u;
+        if (now >= deadline) break;
+        mp_cond_wait_ms(&m->cv, &m->mx, (unsigned)(deadline - now));
+    }
+    uint64_t tests = m->st.tests;
+    mp_mutex_unlock(&m->mx);
+    return tests;
+}
+
+void mask_status(mask_t* m, mask_status_t* out) {
+    mp_mutex_lock(&m->mx);
+    *out = m->st;
+    mp_mutex_unlock(&m->mx);
+}
+
+size_t mask_verdicts(mask_t* m, uint64_t since, mask_verdict_t* out, size_t cap, uint64_t* next) {
+    size_t cnt = 0;
+    mp_mutex_lock(&m->mx);
+    uint64_t lo = m->st.tests > MASK_VERDICTS_CAP ? m->st.tests - MASK_VERDICTS_CAP : 0;
+    uint64_t k = since < lo ? lo : since;
+    for (; k < m->st.tests && cnt < cap; k++) {
+        out[cnt++] = m->verdicts[k & MASK_VERDICTS_MASK];
+    }
+    *next = k;
+    mp_mutex_unlock(&m->mx);
+    return cnt;
+}
@@ -0,0 +1,121 @@
+// mask.h
+// Pass/fail mask and limit testing of the ADC stream, evaluated per frame.
+//
+// A test is armed, waits for its trigger, then every incoming frame is checked
+// against the rules as it arrives.  The first violation decides FAIL immediately
+// (early abort), PASS is decided as soon as the last rule window has closed, so a
+// DUT gets its verdict when the data proves it instead of after a full acquisition.
+//
+// Rules, windows in samples relative to the trigger sample [start, end), start may be
+// negative (pre-trigger samples are replayed from a history ring):
+//   ENVELOPE  every sample within [lower, upper]
+//   MEAN      window mean within [lower, upper]
+//   PEAK      window maximum within [lower, upper], fails early above upper
+//   MIN       window minimum within [lower, upper], fails early below lower
+//   CHARGE    window charge (uC) within [lower, upper]
+// on i, isnk or i - isnk in mA.  A NaN limit is not checked.  Several ENVELOPE rules
+// build a piecewise envelope.  With repeat the test re-arms after each verdict.
+#ifndef MP_SERIAL_MASK_H
+#define MP_SERIAL_MASK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mp_platform.h"
+#include "adc_frame.h"
+#include "recording.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MASK_MAX_RULES      32
+#define MASK_PRE_MAX_LOG2   20          // pre-trigger history limit, samples (~8 s)
+#define MASK_VERDICTS_LOG2  10          // verdicts kept
+
+enum { MASK_RULE_ENVELOPE = 1, MASK_RULE_MEAN, MASK_RULE_PEAK, MASK_RULE_MIN, MASK_RULE_CHARGE };
+enum { MASK_SRC_I, MASK_SRC_ISNK, MASK_SRC_NET };
+enum { MASK_IDLE, MASK_ARMED, MASK_RUNNING };
+
+typedef struct {                // 32 bytes, packed by Python
+    uint8_t  kind;              // MASK_RULE_*
+    uint8_t  source;            // MASK_SRC_*
+    uint8_t  reserved[2];
+    int32_t  start;             // samples relative to the trigger
+    int32_t  end;               // exclusive
+    uint32_t reserved2;
+    double   lower;             // NaN: none
+    double   upper;
+} mask_rule_t;
+
+typedef struct {                // 48 bytes
+    uint64_t number;
+    uint64_t trigger;           // stream sample index of the trigger
+    int64_t  at;                // decided at this offset from the trigger
+    double   value;             // failing sample/aggregate, NaN on pass
+    uint64_t latency_ns;        // host time from trigger detection to verdict
+    int32_t  pass;
+    int32_t  rule;              // failing rule, -1 on pass
+} mask_verdict_t;
+
+typedef struct {
+    uint64_t n;
+    double   sum;
+    float    peak, min;
+} mask_acc_t;
+
+typedef struct {
+    int            state;       // MASK_*
+    int            repeat;
+    uint64_t       tests, passed, failed;
+    uint64_t       trigger;     // running test
+    int64_t        offset;      // next offset to evaluate
+    uint32_t       n_rules;
+    mask_acc_t     acc[MASK_MAX_RULES];
+} mask_status_t;
+
+typedef struct {
+    rec_trigger_t  trig;        // REC_TRIG_NONE: trigger on the first sample after arm
+    mask_rule_t    rules[MASK_MAX_RULES];
+    uint32_t       n_rules;
+    int64_t        first, last; // union of the rule windows
+
+    float*         hist_i;      // pre-trigger history, i and isnk mA
+    float*         hist_isnk;
+    uint64_t       hist_cap;    // power of two, 0 without pre-trigger rules
+    uint64_t       hist_head;   // stream index after the newest history sample
+    int            have_last;
+    float          last_i, last_isnk;
+    uint8_t        last_d01, last_d0s;
+
+    mask_status_t  st;
+    uint64_t       trig_ns;
+    uint8_t        closed[MASK_MAX_RULES];   // aggregate checked for the running test
+
+    mask_verdict_t* verdicts;
+    mp_mutex_t     mx;          // reader thread feeds, Python configures/reads
+    mp_cond_t      cv;          // verdicts
+} mask_t;
+
+int  mask_init(mask_t* m);
+void mask_free(mask_t* m);
+
+// Replace trigger and rules (disarms); -1 bad rules, -2 allocation failure
+int  mask_config(mask_t* m, const rec_trigger_t* trig, const mask_rule_t* rules, uint32_t n_rules);
+int  mask_arm(mask_t* m, int repeat);   // -1 without rules
+void mask_disarm(mask_t* m);
+
+// Reader thread: one frame starting at stream sample index base
+void mask_feed(mask_t* m, uint64_t base, const adc_frame_t* f);
+
+// Block until more than after tests are decided or timeout; returns tests decided
+uint64_t mask_wait(mask_t* m, uint64_t after, unsigned timeout_ms);
+
+void   mask_status(mask_t* m, mask_status_t* out);
+size_t mask_verdicts(mask_t* m, uint64_t since, mask_verdict_t* out, size_t cap, uint64_t* next);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_MASK_H
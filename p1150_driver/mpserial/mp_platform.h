@@ -0,0 +1,204 @@
+// mp_platform.h
+// Small portability layer (mutex, thread, clocks) shared by the native modules
+// that sit beside mp_serial_ext.c.  Header-only, no Python dependency.
+#ifndef MP_SERIAL_PLATFORM_H
+#define MP_SERIAL_PLATFORM_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+  #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+  #endif
+  #include <windows.h>
+#else
+  #include <pthread.h>
+  #include <time.h>
+  #include <unistd.h>
+  #include <sched.h>
+#endif
+
+// ----------------- Mutex -----------------
+#ifdef _WIN32
+typedef CRITICAL_SECTION mp_mutex_t;
+static inline void mp_mutex_init(mp_mutex_t* m)    { InitializeCriticalSection(m); }
+static inline void mp_mutex_destroy(mp_mutex_t* m) { DeleteCriticalSection(m); }
+static inline void mp_mutex_lock(mp_mutex_t* m)    { EnterCriticalSection(m); }
+static inline int  mp_mutex_trylock(mp_mutex_t* m) { return TryEnterCriticalSection(m) ? 1 : 0; }
+static inline void mp_mutex_unlock(mp_mutex_t* m)  { LeaveCriticalSection(m); }
+#else
+typedef pthread_mutex_t mp_mutex_t;
+static inline void mp_mutex_init(mp_mutex_t* m)    { pthread_mutex_init(m, NULL); }
+static inline void mp_mutex_destroy(mp_mutex_t* m) { pthread_mutex_destroy(m); }
+static inline void mp_mutex_lock(mp_mutex_t* m)    { pthread_mutex_lock(m); }
+static inline int  mp_mutex_trylock(mp_mutex_t* m) { return pthread_mutex_trylock(m) == 0; }
+static inline void mp_mutex_unlock(mp_mutex_t* m)  { pthread_mutex_unlock(m); }
+#endif
+
+// ----------------- Condition variable -----------------
+#ifdef _WIN32
+typedef CONDITION_VARIABLE mp_cond_t;
+static inline void mp_cond_init(mp_cond_t* c)      { InitializeConditionVariable(c); }
+static inline void mp_cond_destroy(mp_cond_t* c)   { (void)c; }
+static inline void mp_cond_broadcast(mp_cond_t* c) { WakeAllConditionVariable(c); }
+// Returns 0 when signalled (or spurious), 1 on timeout
+static inline int mp_cond_wait_ms(mp_cond_t* c, mp_mutex_t* m, unsigned ms) {
+    return SleepConditionVariableCS(c, m, ms) ? 0 : 1;
+}
+#else
+typedef pthread_cond_t mp_cond_t;
+static inline void mp_cond_init(mp_cond_t* c)      { pthread_cond_init(c, NULL); }
+static inline void mp_cond_destroy(mp_cond_t* c)   { pthread_cond_destroy(c); }
+static inline void mp_cond_broadcast(mp_cond_t* c) { pthread_cond_broadcast(c); }
+static inline int mp_cond_wait_ms(mp_cond_t* c, mp_mutex_t* m, unsigned ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec  += ms / 1000u;
+    ts.tv_nsec += (long)(ms % 1000u) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+    return pthread_cond_timedwait(c, m, &ts) == 0 ? 0 : 1;
+}
+#endif
+
+// ----------------- Atomics -----------------
+// 64-bit publish/observe for single-writer cursors.  The fences order a cursor store
+// before the data stores that follow it (mp_fence_release) and data loads before a
+// cursor re-check (mp_fence_acquire), the seqlock pattern of sample_ring claim.
+#ifdef _MSC_VER
+static inline uint64_t mp_load_acquire_u64(const volatile uint64_t* p) {
+    uint64_t v = *p;
+    _ReadWriteBarrier();
+    return v;
+}
+static inline void mp_store_release_u64(volatile uint64_t* p, uint64_t v) {
+    _ReadWriteBarrier();
+    *p = v;
+}
+// x86/x64 keep stores and loads in order, ARM needs the hardware barrier
+static inline void mp_fence_release(void) {
+#if defined(_M_IX86) || defined(_M_X64)
+    _ReadWriteBarrier();
+#else
+    MemoryBarrier();
+#endif
+}
+static inline void mp_fence_acquire(void) { mp_fence_release(); }
+#else
+static inline uint64_t mp_load_acquire_u64(const volatile uint64_t* p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+static inline void mp_store_release_u64(volatile uint64_t* p, uint64_t v) {
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+static inline void mp_fence_release(void) { __atomic_thread_fence(__ATOMIC_RELEASE); }
+static inline void mp_fence_acquire(void) { __atomic_thread_fence(__ATOMIC_ACQUIRE); }
+#endif
+
+// ----------------- Thread -----------------
+typedef void* (*mp_thread_fn)(void*);
+
+#ifdef _WIN32
+typedef HANDLE mp_thread_t;
+
+typedef struct { mp_thread_fn fn; void* arg; } mp_thread_tramp_t;
+
+static DWORD WINAPI mp_thread_tramp(LPVOID p) {
+    mp_thread_tramp_t t = *(mp_thread_tramp_t*)p;
+    free(p);
+    t.fn(t.arg);
+    return 0;
+}
+
+// Returns 0 on success
+static inline int mp_thread_start(mp_thread_t* th, mp_thread_fn fn, void* arg) {
+    mp_thread_tramp_t* t = (mp_thread_tramp_t*)malloc(sizeof(*t));
+    if (!t) return -1;
+    t->fn = fn; t->arg = arg;
+    *th = CreateThread(NULL, 0, mp_thread_tramp, t, 0, NULL);
+    if (!*th) { free(t); return -1; }
+    return 0;
+}
+
+static inline void mp_thread_join(mp_thread_t* th) {
+    if (*th) {
+        WaitForSingleObject(*th, INFINITE);
+        CloseHandle(*th);
+        *th = NULL;
+    }
+}
+
+static inline void mp_sleep_ms(unsigned ms) { Sleep(ms); }
+static inline void mp_thread_yield(void) { SwitchToThread(); }
+#else
+typedef pthread_t mp_thread_t;
+
+static inline int mp_thread_start(mp_thread_t* th, mp_thread_fn fn, void* arg) {
+    return pthread_create(th, NULL, fn, arg) == 0 ? 0 : -1;
+}
+
+static inline void mp_thread_join(mp_thread_t* th) {
+    if (*th) {
+        pthread_join(*th, NULL);
+        *th = (pthread_t)0;
+    }
+}
+
+static inline void mp_sleep_ms(unsigned ms) { usleep(ms * 1000u); }
+static inline void mp_thread_yield(void) { sched_yield(); }
+#endif
+
+// ----------------- Clocks -----------------
+// Monotonic time in nanoseconds
+static inline uint64_t mp_now_ns(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER freq = {0};
+    LARGE_INTEGER c;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&c);
+    return (uint64_t)((double)c.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static inline uint64_t mp_now_us(void) { return mp_now_ns() / 1000u; }
+static inline uint64_t mp_now_ms(void) { return mp_now_ns() / 1000000u; }
+
+// CPU time of the calling thread in nanoseconds, 0 if unavailable
+static inline uint64_t mp_thread_cpu_ns(void) {
+#ifdef _WIN32
+    FILETIME ct, et, kt, ut;
+    if (GetThreadTimes(GetCurrentThread(), &ct, &et, &kt, &ut)) {
+        ULARGE_INTEGER k, u;
+        k.LowPart = kt.dwLowDateTime; k.HighPart = kt.dwHighDateTime;
+        u.LowPart = ut.dwLowDateTime; u.HighPart = ut.dwHighDateTime;
+        return (uint64_t)((k.QuadPart + u.QuadPart) * 100ULL); // 100ns -> ns
+    }
+    return 0;
+#else
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    }
+    return 0;
+#endif
+}
+
+// Wall clock, nanoseconds since the Unix epoch (timestamps that outlive the process)
+static inline uint64_t mp_unix_ns(void) {
+#ifdef _WIN32
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    uint64_t t = ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime;  // 100 ns since 1601
+    return (t - 116444736000000000ULL) * 100u;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+#endif // MP_SERIAL_PLATFORM_H
@@ -1,4 +1,11 @@
 // mp_serial_ext.c
+// Python wrapper over libp1150 (p1150.h): serial I/O, framing, ADC decoding and the
+// analysis modules all run in the native core.  This file adds the Python side only:
+//   pump    - qin (bytes from the Python pipeline) -> p1150_write()
+//   deliver - p1150_frame_pop() batches -> qout, link/pressure callbacks; with
+//             decode_workers the batches go through the decode pool (decode_pool.h)
+//             and ADC frames reach qout already decoded
+// plus the out-of-band metrics thread and the bindings of the module APIs.
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 #include <structmember.h>
@@ -7,50 +14,28 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>  // malloc/free
-
-#ifdef _WIN32
-  #define WIN32_LEAN_AND_MEAN
-  #include <windows.h>
-#else
-  #include <unistd.h>
-  #include <errno.h>
-  #include <fcntl.h>
-  #include <termios.h>
-  #include <sys/select.h>
-  #include <sys/time.h>
-  #include <pthread.h>
-  #include <sched.h>
-  #include <sys/ioctl.h>
-#endif
+#include <math.h>
 
 #include <inttypes.h>
 
+#include "mp_platform.h"
+#include "p1150_dev.h"
+#include "stats_page.h"
+#include "prom_export.h"
+#include "derived.h"
+#include "decode_pool.h"
+#include "rec_search.h"
+
 #define CPU_SAMPLE_EVERY_N_LOOPS 512U
+#define PUMP_CHUNK               65536     // pump thread stack buffer
 
-static inline uint64_t now_ms(void) {
-#ifdef _WIN32
-    return (uint64_t)GetTickCount64();
-#else
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)(ts.tv_nsec / 1000000u);
-#endif
-}
+// ----------------- SerialManager object -----------------
 
-static inline void perf_log(const char* msg) {
-#ifdef _WIN32
-    OutputDebugStringA(msg);
-    OutputDebugStringA("\r\n");
-#endif
-    fprintf(stderr, "%s\n", msg);
-    fflush(stderr);
-}
+#define METRICS_MAX_EXT 24
 
-// ----------------- SerialManager object -----------------
 typedef struct {
     PyObject_HEAD
-    // ... config members ...
-    char* port;
+    p1150_t* dev;
     int baud;
 
     PyObject* q_in;
@@ -63,113 +48,35 @@ typedef struct {
     volatile int alive;
     volatile int py_enabled;
 
-#ifdef _WIN32
-    HANDLE h_read_thread;
-    HANDLE h_write_thread;
-    HANDLE h_deliver_thread;
-    HANDLE h_port;
-    CRITICAL_SECTION ring_cs;
-    HANDLE h_ring_event;
-#else
-    int fd;
-    pthread_t read_thread;
-    pthread_t write_thread;
-    pthread_t deliver_thread;
-    pthread_mutex_t ring_mx;
-    pthread_cond_t ring_cond;
-#endif
-
-    // COMMON: Zero-allocation Ring Buffer
-    uint8_t* ring_data;
-    size_t   ring_size;    // Total bytes
-    size_t   ring_head;    // Continuous write index
-    size_t   ring_tail;    // Continuous read index
-    size_t   ring_dropped;
-
-    // PERF counters (best-effort, low-overhead)
-    uint64_t perf_rx_bytes;
-    uint64_t perf_rx_frames;
-    uint64_t perf_cobs_decode_errors;
-    uint64_t perf_ring_push_dropped;
-    uint64_t perf_delivered_frames;
-    uint64_t perf_delivered_bytes;
-    uint64_t perf_tx_batches;
-    uint64_t perf_tx_bytes;
-    uint64_t perf_rx_idle_loops;
-
-    // CPU time counters (nanoseconds of actual thread CPU time)
-    uint64_t perf_cpu_reader_ns;
-    uint64_t perf_cpu_writer_ns;
-    uint64_t perf_cpu_deliver_ns;
+    mp_thread_t pump_thread;
+    mp_thread_t deliver_thread;
 
-} SerialManagerObject;
+    // get_perf_stats() reports deltas against perf_last, the exporter reports totals
+    p1150_perf_t perf_last;
 
-// Internal Helpers to abstract locking
-static inline void ring_lock(SerialManagerObject* self) {
-#ifdef _WIN32
-    EnterCriticalSection(&self->ring_cs);
-#else
-    pthread_mutex_lock(&self->ring_mx);
-#endif
-}
+    // Histograms (log2 buckets), updated by the deliver thread
+    log2_hist_t hist_gil_wait_us;
+    log2_hist_t hist_deliver_us;
+    log2_hist_t hist_batch_frames;
 
-static inline void ring_unlock(SerialManagerObject* self) {
-#ifdef _WIN32
-    LeaveCriticalSection(&self->ring_cs);
-#else
-    pthread_mutex_unlock(&self->ring_mx);
-#endif
-}
+    // Out-of-band metrics: shared-memory stats page + Prometheus exporter thread
+    stats_shm_t      stats_shm;
+    prom_listener_t  prom;
+    mp_thread_t      metrics_thread;
+    volatile int     metrics_alive;
+    int              metrics_period_ms;
+    mp_mutex_t       metrics_mx;       // guards metrics_ext (Python writers vs publisher)
+    stats_entry_t    metrics_ext[METRICS_MAX_EXT];
+    int              metrics_n_ext;
 
-static inline void ring_signal(SerialManagerObject* self) {
-#ifdef _WIN32
-    if (self->h_ring_event) SetEvent(self->h_ring_event);
-#else
-    pthread_cond_signal(&self->ring_cond);
-#endif
-}
+    PyObject*        cb_link;
+    PyObject*        cb_pressure;
 
-static inline uint64_t thread_cpu_now_ns(void) {
-#ifdef _WIN32
-    FILETIME ct, et, kt, ut;
-    if (GetThreadTimes(GetCurrentThread(), &ct, &et, &kt, &ut)) {
-        ULARGE_INTEGER k, u;
-        k.LowPart = kt.dwLowDateTime; k.HighPart = kt.dwHighDateTime;
-        u.LowPart = ut.dwLowDateTime; u.HighPart = ut.dwHighDateTime;
-        return (uint64_t)((k.QuadPart + u.QuadPart) * 100ULL); // 100ns -> ns
-    }
-    return 0;
-#else
-    struct timespec ts;
-    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
-        return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
-    }
-    return 0;
-#endif
-}
+    dpool_t*         dpool;            // NULL: frames are delivered raw
+} SerialManagerObject;
 
 // ----------------- Queue helpers -----------------
 
-// Fast-path delivery: assumes GIL is already held and we have a bound method
-static inline void deliver_frame_nogil(SerialManagerObject* self, const uint8_t* data, Py_ssize_t len) {
-    PyObject* py_bytes = PyBytes_FromStringAndSize((const char*)data, len);
-    if (py_bytes) {
-        PyObject* r = PyObject_CallOneArg(self->q_out_put_nowait, py_bytes);
-        if (!r) PyErr_Clear();
-        Py_XDECREF(r);
-        Py_DECREF(py_bytes);
-    } else {
-        PyErr_Clear();
-    }
-}
-
-
-// Provide a flat-field ring_size helper matching SerialManagerObject members
-static inline size_t ring_size(const SerialManagerObject* self) {
-    size_t h = self->ring_head, t = self->ring_tail;
-    return (h >= t) ? (h - t) : 0;
-}
-
 static int try_pop_write(SerialManagerObject* self, uint8_t* buf, size_t cap, double timeout_s, Py_ssize_t* out_len) {
     int got = 0;
     *out_len = 0;
@@ -205,49 +112,45 @@ static int try_pop_write(SerialManagerObject* self, uint8_t* buf, size_t cap, do
     return got;
 }
 
-// ----------------- Zero-Allocation Ring Logic (Common) -----------------
-
-static int ring_push(SerialManagerObject* self, const uint8_t* data, int len) {
-    ring_lock(self);
-
-    size_t needed = sizeof(uint16_t) + (size_t)len;
-    size_t available = self->ring_size - (self->ring_head - self->ring_tail);
+static void dict_set_u64(PyObject* d, const char* key, uint64_t v) {
+    PyObject* o = PyLong_FromUnsignedLongLong((unsigned long long)v);
+    if (!o) { PyErr_Clear(); return; }
+    PyDict_SetItemString(d, key, o);
+    Py_DECREF(o);
+}
 
-    if (needed > available) {
-        self->ring_dropped++;
-        self->perf_ring_push_dropped++;
-        ring_unlock(self);
-        return 0;
-    }
+static void dict_set_f64(PyObject* d, const char* key, double v) {
+    PyObject* o = PyFloat_FromDouble(v);
+    if (!o) { PyErr_Clear(); return; }
+    PyDict_SetItemString(d, key, o);
+    Py_DECREF(o);
+}
 
-    // 1. Store length (uint16_t)
-    uint16_t ulen = (uint16_t)len;
-    for (size_t i = 0; i < sizeof(uint16_t); i++) {
-        self->ring_data[(self->ring_head + i) % self->ring_size] = ((uint8_t*)&ulen)[i];
+// Replace a callback slot; cb may be None to remove
+static int set_callback(PyObject** slot, PyObject* cb) {
+    if (cb != Py_None && !PyCallable_Check(cb)) {
+        PyErr_SetString(PyExc_TypeError, "callback must be callable or None");
+        return -1;
     }
-
-    // 2. Store data with wrap-around support
-    size_t data_start = (self->ring_head + sizeof(uint16_t)) % self->ring_size;
-    size_t space_to_end = self->ring_size - data_start;
-
-    if ((size_t)len <= space_to_end) {
-        memcpy(self->ring_data + data_start, data, (size_t)len);
+    PyObject* old = *slot;
+    if (cb == Py_None) {
+        *slot = NULL;
     } else {
-        memcpy(self->ring_data + data_start, data, space_to_end);
-        memcpy(self->ring_data, data + space_to_end, (size_t)len - space_to_end);
+        Py_INCREF(cb);
+        *slot = cb;
     }
-
-    self->ring_head += needed;
-    ring_signal(self);
-    ring_unlock(self);
-    return 1;
+    Py_XDECREF(old);
+    return 0;
 }
 
+// Deliver thread: one batch of queued frames to qout as a list of bytes
 static void deliver_batch_to_python(SerialManagerObject* self) {
     if (!self->py_enabled) return;
 
+    uint64_t t0_us = mp_now_us();
     PyGILState_STATE g = PyGILState_Ensure();
-    uint8_t frame_tmp[65536]; // Stack buffer for delivery
+    uint64_t t_gil_us = mp_now_us();
+    uint8_t frame_tmp[P1150_FRAME_MAX]; // Stack buffer for delivery
     PyObject* py_batch = PyList_New(0);
     if (!py_batch) {
         PyErr_Clear();
@@ -256,32 +159,9 @@ static void deliver_batch_to_python(SerialManagerObject* self) {
     }
 
     for (int i = 0; i < 1024; i++) {
-        uint16_t len = 0;
-
-        ring_lock(self);
-        if (self->ring_head == self->ring_tail) {
-            ring_unlock(self);
-            break;
-        }
-
-        // 1. Peek length
-        for (size_t j = 0; j < sizeof(uint16_t); j++) {
-            ((uint8_t*)&len)[j] = self->ring_data[(self->ring_tail + j) % self->ring_size];
-        }
-
-        // 2. Copy out data
-        size_t data_start = (self->ring_tail + sizeof(uint16_t)) % self->ring_size;
-        size_t space_to_end = self->ring_size - data_start;
-
-        if ((size_t)len <= space_to_end) {
-            memcpy(frame_tmp, self->ring_data + data_start, (size_t)len);
-        } else {
-            memcpy(frame_tmp, self->ring_data + data_start, space_to_end);
-            memcpy(frame_tmp + space_to_end, self->ring_data, (size_t)len - space_to_end);
-        }
-
-        self->ring_tail += (sizeof(uint16_t) + (size_t)len);
-        ring_unlock(self);
+        int len = p1150_frame_pop(self->dev, frame_tmp, sizeof(frame_tmp));
+        if (len == 0) break;
+        if (len < 0) continue;
 
         PyObject* py_bytes = PyBytes_FromStringAndSize((const char*)frame_tmp, (Py_ssize_t)len);
         if (!py_bytes) {
@@ -295,13 +175,11 @@ static void deliver_batch_to_python(SerialManagerObject* self) {
         }
         Py_DECREF(py_bytes);
 
-        self->perf_delivered_frames++;
-        self->perf_delivered_bytes += (uint64_t)len;
-
         if (!self->alive || !self->py_enabled) break;
     }
 
-    if (PyList_GET_SIZE(py_batch) > 0) {
+    Py_ssize_t nframes = PyList_GET_SIZE(py_batch);
+    if (nframes > 0) {
         PyObject* r = PyObject_CallOneArg(self->q_out_put_nowait, py_batch);
         if (!r) PyErr_Clear();
         Py_XDECREF(r);
@@ -309,997 +187,2197 @@ static void deliver_batch_to_python(SerialManagerObject* self) {
 
     Py_DECREF(py_batch);
     PyGILState_Release(g);
-}
 
+    log2_hist_add(&self->hist_gil_wait_us, t_gil_us - t0_us);
+    log2_hist_add(&self->hist_deliver_us, mp_now_us() - t0_us);
+    log2_hist_add(&self->hist_batch_frames, (uint64_t)nframes);
+}
 
-// Elevate the current thread (reader thread) to highest priority on all platforms
-static void set_current_thread_highest_priority(void) {
-#ifdef _WIN32
-    HANDLE h = GetCurrentThread();
-    SetThreadPriority(h, THREAD_PRIORITY_HIGHEST);
-    SetThreadPriorityBoost(h, FALSE);
-#else
-    struct sched_param sp;
-    int maxp = sched_get_priority_max(SCHED_FIFO);
-    if (maxp > 0) {
-        sp.sched_priority = maxp;
-        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) != 0) {
-            int maxp_rr = sched_get_priority_max(SCHED_RR);
-            if (maxp_rr > 0) {
-                sp.sched_priority = maxp_rr;
-                if (pthread_setschedparam(pthread_self(), SCHED_RR, &sp) != 0) {
-                    errno = 0;
-                    nice(-20);
-                }
-            } else {
-                errno = 0;
-                nice(-20);
+// Deliver thread: one decoded batch to qout as (items, adc, i, isnk, a0, d01, d0s), items
+// in arrival order, bytes for raw frames and the dpool_adc_t record index for ADC frames
+// decoded into the columns (see mp_serial.expand_decoded())
+static void deliver_decoded_batch(SerialManagerObject* self, const dpool_batch_t* b) {
+    uint64_t t0_us = mp_now_us();
+    PyGILState_STATE g = PyGILState_Ensure();
+    uint64_t t_gil_us = mp_now_us();
+
+    PyObject* items = PyList_New((Py_ssize_t)b->frames);
+    PyObject* batch = NULL;
+    if (items) {
+        size_t at = 0;
+        uint32_t k = 0;
+        for (uint32_t fi = 0; fi < b->frames; fi++) {
+            uint16_t len;
+            memcpy(&len, b->in + at, 2);
+            PyObject* o = k < b->n_adc && b->adc[k].frame == fi
+                        ? PyLong_FromUnsignedLong(k++)
+                        : PyBytes_FromStringAndSize((const char*)b->in + at + 2, (Py_ssize_t)len);
+            at += 2u + len;
+            if (!o) {
+                Py_CLEAR(items);
+                break;
             }
+            PyList_SET_ITEM(items, fi, o);
         }
-    } else {
-        errno = 0;
-        nice(-20);
     }
-#endif
-}
-
-// ----------------- Utility: COBS decode -----------------
-static int cobs_decode(const uint8_t* in, size_t in_len, uint8_t* out, size_t out_cap) {
-    size_t in_idx = 0, out_idx = 0;
-    while (in_idx < in_len) {
-        uint8_t code = in[in_idx++];
-        if (code == 0) return -1;
-        size_t copy_len = (size_t)(code - 1);
-        if (in_idx + copy_len > in_len) return -1;
-        if (out_idx + copy_len + (code < 0xFF ? 1 : 0) > out_cap) return -1;
+    if (items) {
+        Py_ssize_t s = (Py_ssize_t)b->samples;
+        batch = Py_BuildValue("(NNNNNNN)", items,
+                              PyBytes_FromStringAndSize((const char*)b->adc, (Py_ssize_t)(b->n_adc * sizeof(dpool_adc_t))),
+                              PyByteArray_FromStringAndSize((const char*)b->i, s * 4),
+                              PyByteArray_FromStringAndSize((const char*)b->isnk, s * 4),
+                              PyByteArray_FromStringAndSize((const char*)b->a0, s * 8),
+                              PyByteArray_FromStringAndSize((const char*)b->d01, s),
+                              PyBytes_FromStringAndSize(b->d0s, s));
+    }
+    if (batch && b->frames) {
+        PyObject* r = PyObject_CallOneArg(self->q_out_put_nowait, batch);
+        Py_XDECREF(r);
+    }
+    Py_XDECREF(batch);
+    PyErr_Clear();
+    PyGILState_Release(g);
 
-        memcpy(out + out_idx, in + in_idx, copy_len);
-        out_idx += copy_len;
-        in_idx += copy_len;
+    log2_hist_add(&self->hist_gil_wait_us, t_gil_us - t0_us);
+    log2_hist_add(&self->hist_deliver_us, mp_now_us() - t0_us);
+    log2_hist_add(&self->hist_batch_frames, (uint64_t)b->frames);
+}
 
-        if (code < 0xFF && in_idx < in_len) {
-            out[out_idx++] = 0x00;
+// Deliver thread: keep every worker busy while frames are queued, hand the batches to
+// Python in the order they were taken
+static void deliver_decoded(SerialManagerObject* self) {
+    dpool_t* p = self->dpool;
+    while (self->alive && self->py_enabled) {
+        size_t bytes, frames;
+        dpool_batch_t* b;
+        p1150_queue_used(self->dev, &bytes, &frames);
+        while (frames && (b = dpool_acquire(p)) != NULL) {
+            // spread a backlog over the workers, small batches when keeping up
+            size_t per = frames / p->n_workers;
+            if (per < 16) per = 16;
+            if (per > DPOOL_BATCH_FRAMES) per = DPOOL_BATCH_FRAMES;
+            size_t used;
+            b->frames = (uint32_t)p1150_frames_pop(self->dev, b->in, DPOOL_BATCH_BYTES, per, &used);
+            b->in_len = used;
+            dpool_submit(p, b);
+            p1150_queue_used(self->dev, &bytes, &frames);
         }
+        b = dpool_collect(p, 100);
+        if (!b) break;  // nothing in flight
+        deliver_decoded_batch(self, b);
+        dpool_release(p, b);
     }
-    return (int)out_idx;
 }
 
+// ----------------- Link and pressure callbacks -----------------
 
-// ----------------- Platform-specific serial I/O -----------------
-#ifdef _WIN32
+static PyObject* link_state_dict(SerialManagerObject* self) {
+    p1150_link_t l;
+    p1150_link(self->dev, &l);
+
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+    PyDict_SetItemString(d, "connected", l.connected ? Py_True : Py_False);
+    PyObject* o = PyUnicode_FromString(l.port);
+    if (o) { PyDict_SetItemString(d, "port", o); Py_DECREF(o); }
+    o = PyUnicode_FromString(l.sn);
+    if (o) { PyDict_SetItemString(d, "sn", o); Py_DECREF(o); }
+    dict_set_u64(d, "disconnects", l.disconnects);
+    dict_set_u64(d, "reconnects", l.reconnects);
+    dict_set_u64(d, "down_ms", l.down_ms);
+    dict_set_u64(d, "last_reconnect_ms", l.last_reconnect_ms);
+    dict_set_u64(d, "max_reconnect_ms", l.max_reconnect_ms);
+    return d;
+}
 
-static void cancel_all_io_win(HANDLE h) {
-    if (!h || h == INVALID_HANDLE_VALUE) return;
-    CancelIoEx(h, NULL);
-    DWORD ce = 0; COMSTAT st = {0};
-    ClearCommError(h, &ce, &st);
-    PurgeComm(h, PURGE_RXABORT | PURGE_TXABORT | PURGE_RXCLEAR | PURGE_TXCLEAR);
+// Deliver thread: report a link state change to the optional Python callback
+static void link_notify(SerialManagerObject* self) {
+    if (!self->py_enabled) return;
+
+    PyGILState_STATE g = PyGILState_Ensure();
+    if (self->cb_link) {
+        PyObject* info = link_state_dict(self);
+        if (info) {
+            PyObject* r = PyObject_CallOneArg(self->cb_link, info);
+            if (!r) PyErr_Clear();
+            Py_XDECREF(r);
+            Py_DECREF(info);
+        } else {
+            PyErr_Clear();
+        }
+    }
+    PyGILState_Release(g);
 }
 
-static HANDLE open_serial_win(const char* port, int baud) {
-    char name[256];
-    if (strncmp(port, "\\\\.\\", 4) == 0) {
-        strncpy(name, port, sizeof(name)-1);
-        name[sizeof(name)-1] = 0;
+static PyObject* pressure_dict(SerialManagerObject* self, int history) {
+    p1150_t* dev = self->dev;
+    pressure_t* p = &dev->pressure;
+    pressure_sample_t cur;
+    float slope, peak;
+    uint32_t eta;
+    int warn;
+    uint64_t warn_events, n;
+
+    mp_mutex_lock(&p->mx);
+    n = p->n;
+    memset(&cur, 0, sizeof(cur));
+    if (n) cur = p->hist[(n - 1) % PRESSURE_HISTORY];
+    slope = p->slope;
+    peak = p->peak;
+    eta = p->eta_ms;
+    warn = p->warn;
+    warn_events = p->warn_events;
+    mp_mutex_unlock(&p->mx);
+
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+    double fps = dev->frames_per_s;
+
+    dict_set_f64(d, "pressure", cur.pressure);
+    PyDict_SetItemString(d, "warn", warn ? Py_True : Py_False);
+    dict_set_f64(d, "slope_per_s", slope);
+    if (eta == PRESSURE_ETA_NONE) PyDict_SetItemString(d, "eta_ms", Py_None);
+    else dict_set_u64(d, "eta_ms", eta);
+    dict_set_f64(d, "peak", peak);
+    dict_set_u64(d, "warn_events", warn_events);
+    dict_set_u64(d, "fw_backlog", cur.fw_backlog);
+    dict_set_u64(d, "fw_backlog_peak", dev->fw_backlog_peak);
+    dict_set_u64(d, "ring_used_bytes", cur.ring_used);
+    dict_set_u64(d, "ring_size_bytes", dev->q_size);
+    dict_set_u64(d, "deliver_lag_frames", cur.deliver_lag);
+    dict_set_f64(d, "deliver_lag_ms", fps > 1.0 ? cur.deliver_lag * 1000.0 / fps : 0.0);
+    if (dev->consumer_acks) {
+        dict_set_u64(d, "consumer_lag_frames", cur.consumer_lag);
+        dict_set_f64(d, "consumer_lag_ms", fps > 1.0 ? cur.consumer_lag * 1000.0 / fps : 0.0);
     } else {
-        snprintf(name, sizeof(name), "\\\\.\\%s", port);
+        PyDict_SetItemString(d, "consumer_lag_frames", Py_None);
+        PyDict_SetItemString(d, "consumer_lag_ms", Py_None);
+    }
+    dict_set_f64(d, "frames_per_s", fps);
+    dict_set_u64(d, "t_ms", cur.t_ms);
+
+    if (history <= 0) return d;
+
+    // Oldest first, columns so numpy.asarray() works directly
+    if ((uint64_t)history > n) history = (int)n;
+    if (history > PRESSURE_HISTORY) history = PRESSURE_HISTORY;
+    pressure_sample_t* buf = (pressure_sample_t*)malloc(sizeof(pressure_sample_t) * (size_t)(history ? history : 1));
+    if (!buf) { Py_DECREF(d); return PyErr_NoMemory(); }
+
+    mp_mutex_lock(&p->mx);
+    n = p->n;
+    if ((uint64_t)history > n) history = (int)n;
+    for (int k = 0; k < history; k++) buf[k] = p->hist[(n - (uint64_t)history + (uint64_t)k) % PRESSURE_HISTORY];
+    mp_mutex_unlock(&p->mx);
+
+    static const char* cols[] = {"t_ms", "fw_backlog", "ring_used", "deliver_lag", "consumer_lag", "pressure"};
+    PyObject* h = PyDict_New();
+    for (int c = 0; h && c < 6; c++) {
+        PyObject* l = PyList_New(history);
+        if (!l) { Py_CLEAR(h); break; }
+        for (int k = 0; k < history; k++) {
+            const pressure_sample_t* s = &buf[k];
+            PyObject* o;
+            switch (c) {
+                case 0:  o = PyLong_FromUnsignedLongLong(s->t_ms); break;
+                case 1:  o = PyLong_FromUnsignedLong(s->fw_backlog); break;
+                case 2:  o = PyLong_FromUnsignedLong(s->ring_used); break;
+                case 3:  o = PyLong_FromUnsignedLong(s->deliver_lag); break;
+                case 4:  o = PyLong_FromUnsignedLong(s->consumer_lag); break;
+                default: o = PyFloat_FromDouble(s->pressure); break;
+            }
+            if (!o) { Py_DECREF(l); l = NULL; break; }
+            PyList_SET_ITEM(l, k, o);
+        }
+        if (!l) { Py_CLEAR(h); break; }
+        PyDict_SetItemString(h, cols[c], l);
+        Py_DECREF(l);
     }
+    free(buf);
+    if (!h) { Py_DECREF(d); return NULL; }
+    PyDict_SetItemString(d, "history", h);
+    Py_DECREF(h);
+    return d;
+}
 
-    HANDLE h = CreateFileA(
-        name, GENERIC_READ | GENERIC_WRITE, 0, NULL,
-        OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL);
-    if (h == INVALID_HANDLE_VALUE) {
-        fprintf(stderr, "CreateFile failed for %s, err=%lu\n", name, GetLastError());
-        return INVALID_HANDLE_VALUE;
+// Deliver thread: report a pressure warning state change to the optional Python callback
+static void pressure_notify(SerialManagerObject* self) {
+    if (!self->py_enabled) return;
+
+    PyGILState_STATE g = PyGILState_Ensure();
+    if (self->cb_pressure) {
+        PyObject* info = pressure_dict(self, 0);
+        if (info) {
+            PyObject* r = PyObject_CallOneArg(self->cb_pressure, info);
+            if (!r) PyErr_Clear();
+            Py_XDECREF(r);
+            Py_DECREF(info);
+        } else {
+            PyErr_Clear();
+        }
     }
+    PyGILState_Release(g);
+}
+
+// ----------------- Threads -----------------
+
+static void* deliver_thread_fn(void* param) {
+    SerialManagerObject* self = (SerialManagerObject*)param;
+    uint64_t cpu_prev_ns = mp_thread_cpu_ns();
+    uint32_t cpu_sample_ctr = 0;
 
-    SetupComm(h, 64 * 1024, 4 * 1024);
-    PurgeComm(h, PURGE_RXCLEAR | PURGE_TXCLEAR | PURGE_RXABORT | PURGE_TXABORT);
+    while (self->alive) {
+        if (++cpu_sample_ctr >= CPU_SAMPLE_EVERY_N_LOOPS) {
+            uint64_t cpu_now_ns = mp_thread_cpu_ns();
+            if (cpu_now_ns >= cpu_prev_ns) self->dev->perf.cpu_deliver_ns += (cpu_now_ns - cpu_prev_ns);
+            cpu_prev_ns = cpu_now_ns;
+            cpu_sample_ctr = 0;
+        }
 
-    DCB dcb = (DCB){0};
-    dcb.DCBlength = sizeof(DCB);
-    if (!GetCommState(h, &dcb)) {
-        fprintf(stderr, "GetCommState failed, err=%lu\n", GetLastError());
-        CloseHandle(h);
-        return INVALID_HANDLE_VALUE;
+        unsigned ev = p1150_wait(self->dev, 100);
+        if (!self->alive) break;
+        if (ev & P1150_EV_LINK) link_notify(self);
+        if (ev & P1150_EV_PRESSURE) pressure_notify(self);
+        if (ev & P1150_EV_FRAME) {
+            if (self->dpool) deliver_decoded(self);
+            else deliver_batch_to_python(self);
+        }
+        if (ev & P1150_EV_STOPPED) mp_sleep_ms(10);
     }
 
-    dcb.fBinary       = TRUE;
-    dcb.fAbortOnError = FALSE;
+    uint64_t cpu_end_ns = mp_thread_cpu_ns();
+    if (cpu_end_ns >= cpu_prev_ns) self->dev->perf.cpu_deliver_ns += (cpu_end_ns - cpu_prev_ns);
+    return NULL;
+}
+
+// qin -> native TX queue, the core's writer thread coalesces and writes
+static void* pump_thread_fn(void* param) {
+    SerialManagerObject* self = (SerialManagerObject*)param;
+    uint8_t buf[PUMP_CHUNK];
+    uint64_t cpu_prev_ns = mp_thread_cpu_ns();
+    uint32_t cpu_sample_ctr = 0;
+
+    while (self->alive) {
+        if (++cpu_sample_ctr >= CPU_SAMPLE_EVERY_N_LOOPS) {
+            uint64_t cpu_now_ns = mp_thread_cpu_ns();
+            if (cpu_now_ns >= cpu_prev_ns) self->dev->perf.cpu_writer_ns += (cpu_now_ns - cpu_prev_ns);
+            cpu_prev_ns = cpu_now_ns;
+            cpu_sample_ctr = 0;
+        }
 
-    dcb.BaudRate = baud;
-    dcb.ByteSize = 8;
-    dcb.Parity   = NOPARITY;
-    dcb.StopBits = ONESTOPBIT;
+        if (!self->py_enabled) break; // don't touch Python C-API after shutdown begins
 
-    dcb.fOutxCtsFlow = FALSE;
-    dcb.fOutxDsrFlow = FALSE;
-    dcb.fOutX = FALSE;
-    dcb.fInX  = FALSE;
+        Py_ssize_t n = 0;
+        // Slightly longer wait lowers idle CPU while keeping low latency for infrequent TX
+        if (!try_pop_write(self, buf, sizeof(buf), 0.005, &n)) continue;
+        if (!self->alive || !self->py_enabled) break;
+        (void)p1150_write(self->dev, buf, (size_t)n);
+    }
+    uint64_t cpu_end_ns = mp_thread_cpu_ns();
+    if (cpu_end_ns >= cpu_prev_ns) self->dev->perf.cpu_writer_ns += (cpu_end_ns - cpu_prev_ns);
+    return NULL;
+}
 
-    dcb.fDtrControl = DTR_CONTROL_ENABLE;
-    dcb.fRtsControl = RTS_CONTROL_ENABLE;
+// ----------------- Out-of-band metrics -----------------
+// The metrics thread never takes the GIL: the stats page and the Prometheus
+// text are built from native counters only, so scraping cannot perturb acquisition.
 
-    if (!SetCommState(h, &dcb)) {
-        fprintf(stderr, "SetCommState failed, err=%lu\n", GetLastError());
-        CloseHandle(h);
-        return INVALID_HANDLE_VALUE;
+static void metrics_default_shm_name(const char* port, char* out, size_t cap) {
+    const char* base = port;
+    for (const char* p = port; *p; p++) {
+        if (*p == '/' || *p == '\\') base = p + 1;
     }
+#ifdef _WIN32
+    snprintf(out, cap, "Local\\p1150_stats_%s", base);
+#else
+    snprintf(out, cap, "/p1150_stats_%s", base);
+#endif
+}
 
-    // Set no timeouts (non-blocking behavior controlled by our read logic)
-    COMMTIMEOUTS to = (COMMTIMEOUTS){0};
-    to.ReadIntervalTimeout = 0;
-    to.ReadTotalTimeoutMultiplier = 0;
-    to.ReadTotalTimeoutConstant = 0;
-    to.WriteTotalTimeoutMultiplier = 0;
-    to.WriteTotalTimeoutConstant = 0;
-    if (!SetCommTimeouts(h, &to)) {
-        fprintf(stderr, "SetCommTimeouts failed, err=%lu\n", GetLastError());
-        CloseHandle(h);
-        return INVALID_HANDLE_VALUE;
+static void metrics_publish(SerialManagerObject* self) {
+    stats_page_t* page = self->stats_shm.page;
+    if (!page) return;
+    p1150_t* dev = self->dev;
+
+    size_t ring_used, ring_frames;
+    p1150_queue_used(dev, &ring_used, &ring_frames);
+
+    stats_page_write_begin(page);
+
+#define X(name) stats_page_set(page, #name, STATS_KIND_COUNTER, (double)dev->perf.name);
+    P1150_PERF_COUNTERS(X)
+#undef X
+    stats_page_set(page, "ring_used_bytes", STATS_KIND_GAUGE, (double)ring_used);
+    stats_page_set(page, "ring_size_bytes", STATS_KIND_GAUGE, (double)dev->q_size);
+    stats_page_set(page, "running", STATS_KIND_GAUGE, self->alive ? 1.0 : 0.0);
+    stats_page_set(page, "link_up", STATS_KIND_GAUGE, dev->link_up ? 1.0 : 0.0);
+    stats_page_set(page, "last_reconnect_ms", STATS_KIND_GAUGE, (double)dev->last_reconnect_ms);
+
+    mp_mutex_lock(&dev->pressure.mx);
+    pressure_sample_t ps;
+    memset(&ps, 0, sizeof(ps));
+    if (dev->pressure.n) ps = dev->pressure.hist[(dev->pressure.n - 1) % PRESSURE_HISTORY];
+    int pwarn = dev->pressure.warn;
+    mp_mutex_unlock(&dev->pressure.mx);
+    stats_page_set(page, "pipeline_pressure", STATS_KIND_GAUGE, ps.pressure);
+    stats_page_set(page, "pipeline_pressure_warn", STATS_KIND_GAUGE, pwarn ? 1.0 : 0.0);
+    stats_page_set(page, "fw_backlog", STATS_KIND_GAUGE, ps.fw_backlog);
+    stats_page_set(page, "deliver_lag_frames", STATS_KIND_GAUGE, ps.deliver_lag);
+    stats_page_set(page, "consumer_lag_frames", STATS_KIND_GAUGE, ps.consumer_lag);
+    if (sample_ring_enabled(&dev->sring)) {
+        stats_page_set(page, "sample_ring_samples", STATS_KIND_COUNTER, (double)dev->sring.head);
+        stats_page_set(page, "sample_ring_dropped", STATS_KIND_COUNTER, (double)dev->sring.dropped);
     }
 
-    if (!SetCommMask(h, EV_RXCHAR | EV_ERR | EV_BREAK)) {
-        fprintf(stderr, "SetCommMask failed, err=%lu\n", GetLastError());
-        CloseHandle(h);
-        return INVALID_HANDLE_VALUE;
+    mp_mutex_lock(&self->metrics_mx);
+    for (int k = 0; k < self->metrics_n_ext; k++) {
+        const stats_entry_t* e = &self->metrics_ext[k];
+        stats_page_set(page, e->name, e->kind, e->value);
     }
+    mp_mutex_unlock(&self->metrics_mx);
 
-    DWORD ce = 0; COMSTAT st = {0};
-    ClearCommError(h, &ce, &st);
-    EscapeCommFunction(h, SETRTS);
-    EscapeCommFunction(h, SETDTR);
-    EscapeCommFunction(h, CLRDTR);
-    Sleep(10);
-    EscapeCommFunction(h, SETDTR);
+    stats_page_set_hist(page, "gil_wait_us", &self->hist_gil_wait_us);
+    stats_page_set_hist(page, "deliver_batch_us", &self->hist_deliver_us);
+    stats_page_set_hist(page, "deliver_batch_frames", &self->hist_batch_frames);
 
-    return h;
+    page->update_ms = mp_now_ms();
+    stats_page_write_end(page);
 }
 
-static int serial_write_win(HANDLE h, const uint8_t* data, size_t len) {
-    OVERLAPPED ov = (OVERLAPPED){0};
-    ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
-    if (!ov.hEvent) return -1;
+static void* metrics_thread_fn(void* param) {
+    SerialManagerObject* self = (SerialManagerObject*)param;
+    const size_t text_cap = 64 * 1024;
+    char* text = (char*)malloc(text_cap);
+    stats_page_t* snap = (stats_page_t*)malloc(sizeof(stats_page_t));
+    uint64_t next_ms = 0;
+
+    while (self->metrics_alive) {
+        uint64_t t = mp_now_ms();
+        if (t >= next_ms) {
+            metrics_publish(self);
+            next_ms = t + (uint64_t)self->metrics_period_ms;
+        }
+
+        // wake at least every 100ms so stop_metrics() is prompt
+        int wait_ms = (int)(next_ms - mp_now_ms());
+        if (wait_ms < 1) wait_ms = 1;
+        if (wait_ms > 100) wait_ms = 100;
 
-    DWORD written = 0;
-    BOOL ok = WriteFile(h, data, (DWORD)len, NULL, &ov);
-    if (!ok) {
-        DWORD err = GetLastError();
-        if (err == ERROR_IO_PENDING) {
-            DWORD wait_rc = WaitForSingleObject(ov.hEvent, 2000);
-            if (wait_rc == WAIT_TIMEOUT) {
-                if (!CancelIoEx(h, &ov)) CancelIo(h);
-                DWORD ce = 0; COMSTAT st = {0};
-                ClearCommError(h, &ce, &st);
-                CloseHandle(ov.hEvent);
-                return 0;
-            }
-            if (!GetOverlappedResult(h, &ov, &written, FALSE)) {
-                CloseHandle(ov.hEvent);
-                return -1;
-            }
-        } else {
-            CloseHandle(ov.hEvent);
-            return -1;
+        if (self->prom.fd == PROM_INVALID_SOCK) {
+            mp_sleep_ms((unsigned)wait_ms);
+            continue;
         }
-    } else {
-        if (!GetOverlappedResult(h, &ov, &written, TRUE)) {
-            CloseHandle(ov.hEvent);
-            return -1;
+
+        int rv = prom_wait(&self->prom, wait_ms);
+        if (rv > 0) {
+            size_t n = 0;
+            if (text && snap && stats_page_snapshot(self->stats_shm.page, snap) == 0) {
+                n = prom_format(snap, text, text_cap);
+            }
+            prom_serve_one(&self->prom, text ? text : "", n);
+        } else if (rv < 0) {
+            mp_sleep_ms((unsigned)wait_ms);
         }
     }
 
-    CloseHandle(ov.hEvent);
-    return (int)written;
+    free(text);
+    free(snap);
+    return NULL;
 }
 
-// Windows non-blocking read: we poll cbInQue; if zero => return 0.
-// If > 0, issue overlapped ReadFile and allow a minimal wait so completion
-// can materialize; otherwise treat as no data.
-static int serial_read_win(HANDLE h, uint8_t* buf, size_t cap) {
-    DWORD errs = 0; COMSTAT st = {0};
-    ClearCommError(h, &errs, &st);
+// Caller must not hold the GIL if the thread may be running
+static void metrics_stop(SerialManagerObject* self) {
+    self->metrics_alive = 0;
+    mp_thread_join(&self->metrics_thread);
+    prom_close(&self->prom);
+    stats_shm_close(&self->stats_shm);
+}
 
-    if (st.cbInQue == 0) {
-        return 0;
-    }
+// ----------------- Python type: SerialManager -----------------
 
-    DWORD to_read = st.cbInQue;
-    if (to_read > cap) to_read = (DWORD)cap;
+// Stop the Python side threads, then the core.  Caller holds the GIL.
+static void stop_threads(SerialManagerObject* self) {
+    self->py_enabled = 0;
+    self->alive = 0;
 
-    OVERLAPPED ov = (OVERLAPPED){0};
-    ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
-    if (!ov.hEvent) return -1;
+    Py_BEGIN_ALLOW_THREADS
+    metrics_stop(self);
+    if (self->dev) p1150_stop(self->dev);
+    mp_thread_join(&self->pump_thread);
+    mp_thread_join(&self->deliver_thread);
+    Py_END_ALLOW_THREADS
+}
 
-    DWORD got = 0;
-    BOOL ok = ReadFile(h, buf, to_read, NULL, &ov);
-    if (!ok) {
-        DWORD err = GetLastError();
-        if (err == ERROR_IO_PENDING) {
-            // Slightly longer wait to avoid busy loop while still low latency
-            DWORD rc = WaitForSingleObject(ov.hEvent, 3);
-            if (rc == WAIT_TIMEOUT) {
-                CancelIoEx(h, &ov);
-                DWORD ce2 = 0; COMSTAT st2 = {0};
-                ClearCommError(h, &ce2, &st2);
-                CloseHandle(ov.hEvent);
-                return 0;
-            }
-            if (!GetOverlappedResult(h, &ov, &got, FALSE)) {
-                CloseHandle(ov.hEvent);
-                return -1;
-            }
-        } else if (err == ERROR_OPERATION_ABORTED) {
-            CloseHandle(ov.hEvent);
-            return 0;
-        } else {
-            CloseHandle(ov.hEvent);
-            return -1;
-        }
-    } else {
-        if (!GetOverlappedResult(h, &ov, &got, TRUE)) {
-            CloseHandle(ov.hEvent);
-            return -1;
-        }
+static void SerialManager_dealloc(SerialManagerObject* self) {
+    stop_threads(self);
+    mp_mutex_destroy(&self->metrics_mx);
+    p1150_destroy(self->dev);
+    if (self->dpool) {
+        dpool_free(self->dpool);
+        free(self->dpool);
     }
 
-    CloseHandle(ov.hEvent);
-    return (int)got;
+    Py_XDECREF(self->q_in);
+    Py_XDECREF(self->q_out);
+    Py_XDECREF(self->q_out_put_nowait);
+    Py_XDECREF(self->q_in_get);
+    Py_XDECREF(self->q_in_get_nowait);
+    Py_XDECREF(self->cb_link);
+    Py_XDECREF(self->cb_pressure);
+    Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
-static void close_serial_win(HANDLE h) {
-    if (h && h != INVALID_HANDLE_VALUE) {
-        CloseHandle(h);
-    }
-}
 
-#else // POSIX
+static int SerialManager_init(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"port", "qin", "qout", "baud", "sn", "reconnect", "sample_ring", "digital",
+                             "decode_workers", NULL};
+    const char* port = NULL;
+    int baud = 115200;
+    const char* sn = NULL;
+    int reconnect = 0;
+    int sample_ring_log2 = 0;
+    int digital_log2 = 0;
+    int decode_workers = 0;
+    PyObject* qin = NULL;
+    PyObject* qout = NULL;
 
-static int set_interface_attribs(int fd, int speed) {
-    struct termios tty;
-    if (tcgetattr(fd, &tty) != 0) {
-        perror("tcgetattr");
+    // Reset members to NULL/initial state
+    self->dev = NULL;
+    self->q_in = NULL;
+    self->q_out = NULL;
+    self->q_out_put_nowait = NULL;
+    self->q_in_get = NULL;
+    self->q_in_get_nowait = NULL;
+    self->alive = 0;
+    self->py_enabled = 0;
+    self->pump_thread = (mp_thread_t)0;
+    self->deliver_thread = (mp_thread_t)0;
+    memset(&self->stats_shm, 0, sizeof(self->stats_shm));
+    memset(&self->prom, 0, sizeof(self->prom));
+    self->prom.fd = PROM_INVALID_SOCK;
+    self->metrics_thread = (mp_thread_t)0;
+    self->metrics_alive = 0;
+    self->metrics_n_ext = 0;
+    mp_mutex_init(&self->metrics_mx);
+    self->cb_link = NULL;
+    self->cb_pressure = NULL;
+    self->dpool = NULL;
+    memset(&self->perf_last, 0, sizeof(self->perf_last));
+    memset(&self->hist_gil_wait_us, 0, sizeof(self->hist_gil_wait_us));
+    memset(&self->hist_deliver_us, 0, sizeof(self->hist_deliver_us));
+    memset(&self->hist_batch_frames, 0, sizeof(self->hist_batch_frames));
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "sOO|izpiii", kwlist,
+                                     &port, &qin, &qout, &baud, &sn, &reconnect, &sample_ring_log2, &digital_log2,
+                                     &decode_workers)) {
         return -1;
     }
-    cfmakeraw(&tty);
 
-    speed_t spd = B115200;
-    switch (speed) {
-        case 9600: spd = B9600; break;
-        case 19200: spd = B19200; break;
-        case 38400: spd = B38400; break;
-        case 57600: spd = B57600; break;
-        case 115200: spd = B115200; break;
-        default: spd = B115200; break;
+    if (sample_ring_log2 != 0 && (sample_ring_log2 < SR_MIN_LOG2 || sample_ring_log2 > SR_MAX_LOG2)) {
+        PyErr_Format(PyExc_ValueError, "sample_ring must be 0 (off) or %d..%d (log2 samples)", SR_MIN_LOG2, SR_MAX_LOG2);
+        return -1;
     }
-    cfsetispeed(&tty, spd);
-    cfsetospeed(&tty, spd);
-
-    tty.c_cflag |= (CLOCAL | CREAD);
-    tty.c_cflag &= ~CSIZE;
-    tty.c_cflag |= CS8;
-    tty.c_cflag &= ~(PARENB | CSTOPB | CRTSCTS);
-
-    // Non-blocking read by default
-    tty.c_cc[VTIME] = 0;
-    tty.c_cc[VMIN]  = 0;
-
-    if (tcsetattr(fd, TCSANOW, &tty) != 0) {
-        perror("tcsetattr");
+    if (digital_log2 != 0 && (digital_log2 < DIG_MIN_LOG2 || digital_log2 > DIG_MAX_LOG2)) {
+        PyErr_Format(PyExc_ValueError, "digital must be 0 (off) or %d..%d (log2 samples)", DIG_MIN_LOG2, DIG_MAX_LOG2);
         return -1;
     }
-    return 0;
-}
-
-static int open_serial_posix(const char* port, int baud) {
-    int fd = open(port, O_RDWR | O_NOCTTY | O_NONBLOCK);
-    if (fd < 0) {
-        perror("open");
+    if (decode_workers < 0 || decode_workers > DPOOL_MAX_WORKERS) {
+        PyErr_Format(PyExc_ValueError, "decode_workers must be 0 (off) or 1..%d", DPOOL_MAX_WORKERS);
         return -1;
     }
-    if (set_interface_attribs(fd, baud) != 0) {
-        close(fd);
+    if (!PyObject_HasAttrString(qin, "get") || !PyObject_HasAttrString(qout, "put_nowait")) {
+        PyErr_SetString(PyExc_ValueError, "qin/qout must be queue-like objects");
         return -1;
     }
-    return fd;
-}
 
-static int serial_write_posix(int fd, const uint8_t* data, size_t len) {
-    ssize_t w = write(fd, data, len);
-    if (w < 0) return -1;
-    return (int)w;
-}
+    p1150_config_t cfg;
+    p1150_config_default(&cfg);
+    cfg.baud = baud;
+    cfg.sn = sn;
+    cfg.reconnect = reconnect;
+    cfg.sample_ring_log2 = (unsigned)sample_ring_log2;
+    cfg.digital_log2 = (unsigned)digital_log2;
+    int rc = p1150_create(&self->dev, port, &cfg);
+    if (rc != 0) {
+        PyErr_Format(rc == P1150_ENOMEM ? PyExc_MemoryError : PyExc_ValueError, "p1150_create: %s", p1150_strerror(rc));
+        return -1;
+    }
+    self->baud = baud;
 
-// POSIX non-blocking drain: read() until EAGAIN/EWOULDBLOCK or cap reached.
-static int serial_read_posix(int fd, uint8_t* buf, size_t cap) {
-    if (cap == 0) return 0;
+    Py_INCREF(qin);  self->q_in  = qin;
+    Py_INCREF(qout); self->q_out = qout;
 
-    ssize_t total = 0;
-    for (;;) {
-        ssize_t r = read(fd, buf + total, cap - (size_t)total);
-        if (r > 0) {
-            total += r;
-            if ((size_t)total >= cap) break;
-            continue;
-        }
-        if (r == 0) {
-            break;
-        }
-        if (r < 0) {
-            if (errno == EINTR) continue;
-            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+    // Cache bound methods to reduce attribute lookups in delivery/pump threads
+    self->q_out_put_nowait = PyObject_GetAttrString(qout, "put_nowait");
+    self->q_in_get = PyObject_GetAttrString(qin, "get");
+    self->q_in_get_nowait = PyObject_GetAttrString(qin, "get_nowait");
+
+    if (!self->q_out_put_nowait || !self->q_in_get || !self->q_in_get_nowait) {
+        PyErr_SetString(PyExc_ValueError, "qin/qout must provide get/get_nowait/put_nowait methods");
+        return -1;
+    }
+
+    if (decode_workers) {
+        self->dpool = (dpool_t*)calloc(1, sizeof(dpool_t));
+        if (!self->dpool || dpool_init(self->dpool, (unsigned)decode_workers, 0) != 0) {
+            free(self->dpool);
+            self->dpool = NULL;
+            PyErr_NoMemory();
             return -1;
         }
     }
-    return (int)total;
+    return 0;
 }
 
-static inline int bytes_available_posix(int fd) {
-    int avail = 0;
-    if (ioctl(fd, FIONREAD, &avail) < 0) {
-        return 0;
-    }
-    return (avail > 0) ? avail : 0;
-}
+// Counters since the previous call (the cumulative totals keep running for the exporter)
+static PyObject* SerialManager_get_perf_stats(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+
+    p1150_perf_t cur;
+    p1150_perf(self->dev, &cur);
+#define X(name) dict_set_u64(d, #name, cur.name - self->perf_last.name);
+    P1150_PERF_COUNTERS(X)
+#undef X
+    self->perf_last = cur;
 
-static void close_serial_posix(int fd) {
-    if (fd >= 0) close(fd);
+    return d;
 }
 
+static PyObject* SerialManager_start_metrics(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"shm_name", "listen", "period_ms", NULL};
+    const char* shm_name = NULL;
+    const char* listen = NULL;
+    int period_ms = 250;
+    char name_buf[128];
 
-#endif
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|zzi", kwlist, &shm_name, &listen, &period_ms)) {
+        return NULL;
+    }
+    if (period_ms < 10) period_ms = 10;
 
-// ----------------- Threads -----------------
-#ifdef _WIN32
+    Py_BEGIN_ALLOW_THREADS
+    metrics_stop(self);
+    Py_END_ALLOW_THREADS
 
-static void wait_and_close_thread(HANDLE* phThread) {
-    if (*phThread) {
-        WaitForSingleObject(*phThread, INFINITE);
-        CloseHandle(*phThread);
-        *phThread = NULL;
+    // None -> default per-port name, "" -> private page (exporter only)
+    if (!shm_name) {
+        metrics_default_shm_name(self->dev->port, name_buf, sizeof(name_buf));
+        shm_name = name_buf;
     }
-}
-
-// Wait for EV_RXCHAR (or error/break) with a short timeout.
-// Returns 1 if an event fired, 0 on timeout, -1 on error.
-static int wait_for_rx_win(HANDLE h, DWORD timeout_ms) {
-    DWORD mask = 0;
-    OVERLAPPED ov = {0};
-    ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
-    if (!ov.hEvent) return -1;
+    if (stats_shm_open(&self->stats_shm, shm_name) != 0) {
+        return PyErr_Format(PyExc_OSError, "failed to create stats page '%s'", shm_name);
+    }
+    stats_page_init(self->stats_shm.page, self->dev->port);
+    metrics_publish(self);
 
-    // Ensure we’re listening for RX events
-    if (!SetCommMask(h, EV_RXCHAR | EV_ERR | EV_BREAK)) {
-        CloseHandle(ov.hEvent);
-        return -1;
+    if (listen && listen[0] && prom_listen(&self->prom, listen) != 0) {
+        stats_shm_close(&self->stats_shm);
+        return PyErr_Format(PyExc_OSError, "failed to listen on '%s'", listen);
     }
 
-    BOOL ok = WaitCommEvent(h, &mask, &ov);
-    if (!ok) {
-        DWORD err = GetLastError();
-        if (err == ERROR_IO_PENDING) {
-            DWORD rc = WaitForSingleObject(ov.hEvent, timeout_ms);
-            if (rc == WAIT_TIMEOUT) {
-                CancelIoEx(h, &ov);
-                DWORD ce = 0; COMSTAT st = {0};
-                ClearCommError(h, &ce, &st);
-                CloseHandle(ov.hEvent);
-                return 0; // no event in time
-            }
-            // completion occurred; fall-through to success
-        } else if (err == ERROR_INVALID_PARAMETER) {
-            // Some drivers don’t signal events reliably; treat as timeout
-            CloseHandle(ov.hEvent);
-            return 0;
-        } else if (err == ERROR_OPERATION_ABORTED) {
-            CloseHandle(ov.hEvent);
-            return 0;
-        } else {
-            CloseHandle(ov.hEvent);
-            return -1;
-        }
-    } else {
-        // Synchronous success; mask already set
-        (void)mask;
+    self->metrics_period_ms = period_ms;
+    self->metrics_alive = 1;
+    if (mp_thread_start(&self->metrics_thread, metrics_thread_fn, self) != 0) {
+        self->metrics_alive = 0;
+        prom_close(&self->prom);
+        stats_shm_close(&self->stats_shm);
+        return PyErr_Format(PyExc_RuntimeError, "failed to start metrics thread");
     }
 
-    CloseHandle(ov.hEvent);
-    return 1;
+    return PyUnicode_FromString(self->stats_shm.name);
 }
 
 
-static DWORD WINAPI reader_thread_win(LPVOID param) {
-    SerialManagerObject* self = (SerialManagerObject*)param;
+static PyObject* SerialManager_link_state(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    return link_state_dict(self);
+}
 
-    uint8_t inbuf[16384];
-    uint8_t framebuf[65536];
-    size_t  frame_len = 0;
+// cb(info: dict) is called from the deliver thread on disconnect and on reconnect
+static PyObject* SerialManager_set_link_callback(SerialManagerObject* self, PyObject* cb) {
+    if (set_callback(&self->cb_link, cb) != 0) return NULL;
+    Py_RETURN_NONE;
+}
 
-    set_current_thread_highest_priority();
-    uint64_t cpu_prev_ns = thread_cpu_now_ns();
-    uint32_t cpu_sample_ctr = 0;
+static PyObject* SerialManager_pipeline_pressure(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"history", NULL};
+    int history = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i", kwlist, &history)) return NULL;
+    return pressure_dict(self, history);
+}
 
-    int idle_backoff_ms = 0; // adaptive: 0, 1, 2, 3 (cap small to keep latency)
+// Keyword-only, omitted values are kept; returns the active configuration
+static PyObject* SerialManager_pressure_config(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"fw_backlog_max", "consumer_lag_max", "warn_level", "clear_level", "horizon_ms", NULL};
+    pressure_t* p = &self->dev->pressure;
 
-    while (self->alive) {
-        if (++cpu_sample_ctr >= CPU_SAMPLE_EVERY_N_LOOPS) {
-            uint64_t cpu_now_ns = thread_cpu_now_ns();
-            if (cpu_now_ns >= cpu_prev_ns) self->perf_cpu_reader_ns += (cpu_now_ns - cpu_prev_ns);
-            cpu_prev_ns = cpu_now_ns;
-            cpu_sample_ctr = 0;
-        }
+    mp_mutex_lock(&p->mx);
+    pressure_cfg_t cfg = p->cfg;
+    mp_mutex_unlock(&p->mx);
 
-        if (!self->h_port || self->h_port == INVALID_HANDLE_VALUE) break;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|$IIddI", kwlist, &cfg.fw_backlog_max, &cfg.consumer_lag_max,
+                                     &cfg.warn_level, &cfg.clear_level, &cfg.horizon_ms)) {
+        return NULL;
+    }
+    if (cfg.clear_level > cfg.warn_level) {
+        PyErr_SetString(PyExc_ValueError, "clear_level must not exceed warn_level");
+        return NULL;
+    }
 
-        // Non-blocking drain
-        int n = serial_read_win(self->h_port, inbuf, sizeof(inbuf));
-        if (!self->alive) break;
+    mp_mutex_lock(&p->mx);
+    p->cfg = cfg;
+    mp_mutex_unlock(&p->mx);
 
-        if (n < 0) {
-            DWORD ce = 0; COMSTAT st = {0};
-            ClearCommError(self->h_port, &ce, &st);
-            Sleep(10);
-            continue;
-        }
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+    dict_set_u64(d, "fw_backlog_max", cfg.fw_backlog_max);
+    dict_set_u64(d, "consumer_lag_max", cfg.consumer_lag_max);
+    dict_set_f64(d, "warn_level", cfg.warn_level);
+    dict_set_f64(d, "clear_level", cfg.clear_level);
+    dict_set_u64(d, "horizon_ms", cfg.horizon_ms);
+    return d;
+}
 
-        if (n > 0) {
-            // got data -> reset backoff
-            idle_backoff_ms = 0;
-            self->perf_rx_bytes += (uint64_t)n;
-
-            const uint8_t* p   = inbuf;
-            const uint8_t* end = inbuf + n;
-
-            while (p < end) {
-                const uint8_t* z = (const uint8_t*)memchr(p, 0x00, (size_t)(end - p));
-                const uint8_t* q = z ? z : end;
-
-                size_t chunk = (size_t)(q - p);
-                if (chunk) {
-                    if (frame_len + chunk <= sizeof(framebuf)) {
-                        memcpy(framebuf + frame_len, p, chunk);
-                        frame_len += chunk;
-                    } else {
-                        frame_len = 0; // overflow -> resync
-                    }
-                }
-
-                if (z) {
-                    if (frame_len > 0 && self->py_enabled) {
-                        uint8_t tmp[65536];
-                        int olen = cobs_decode(framebuf, frame_len, tmp, sizeof(tmp));
-                        if (olen >= 0) {
-                            (void)ring_push(self, tmp, olen);
-                            self->perf_rx_frames++;
-                        } else {
-                            self->perf_cobs_decode_errors++;
-                        }
-                    }
-                    frame_len = 0;
-                    p = z + 1;
-                } else {
-                    break;
-                }
-            }
-            continue;
-        }
+// cb(info: dict) is called from the deliver thread when the pressure warning sets or clears
+static PyObject* SerialManager_set_pressure_callback(SerialManagerObject* self, PyObject* cb) {
+    if (set_callback(&self->cb_pressure, cb) != 0) return NULL;
+    Py_RETURN_NONE;
+}
 
-        // n == 0: nothing available right now.
-        // Use event-driven wait to avoid spinning.
-        int ev = wait_for_rx_win(self->h_port, 3);
-        if (ev == 1) {
-            // Event fired, loop to read
-            continue;
-        } else if (ev < 0) {
-            // Treat as transient error; small sleep to avoid hot loop
-            Sleep(2);
-        } else {
-            // Timeout: apply tiny adaptive backoff
-            if (idle_backoff_ms < 3) idle_backoff_ms++;
-            self->perf_rx_idle_loops++;
-            Sleep(idle_backoff_ms);
+// Consumer acknowledges n frames taken from qout, enables consumer lag tracking
+static PyObject* SerialManager_consumed(SerialManagerObject* self, PyObject* arg) {
+    unsigned long long n = PyLong_AsUnsignedLongLong(arg);
+    if (n == (unsigned long long)-1 && PyErr_Occurred()) return NULL;
+    p1150_consumed(self->dev, (uint64_t)n);
+    Py_RETURN_NONE;
+}
+
+static PyObject* SerialManager_stop_metrics(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    Py_BEGIN_ALLOW_THREADS
+    metrics_stop(self);
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+// Publish a pipeline-level value (e.g. from P1150) alongside the native counters
+static PyObject* SerialManager_stats_set(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"name", "value", "counter", NULL};
+    const char* name = NULL;
+    double value = 0.0;
+    int counter = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "sd|p", kwlist, &name, &value, &counter)) {
+        return NULL;
+    }
+
+    mp_mutex_lock(&self->metrics_mx);
+    int k = 0;
+    while (k < self->metrics_n_ext && strncmp(self->metrics_ext[k].name, name, STATS_NAME_LEN - 1) != 0) k++;
+    if (k == self->metrics_n_ext) {
+        if (k >= METRICS_MAX_EXT) {
+            mp_mutex_unlock(&self->metrics_mx);
+            PyErr_SetString(PyExc_ValueError, "too many pipeline stats");
+            return NULL;
         }
+        memset(&self->metrics_ext[k], 0, sizeof(self->metrics_ext[k]));
+        strncpy(self->metrics_ext[k].name, name, STATS_NAME_LEN - 1);
+        self->metrics_n_ext++;
     }
-    uint64_t cpu_end_ns = thread_cpu_now_ns();
-    if (cpu_end_ns >= cpu_prev_ns) self->perf_cpu_reader_ns += (cpu_end_ns - cpu_prev_ns);
-    return 0;
+    self->metrics_ext[k].kind = counter ? STATS_KIND_COUNTER : STATS_KIND_GAUGE;
+    self->metrics_ext[k].value = value;
+    mp_mutex_unlock(&self->metrics_mx);
+
+    Py_RETURN_NONE;
 }
 
+// Prometheus text of the current page (what a scraper would see)
+static PyObject* SerialManager_get_metrics_text(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    if (!self->stats_shm.page) {
+        PyErr_SetString(PyExc_RuntimeError, "metrics not started");
+        return NULL;
+    }
+    stats_page_t* snap = (stats_page_t*)PyMem_Malloc(sizeof(stats_page_t));
+    char* text = (char*)PyMem_Malloc(64 * 1024);
+    if (!snap || !text) {
+        PyMem_Free(snap);
+        PyMem_Free(text);
+        return PyErr_NoMemory();
+    }
+    size_t n = 0;
+    if (stats_page_snapshot(self->stats_shm.page, snap) == 0) {
+        n = prom_format(snap, text, 64 * 1024);
+    }
+    PyObject* r = PyUnicode_FromStringAndSize(text, (Py_ssize_t)n);
+    PyMem_Free(snap);
+    PyMem_Free(text);
+    return r;
+}
 
-static DWORD WINAPI deliver_thread_win(LPVOID param) {
-    SerialManagerObject* self = (SerialManagerObject*)param;
-    uint64_t cpu_prev_ns = thread_cpu_now_ns();
-    uint32_t cpu_sample_ctr = 0;
 
-    while (self->alive) {
-        if (++cpu_sample_ctr >= CPU_SAMPLE_EVERY_N_LOOPS) {
-            uint64_t cpu_now_ns = thread_cpu_now_ns();
-            if (cpu_now_ns >= cpu_prev_ns) self->perf_cpu_deliver_ns += (cpu_now_ns - cpu_prev_ns);
-            cpu_prev_ns = cpu_now_ns;
-            cpu_sample_ctr = 0;
-        }
+static PyObject* SerialManager_start(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    if (self->alive) Py_RETURN_NONE;
 
-        if (self->ring_tail == self->ring_head) {
-            if (self->h_ring_event) WaitForSingleObject(self->h_ring_event, INFINITE);
-            else Sleep(1);
-            continue;
-        }
-        deliver_batch_to_python(self);
+    int rc = p1150_start(self->dev);
+    if (rc == P1150_EOPEN) {
+        return PyErr_Format(PyExc_OSError, "failed to open serial '%s'", self->dev->cur_port);
     }
+    if (rc != 0) return PyErr_Format(PyExc_RuntimeError, "p1150_start: %s", p1150_strerror(rc));
 
-    uint64_t cpu_end_ns = thread_cpu_now_ns();
-    if (cpu_end_ns >= cpu_prev_ns) self->perf_cpu_deliver_ns += (cpu_end_ns - cpu_prev_ns);
+    self->py_enabled = 1; // allow worker threads to use Python C-API
+    self->alive = 1;
+    if (mp_thread_start(&self->pump_thread, pump_thread_fn, self) != 0 ||
+        mp_thread_start(&self->deliver_thread, deliver_thread_fn, self) != 0) {
+        stop_threads(self);
+        return PyErr_Format(PyExc_RuntimeError, "failed to start I/O threads");
+    }
+
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* SerialManager_is_running(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    if (self->alive && self->py_enabled && p1150_running(self->dev)) Py_RETURN_TRUE;
+    Py_RETURN_FALSE;
+}
+
+
+static PyObject* SerialManager_shutdown(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    stop_threads(self);
+    Py_RETURN_NONE;
+}
+
+// Decode pool counters, None when decode_workers is off
+static PyObject* SerialManager_decode_stats(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    if (!self->dpool) Py_RETURN_NONE;
+    dpool_stats_t st;
+    dpool_stats(self->dpool, &st);
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+    dict_set_u64(d, "workers", st.workers);
+    dict_set_u64(d, "slots", st.slots);
+    dict_set_u64(d, "in_flight", st.in_flight);
+    dict_set_u64(d, "bytes", st.bytes);
+    dict_set_u64(d, "batches", st.batches);
+    dict_set_u64(d, "frames", st.frames);
+    dict_set_u64(d, "adc_frames", st.adc_frames);
+    dict_set_u64(d, "samples", st.samples);
+    dict_set_f64(d, "decode_s", (double)st.decode_ns / 1e9);
+    dict_set_f64(d, "collect_wait_s", (double)st.collect_wait_ns / 1e9);
+    return d;
+}
+
+// Bytes held by the native device and this manager, per subsystem (p1150_memory())
+static PyObject* SerialManager_memory(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    p1150_mem_t m;
+    dpool_stats_t ds;
+    memset(&ds, 0, sizeof(ds));
+    Py_BEGIN_ALLOW_THREADS
+    p1150_memory(self->dev, &m);
+    if (self->dpool) dpool_stats(self->dpool, &ds);
+    Py_END_ALLOW_THREADS
+
+    // pump thread buf + deliver thread frame_tmp (deliver_raw())
+    const uint64_t stacks = self->alive ? PUMP_CHUNK + P1150_FRAME_MAX : 0;
+    m.threads += stacks;
+    m.total += stacks + ds.bytes;
+
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+#define X(name) dict_set_u64(d, #name, m.name);
+    P1150_MEM_FIELDS(X)
+#undef X
+    dict_set_u64(d, "decode_pool", ds.bytes);
+    dict_set_u64(d, "total", m.total);
+    // not held here: mean size of the frames handed to Python, to size its queue backlog
+    const p1150_perf_t* pf = &self->dev->perf;
+    dict_set_u64(d, "frame_mean", pf->delivered_frames ? pf->delivered_bytes / pf->delivered_frames : 0);
+    return d;
+}
+
+// ----------------- Sample ring: consumers and zero-copy columns -----------------
+
+static const char* sr_col_names[SR_NCOLS]     = { "i", "isnk", "a0", "d01", "d0s" };
+static const char* sr_col_formats[SR_NCOLS]   = { "f", "f", "H", "B", "c" };
+static const Py_ssize_t sr_col_items[SR_NCOLS] = { 4, 4, 2, 1, 1 };
+
+// Read-only buffer over one ring column, holds a reference to its manager so the
+// memory outlives any numpy view made from it
+typedef struct {
+    PyObject_HEAD
+    SerialManagerObject* owner;
+    int                  col;
+    Py_ssize_t           shape;
+} SampleColumnObject;
+
+static void SampleColumn_dealloc(SampleColumnObject* self) {
+    Py_XDECREF(self->owner);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int SampleColumn_getbuffer(SampleColumnObject* self, Py_buffer* view, int flags) {
+    if (flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "sample ring columns are read-only");
+        view->obj = NULL;
+        return -1;
+    }
+    view->obj = (PyObject*)self;
+    Py_INCREF(self);
+    view->buf = self->owner->dev->sring.col[self->col];
+    view->itemsize = sr_col_items[self->col];
+    view->len = self->shape * view->itemsize;
+    view->readonly = 1;
+    view->ndim = 1;
+    view->format = (flags & PyBUF_FORMAT) ? (char*)sr_col_formats[self->col] : NULL;
+    view->shape = (flags & PyBUF_ND) ? &self->shape : NULL;
+    view->strides = (flags & PyBUF_STRIDES) ? &view->itemsize : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
     return 0;
 }
 
+static PyBufferProcs SampleColumn_as_buffer = {
+    (getbufferproc)SampleColumn_getbuffer,
+    NULL,
+};
 
-static DWORD WINAPI writer_thread_win(LPVOID param) {
-    SerialManagerObject* self = (SerialManagerObject*)param;
-    uint8_t buf[65536];
-    uint64_t cpu_prev_ns = thread_cpu_now_ns();
-    uint32_t cpu_sample_ctr = 0;
+static PyTypeObject SampleColumnType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "mp_serial_ext.SampleColumn",
+    .tp_basicsize = sizeof(SampleColumnObject),
+    .tp_dealloc = (destructor)SampleColumn_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "Read-only buffer over one sample ring column, index with seq & (capacity - 1)",
+    .tp_as_buffer = &SampleColumn_as_buffer,
+};
 
-    while (self->alive) {
-        if (++cpu_sample_ctr >= CPU_SAMPLE_EVERY_N_LOOPS) {
-            uint64_t cpu_now_ns = thread_cpu_now_ns();
-            if (cpu_now_ns >= cpu_prev_ns) self->perf_cpu_writer_ns += (cpu_now_ns - cpu_prev_ns);
-            cpu_prev_ns = cpu_now_ns;
-            cpu_sample_ctr = 0;
-        }
+static int ring_check(SerialManagerObject* self) {
+    if (!sample_ring_enabled(&self->dev->sring)) {
+        PyErr_SetString(PyExc_RuntimeError, "sample ring disabled (sample_ring=0)");
+        return -1;
+    }
+    return 0;
+}
 
-        if (!self->py_enabled) break; // don't touch Python C-API after shutdown begins
+static int ring_check_id(SerialManagerObject* self, int id) {
+    if (ring_check(self) != 0) return -1;
+    if (id < 0 || id >= SR_MAX_CONSUMERS || !self->dev->sring.cons[id].active) {
+        PyErr_Format(PyExc_ValueError, "invalid sample ring consumer %d", id);
+        return -1;
+    }
+    return 0;
+}
 
-        Py_ssize_t n = 0;
-        int got = try_pop_write(self, buf, sizeof(buf), 0.001, &n);
-        if (!got) {
-            continue;
-        }
+static PyObject* SerialManager_ring_column(SerialManagerObject* self, PyObject* arg) {
+    if (ring_check(self) != 0) return NULL;
+    const char* name = PyUnicode_AsUTF8(arg);
+    if (!name) return NULL;
+    for (int c = 0; c < SR_NCOLS; c++) {
+        if (strcmp(name, sr_col_names[c]) != 0) continue;
+        SampleColumnObject* o = PyObject_New(SampleColumnObject, &SampleColumnType);
+        if (!o) return NULL;
+        Py_INCREF(self);
+        o->owner = self;
+        o->col = c;
+        o->shape = (Py_ssize_t)self->dev->sring.capacity;
+        return (PyObject*)o;
+    }
+    return PyErr_Format(PyExc_KeyError, "no sample ring column '%s'", name);
+}
 
-        if (!self->alive || !self->py_enabled) break;
-        if (!self->h_port || self->h_port == INVALID_HANDLE_VALUE) break;
-
-        // Batch: drain more queued items without blocking to coalesce writes
-        Py_ssize_t total = n;
-        while (total < (Py_ssize_t)sizeof(buf)) {
-            Py_ssize_t m = 0;
-            if (!try_pop_write(self, buf + total, sizeof(buf) - (size_t)total, 0.0, &m))
-                break; // queue empty
-            total += m;
-        }
+static PyObject* SerialManager_ring_attach(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"name", "policy", "wake", NULL};
+    const char* name = "";
+    const char* policy = "overwrite";
+    unsigned long long wake = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|sK", kwlist, &name, &policy, &wake)) return NULL;
+    if (ring_check(self) != 0) return NULL;
+
+    int pol;
+    if (strcmp(policy, "overwrite") == 0) pol = SR_POLICY_OVERWRITE;
+    else if (strcmp(policy, "gate") == 0) pol = SR_POLICY_GATE;
+    else return PyErr_Format(PyExc_ValueError, "policy must be 'overwrite' or 'gate'");
+
+    int id = sample_ring_attach(&self->dev->sring, name, pol, (uint64_t)wake);
+    if (id < 0) return PyErr_Format(PyExc_RuntimeError, "sample ring: all %d consumer slots in use", SR_MAX_CONSUMERS);
+    return PyLong_FromLong(id);
+}
 
-        // Single OS write for the batch
-        if (total > 0) {
-            (void)serial_write_win(self->h_port, buf, (size_t)total);
-            self->perf_tx_batches++;
-            self->perf_tx_bytes += (uint64_t)total;
-        }
+static PyObject* SerialManager_ring_detach(SerialManagerObject* self, PyObject* arg) {
+    int id = (int)PyLong_AsLong(arg);
+    if (id == -1 && PyErr_Occurred()) return NULL;
+    if (sample_ring_enabled(&self->dev->sring)) sample_ring_detach(&self->dev->sring, id);
+    Py_RETURN_NONE;
+}
+
+// (start_seq, n) readable now
+static PyObject* SerialManager_ring_poll(SerialManagerObject* self, PyObject* arg) {
+    int id = (int)PyLong_AsLong(arg);
+    if (id == -1 && PyErr_Occurred()) return NULL;
+    if (ring_check_id(self, id) != 0) return NULL;
+    uint64_t start = 0;
+    uint64_t n = sample_ring_poll(&self->dev->sring, id, &start);
+    return Py_BuildValue("(KK)", (unsigned long long)start, (unsigned long long)n);
+}
+
+static PyObject* SerialManager_ring_wait(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"id", "min", "timeout", NULL};
+    int id = -1;
+    unsigned long long min = 0;
+    double timeout = 1.0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "i|Kd", kwlist, &id, &min, &timeout)) return NULL;
+    if (ring_check_id(self, id) != 0) return NULL;
+    if (timeout < 0) timeout = 0;
+
+    uint64_t n;
+    Py_BEGIN_ALLOW_THREADS
+    n = sample_ring_wait(&self->dev->sring, id, (uint64_t)min, (unsigned)(timeout * 1000.0));
+    Py_END_ALLOW_THREADS
+    return PyLong_FromUnsignedLongLong((unsigned long long)n);
+}
+
+static PyObject* SerialManager_ring_commit(SerialManagerObject* self, PyObject* args) {
+    int id = -1;
+    unsigned long long n = 0;
+    if (!PyArg_ParseTuple(args, "iK", &id, &n)) return NULL;
+    if (ring_check_id(self, id) != 0) return NULL;
+    return PyLong_FromUnsignedLongLong((unsigned long long)sample_ring_commit(&self->dev->sring, id, (uint64_t)n));
+}
+
+static PyObject* SerialManager_ring_info(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    sample_ring_t* r = &self->dev->sring;
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+    uint64_t head = mp_load_acquire_u64(&r->head);
+    dict_set_u64(d, "capacity", r->capacity);
+    dict_set_u64(d, "head", head);
+    dict_set_u64(d, "dropped", r->dropped);
+    dict_set_u64(d, "bytes", r->capacity * SR_SAMPLE_BYTES);
+
+    PyObject* l = PyList_New(0);
+    if (!l) { Py_DECREF(d); return NULL; }
+    mp_mutex_lock(&r->mx);
+    for (int k = 0; k < SR_MAX_CONSUMERS; k++) {
+        const sr_consumer_t* c = &r->cons[k];
+        if (!c->active) continue;
+        PyObject* cd = PyDict_New();
+        if (!cd) break;
+        dict_set_u64(cd, "id", (uint64_t)k);
+        PyObject* o = PyUnicode_FromString(c->name);
+        if (o) { PyDict_SetItemString(cd, "name", o); Py_DECREF(o); }
+        o = PyUnicode_FromString(c->policy == SR_POLICY_GATE ? "gate" : "overwrite");
+        if (o) { PyDict_SetItemString(cd, "policy", o); Py_DECREF(o); }
+        dict_set_u64(cd, "cursor", c->cursor);
+        dict_set_u64(cd, "lag", head > c->cursor ? head - c->cursor : 0);
+        dict_set_u64(cd, "max_lag", c->max_lag);
+        dict_set_u64(cd, "overrun", c->overrun);
+        dict_set_u64(cd, "consumed", c->consumed);
+        dict_set_u64(cd, "wake", c->wake);
+        PyList_Append(l, cd);
+        Py_DECREF(cd);
+    }
+    mp_mutex_unlock(&r->mx);
+    PyErr_Clear();
+    PyDict_SetItemString(d, "consumers", l);
+    Py_DECREF(l);
+    return d;
+}
+
+// ----------------- Digital channels: edges and packed bits -----------------
+
+static int digital_check(SerialManagerObject* self, int line) {
+    if (!digital_enabled(&self->dev->digital)) {
+        PyErr_SetString(PyExc_RuntimeError, "digital channels disabled (digital=0)");
+        return -1;
+    }
+    if (line < 0 || line >= DIG_LINES) {
+        PyErr_SetString(PyExc_ValueError, "line must be 0 (D0) or 1 (D1)");
+        return -1;
     }
-    uint64_t cpu_end_ns = thread_cpu_now_ns();
-    if (cpu_end_ns >= cpu_prev_ns) self->perf_cpu_writer_ns += (cpu_end_ns - cpu_prev_ns);
     return 0;
 }
 
-#else
-static void* reader_thread_posix(void* param) {
-    SerialManagerObject* self = (SerialManagerObject*)param;
+// bytes of little-endian uint64 edges, (sample index << 1) | new state
+static PyObject* SerialManager_digital_edges(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"line", "start", "end", "max", NULL};
+    int line = 0;
+    unsigned long long start = 0, end = UINT64_MAX;
+    Py_ssize_t max = (Py_ssize_t)1 << DIG_EDGES_LOG2;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "i|KKn", kwlist, &line, &start, &end, &max)) return NULL;
+    if (digital_check(self, line) != 0) return NULL;
+    if (max < 0) max = 0;
+
+    PyObject* b = PyBytes_FromStringAndSize(NULL, max * (Py_ssize_t)sizeof(uint64_t));
+    if (!b) return NULL;
+    size_t n;
+    Py_BEGIN_ALLOW_THREADS
+    n = digital_edges(&self->dev->digital, line, start, end, (uint64_t*)PyBytes_AS_STRING(b), (size_t)max);
+    Py_END_ALLOW_THREADS
+    if (_PyBytes_Resize(&b, (Py_ssize_t)(n * sizeof(uint64_t))) != 0) return NULL;
+    return b;
+}
 
-    // IO + framing
-    uint8_t inbuf[16384];
-    uint8_t framebuf[65536];
-    size_t  frame_len = 0;
+static PyObject* SerialManager_digital_state_at(SerialManagerObject* self, PyObject* args) {
+    int line = 0;
+    unsigned long long idx = 0;
+    if (!PyArg_ParseTuple(args, "iK", &line, &idx)) return NULL;
+    if (digital_check(self, line) != 0) return NULL;
+    int st = digital_state_at(&self->dev->digital, line, idx);
+    if (st < 0) Py_RETURN_NONE;
+    return PyLong_FromLong(st);
+}
 
-    set_current_thread_highest_priority();
-    uint64_t cpu_prev_ns = thread_cpu_now_ns();
-    uint32_t cpu_sample_ctr = 0;
+// slope: +1 rise, -1 fall, 0 either; returns (index, state) or None
+static PyObject* SerialManager_digital_find_edge(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"line", "start", "slope", NULL};
+    int line = 0, slope = 1;
+    unsigned long long start = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "iK|i", kwlist, &line, &start, &slope)) return NULL;
+    if (digital_check(self, line) != 0) return NULL;
+    uint64_t e = 0;
+    if (!digital_find_edge(&self->dev->digital, line, start, slope, &e)) Py_RETURN_NONE;
+    return Py_BuildValue("(KI)", (unsigned long long)DIG_EDGE_IDX(e), DIG_EDGE_STATE(e));
+}
 
-    while (self->alive) {
-        if (++cpu_sample_ctr >= CPU_SAMPLE_EVERY_N_LOOPS) {
-            uint64_t cpu_now_ns = thread_cpu_now_ns();
-            if (cpu_now_ns >= cpu_prev_ns) self->perf_cpu_reader_ns += (cpu_now_ns - cpu_prev_ns);
-            cpu_prev_ns = cpu_now_ns;
-            cpu_sample_ctr = 0;
-        }
+// (start, n, packed bits LSB first) clipped to the retained range
+static PyObject* SerialManager_digital_bits(SerialManagerObject* self, PyObject* args) {
+    int line = 0;
+    unsigned long long start = 0, n = 0;
+    if (!PyArg_ParseTuple(args, "iKK", &line, &start, &n)) return NULL;
+    if (digital_check(self, line) != 0) return NULL;
+    if (n > self->dev->digital.bits_capacity) n = self->dev->digital.bits_capacity;
+
+    PyObject* b = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)((n + 7) / 8));
+    if (!b) return NULL;
+    uint64_t s = start, got;
+    Py_BEGIN_ALLOW_THREADS
+    got = digital_bits(&self->dev->digital, line, &s, n, (uint8_t*)PyBytes_AS_STRING(b));
+    Py_END_ALLOW_THREADS
+    if (_PyBytes_Resize(&b, (Py_ssize_t)((got + 7) / 8)) != 0) return NULL;
+    PyObject* r = Py_BuildValue("(KKO)", (unsigned long long)s, (unsigned long long)got, b);
+    Py_DECREF(b);
+    return r;
+}
 
-        fd_set read_fds;
-        FD_ZERO(&read_fds);
-        if (self->fd < 0) break;
-        FD_SET(self->fd, &read_fds);
+static PyObject* SerialManager_digital_info(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    digital_t* d = &self->dev->digital;
+    PyObject* r = PyDict_New();
+    if (!r) return NULL;
+    mp_mutex_lock(&d->mx);
+    uint64_t n = d->n_samples, e0 = d->n_edges[0], e1 = d->n_edges[1];
+    unsigned s0 = d->state[0], s1 = d->state[1];
+    int primed = d->primed;
+    mp_mutex_unlock(&d->mx);
+
+    dict_set_u64(r, "samples", n);
+    dict_set_u64(r, "oldest", digital_enabled(d) ? digital_oldest(d) : 0);
+    dict_set_u64(r, "bits_capacity", d->bits_capacity);
+    dict_set_u64(r, "edges_capacity", (uint64_t)1 << DIG_EDGES_LOG2);
+    PyObject* o = Py_BuildValue("(KK)", (unsigned long long)(e0 ? e0 - 1 : 0), (unsigned long long)(e1 ? e1 - 1 : 0));
+    if (o) { PyDict_SetItemString(r, "edges", o); Py_DECREF(o); }
+    if (primed) o = Py_BuildValue("(II)", s0, s1);
+    else { o = Py_None; Py_INCREF(o); }
+    if (o) { PyDict_SetItemString(r, "state", o); Py_DECREF(o); }
+    PyErr_Clear();
+    return r;
+}
 
-        struct timeval timeout;
-        timeout.tv_sec = 0;
-        timeout.tv_usec = 100000; // 100ms timeout to remain responsive
+// ----------------- D0/D1 gated current statistics -----------------
 
-        int rv = select(self->fd + 1, &read_fds, NULL, NULL, &timeout);
-        if (!self->alive) break;
+static const char* gated_src_names[] = {"i", "isnk", "net"};
 
-        if (rv < 0) {
-            if (errno == EINTR) continue; // Interrupted by signal, just loop again
-            break; // A real error occurred
-        }
-        if (rv == 0) {
-            continue; // Timeout, no data. Loop to check self->alive.
-        }
+static PyObject* gated_cfg_dict(const gated_cfg_t* c) {
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+    dict_set_u64(d, "line", (uint64_t)c->line);
+    dict_set_u64(d, "active", (uint64_t)c->active);
+    PyObject* o = PyUnicode_FromString(gated_src_names[c->source]);
+    if (o) { PyDict_SetItemString(d, "source", o); Py_DECREF(o); }
+    PyErr_Clear();
+    dict_set_u64(d, "min_samples", c->min_samples);
+    return d;
+}
 
-        // Data is available, so we read it.
-        int n = serial_read_posix(self->fd, inbuf, sizeof(inbuf));
-        if (!self->alive) break;
+static PyObject* gated_acc_dict(const gated_acc_t* a) {
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+    double mean = a->n ? a->sum / (double)a->n : 0.0;
+    dict_set_u64(d, "samples", a->n);
+    dict_set_f64(d, "charge_uc", a->sum * 1000.0 / ADC_SAMPLE_RATE_HZ);
+    dict_set_f64(d, "mean_ma", mean);
+    dict_set_f64(d, "rms_ma", a->n ? sqrt(a->sumsq / (double)a->n) : 0.0);
+    dict_set_f64(d, "peak_ma", a->peak);
+    dict_set_f64(d, "min_ma", a->min);
+    return d;
+}
+
+static void dict_set_obj(PyObject* d, const char* key, PyObject* o) {
+    if (!o) { PyErr_Clear(); return; }
+    PyDict_SetItemString(d, key, o);
+    Py_DECREF(o);
+}
+
+// Keyword only line, active, source ("i"/"isnk"/"net"), min_samples; omitted values are
+// kept.  Applying a configuration clears all results.
+static PyObject* SerialManager_gated_config(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"line", "active", "source", "min_samples", NULL};
+    gated_t* g = &self->dev->gated;
+    const char* source = NULL;
 
-        if (n <= 0) {
-            // Error or EOF, either way, we can't continue.
-            break;
+    mp_mutex_lock(&g->mx);
+    gated_cfg_t cfg = g->cfg;
+    mp_mutex_unlock(&g->mx);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|$iizI", kwlist, &cfg.line, &cfg.active, &source, &cfg.min_samples)) {
+        return NULL;
+    }
+    if (cfg.line < 0 || cfg.line > 1) {
+        PyErr_SetString(PyExc_ValueError, "line must be 0 (D0) or 1 (D1)");
+        return NULL;
+    }
+    if (cfg.active != 0 && cfg.active != 1) {
+        PyErr_SetString(PyExc_ValueError, "active must be 0 or 1");
+        return NULL;
+    }
+    if (source) {
+        int k;
+        for (k = 0; k < 3 && strcmp(source, gated_src_names[k]) != 0; k++) {}
+        if (k == 3) {
+            PyErr_SetString(PyExc_ValueError, "source must be 'i', 'isnk' or 'net'");
+            return NULL;
         }
-        self->perf_rx_bytes += (uint64_t)n;
-
-        const uint8_t* p   = inbuf;
-        const uint8_t* end = inbuf + n;
-
-        while (p < end) {
-            const uint8_t* z = (const uint8_t*)memchr(p, 0x00, (size_t)(end - p));
-            const uint8_t* q = z ? z : end;
-
-            size_t chunk = (size_t)(q - p);
-            if (chunk) {
-                if (frame_len + chunk <= sizeof(framebuf)) {
-                    memcpy(framebuf + frame_len, p, chunk);
-                    frame_len += chunk;
-                } else {
-                    // overflow -> drop partial to resync
-                    frame_len = 0;
-                }
-            }
+        cfg.source = k;
+    }
 
-            if (z) {
-                if (frame_len > 0 && self->py_enabled) {
-                    uint8_t tmp[65536];
-                    int olen = cobs_decode(framebuf, frame_len, tmp, sizeof(tmp));
-                    if (olen >= 0) {
-                        ring_push(self, tmp, olen);
-                        self->perf_rx_frames++;
-                    } else {
-                        self->perf_cobs_decode_errors++;
-                    }
-                }
-                frame_len = 0;
-                p = z + 1;
-            } else {
-                break;
-            }
+    gated_reset(g, &cfg, self->dev->perf.adc_samples);
+    return gated_cfg_dict(&cfg);
+}
 
-            if (!self->alive) break;
+// Per state, per line and open pulse results since the last reset
+static PyObject* SerialManager_gated_stats(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"reset", NULL};
+    int reset = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|p", kwlist, &reset)) return NULL;
+
+    gated_t* g = &self->dev->gated;
+    mp_mutex_lock(&g->mx);
+    gated_cfg_t cfg = g->cfg;
+    gated_acc_t st[GATED_STATES], open = g->open;
+    memcpy(st, g->state, sizeof(st));
+    uint64_t n_pulses = g->n_pulses, glitches = g->glitches, since = g->since, open_start = g->open_start;
+    int in_pulse = g->in_pulse;
+    mp_mutex_unlock(&g->mx);
+    if (reset) gated_reset(g, NULL, self->dev->perf.adc_samples);
+
+    PyObject* d = gated_cfg_dict(&cfg);
+    if (!d) return NULL;
+    dict_set_u64(d, "since", since);
+    dict_set_u64(d, "pulses", n_pulses);
+    dict_set_u64(d, "glitches", glitches);
+
+    PyObject* states = PyList_New(GATED_STATES);
+    if (states) {
+        for (int s = 0; s < GATED_STATES; s++) {
+            PyObject* o = gated_acc_dict(&st[s]);
+            if (!o) { o = Py_None; Py_INCREF(o); PyErr_Clear(); }
+            PyList_SET_ITEM(states, s, o);
         }
     }
-    uint64_t cpu_end_ns = thread_cpu_now_ns();
-    if (cpu_end_ns >= cpu_prev_ns) self->perf_cpu_reader_ns += (cpu_end_ns - cpu_prev_ns);
-    return NULL;
+    dict_set_obj(d, "states", states);
+
+    static const char* lines[] = {"d0", "d1"};
+    for (int l = 0; l < 2; l++) {
+        gated_acc_t lo, hi;
+        memset(&lo, 0, sizeof(lo));
+        memset(&hi, 0, sizeof(hi));
+        for (int s = 0; s < GATED_STATES; s++) gated_acc_merge(((s >> l) & 1) ? &hi : &lo, &st[s]);
+        PyObject* ld = PyDict_New();
+        if (ld) {
+            dict_set_obj(ld, "low", gated_acc_dict(&lo));
+            dict_set_obj(ld, "high", gated_acc_dict(&hi));
+        }
+        dict_set_obj(d, lines[l], ld);
+    }
+
+    if (in_pulse) {
+        PyObject* o = gated_acc_dict(&open);
+        if (o) dict_set_u64(o, "start", open_start);
+        dict_set_obj(d, "open", o);
+    } else {
+        PyDict_SetItemString(d, "open", Py_None);
+    }
+    return d;
 }
 
-static void* deliver_thread_posix(void* param) {
-    SerialManagerObject* self = (SerialManagerObject*)param;
-    uint64_t cpu_prev_ns = thread_cpu_now_ns();
-    uint32_t cpu_sample_ctr = 0;
+// (next, bytes of gated_pulse_t records) for pulses numbered >= since
+static PyObject* SerialManager_gated_pulses(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"since", "max", NULL};
+    unsigned long long since = 0;
+    Py_ssize_t max = (Py_ssize_t)1 << GATED_PULSES_LOG2;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|Kn", kwlist, &since, &max)) return NULL;
+    if (max < 0) max = 0;
+    if (max > ((Py_ssize_t)1 << GATED_PULSES_LOG2)) max = (Py_ssize_t)1 << GATED_PULSES_LOG2;
+
+    PyObject* b = PyBytes_FromStringAndSize(NULL, max * (Py_ssize_t)sizeof(gated_pulse_t));
+    if (!b) return NULL;
+    uint64_t next = since;
+    size_t n = gated_pulses(&self->dev->gated, since, (gated_pulse_t*)PyBytes_AS_STRING(b), (size_t)max, &next);
+    if (_PyBytes_Resize(&b, (Py_ssize_t)(n * sizeof(gated_pulse_t))) != 0) return NULL;
+    PyObject* r = Py_BuildValue("(KO)", (unsigned long long)next, b);
+    Py_DECREF(b);
+    return r;
+}
 
-    while (self->alive) {
-        if (++cpu_sample_ctr >= CPU_SAMPLE_EVERY_N_LOOPS) {
-            uint64_t cpu_now_ns = thread_cpu_now_ns();
-            if (cpu_now_ns >= cpu_prev_ns) self->perf_cpu_deliver_ns += (cpu_now_ns - cpu_prev_ns);
-            cpu_prev_ns = cpu_now_ns;
-            cpu_sample_ctr = 0;
-        }
+// ----------------- Current distribution histogram -----------------
+
+// Log bin counts of "i"/"isnk" since reset (window_s 0) or over the last window_s seconds,
+// rounded up to whole slots
+static PyObject* SerialManager_current_hist(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"channel", "window_s", NULL};
+    const char* channel = "i";
+    double window_s = 0.0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|sd", kwlist, &channel, &window_s)) return NULL;
+
+    int ch;
+    if (strcmp(channel, "i") == 0) ch = 0;
+    else if (strcmp(channel, "isnk") == 0) ch = 1;
+    else {
+        PyErr_SetString(PyExc_ValueError, "channel must be 'i' or 'isnk'");
+        return NULL;
+    }
+    if (window_s < 0.0) window_s = 0.0;
 
-        pthread_mutex_lock(&self->ring_mx);
-        while (self->alive && self->ring_head == self->ring_tail) {
-            pthread_cond_wait(&self->ring_cond, &self->ring_mx);
+    chist_t* h = &self->dev->chist;
+    mp_mutex_lock(&h->mx);
+    uint64_t slot_samples = h->slot_samples, since = h->since;
+    mp_mutex_unlock(&h->mx);
+
+    uint32_t window = 0;
+    if (window_s > 0.0) {
+        double w = ceil(window_s * ADC_SAMPLE_RATE_HZ / (double)slot_samples);
+        window = w >= CHIST_SLOTS ? CHIST_SLOTS : (uint32_t)w;
+    }
+    uint64_t counts[CHIST_NBINS];
+    uint64_t samples = chist_query(h, ch, window, counts);
+
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+    dict_set_u64(d, "samples", samples);
+    dict_set_f64(d, "seconds", (double)samples / ADC_SAMPLE_RATE_HZ);
+    dict_set_u64(d, "since", since);
+    dict_set_u64(d, "window_slots", window);
+    dict_set_u64(d, "slot_ms", slot_samples * 1000u / ADC_SAMPLE_RATE_HZ);
+    dict_set_u64(d, "underflow", counts[0]);
+    dict_set_u64(d, "overflow", counts[CHIST_NBINS - 1]);
+
+    PyObject* c = PyList_New(CHIST_LOG_BINS);
+    PyObject* e = PyList_New(CHIST_LOG_BINS + 1);
+    if (c && e) {
+        for (int b = 0; b < CHIST_LOG_BINS; b++) {
+            PyList_SET_ITEM(c, b, PyLong_FromUnsignedLongLong((unsigned long long)counts[b + 1]));
         }
-        pthread_mutex_unlock(&self->ring_mx);
+        for (int b = 0; b <= CHIST_LOG_BINS; b++) PyList_SET_ITEM(e, b, PyFloat_FromDouble(chist_edge_ma(b + 1)));
+    }
+    dict_set_obj(d, "counts", c);
+    dict_set_obj(d, "edges_ma", e);
+    return d;
+}
 
-        if (!self->alive) break;
-        deliver_batch_to_python(self);
+// Clear all counts; slot_ms (1..60000) sets the window granularity, 0 keeps it
+static PyObject* SerialManager_current_hist_reset(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"slot_ms", NULL};
+    unsigned int slot_ms = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|I", kwlist, &slot_ms)) return NULL;
+    if (slot_ms > CHIST_SLOT_MS_MAX) {
+        PyErr_Format(PyExc_ValueError, "slot_ms must be 0 (keep) or 1..%d", CHIST_SLOT_MS_MAX);
+        return NULL;
     }
+    chist_reset(&self->dev->chist, slot_ms, self->dev->perf.adc_samples);
+    Py_RETURN_NONE;
+}
+
+// ----------------- Multi-rate history -----------------
+
+static PyObject* history_dict(SerialManagerObject* self) {
+    hist_info_t st;
+    hist_info(&self->dev->hist, &st);
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+    dict_set_u64(d, "base", st.base);
+    dict_set_u64(d, "samples", st.samples);
+    dict_set_u64(d, "bytes", st.bytes);
+    PyObject* l = PyList_New(st.n_levels);
+    for (uint32_t k = 0; l && k < st.n_levels; k++) {
+        PyObject* e = PyDict_New();
+        if (!e) break;
+        dict_set_u64(e, "decim", st.level[k].decim);
+        dict_set_u64(e, "capacity", st.level[k].capacity);
+        dict_set_u64(e, "done", st.level[k].done);
+        dict_set_f64(e, "rate_hz", (double)ADC_SAMPLE_RATE_HZ / st.level[k].decim);
+        dict_set_f64(e, "span_s", (double)st.level[k].capacity * st.level[k].decim / ADC_SAMPLE_RATE_HZ);
+        PyList_SET_ITEM(l, k, e);
+    }
+    dict_set_obj(d, "levels", l);
+    return d;
+}
+
+// history_config(levels): [(decim, capacity), ...] up to HIST_MAX_LEVELS, [] turns it off
+static PyObject* SerialManager_history_config(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"levels", NULL};
+    PyObject* levels;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O", kwlist, &levels)) return NULL;
+    PyObject* seq = PySequence_Fast(levels, "levels must be a sequence of (decim, capacity)");
+    if (!seq) return NULL;
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    uint32_t decim[HIST_MAX_LEVELS];
+    uint64_t capacity[HIST_MAX_LEVELS];
+    int ok = n <= HIST_MAX_LEVELS;
+    for (Py_ssize_t k = 0; ok && k < n; k++) {
+        unsigned int dc;
+        unsigned long long cp;
+        ok = PyArg_ParseTuple(PySequence_Fast_GET_ITEM(seq, k), "IK", &dc, &cp);
+        decim[k] = dc;
+        capacity[k] = cp;
+    }
+    Py_DECREF(seq);
+    if (!ok) {
+        PyErr_Clear();
+        return PyErr_Format(PyExc_ValueError, "levels must be up to %d (decim, capacity) pairs", HIST_MAX_LEVELS);
+    }
+
+    int rv;
+    uint64_t base = self->dev->perf.adc_samples;
+    Py_BEGIN_ALLOW_THREADS
+    rv = hist_config(&self->dev->hist, decim, capacity, (uint32_t)n, base);
+    Py_END_ALLOW_THREADS
+    if (rv == -1) {
+        return PyErr_Format(PyExc_ValueError, "history levels need decim > 0, each a multiple of the one "
+                            "before, and capacity > 0");
+    }
+    if (rv != 0) return PyErr_NoMemory();
+    return history_dict(self);
+}
+
+static PyObject* SerialManager_history_info(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    return history_dict(self);
+}
+
+// history_read(level, since=None, max_blocks=65536) -> (first, packed rec_bg_block_t);
+// since None: the newest max_blocks
+static PyObject* SerialManager_history_read(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"level", "since", "max_blocks", NULL};
+    unsigned int level;
+    PyObject* since_obj = Py_None;
+    unsigned long long max_blocks = 65536;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "I|OK", kwlist, &level, &since_obj, &max_blocks)) return NULL;
+    uint64_t since = HIST_LAST;
+    if (since_obj != Py_None) {
+        since = PyLong_AsUnsignedLongLong(since_obj);
+        if (PyErr_Occurred()) return NULL;
+    }
+    if (max_blocks == 0 || max_blocks > PY_SSIZE_T_MAX / sizeof(rec_bg_block_t)) {
+        return PyErr_Format(PyExc_ValueError, "max_blocks out of range");
+    }
+    hist_info_t st;
+    hist_info(&self->dev->hist, &st);
+    if (level >= st.n_levels) return PyErr_Format(PyExc_ValueError, "history level %u not configured", level);
+    if (max_blocks > st.level[level].capacity) max_blocks = st.level[level].capacity;
+
+    PyObject* out = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)(max_blocks * sizeof(rec_bg_block_t)));
+    if (!out) return NULL;
+    uint64_t first;
+    size_t cnt;
+    Py_BEGIN_ALLOW_THREADS
+    cnt = hist_read(&self->dev->hist, level, since, (rec_bg_block_t*)PyBytes_AS_STRING(out), (size_t)max_blocks, &first);
+    Py_END_ALLOW_THREADS
+    if (_PyBytes_Resize(&out, (Py_ssize_t)(cnt * sizeof(rec_bg_block_t))) != 0) return NULL;
+    return Py_BuildValue("(KN)", (unsigned long long)first, out);
+}
+
+// ----------------- Debug plotter channels -----------------
+
+static PyObject* plot_dict(SerialManagerObject* self) {
+    plot_t* p = &self->dev->plot;
+    plot_info_t st;
+    plot_info(p, &st);
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+    dict_set_u64(d, "max_channels", st.max_channels);
+    dict_set_u64(d, "capacity", st.capacity);
+    dict_set_u64(d, "items", st.items);
+    dict_set_u64(d, "errors", st.errors);
+    dict_set_u64(d, "unbound", st.unbound);
+    dict_set_u64(d, "bytes", st.bytes);
+    dict_set_u64(d, "stream_samples", self->dev->perf.adc_samples);
+    dict_set_obj(d, "forward", PyBool_FromLong(st.forward));
+    PyObject* l = PyList_New(st.n_channels);
+    for (uint32_t k = 0; l && k < st.n_channels; k++) {
+        char name[PLOT_NAME_MAX];
+        uint64_t done = 0, items = 0, last = 0;
+        (void)plot_channel_info(p, (int)k, name, &done, &items, &last);
+        PyObject* e = PyDict_New();
+        if (!e) break;
+        dict_set_obj(e, "name", PyUnicode_DecodeUTF8(name, (Py_ssize_t)strlen(name), "replace"));
+        dict_set_u64(e, "points", done);
+        dict_set_u64(e, "items", items);
+        dict_set_u64(e, "last_seq", last);
+        PyList_SET_ITEM(l, k, e);
+    }
+    dict_set_obj(d, "channels", l);
+    return d;
+}
+
+// plot_config(channels=16, capacity=65536, forward=False): 0 channels turns it off
+static PyObject* SerialManager_plot_config(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"channels", "capacity", "forward", NULL};
+    unsigned int channels = 16;
+    unsigned long long capacity = 65536;
+    int forward = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|IKp", kwlist, &channels, &capacity, &forward)) return NULL;
+    int rv;
+    Py_BEGIN_ALLOW_THREADS
+    rv = plot_config(&self->dev->plot, channels, capacity, forward);
+    Py_END_ALLOW_THREADS
+    if (rv == -1) {
+        return PyErr_Format(PyExc_ValueError, "plot needs 0..%d channels and capacity > 0", PLOT_MAX_CHANNELS);
+    }
+    if (rv != 0) return PyErr_NoMemory();
+    return plot_dict(self);
+}
+
+static PyObject* SerialManager_plot_info(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    return plot_dict(self);
+}
+
+static int plot_channel_arg(SerialManagerObject* self, const char* name) {
+    int ch = plot_channel(&self->dev->plot, name);
+    if (ch < 0) PyErr_Format(PyExc_ValueError, "plot channel '%s' not seen", name);
+    return ch;
+}
+
+// plot_read(name, since=None, max_points=65536) -> (first, packed plot_point_t);
+// since None: the newest max_points
+static PyObject* SerialManager_plot_read(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"name", "since", "max_points", NULL};
+    const char* name;
+    PyObject* since_obj = Py_None;
+    unsigned long long max_points = 65536;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|OK", kwlist, &name, &since_obj, &max_points)) return NULL;
+    uint64_t since = PLOT_LAST;
+    if (since_obj != Py_None) {
+        since = PyLong_AsUnsignedLongLong(since_obj);
+        if (PyErr_Occurred()) return NULL;
+    }
+    if (max_points == 0 || max_points > PY_SSIZE_T_MAX / sizeof(plot_point_t)) {
+        return PyErr_Format(PyExc_ValueError, "max_points out of range");
+    }
+    int ch = plot_channel_arg(self, name);
+    if (ch < 0) return NULL;
+    plot_info_t st;
+    plot_info(&self->dev->plot, &st);
+    if (max_points > st.capacity) max_points = st.capacity;
+
+    PyObject* out = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)(max_points * sizeof(plot_point_t)));
+    if (!out) return NULL;
+    uint64_t first;
+    size_t cnt;
+    Py_BEGIN_ALLOW_THREADS
+    cnt = plot_read(&self->dev->plot, ch, since, (plot_point_t*)PyBytes_AS_STRING(out), (size_t)max_points, &first);
+    Py_END_ALLOW_THREADS
+    if (_PyBytes_Resize(&out, (Py_ssize_t)(cnt * sizeof(plot_point_t))) != 0) return NULL;
+    return Py_BuildValue("(KN)", (unsigned long long)first, out);
+}
+
+// plot_lod(name, seq0, seq1, buckets) -> (points, packed plot_bucket_t)
+static PyObject* SerialManager_plot_lod(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"name", "seq0", "seq1", "buckets", NULL};
+    const char* name;
+    unsigned long long seq0, seq1;
+    unsigned int buckets;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "sKKI", kwlist, &name, &seq0, &seq1, &buckets)) return NULL;
+    if (buckets == 0 || buckets > (1u << 24) || seq1 <= seq0) {
+        return PyErr_Format(PyExc_ValueError, "plot_lod needs seq1 > seq0 and 1..%u buckets", 1u << 24);
+    }
+    int ch = plot_channel_arg(self, name);
+    if (ch < 0) return NULL;
+    PyObject* out = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)((size_t)buckets * sizeof(plot_bucket_t)));
+    if (!out) return NULL;
+    uint64_t n;
+    Py_BEGIN_ALLOW_THREADS
+    n = plot_lod(&self->dev->plot, ch, seq0, seq1, (plot_bucket_t*)PyBytes_AS_STRING(out), buckets);
+    Py_END_ALLOW_THREADS
+    return Py_BuildValue("(KN)", (unsigned long long)n, out);
+}
 
-    uint64_t cpu_end_ns = thread_cpu_now_ns();
-    if (cpu_end_ns >= cpu_prev_ns) self->perf_cpu_deliver_ns += (cpu_end_ns - cpu_prev_ns);
-    return NULL;
+// ----------------- Power state segmentation -----------------
+
+static PyObject* seg_record_dict(const seg_record_t* r) {
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+    dict_set_u64(d, "number", r->number);
+    dict_set_u64(d, "start", r->start);
+    dict_set_u64(d, "samples", r->n);
+    dict_set_f64(d, "charge_uc", r->charge_uc);
+    dict_set_f64(d, "mean_ma", r->mean_ma);
+    dict_set_f64(d, "peak_ma", r->peak_ma);
+    dict_set_f64(d, "min_ma", r->min_ma);
+    return d;
 }
 
+// Keyword only block, k, h, floor_ma, min_blocks; omitted values are kept.  Always
+// restarts the segmentation (also the way to reset it).
+static PyObject* SerialManager_segment_config(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"block", "k", "h", "floor_ma", "min_blocks", NULL};
+    seg_t* sg = &self->dev->seg;
 
-static void* writer_thread_posix(void* param) {
-    SerialManagerObject* self = (SerialManagerObject*)param;
-    uint8_t buf[65536];
-    uint64_t cpu_prev_ns = thread_cpu_now_ns();
-    uint32_t cpu_sample_ctr = 0;
+    mp_mutex_lock(&sg->mx);
+    seg_cfg_t cfg = sg->cfg;
+    mp_mutex_unlock(&sg->mx);
 
-    while (self->alive) {
-        if (++cpu_sample_ctr >= CPU_SAMPLE_EVERY_N_LOOPS) {
-            uint64_t cpu_now_ns = thread_cpu_now_ns();
-            if (cpu_now_ns >= cpu_prev_ns) self->perf_cpu_writer_ns += (cpu_now_ns - cpu_prev_ns);
-            cpu_prev_ns = cpu_now_ns;
-            cpu_sample_ctr = 0;
-        }
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|$IdddI", kwlist, &cfg.block, &cfg.k, &cfg.h,
+                                     &cfg.floor_ma, &cfg.min_blocks)) {
+        return NULL;
+    }
+    if (cfg.block == 0 || cfg.k < 0.0 || cfg.h <= 0.0 || cfg.floor_ma <= 0.0) {
+        PyErr_SetString(PyExc_ValueError, "block, h and floor_ma must be > 0, k >= 0");
+        return NULL;
+    }
+    seg_reset(sg, &cfg, self->dev->perf.adc_samples);
 
-        if (!self->py_enabled) break;
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+    dict_set_u64(d, "block", cfg.block);
+    dict_set_f64(d, "k", cfg.k);
+    dict_set_f64(d, "h", cfg.h);
+    dict_set_f64(d, "floor_ma", cfg.floor_ma);
+    dict_set_u64(d, "min_blocks", cfg.min_blocks);
+    return d;
+}
 
-        Py_ssize_t n = 0;
-        // Slightly longer wait lowers idle CPU while keeping low latency for infrequent TX
-        int got = try_pop_write(self, buf, sizeof(buf), 0.005, &n);
-        if (!got) {
-            // Rare TX workload: sleep a little instead of spin-yield
-            usleep(1000);
-            continue;
-        }
+// (next, bytes of seg_record_t) for closed segments numbered >= since
+static PyObject* SerialManager_segments(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"since", "max", NULL};
+    unsigned long long since = 0;
+    Py_ssize_t max = (Py_ssize_t)1 << SEG_RECORDS_LOG2;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|Kn", kwlist, &since, &max)) return NULL;
+    if (max < 0) max = 0;
+    if (max > ((Py_ssize_t)1 << SEG_RECORDS_LOG2)) max = (Py_ssize_t)1 << SEG_RECORDS_LOG2;
+
+    PyObject* b = PyBytes_FromStringAndSize(NULL, max * (Py_ssize_t)sizeof(seg_record_t));
+    if (!b) return NULL;
+    uint64_t next = since;
+    size_t n = seg_records(&self->dev->seg, since, (seg_record_t*)PyBytes_AS_STRING(b), (size_t)max, &next);
+    if (_PyBytes_Resize(&b, (Py_ssize_t)(n * sizeof(seg_record_t))) != 0) return NULL;
+    PyObject* r = Py_BuildValue("(KO)", (unsigned long long)next, b);
+    Py_DECREF(b);
+    return r;
+}
 
-        if (!self->alive || !self->py_enabled) break;
+static PyObject* SerialManager_segment_info(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    seg_t* sg = &self->dev->seg;
+    seg_record_t open;
+    int has_open = seg_open(sg, &open);
 
-        // Batch: drain more queued items to coalesce writes
-        Py_ssize_t total = n;
-        while (total < (Py_ssize_t)sizeof(buf)) {
-            Py_ssize_t m = 0;
-            if (!try_pop_write(self, buf + total, sizeof(buf) - (size_t)total, 0.0, &m))
-                break;
-            total += m;
-        }
+    mp_mutex_lock(&sg->mx);
+    uint64_t n_recs = sg->n_recs, since = sg->since;
+    double g0 = sg->g[0], g1 = sg->g[1];
+    mp_mutex_unlock(&sg->mx);
 
-        if (self->fd >= 0 && total > 0) {
-            (void)serial_write_posix(self->fd, buf, (size_t)total);
-            self->perf_tx_batches++;
-            self->perf_tx_bytes += (uint64_t)total;
-        }
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+    dict_set_u64(d, "segments", n_recs);
+    dict_set_u64(d, "retained", n_recs < ((uint64_t)1 << SEG_RECORDS_LOG2) ? n_recs : ((uint64_t)1 << SEG_RECORDS_LOG2));
+    dict_set_u64(d, "since", since);
+    dict_set_f64(d, "cusum_up", g0);
+    dict_set_f64(d, "cusum_down", g1);
+    if (has_open) {
+        dict_set_obj(d, "open", seg_record_dict(&open));
+    } else {
+        PyDict_SetItemString(d, "open", Py_None);
     }
-    uint64_t cpu_end_ns = thread_cpu_now_ns();
-    if (cpu_end_ns >= cpu_prev_ns) self->perf_cpu_writer_ns += (cpu_end_ns - cpu_prev_ns);
-    return NULL;
+    return d;
 }
-#endif
 
-// ----------------- Python type: SerialManager -----------------
-static void SerialManager_dealloc(SerialManagerObject* self) {
-    self->py_enabled = 0;
-    self->alive = 0;
+// ----------------- Event-triggered recorder -----------------
 
-    // Wake threads for shutdown
-    ring_signal(self);
+static PyObject* recorder_dict(SerialManagerObject* self) {
+    rec_stats_t st;
+    recorder_stats(&self->dev->rec, &st);
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+    PyDict_SetItemString(d, "running", st.running ? Py_True : Py_False);
+    PyDict_SetItemString(d, "pending", st.pending ? Py_True : Py_False);
+    dict_set_u64(d, "start_seq", st.start_seq);
+    dict_set_u64(d, "seq", st.seq);
+    dict_set_u64(d, "events", st.events);
+    dict_set_u64(d, "truncated", st.truncated);
+    dict_set_u64(d, "bg_blocks", st.bg_blocks);
+    dict_set_u64(d, "bytes", st.bytes);
+    dict_set_u64(d, "lost", st.lost);
+    dict_set_u64(d, "error", (uint64_t)st.error);
+    return d;
+}
 
-#ifdef _WIN32
-    // ... existing Windows thread joins ...
-    DeleteCriticalSection(&self->ring_cs);
-    if (self->h_ring_event) CloseHandle(self->h_ring_event);
-#else
+// Start recording to path; triggers is a bytes object of packed rec_trigger_t records
+static PyObject* SerialManager_recorder_start(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"path", "triggers", "pre", "post", "decim", NULL};
+    PyObject* path_obj = NULL;
+    Py_buffer trig;
+    rec_cfg_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.pre = 12500;
+    cfg.post = 12500;
+    cfg.decim = 12500;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&y*|III", kwlist, PyUnicode_FSConverter, &path_obj, &trig,
+                                     &cfg.pre, &cfg.post, &cfg.decim)) {
+        return NULL;
+    }
+    if (trig.len % (Py_ssize_t)sizeof(rec_trigger_t) != 0 || trig.len / (Py_ssize_t)sizeof(rec_trigger_t) > REC_MAX_TRIGGERS) {
+        PyBuffer_Release(&trig);
+        Py_DECREF(path_obj);
+        return PyErr_Format(PyExc_ValueError, "triggers must be 0..%d packed records", REC_MAX_TRIGGERS);
+    }
+    cfg.n_trig = (uint32_t)(trig.len / (Py_ssize_t)sizeof(rec_trigger_t));
+    memcpy(cfg.trig, trig.buf, (size_t)trig.len);
+    PyBuffer_Release(&trig);
+
+    int rv;
     Py_BEGIN_ALLOW_THREADS
-    if (self->read_thread)    pthread_join(self->read_thread,    NULL);
-    if (self->write_thread)   pthread_join(self->write_thread,   NULL);
-    if (self->deliver_thread) pthread_join(self->deliver_thread, NULL);
+    rv = recorder_start(&self->dev->rec, &self->dev->sring, PyBytes_AS_STRING(path_obj), &cfg);
     Py_END_ALLOW_THREADS
-    if (self->fd >= 0) close(self->fd);
-    pthread_mutex_destroy(&self->ring_mx);
-    pthread_cond_destroy(&self->ring_cond);
-#endif
 
-    if (self->ring_data) free(self->ring_data);
+    if (rv == -2) PyErr_SetFromErrnoWithFilename(PyExc_OSError, PyBytes_AS_STRING(path_obj));
+    Py_DECREF(path_obj);
+    if (rv == -1) {
+        return PyErr_Format(PyExc_ValueError, "recorder needs the sample ring, decim > 0, post > 0 and "
+                            "pre + post <= %llu samples", (unsigned long long)(self->dev->sring.capacity / 2));
+    }
+    if (rv == -2) return NULL;
+    if (rv == -3) return PyErr_Format(PyExc_RuntimeError, "no free sample ring consumer");
+    if (rv != 0) return PyErr_Format(PyExc_RuntimeError, "failed to start recorder thread");
+    return recorder_dict(self);
+}
 
-    Py_XDECREF(self->q_in);
-    Py_XDECREF(self->q_out);
-    Py_XDECREF(self->q_out_put_nowait);
-    Py_XDECREF(self->q_in_get);
-    Py_XDECREF(self->q_in_get_nowait);
-    if (self->port) PyMem_Free(self->port);
-    Py_TYPE(self)->tp_free((PyObject*)self);
+static PyObject* SerialManager_recorder_stop(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    Py_BEGIN_ALLOW_THREADS
+    recorder_stop(&self->dev->rec);
+    Py_END_ALLOW_THREADS
+    return recorder_dict(self);
 }
 
+static PyObject* SerialManager_recorder_info(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    return recorder_dict(self);
+}
 
-static int SerialManager_init(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
-    static char* kwlist[] = {"port", "qin", "qout", "baud", NULL};
-    const char* port = NULL;
-    int baud = 115200;
-    PyObject* qin = NULL;
-    PyObject* qout = NULL;
+// ----------------- Sequence capture -----------------
 
-    // Reset members to NULL/initial state
-    self->port = NULL;
-    self->q_in = NULL;
-    self->q_out = NULL;
-    self->q_out_put_nowait = NULL;
-    self->q_in_get = NULL;
-    self->q_in_get_nowait = NULL;
-    self->ring_data = NULL;
-    self->alive = 0;
-    self->py_enabled = 0;
+static PyObject* seqcap_dict(SerialManagerObject* self) {
+    seqcap_stats_t st;
+    seqcap_stats(&self->dev->seqcap, &st);
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+    PyDict_SetItemString(d, "running", st.running ? Py_True : Py_False);
+    PyDict_SetItemString(d, "armed", st.armed ? Py_True : Py_False);
+    dict_set_u64(d, "pre", st.pre);
+    dict_set_u64(d, "post", st.post);
+    dict_set_u64(d, "slots", st.slots);
+    dict_set_u64(d, "start_seq", st.start_seq);
+    dict_set_u64(d, "seq", st.seq);
+    dict_set_u64(d, "segments", st.segments);
+    dict_set_u64(d, "sequences", st.sequences);
+    dict_set_u64(d, "taken", st.taken);
+    dict_set_u64(d, "ready", st.ready);
+    dict_set_u64(d, "fill", st.fill);
+    dict_set_u64(d, "missed", st.missed);
+    dict_set_u64(d, "truncated", st.truncated);
+    dict_set_u64(d, "lost", st.lost);
+    dict_set_u64(d, "min_interval", st.min_interval);
+    dict_set_f64(d, "segments_per_s", st.segments > 1 && st.last_ns > st.first_ns
+                 ? (double)(st.segments - 1) * 1e9 / (double)(st.last_ns - st.first_ns) : 0.0);
+    dict_set_f64(d, "busy_s", (double)st.busy_ns / 1e9);
+    dict_set_u64(d, "bytes", st.bytes);
+    return d;
+}
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "sOO|i", kwlist,
-                                     &port, &qin, &qout, &baud)) {
-        return -1;
+// triggers is a bytes object of packed rec_trigger_t records
+static PyObject* SerialManager_seqcap_start(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"triggers", "pre", "post", "segments", "continuous", NULL};
+    Py_buffer trig;
+    int continuous = 0;
+    seqcap_cfg_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.pre = 125;
+    cfg.post = 1125;
+    cfg.segments = 100;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y*|IIIp", kwlist, &trig, &cfg.pre, &cfg.post, &cfg.segments,
+                                     &continuous)) {
+        return NULL;
     }
+    if (trig.len == 0 || trig.len % (Py_ssize_t)sizeof(rec_trigger_t) != 0
+        || trig.len / (Py_ssize_t)sizeof(rec_trigger_t) > REC_MAX_TRIGGERS) {
+        PyBuffer_Release(&trig);
+        return PyErr_Format(PyExc_ValueError, "triggers must be 1..%d packed records", REC_MAX_TRIGGERS);
+    }
+    cfg.n_trig = (uint32_t)(trig.len / (Py_ssize_t)sizeof(rec_trigger_t));
+    memcpy(cfg.trig, trig.buf, (size_t)trig.len);
+    PyBuffer_Release(&trig);
+    if (continuous) cfg.flags |= SEQCAP_CONTINUOUS;
 
-    if (!PyObject_HasAttrString(qin, "get") || !PyObject_HasAttrString(qout, "put_nowait")) {
-        PyErr_SetString(PyExc_ValueError, "qin/qout must be queue-like objects");
-        return -1;
+    int rv;
+    Py_BEGIN_ALLOW_THREADS
+    rv = seqcap_start(&self->dev->seqcap, &self->dev->sring, &cfg);
+    Py_END_ALLOW_THREADS
+
+    if (rv == -1) {
+        return PyErr_Format(PyExc_ValueError, "sequence capture needs the sample ring, post > 0, 1..%u segments "
+                            "and pre + post <= %llu samples", SEQCAP_MAX_SEGMENTS,
+                            (unsigned long long)(self->dev->sring.capacity / 2));
     }
+    if (rv == -2) return PyErr_NoMemory();
+    if (rv == -3) return PyErr_Format(PyExc_RuntimeError, "no free sample ring consumer");
+    if (rv != 0) return PyErr_Format(PyExc_RuntimeError, "failed to start sequence capture thread");
+    return seqcap_dict(self);
+}
 
-    self->port = PyMem_Malloc(strlen(port) + 1);
-    if (!self->port) return -1;
-    strcpy(self->port, port);
-    self->baud = baud;
+static PyObject* SerialManager_seqcap_stop(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    Py_BEGIN_ALLOW_THREADS
+    seqcap_stop(&self->dev->seqcap);
+    Py_END_ALLOW_THREADS
+    return seqcap_dict(self);
+}
 
-    Py_INCREF(qin);  self->q_in  = qin;
-    Py_INCREF(qout); self->q_out = qout;
+static PyObject* SerialManager_seqcap_info(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    return seqcap_dict(self);
+}
 
-    // Cache bound methods to reduce attribute lookups in delivery/writer threads
-    self->q_out_put_nowait = PyObject_GetAttrString(qout, "put_nowait");
-    self->q_in_get = PyObject_GetAttrString(qin, "get");
-    self->q_in_get_nowait = PyObject_GetAttrString(qin, "get_nowait");
+// Oldest ready sequence as (number, segments, slots, pre, post, bytearray block), None if none
+// within timeout_ms
+static PyObject* SerialManager_seqcap_take(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"timeout_ms", NULL};
+    unsigned int timeout_ms = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|I", kwlist, &timeout_ms)) return NULL;
 
-    if (!self->q_out_put_nowait || !self->q_in_get || !self->q_in_get_nowait) {
-        PyErr_SetString(PyExc_ValueError, "qin/qout must provide get/get_nowait/put_nowait methods");
-        return -1;
+    seqcap_t* s = &self->dev->seqcap;
+    int ready;
+    Py_BEGIN_ALLOW_THREADS
+    ready = seqcap_wait(s, timeout_ms);
+    Py_END_ALLOW_THREADS
+    if (!ready) Py_RETURN_NONE;
+
+    seqcap_stats_t st;
+    seqcap_stats(s, &st);
+    PyObject* buf = PyByteArray_FromStringAndSize(NULL, (Py_ssize_t)st.bytes);
+    if (!buf) return NULL;
+    uint64_t number = 0;
+    uint32_t segments = 0;
+    int rv;
+    Py_BEGIN_ALLOW_THREADS
+    rv = seqcap_take(s, (uint8_t*)PyByteArray_AS_STRING(buf), (size_t)st.bytes, &number, &segments);
+    Py_END_ALLOW_THREADS
+    if (rv != 1) {
+        // restarted with other sizes meanwhile
+        Py_DECREF(buf);
+        Py_RETURN_NONE;
     }
+    return Py_BuildValue("KIIIIN", (unsigned long long)number, segments, st.slots, st.pre, st.post, buf);
+}
 
-    // Initialize Zero-Allocation Ring Buffer
-    self->ring_size = 1024 * 1024; // 1MB buffer
-    self->ring_data = (uint8_t*)malloc(self->ring_size);
-    self->ring_head = 0;
-    self->ring_tail = 0;
-    self->ring_dropped = 0;
-
-    self->perf_rx_bytes = 0;
-    self->perf_rx_frames = 0;
-    self->perf_cobs_decode_errors = 0;
-    self->perf_ring_push_dropped = 0;
-    self->perf_delivered_frames = 0;
-    self->perf_delivered_bytes = 0;
-    self->perf_tx_batches = 0;
-    self->perf_tx_bytes = 0;
-    self->perf_rx_idle_loops = 0;
-    self->perf_cpu_reader_ns = 0;
-    self->perf_cpu_writer_ns = 0;
-    self->perf_cpu_deliver_ns = 0;
-
-    if (!self->ring_data) {
-        PyErr_SetString(PyExc_MemoryError, "ring buffer allocation failed");
-        return -1;
+// ----------------- Mask test -----------------
+
+static const char* mask_state_names[] = {"idle", "armed", "running"};
+
+// trigger: one packed rec_trigger_t (empty: immediate), rules: packed mask_rule_t records
+static PyObject* SerialManager_mask_config(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"trigger", "rules", NULL};
+    Py_buffer trig, rules;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y*y*", kwlist, &trig, &rules)) return NULL;
+
+    rec_trigger_t t;
+    memset(&t, 0, sizeof(t));
+    int ok = (trig.len == 0 || trig.len == (Py_ssize_t)sizeof(t)) && rules.len % (Py_ssize_t)sizeof(mask_rule_t) == 0 &&
+             rules.len / (Py_ssize_t)sizeof(mask_rule_t) <= MASK_MAX_RULES;
+    int rv = -1;
+    if (ok) {
+        if (trig.len) memcpy(&t, trig.buf, sizeof(t));
+        rv = mask_config(&self->dev->mask, &t, (const mask_rule_t*)rules.buf,
+                         (uint32_t)(rules.len / (Py_ssize_t)sizeof(mask_rule_t)));
     }
-
-#ifdef _WIN32
-    self->h_read_thread = NULL;
-    self->h_write_thread = NULL;
-    self->h_deliver_thread = NULL;
-    self->h_port = NULL;
-    InitializeCriticalSection(&self->ring_cs);
-    self->h_ring_event = CreateEvent(NULL, FALSE, FALSE, NULL);
-    if (!self->h_ring_event) {
-        PyErr_SetString(PyExc_RuntimeError, "CreateEvent failed");
-        return -1;
+    PyBuffer_Release(&trig);
+    PyBuffer_Release(&rules);
+    if (rv == -2) return PyErr_NoMemory();
+    if (rv != 0) {
+        return PyErr_Format(PyExc_ValueError, "mask needs one trigger record and 0..%d rules with start < end, "
+                            "pre-trigger windows up to %d samples", MASK_MAX_RULES, 1 << MASK_PRE_MAX_LOG2);
     }
-#else
-    self->fd = -1;
-    self->read_thread = (pthread_t)0;
-    self->write_thread = (pthread_t)0;
-    self->deliver_thread = (pthread_t)0;
-    pthread_mutex_init(&self->ring_mx, NULL);
-    pthread_cond_init(&self->ring_cond, NULL);
-#endif
+    Py_RETURN_NONE;
+}
 
-    return 0;
+static PyObject* SerialManager_mask_arm(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"repeat", NULL};
+    int repeat = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|p", kwlist, &repeat)) return NULL;
+    if (mask_arm(&self->dev->mask, repeat) != 0) return PyErr_Format(PyExc_RuntimeError, "no mask rules configured");
+    Py_RETURN_NONE;
 }
 
-static PyObject* SerialManager_get_perf_stats(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
-    PyObject* d = PyDict_New();
-    if (!d) return NULL;
+static PyObject* SerialManager_mask_disarm(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    mask_disarm(&self->dev->mask);
+    Py_RETURN_NONE;
+}
 
-    PyDict_SetItemString(d, "rx_bytes", PyLong_FromUnsignedLongLong((unsigned long long)self->perf_rx_bytes));
-    PyDict_SetItemString(d, "rx_frames", PyLong_FromUnsignedLongLong((unsigned long long)self->perf_rx_frames));
-    PyDict_SetItemString(d, "cobs_decode_errors", PyLong_FromUnsignedLongLong((unsigned long long)self->perf_cobs_decode_errors));
-    PyDict_SetItemString(d, "ring_push_dropped", PyLong_FromUnsignedLongLong((unsigned long long)self->perf_ring_push_dropped));
-    PyDict_SetItemString(d, "ring_dropped", PyLong_FromUnsignedLongLong((unsigned long long)self->ring_dropped));
-    PyDict_SetItemString(d, "delivered_frames", PyLong_FromUnsignedLongLong((unsigned long long)self->perf_delivered_frames));
-    PyDict_SetItemString(d, "delivered_bytes", PyLong_FromUnsignedLongLong((unsigned long long)self->perf_delivered_bytes));
-    PyDict_SetItemString(d, "tx_batches", PyLong_FromUnsignedLongLong((unsigned long long)self->perf_tx_batches));
-    PyDict_SetItemString(d, "tx_bytes", PyLong_FromUnsignedLongLong((unsigned long long)self->perf_tx_bytes));
-    PyDict_SetItemString(d, "rx_idle_loops", PyLong_FromUnsignedLongLong((unsigned long long)self->perf_rx_idle_loops));
-    PyDict_SetItemString(d, "cpu_reader_ns", PyLong_FromUnsignedLongLong((unsigned long long)self->perf_cpu_reader_ns));
-    PyDict_SetItemString(d, "cpu_writer_ns", PyLong_FromUnsignedLongLong((unsigned long long)self->perf_cpu_writer_ns));
-    PyDict_SetItemString(d, "cpu_deliver_ns", PyLong_FromUnsignedLongLong((unsigned long long)self->perf_cpu_deliver_ns));
-
-
-    self->perf_rx_bytes = 0;
-    self->perf_rx_frames = 0;
-    self->perf_cobs_decode_errors = 0;
-    self->perf_ring_push_dropped = 0;
-    self->ring_dropped = 0;
-    self->perf_delivered_frames = 0;
-    self->perf_delivered_bytes = 0;
-    self->perf_tx_batches = 0;
-    self->perf_tx_bytes = 0;
-    self->perf_rx_idle_loops = 0;
-    self->perf_cpu_reader_ns = 0;
-    self->perf_cpu_writer_ns = 0;
-    self->perf_cpu_deliver_ns = 0;
+// Wait (GIL released) until more than `after` tests are decided; returns tests decided
+static PyObject* SerialManager_mask_wait(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"after", "timeout", NULL};
+    unsigned long long after = 0;
+    double timeout = 1.0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|Kd", kwlist, &after, &timeout)) return NULL;
+    if (timeout < 0.0) timeout = 0.0;
+    uint64_t tests;
+    Py_BEGIN_ALLOW_THREADS
+    tests = mask_wait(&self->dev->mask, (uint64_t)after, (unsigned)(timeout * 1000.0));
+    Py_END_ALLOW_THREADS
+    return PyLong_FromUnsignedLongLong((unsigned long long)tests);
+}
 
+static PyObject* SerialManager_mask_status(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    mask_status_t st;
+    mask_status(&self->dev->mask, &st);
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+    dict_set_obj(d, "state", PyUnicode_FromString(mask_state_names[st.state]));
+    PyDict_SetItemString(d, "repeat", st.repeat ? Py_True : Py_False);
+    dict_set_u64(d, "tests", st.tests);
+    dict_set_u64(d, "passed", st.passed);
+    dict_set_u64(d, "failed", st.failed);
+    dict_set_u64(d, "trigger", st.trigger);
+    dict_set_obj(d, "offset", PyLong_FromLongLong((long long)st.offset));
+    PyObject* rl = PyList_New((Py_ssize_t)st.n_rules);
+    if (rl) {
+        for (uint32_t r = 0; r < st.n_rules; r++) {
+            const mask_acc_t* a = &st.acc[r];
+            PyObject* o = Py_BuildValue("{s:K,s:d,s:d,s:d,s:d}", "n", (unsigned long long)a->n,
+                                        "mean", a->n ? a->sum / (double)a->n : NAN,
+                                        "peak", a->n ? (double)a->peak : NAN, "min", a->n ? (double)a->min : NAN,
+                                        "charge_uc", a->sum * 1000.0 / ADC_SAMPLE_RATE_HZ);
+            if (!o) {
+                Py_CLEAR(rl);
+                break;
+            }
+            PyList_SET_ITEM(rl, r, o);
+        }
+    }
+    dict_set_obj(d, "rules", rl);
     return d;
 }
 
-static PyObject* SerialManager_start(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
-#ifdef _WIN32
-    if (self->h_port && self->h_port != INVALID_HANDLE_VALUE) Py_RETURN_NONE;
-    HANDLE h = open_serial_win(self->port, self->baud);
-    if (h == INVALID_HANDLE_VALUE) {
-        return PyErr_Format(PyExc_OSError, "failed to open serial '%s'", self->port);
+// (next, bytes of mask_verdict_t) for verdicts numbered >= since
+static PyObject* SerialManager_mask_verdicts(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"since", "max", NULL};
+    unsigned long long since = 0;
+    Py_ssize_t max = 1 << MASK_VERDICTS_LOG2;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|Kn", kwlist, &since, &max)) return NULL;
+    if (max <= 0) return PyErr_Format(PyExc_ValueError, "max must be > 0");
+
+    PyObject* b = PyBytes_FromStringAndSize(NULL, max * (Py_ssize_t)sizeof(mask_verdict_t));
+    if (!b) return NULL;
+    uint64_t next;
+    size_t n = mask_verdicts(&self->dev->mask, since, (mask_verdict_t*)PyBytes_AS_STRING(b), (size_t)max, &next);
+    if (_PyBytes_Resize(&b, (Py_ssize_t)(n * sizeof(mask_verdict_t))) != 0) return NULL;
+    PyObject* r = Py_BuildValue("(KO)", (unsigned long long)next, b);
+    Py_DECREF(b);
+    return r;
+}
+
+// ----------------- Closed-loop control -----------------
+
+// rules: packed ctl_rule_t records, payloads: one command payload (CBOR) per rule, framed
+// here for `port` so the reader thread writes them as they are
+static PyObject* SerialManager_control_config(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"rules", "payloads", "port", NULL};
+    Py_buffer rules;
+    PyObject* payloads;
+    unsigned int port = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y*O|I", kwlist, &rules, &payloads, &port)) return NULL;
+
+    Py_ssize_t n = rules.len / (Py_ssize_t)sizeof(ctl_rule_t);
+    PyObject* seq = PySequence_Fast(payloads, "payloads must be a sequence of bytes");
+    if (!seq) {
+        PyBuffer_Release(&rules);
+        return NULL;
     }
-    self->h_port = h;
-#else
-    if (self->fd >= 0) Py_RETURN_NONE;
-    int fd = open_serial_posix(self->port, self->baud);
-    if (fd < 0) {
-        return PyErr_Format(PyExc_OSError, "failed to open serial '%s'", self->port);
+    int rv = -1;
+    ctl_action_t* actions = NULL;
+    if (rules.len % (Py_ssize_t)sizeof(ctl_rule_t) == 0 && n <= CTL_MAX_RULES && PySequence_Fast_GET_SIZE(seq) == n) {
+        actions = (ctl_action_t*)calloc((size_t)(n ? n : 1), sizeof(ctl_action_t));
+        if (!actions) rv = -2;
+        Py_ssize_t r = 0;
+        for (; actions && r < n; r++) {
+            char* p;
+            Py_ssize_t len;
+            if (PyBytes_AsStringAndSize(PySequence_Fast_GET_ITEM(seq, r), &p, &len) != 0) {
+                rv = -3;
+                break;
+            }
+            int m = p1150_frame(port, p, (size_t)len, actions[r].b, sizeof(actions[r].b));
+            if (m <= 0) break;
+            actions[r].n = (uint16_t)m;
+        }
+        if (actions && r == n) rv = ctl_config(&self->dev->ctl, (const ctl_rule_t*)rules.buf, actions, (uint32_t)n);
     }
-    self->fd = fd;
-#endif
-
-    self->py_enabled = 1; // allow worker threads to use Python C-API
-    self->alive = 1;
+    free(actions);
+    Py_DECREF(seq);
+    PyBuffer_Release(&rules);
+    if (rv == -3) return NULL;
+    if (rv == -2) return PyErr_NoMemory();
+    if (rv != 0) {
+        return PyErr_Format(PyExc_ValueError, "control needs 0..%d rules with one payload each, "
+                            "framed payloads up to %d bytes", CTL_MAX_RULES, CTL_ACTION_MAX);
+    }
+    Py_RETURN_NONE;
+}
 
-#ifdef _WIN32
-    self->h_read_thread  = CreateThread(NULL, 0, reader_thread_win, self, 0, NULL);
-    self->h_write_thread = CreateThread(NULL, 0, writer_thread_win, self, 0, NULL);
-    self->h_deliver_thread = CreateThread(NULL, 0, deliver_thread_win, self, 0, NULL);
-#else
-    pthread_create(&self->read_thread,  NULL, reader_thread_posix, self);
-    pthread_create(&self->write_thread, NULL, writer_thread_posix, self);
-    pthread_create(&self->deliver_thread, NULL, deliver_thread_posix, self);
-#endif
+static PyObject* SerialManager_control_arm(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    if (ctl_arm(&self->dev->ctl) != 0) return PyErr_Format(PyExc_RuntimeError, "no control rules configured");
+    Py_RETURN_NONE;
+}
 
+static PyObject* SerialManager_control_disarm(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    ctl_disarm(&self->dev->ctl);
     Py_RETURN_NONE;
 }
 
+// Wait (GIL released) until more than `after` rules fired; returns firings
+static PyObject* SerialManager_control_wait(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"after", "timeout", NULL};
+    unsigned long long after = 0;
+    double timeout = 1.0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|Kd", kwlist, &after, &timeout)) return NULL;
+    if (timeout < 0.0) timeout = 0.0;
+    uint64_t fired;
+    Py_BEGIN_ALLOW_THREADS
+    fired = ctl_wait(&self->dev->ctl, (uint64_t)after, (unsigned)(timeout * 1000.0));
+    Py_END_ALLOW_THREADS
+    return PyLong_FromUnsignedLongLong((unsigned long long)fired);
+}
 
-static PyObject* SerialManager_is_running(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
-#ifdef _WIN32
-    if (self->alive && self->py_enabled && self->h_port && self->h_port != INVALID_HANDLE_VALUE) Py_RETURN_TRUE;
-#else
-    if (self->alive && self->py_enabled && self->fd >= 0) Py_RETURN_TRUE;
-#endif
-    Py_RETURN_FALSE;
+static PyObject* SerialManager_control_status(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    ctl_status_t st;
+    ctl_status(&self->dev->ctl, &st);
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+    uint64_t written = st.fired - st.failed;
+    PyDict_SetItemString(d, "armed", st.armed ? Py_True : Py_False);
+    dict_set_u64(d, "fired", st.fired);
+    dict_set_u64(d, "failed", st.failed);
+    dict_set_u64(d, "blocked", st.blocked);
+    dict_set_f64(d, "wait_max_us", (double)st.wait_max_ns / 1000.0);
+    dict_set_f64(d, "latency_min_us", written ? (double)st.lat_min_ns / 1000.0 : NAN);
+    dict_set_f64(d, "latency_mean_us", written ? st.lat_sum_ns / (double)written / 1000.0 : NAN);
+    dict_set_f64(d, "latency_max_us", written ? (double)st.lat_max_ns / 1000.0 : NAN);
+    PyObject* rl = PyList_New((Py_ssize_t)st.n_rules);
+    if (rl) {
+        for (uint32_t r = 0; r < st.n_rules; r++) {
+            PyObject* o = Py_BuildValue("{s:K,s:O}", "fired", (unsigned long long)st.rule_fired[r],
+                                        "enabled", st.rule_enabled[r] ? Py_True : Py_False);
+            if (!o) {
+                Py_CLEAR(rl);
+                break;
+            }
+            PyList_SET_ITEM(rl, r, o);
+        }
+    }
+    dict_set_obj(d, "rules", rl);
+    return d;
 }
 
+// (next, bytes of ctl_event_t) for firings numbered >= since
+static PyObject* SerialManager_control_events(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"since", "max", NULL};
+    unsigned long long since = 0;
+    Py_ssize_t max = 1 << CTL_EVENTS_LOG2;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|Kn", kwlist, &since, &max)) return NULL;
+    if (max <= 0) return PyErr_Format(PyExc_ValueError, "max must be > 0");
+
+    PyObject* b = PyBytes_FromStringAndSize(NULL, max * (Py_ssize_t)sizeof(ctl_event_t));
+    if (!b) return NULL;
+    uint64_t next;
+    size_t n = ctl_events(&self->dev->ctl, since, (ctl_event_t*)PyBytes_AS_STRING(b), (size_t)max, &next);
+    if (_PyBytes_Resize(&b, (Py_ssize_t)(n * sizeof(ctl_event_t))) != 0) return NULL;
+    PyObject* r = Py_BuildValue("(KO)", (unsigned long long)next, b);
+    Py_DECREF(b);
+    return r;
+}
 
-static PyObject* SerialManager_shutdown(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
-    self->py_enabled = 0;
-    self->alive = 0;
+// ----------------- VOUT sweep -----------------
 
-    ring_signal(self); // Ensure delivery thread wakes up to exit
+static const char* sweep_state_names[] = {"idle", "send", "ack", "settle", "window", "done", "aborted"};
 
-#ifdef _WIN32
-    if (self->h_port && self->h_port != INVALID_HANDLE_VALUE) {
-        SetCommMask(self->h_port, 0);
-        cancel_all_io_win(self->h_port);
-        EscapeCommFunction(self->h_port, CLRDTR);
-        EscapeCommFunction(self->h_port, CLRRTS);
+static PyObject* sweep_dict(SerialManagerObject* self) {
+    sweep_status_t st;
+    sweep_status(&self->dev->sweep, &st);
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+    dict_set_obj(d, "state", PyUnicode_FromString(sweep_state_names[st.state]));
+    dict_set_u64(d, "steps", st.n_steps);
+    dict_set_u64(d, "done", st.done);
+    dict_set_u64(d, "noack", st.noack);
+    uint64_t end = st.end_ns ? st.end_ns : (st.start_ns ? mp_now_ns() : 0);
+    dict_set_f64(d, "elapsed_s", st.start_ns ? (double)(end - st.start_ns) / 1e9 : 0.0);
+    return d;
+}
+
+// payloads: one CBOR command per step (framed here for port), mv: the step values
+static PyObject* SerialManager_sweep_start(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"payloads", "mv", "settle", "window", "ack_timeout", "ack", "port", NULL};
+    PyObject* payloads;
+    PyObject* mv_obj;
+    const char* ack = "cmd_vout";
+    unsigned int port = 0;
+    sweep_cfg_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.window = 2500;
+    cfg.ack_timeout = 62500;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO|IIIsI", kwlist, &payloads, &mv_obj, &cfg.settle, &cfg.window,
+                                     &cfg.ack_timeout, &ack, &port)) {
+        return NULL;
+    }
+    PyObject* seq = PySequence_Fast(payloads, "payloads must be a sequence of bytes");
+    if (!seq) return NULL;
+    PyObject* mvs = PySequence_Fast(mv_obj, "mv must be a sequence of int");
+    if (!mvs) {
+        Py_DECREF(seq);
+        return NULL;
+    }
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    int rv = -1;
+    uint8_t* framed = NULL;
+    const uint8_t** cmd = NULL;
+    size_t* len = NULL;
+    uint32_t* mv = NULL;
+    if (n > 0 && (uint64_t)n <= SWEEP_MAX_STEPS && PySequence_Fast_GET_SIZE(mvs) == n) {
+        framed = (uint8_t*)malloc((size_t)n * CTL_ACTION_MAX);
+        cmd = (const uint8_t**)malloc((size_t)n * sizeof(*cmd));
+        len = (size_t*)malloc((size_t)n * sizeof(*len));
+        mv = (uint32_t*)malloc((size_t)n * sizeof(*mv));
+        rv = framed && cmd && len && mv ? 0 : -2;
+        for (Py_ssize_t k = 0; rv == 0 && k < n; k++) {
+            char* p;
+            Py_ssize_t pl;
+            if (PyBytes_AsStringAndSize(PySequence_Fast_GET_ITEM(seq, k), &p, &pl) != 0) {
+                rv = -3;
+                break;
+            }
+            unsigned long v = PyLong_AsUnsignedLong(PySequence_Fast_GET_ITEM(mvs, k));
+            if (PyErr_Occurred()) {
+                rv = -3;
+                break;
+            }
+            uint8_t* out = framed + (size_t)k * CTL_ACTION_MAX;
+            int m = p1150_frame(port, p, (size_t)pl, out, CTL_ACTION_MAX);
+            if (m <= 0) {
+                rv = -1;
+                break;
+            }
+            cmd[k] = out;
+            len[k] = (size_t)m;
+            mv[k] = (uint32_t)v;
+        }
+        if (rv == 0) rv = sweep_start(&self->dev->sweep, &cfg, cmd, len, mv, (uint32_t)n, ack);
+    }
+    free(framed);
+    free(cmd);
+    free(len);
+    free(mv);
+    Py_DECREF(mvs);
+    Py_DECREF(seq);
+    if (rv == -3) return NULL;
+    if (rv == -2) return PyErr_NoMemory();
+    if (rv != 0) {
+        return PyErr_Format(PyExc_ValueError, "sweep needs 1..%u steps with one payload and value each, framed "
+                            "payloads up to %d bytes, window > 0 and ack_timeout > 0", SWEEP_MAX_STEPS, CTL_ACTION_MAX);
     }
+    return sweep_dict(self);
+}
+
+static PyObject* SerialManager_sweep_abort(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    sweep_abort(&self->dev->sweep);
+    return sweep_dict(self);
+}
+
+static PyObject* SerialManager_sweep_status(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    return sweep_dict(self);
+}
 
+// Wait (GIL released) until the sweep is over; True when over, False on timeout
+static PyObject* SerialManager_sweep_wait(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"timeout", NULL};
+    double timeout = 1.0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|d", kwlist, &timeout)) return NULL;
+    if (timeout < 0.0) timeout = 0.0;
+    int over;
     Py_BEGIN_ALLOW_THREADS
-    wait_and_close_thread(&self->h_read_thread);
-    wait_and_close_thread(&self->h_write_thread);
-    wait_and_close_thread(&self->h_deliver_thread);
+    over = sweep_wait(&self->dev->sweep, (unsigned)(timeout * 1000.0));
     Py_END_ALLOW_THREADS
+    return PyBool_FromLong(over);
+}
 
-    if (self->h_port && self->h_port != INVALID_HANDLE_VALUE) {
-        CloseHandle(self->h_port);
-        self->h_port = NULL;
-    }
+// Completed steps numbered since and later as packed sweep_step_t records
+static PyObject* SerialManager_sweep_results(SerialManagerObject* self, PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"since", NULL};
+    unsigned int since = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|I", kwlist, &since)) return NULL;
+    sweep_status_t st;
+    sweep_status(&self->dev->sweep, &st);
+    size_t cap = st.done > since ? st.done - since : 0;
+    PyObject* b = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)(cap * sizeof(sweep_step_t)));
+    if (!b) return NULL;
+    size_t n = cap ? sweep_results(&self->dev->sweep, since, (sweep_step_t*)PyBytes_AS_STRING(b), cap) : 0;
+    if (n < cap && _PyBytes_Resize(&b, (Py_ssize_t)(n * sizeof(sweep_step_t))) != 0) return NULL;
+    return b;
+}
 
-    if (self->h_ring_event) { SetEvent(self->h_ring_event); }
+// ----------------- Sample clock -----------------
 
-#else
-    Py_BEGIN_ALLOW_THREADS
-    if (self->read_thread)    { pthread_join(self->read_thread,    NULL); self->read_thread = (pthread_t)0; }
-    if (self->write_thread)   { pthread_join(self->write_thread,   NULL); self->write_thread = (pthread_t)0; }
-    if (self->deliver_thread) { pthread_join(self->deliver_thread, NULL); self->deliver_thread = (pthread_t)0; }
-    Py_END_ALLOW_THREADS
+static PyObject* SerialManager_sample_clock(SerialManagerObject* self, PyObject* Py_UNUSED(ignored)) {
+    sc_info_t st;
+    sclock_info(&self->dev->sclock, &st);
+    PyObject* d = PyDict_New();
+    if (!d) return NULL;
+    dict_set_u64(d, "sample_rate", self->dev->sclock.rate);
+    dict_set_u64(d, "frames", st.frames);
+    dict_set_u64(d, "c", st.c);
+    dict_set_u64(d, "abs", st.abs);
+    dict_set_u64(d, "n", st.n);
+    dict_set_u64(d, "epoch", st.epoch);
+    dict_set_u64(d, "wraps", st.wraps);
+    dict_set_u64(d, "lost_frames", st.lost_frames);
+    dict_set_u64(d, "lost_samples", st.lost_samples);
+    dict_set_u64(d, "origin_mono_ns", st.origin_mono_ns);
+    dict_set_u64(d, "origin_unix_ns", st.origin_unix_ns);
+    PyDict_SetItemString(d, "valid", st.valid ? Py_True : Py_False);
+    dict_set_u64(d, "points", st.points);
+    dict_set_f64(d, "offset_s", st.offset_s);
+    dict_set_f64(d, "drift", st.drift);
+    dict_set_f64(d, "jitter_s", st.jitter_s);
+    dict_set_f64(d, "latency_s", st.latency_s);
+    return d;
+}
 
-    if (self->fd >= 0) {
-        close_serial_posix(self->fd);
-        self->fd = -1;
-    }
-#endif
-    // Note: ring_data is freed in dealloc, not here, to allow multiple start/stops if needed.
-    Py_RETURN_NONE;
+// (abs_start, n) of the frame with counter c, counted from the last frame; None before any
+static PyObject* SerialManager_sample_clock_frame(SerialManagerObject* self, PyObject* arg) {
+    unsigned long long c = PyLong_AsUnsignedLongLong(arg);
+    if (c == (unsigned long long)-1 && PyErr_Occurred()) return NULL;
+    uint64_t abs;
+    uint32_t n;
+    if (!sclock_frame(&self->dev->sclock, (uint64_t)c, &abs, &n)) Py_RETURN_NONE;
+    return Py_BuildValue("(KI)", (unsigned long long)abs, (unsigned int)n);
+}
+
+static PyObject* SerialManager_stream_to_abs(SerialManagerObject* self, PyObject* arg) {
+    unsigned long long idx = PyLong_AsUnsignedLongLong(arg);
+    if (idx == (unsigned long long)-1 && PyErr_Occurred()) return NULL;
+    return PyLong_FromUnsignedLongLong((unsigned long long)sclock_stream_to_abs(&self->dev->sclock, (uint64_t)idx));
 }
 
 // ----------------- Type and module boilerplate -----------------
@@ -1308,6 +2386,72 @@ static PyMethodDef SerialManager_methods[] = {
     {"is_running", (PyCFunction)SerialManager_is_running, METH_NOARGS, "Return whether the I/O threads are running"},
     {"shutdown", (PyCFunction)SerialManager_shutdown, METH_NOARGS, "Stop threads and close the serial port"},
     {"get_perf_stats", (PyCFunction)SerialManager_get_perf_stats, METH_NOARGS, "Get performance counters"},
+    {"start_metrics", (PyCFunction)SerialManager_start_metrics, METH_VARARGS | METH_KEYWORDS, "Publish stats page (shared memory) and optional Prometheus exporter"},
+    {"stop_metrics", (PyCFunction)SerialManager_stop_metrics, METH_NOARGS, "Stop metrics thread and remove stats page"},
+    {"stats_set", (PyCFunction)SerialManager_stats_set, METH_VARARGS | METH_KEYWORDS, "Set a pipeline stat published with the native counters"},
+    {"decode_stats", (PyCFunction)SerialManager_decode_stats, METH_NOARGS, "Decode worker pool counters, None when off"},
+    {"memory", (PyCFunction)SerialManager_memory, METH_NOARGS, "Bytes held per subsystem"},
+    {"link_state", (PyCFunction)SerialManager_link_state, METH_NOARGS, "Port connection state and reconnect latency"},
+    {"set_link_callback", (PyCFunction)SerialManager_set_link_callback, METH_O, "Callback on disconnect/reconnect"},
+    {"get_metrics_text", (PyCFunction)SerialManager_get_metrics_text, METH_NOARGS, "Prometheus text of the stats page"},
+    {"pipeline_pressure", (PyCFunction)SerialManager_pipeline_pressure, METH_VARARGS | METH_KEYWORDS, "Backlog telemetry and pressure, optional history"},
+    {"pressure_config", (PyCFunction)SerialManager_pressure_config, METH_VARARGS | METH_KEYWORDS, "Get/set pressure limits and warning levels"},
+    {"set_pressure_callback", (PyCFunction)SerialManager_set_pressure_callback, METH_O, "Callback when the pressure warning sets/clears"},
+    {"consumed", (PyCFunction)SerialManager_consumed, METH_O, "Acknowledge frames taken from qout"},
+    {"ring_column", (PyCFunction)SerialManager_ring_column, METH_O, "Zero-copy buffer over a sample ring column"},
+    {"ring_attach", (PyCFunction)SerialManager_ring_attach, METH_VARARGS | METH_KEYWORDS, "Add a sample ring consumer, returns its id"},
+    {"ring_detach", (PyCFunction)SerialManager_ring_detach, METH_O, "Remove a sample ring consumer"},
+    {"ring_poll", (PyCFunction)SerialManager_ring_poll, METH_O, "(start_seq, n) readable by a consumer"},
+    {"ring_wait", (PyCFunction)SerialManager_ring_wait, METH_VARARGS | METH_KEYWORDS, "Wait (GIL released) until a consumer has samples"},
+    {"ring_commit", (PyCFunction)SerialManager_ring_commit, METH_VARARGS, "Advance a consumer, returns samples overwritten while read"},
+    {"ring_info", (PyCFunction)SerialManager_ring_info, METH_NOARGS, "Sample ring head, drops and per consumer lag"},
+    {"digital_edges", (PyCFunction)SerialManager_digital_edges, METH_VARARGS | METH_KEYWORDS, "D0/D1 edges in a sample range, packed uint64"},
+    {"digital_state_at", (PyCFunction)SerialManager_digital_state_at, METH_VARARGS, "D0/D1 state at a sample index"},
+    {"digital_find_edge", (PyCFunction)SerialManager_digital_find_edge, METH_VARARGS | METH_KEYWORDS, "First D0/D1 edge at/after a sample index"},
+    {"digital_bits", (PyCFunction)SerialManager_digital_bits, METH_VARARGS, "D0/D1 packed bits of a sample range"},
+    {"digital_info", (PyCFunction)SerialManager_digital_info, METH_NOARGS, "D0/D1 storage state"},
+    {"gated_config", (PyCFunction)SerialManager_gated_config, METH_VARARGS | METH_KEYWORDS, "Set D0/D1 gate line, level, source; clears results"},
+    {"gated_stats", (PyCFunction)SerialManager_gated_stats, METH_VARARGS | METH_KEYWORDS, "Current statistics per D0/D1 state and open pulse"},
+    {"gated_pulses", (PyCFunction)SerialManager_gated_pulses, METH_VARARGS | METH_KEYWORDS, "Completed pulses since a pulse number, packed records"},
+    {"current_hist", (PyCFunction)SerialManager_current_hist, METH_VARARGS | METH_KEYWORDS, "Log-binned i/isnk distribution, total or windowed"},
+    {"current_hist_reset", (PyCFunction)SerialManager_current_hist_reset, METH_VARARGS | METH_KEYWORDS, "Clear the current histograms"},
+    {"history_config", (PyCFunction)SerialManager_history_config, METH_VARARGS | METH_KEYWORDS, "Set the decimated history levels, clears them"},
+    {"history_info", (PyCFunction)SerialManager_history_info, METH_NOARGS, "History levels and counters"},
+    {"history_read", (PyCFunction)SerialManager_history_read, METH_VARARGS | METH_KEYWORDS, "Blocks of a history level, packed records"},
+    {"plot_config", (PyCFunction)SerialManager_plot_config, METH_VARARGS | METH_KEYWORDS, "Decode the debug plotter stream into channel rings"},
+    {"plot_info", (PyCFunction)SerialManager_plot_info, METH_NOARGS, "Plotter channels and counters"},
+    {"plot_read", (PyCFunction)SerialManager_plot_read, METH_VARARGS | METH_KEYWORDS, "Points of a plotter channel, packed records"},
+    {"plot_lod", (PyCFunction)SerialManager_plot_lod, METH_VARARGS | METH_KEYWORDS, "Plotter channel min/max/mean buckets over a stream range"},
+    {"segment_config", (PyCFunction)SerialManager_segment_config, METH_VARARGS | METH_KEYWORDS, "Set changepoint parameters, restarts segmentation"},
+    {"segments", (PyCFunction)SerialManager_segments, METH_VARARGS | METH_KEYWORDS, "Closed segments since a segment number, packed records"},
+    {"segment_info", (PyCFunction)SerialManager_segment_info, METH_NOARGS, "Segment count and the open segment"},
+    {"recorder_start", (PyCFunction)SerialManager_recorder_start, METH_VARARGS | METH_KEYWORDS, "Start event-triggered recording to a file"},
+    {"recorder_stop", (PyCFunction)SerialManager_recorder_stop, METH_NOARGS, "Stop recording, returns final stats"},
+    {"recorder_info", (PyCFunction)SerialManager_recorder_info, METH_NOARGS, "Recorder state and counters"},
+    {"seqcap_start", (PyCFunction)SerialManager_seqcap_start, METH_VARARGS | METH_KEYWORDS, "Start segmented memory capture"},
+    {"seqcap_stop", (PyCFunction)SerialManager_seqcap_stop, METH_NOARGS, "Stop sequence capture, returns final stats"},
+    {"seqcap_info", (PyCFunction)SerialManager_seqcap_info, METH_NOARGS, "Sequence capture state and counters"},
+    {"seqcap_take", (PyCFunction)SerialManager_seqcap_take, METH_VARARGS | METH_KEYWORDS, "Take the oldest ready sequence"},
+    {"mask_config", (PyCFunction)SerialManager_mask_config, METH_VARARGS | METH_KEYWORDS, "Set mask test trigger and rules, disarms"},
+    {"mask_arm", (PyCFunction)SerialManager_mask_arm, METH_VARARGS | METH_KEYWORDS, "Arm the mask test, optionally re-arming after each verdict"},
+    {"mask_disarm", (PyCFunction)SerialManager_mask_disarm, METH_NOARGS, "Stop the mask test"},
+    {"mask_wait", (PyCFunction)SerialManager_mask_wait, METH_VARARGS | METH_KEYWORDS, "Wait (GIL released) for a mask verdict"},
+    {"mask_status", (PyCFunction)SerialManager_mask_status, METH_NOARGS, "Mask test state, tallies and running rule values"},
+    {"mask_verdicts", (PyCFunction)SerialManager_mask_verdicts, METH_VARARGS | METH_KEYWORDS, "Verdicts since a test number, packed records"},
+    {"control_config", (PyCFunction)SerialManager_control_config, METH_VARARGS | METH_KEYWORDS, "Set control rules and their command payloads, disarms"},
+    {"control_arm", (PyCFunction)SerialManager_control_arm, METH_NOARGS, "Start evaluating the control rules"},
+    {"control_disarm", (PyCFunction)SerialManager_control_disarm, METH_NOARGS, "Stop evaluating the control rules"},
+    {"control_wait", (PyCFunction)SerialManager_control_wait, METH_VARARGS | METH_KEYWORDS, "Wait (GIL released) for a control rule to fire"},
+    {"control_status", (PyCFunction)SerialManager_control_status, METH_NOARGS, "Control state, firings and reaction latency"},
+    {"control_events", (PyCFunction)SerialManager_control_events, METH_VARARGS | METH_KEYWORDS, "Firings since a number, packed records"},
+    {"sweep_start", (PyCFunction)SerialManager_sweep_start, METH_VARARGS | METH_KEYWORDS, "Start a native VOUT sweep over framed command payloads"},
+    {"sweep_abort", (PyCFunction)SerialManager_sweep_abort, METH_NOARGS, "Abort the running sweep"},
+    {"sweep_status", (PyCFunction)SerialManager_sweep_status, METH_NOARGS, "Sweep state and progress"},
+    {"sweep_wait", (PyCFunction)SerialManager_sweep_wait, METH_VARARGS | METH_KEYWORDS, "Wait (GIL released) for the sweep to end"},
+    {"sweep_results", (PyCFunction)SerialManager_sweep_results, METH_VARARGS | METH_KEYWORDS, "Completed sweep steps as packed records"},
+    {"sample_clock", (PyCFunction)SerialManager_sample_clock, METH_NOARGS, "Frame counter unwrap state and host clock fit"},
+    {"sample_clock_frame", (PyCFunction)SerialManager_sample_clock_frame, METH_O, "(abs_start, n) of a recent frame by counter"},
+    {"stream_to_abs", (PyCFunction)SerialManager_stream_to_abs, METH_O, "Absolute sample index of a stream sample index"},
     {NULL, NULL, 0, NULL}
 };
 
@@ -1329,7 +2473,183 @@ static PyTypeObject SerialManagerType = {
     .tp_new = PyType_GenericNew,
 };
 
+// ----------------- Derived channels -----------------
+
+// float64 C-contiguous buffer of at least n items; o None leaves b->buf NULL
+static int derive_buf(PyObject* o, Py_buffer* b, int writable, Py_ssize_t n, const char* name) {
+    memset(b, 0, sizeof(*b));
+    if (o == NULL || o == Py_None) return 0;
+    if (PyObject_GetBuffer(o, b, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | (writable ? PyBUF_WRITABLE : 0)) != 0) {
+        b->buf = NULL;
+        return -1;
+    }
+    if (b->itemsize != 8 || !b->format || strcmp(b->format, "d") != 0 || (n >= 0 && b->len / 8 < n)) {
+        if (n < 0) PyErr_Format(PyExc_ValueError, "%s must be a contiguous float64 array", name);
+        else PyErr_Format(PyExc_ValueError, "%s must be a contiguous float64 array of >= %zd items", name, n);
+        PyBuffer_Release(b);
+        b->buf = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// derive(i, isnk=None, a0=None, *, power=None, energy=None, net=None, a0s=None, vout_v=0,
+//        dt=8e-6, energy0=0, a0_gain=1, a0_offset=0) -> energy after the last sample
+static PyObject* mp_derive(PyObject* Py_UNUSED(mod), PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"i", "isnk", "a0", "power", "energy", "net", "a0s",
+                             "vout_v", "dt", "energy0", "a0_gain", "a0_offset", NULL};
+    PyObject *o_i, *o_isnk = NULL, *o_a0 = NULL, *o_pw = NULL, *o_en = NULL, *o_nt = NULL, *o_as = NULL;
+    derived_cfg_t cfg = { 0.0, 1.0 / ADC_SAMPLE_RATE_HZ, 0.0, 1.0, 0.0 };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|OO$OOOOddddd", kwlist, &o_i, &o_isnk, &o_a0,
+                                     &o_pw, &o_en, &o_nt, &o_as, &cfg.vout_v, &cfg.dt_s,
+                                     &cfg.energy0_mj, &cfg.a0_gain, &cfg.a0_offset)) {
+        return NULL;
+    }
+
+    enum { B_I, B_ISNK, B_A0, B_PW, B_EN, B_NT, B_AS, B_N };
+    Py_buffer b[B_N];
+    memset(b, 0, sizeof(b));
+    PyObject* res = NULL;
+    if (derive_buf(o_i, &b[B_I], 0, -1, "i") != 0) return NULL;
+    Py_ssize_t n = b[B_I].len / 8;
+    int need_isnk = o_nt && o_nt != Py_None, need_a0 = o_as && o_as != Py_None;
+    if (derive_buf(o_pw, &b[B_PW], 1, n, "power") != 0 ||
+        derive_buf(o_en, &b[B_EN], 1, n, "energy") != 0 ||
+        derive_buf(o_nt, &b[B_NT], 1, n, "net") != 0 ||
+        derive_buf(o_as, &b[B_AS], 1, n, "a0s") != 0 ||
+        derive_buf(need_isnk ? o_isnk : NULL, &b[B_ISNK], 0, n, "isnk") != 0 ||
+        derive_buf(need_a0 ? o_a0 : NULL, &b[B_A0], 0, n, "a0") != 0) {
+        goto done;
+    }
+    if ((need_isnk && !b[B_ISNK].buf) || (need_a0 && !b[B_A0].buf)) {
+        PyErr_SetString(PyExc_ValueError, "net needs isnk, a0s needs a0");
+        goto done;
+    }
+
+    derived_out_t out = { (double*)b[B_PW].buf, (double*)b[B_EN].buf, (double*)b[B_NT].buf, (double*)b[B_AS].buf };
+    double e;
+    Py_BEGIN_ALLOW_THREADS
+    e = derived_compute((const double*)b[B_I].buf, (const double*)b[B_ISNK].buf, (const double*)b[B_A0].buf,
+                        (size_t)n, &cfg, &out);
+    Py_END_ALLOW_THREADS
+    res = PyFloat_FromDouble(e);
+
+done:
+    for (int k = 0; k < B_N; k++) {
+        if (b[k].buf) PyBuffer_Release(&b[k]);
+    }
+    return res;
+}
+
+// ----------------- Offline recording search -----------------
+
+// search_recording(data, triggers, workers=1, background=False, max_hits=0) -> (hits, stats)
+// data is the recording (e.g. mapped), triggers packed rec_trigger_t, hits packed rs_hit_t
+static PyObject* mp_search_recording(PyObject* Py_UNUSED(mod), PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"data", "triggers", "workers", "background", "max_hits", NULL};
+    Py_buffer data, trig;
+    unsigned int workers = 1;
+    int background = 0;
+    unsigned long long max_hits = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y*y*|IpK", kwlist, &data, &trig, &workers, &background, &max_hits)) {
+        return NULL;
+    }
+
+    rs_cfg_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    if (trig.len % (Py_ssize_t)sizeof(rec_trigger_t) != 0 || trig.len / (Py_ssize_t)sizeof(rec_trigger_t) > REC_MAX_TRIGGERS) {
+        PyBuffer_Release(&trig);
+        PyBuffer_Release(&data);
+        return PyErr_Format(PyExc_ValueError, "triggers must be 1..%d packed records", REC_MAX_TRIGGERS);
+    }
+    cfg.n_trig = (uint32_t)(trig.len / (Py_ssize_t)sizeof(rec_trigger_t));
+    memcpy(cfg.trig, trig.buf, (size_t)trig.len);
+    PyBuffer_Release(&trig);
+    cfg.workers = workers;
+    cfg.flags = background ? RS_BACKGROUND : 0;
+    cfg.max_hits = max_hits;
+
+    rs_result_t res;
+    int rv;
+    Py_BEGIN_ALLOW_THREADS
+    rv = rs_search((const uint8_t*)data.buf, (size_t)data.len, &cfg, &res);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&data);
+
+    if (rv == -1) {
+        return PyErr_Format(PyExc_ValueError, "search needs 1..%d triggers and 0..%d workers",
+                            REC_MAX_TRIGGERS, RS_MAX_WORKERS);
+    }
+    if (rv == -3) return PyErr_Format(PyExc_ValueError, "not a P1150 recording (magic/version)");
+    if (rv != 0) return PyErr_NoMemory();
+
+    PyObject* hits = PyBytes_FromStringAndSize((const char*)res.hits, (Py_ssize_t)(res.n * sizeof(rs_hit_t)));
+    rs_result_free(&res);
+    PyObject* st = PyDict_New();
+    if (!hits || !st) {
+        Py_XDECREF(hits);
+        Py_XDECREF(st);
+        return NULL;
+    }
+    dict_set_u64(st, "bytes", res.st.bytes);
+    dict_set_u64(st, "events", res.st.events);
+    dict_set_u64(st, "samples", res.st.samples);
+    dict_set_u64(st, "bg_blocks", res.st.bg_blocks);
+    dict_set_u64(st, "hits", res.st.hits);
+    dict_set_obj(st, "limited", PyBool_FromLong(res.st.limited));
+    dict_set_u64(st, "workers", res.st.workers);
+    dict_set_u64(st, "units", res.st.units);
+    dict_set_f64(st, "index_s", res.st.index_ns / 1e9);
+    dict_set_f64(st, "search_s", res.st.search_ns / 1e9);
+    return Py_BuildValue("(NN)", hits, st);
+}
+
+// search_context(data, hits, pre, post) -> (i, isnk, a0, d01, d0s) bytearrays, one
+// row of pre + post samples per hit, see rs_context()
+static PyObject* mp_search_context(PyObject* Py_UNUSED(mod), PyObject* args, PyObject* kwds) {
+    static char* kwlist[] = {"data", "hits", "pre", "post", NULL};
+    Py_buffer data, hits;
+    unsigned int pre, post;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y*y*II", kwlist, &data, &hits, &pre, &post)) return NULL;
+
+    const size_t n = (size_t)hits.len / sizeof(rs_hit_t), w = (size_t)pre + post;
+    static const size_t es[5] = { 4, 4, 2, 1, 1 };
+    PyObject* col[5] = { NULL, NULL, NULL, NULL, NULL };
+    PyObject* res = NULL;
+    if (hits.len % (Py_ssize_t)sizeof(rs_hit_t) != 0) {
+        PyErr_SetString(PyExc_ValueError, "hits must be packed rs_hit_t records");
+        goto done;
+    }
+    for (int c = 0; c < 5; c++) {
+        col[c] = PyByteArray_FromStringAndSize(NULL, (Py_ssize_t)(n * w * es[c]));
+        if (!col[c]) goto done;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    const rs_hit_t* h = (const rs_hit_t*)hits.buf;
+    for (size_t k = 0; k < n; k++) {
+        rs_hit_t hk;
+        memcpy(&hk, h + k, sizeof(hk));
+        rs_context((const uint8_t*)data.buf, (size_t)data.len, &hk, pre, post,
+                   (float*)PyByteArray_AS_STRING(col[0]) + k * w, (float*)PyByteArray_AS_STRING(col[1]) + k * w,
+                   (uint16_t*)PyByteArray_AS_STRING(col[2]) + k * w, (uint8_t*)PyByteArray_AS_STRING(col[3]) + k * w,
+                   (uint8_t*)PyByteArray_AS_STRING(col[4]) + k * w);
+    }
+    Py_END_ALLOW_THREADS
+    res = Py_BuildValue("(NNNNN)", col[0], col[1], col[2], col[3], col[4]);
+    memset(col, 0, sizeof(col));   // stolen
+
+done:
+    for (int c = 0; c < 5; c++) Py_XDECREF(col[c]);
+    PyBuffer_Release(&hits);
+    PyBuffer_Release(&data);
+    return res;
+}
+
 static PyMethodDef module_methods[] = {
+    {"derive", (PyCFunction)mp_derive, METH_VARARGS | METH_KEYWORDS, "Fused power/energy/net/scaled a0 of float64 arrays"},
+    {"search_recording", (PyCFunction)mp_search_recording, METH_VARARGS | METH_KEYWORDS, "Multi-threaded trigger search over a recording"},
+    {"search_context", (PyCFunction)mp_search_context, METH_VARARGS | METH_KEYWORDS, "Sample windows around search hits"},
     {NULL, NULL, 0, NULL}
 };
 
@@ -1346,6 +2666,8 @@ PyMODINIT_FUNC PyInit_mp_serial_ext(void) {
     PyObject* m;
     if (PyType_Ready(&SerialManagerType) < 0)
         return NULL;
+    if (PyType_Ready(&SampleColumnType) < 0)
+        return NULL;
 
     m = PyModule_Create(&moduledef);
     if (m == NULL)
@@ -1358,5 +2680,31 @@ PyMODINIT_FUNC PyInit_mp_serial_ext(void) {
         return NULL;
     }
 
+    Py_INCREF(&SampleColumnType);
+    if (PyModule_AddObject(m, "SampleColumn", (PyObject *)&SampleColumnType) < 0) {
+        Py_DECREF(&SampleColumnType);
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    // buffer sizes behind memory(), so Python can size configurations to a budget up front
+    static const struct { const char* name; long value; } sizes[] = {
+        { "SR_SAMPLE_BYTES", SR_SAMPLE_BYTES },
+        { "SR_MIN_LOG2", SR_MIN_LOG2 },
+        { "DIG_MIN_LOG2", DIG_MIN_LOG2 },
+        { "DIG_EDGE_BYTES", DIG_LINES * (8L << DIG_EDGES_LOG2) },
+        { "QUEUE_BYTES", P1150_QUEUE_DEFAULT },
+        { "TX_BYTES", P1150_TX_DEFAULT },
+        { "REC_EVENT_BYTES_PER_SAMPLE", REC_EVENT_BYTES_PER_SAMPLE },
+        { "REC_BG_BYTES", REC_BG_BLOCKS * (long)sizeof(rec_bg_block_t) },
+        { "SEQCAP_SEG_BYTES", (long)sizeof(seqcap_seg_t) },
+    };
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+        if (PyModule_AddIntConstant(m, sizes[k].name, sizes[k].value) < 0) {
+            Py_DECREF(m);
+            return NULL;
+        }
+    }
+
     return m;
 }
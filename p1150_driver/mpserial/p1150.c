@@ -0,0 +1,1462 @@
+// p1150.c
+#include "p1150_dev.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#ifndef _WIN32
+  #include <errno.h>
+  #include <fcntl.h>
+  #include <termios.h>
+  #include <sys/select.h>
+  #include <sys/time.h>
+  #include <sched.h>
+  #include <sys/ioctl.h>
+#endif
+
+#include "hotplug.h"
+
+#define CPU_SAMPLE_EVERY_N_LOOPS 512U
+#define RX_CHUNK                 16384      // reader thread stack buffer, one OS read
+#define TX_CHUNK                 65536      // writer thread stack buffer
+#define TX_SLICE                 4096       // writer bytes per io_mx hold, whole frames
+#define TX_WRITE_MS              2000       // writer thread write timeout
+#define DIRECT_WRITE_MS          20         // control/sweep command write timeout
+
+static void p1150_log(const char* msg) {
+#ifdef _WIN32
+    OutputDebugStringA(msg);
+    OutputDebugStringA("\r\n");
+#endif
+    fprintf(stderr, "%s\n", msg);
+    fflush(stderr);
+}
+
+void p1150_config_default(p1150_config_t* cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->baud = 115200;
+    cfg->queue_adc = 1;
+}
+
+const char* p1150_strerror(int err) {
+    switch (err) {
+        case 0:              return "ok";
+        case P1150_EARG:     return "invalid argument";
+        case P1150_ENOMEM:   return "out of memory";
+        case P1150_EOPEN:    return "failed to open serial port";
+        case P1150_EFULL:    return "TX queue full";
+        case P1150_ESTOPPED: return "not running";
+        case P1150_ESIZE:    return "frame larger than buffer";
+        case P1150_ETHREAD:  return "failed to start thread";
+        case P1150_EIO:      return "serial write failed";
+        default:             return "unknown error";
+    }
+}
+
+// Elevate the current thread (reader thread) to highest priority on all platforms
+static void set_current_thread_highest_priority(void) {
+#ifdef _WIN32
+    HANDLE h = GetCurrentThread();
+    SetThreadPriority(h, THREAD_PRIORITY_HIGHEST);
+    SetThreadPriorityBoost(h, FALSE);
+#else
+    struct sched_param sp;
+    int maxp = sched_get_priority_max(SCHED_FIFO);
+    if (maxp > 0) {
+        sp.sched_priority = maxp;
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) != 0) {
+            int maxp_rr = sched_get_priority_max(SCHED_RR);
+            if (maxp_rr > 0) {
+                sp.sched_priority = maxp_rr;
+                if (pthread_setschedparam(pthread_self(), SCHED_RR, &sp) != 0) {
+                    errno = 0;
+                    if (nice(-20) == -1) errno = 0;
+                }
+            } else {
+                errno = 0;
+                if (nice(-20) == -1) errno = 0;
+            }
+        }
+    } else {
+        errno = 0;
+        if (nice(-20) == -1) errno = 0;
+    }
+#endif
+}
+
+// ----------------- COBS -----------------
+
+static int cobs_decode(const uint8_t* in, size_t in_len, uint8_t* out, size_t out_cap) {
+    size_t in_idx = 0, out_idx = 0;
+    while (in_idx < in_len) {
+        uint8_t code = in[in_idx++];
+        if (code == 0) return -1;
+        size_t copy_len = (size_t)(code - 1);
+        if (in_idx + copy_len > in_len) return -1;
+        if (out_idx + copy_len + (code < 0xFF ? 1 : 0) > out_cap) return -1;
+
+        memcpy(out + out_idx, in + in_idx, copy_len);
+        out_idx += copy_len;
+        in_idx += copy_len;
+
+        if (code < 0xFF && in_idx < in_len) {
+            out[out_idx++] = 0x00;
+        }
+    }
+    return (int)out_idx;
+}
+
+// Same output as cobs_c (no trailing empty block after a full one); out needs
+// n + n / 254 + 1 bytes
+static size_t cobs_encode(const uint8_t* in, size_t n, uint8_t* out) {
+    size_t code_at = 0, o = 1;
+    uint8_t code = 1;
+    int last_max = 0;
+    for (size_t k = 0; k < n; k++) {
+        last_max = 0;
+        if (in[k] == 0) {
+            out[code_at] = code;
+            code_at = o++;
+            code = 1;
+        } else {
+            out[o++] = in[k];
+            if (++code == 0xFF) {
+                out[code_at] = code;
+                code_at = o++;
+                code = 1;
+                last_max = 1;
+            }
+        }
+    }
+    if (last_max) return o - 1;
+    out[code_at] = code;
+    return o;
+}
+
+// ----------------- Raw frame queue -----------------
+
+static inline size_t q_used(const p1150_t* d) {
+    return d->q_head - d->q_tail;
+}
+
+void p1150_queue_used(p1150_t* d, size_t* bytes, size_t* frames) {
+    mp_mutex_lock(&d->mx);
+    *bytes = q_used(d);
+    *frames = d->q_frames;
+    mp_mutex_unlock(&d->mx);
+}
+
+static int q_push(p1150_t* d, const uint8_t* data, int len) {
+    mp_mutex_lock(&d->mx);
+
+    size_t needed = sizeof(uint16_t) + (size_t)len;
+    if (needed > d->q_size - q_used(d)) {
+        d->perf.ring_dropped++;
+        d->perf.ring_push_dropped++;
+        mp_mutex_unlock(&d->mx);
+        return 0;
+    }
+
+    uint16_t ulen = (uint16_t)len;
+    for (size_t i = 0; i < sizeof(uint16_t); i++) {
+        d->q_data[(d->q_head + i) % d->q_size] = ((uint8_t*)&ulen)[i];
+    }
+
+    size_t data_start = (d->q_head + sizeof(uint16_t)) % d->q_size;
+    size_t space_to_end = d->q_size - data_start;
+    if ((size_t)len <= space_to_end) {
+        memcpy(d->q_data + data_start, data, (size_t)len);
+    } else {
+        memcpy(d->q_data + data_start, data, space_to_end);
+        memcpy(d->q_data, data + space_to_end, (size_t)len - space_to_end);
+    }
+
+    d->q_head += needed;
+    d->q_frames++;
+    if (d->waiters) mp_cond_broadcast(&d->cv);
+    mp_mutex_unlock(&d->mx);
+    return 1;
+}
+
+int p1150_frame_pop(p1150_t* d, uint8_t* buf, size_t cap) {
+    uint16_t len = 0;
+
+    mp_mutex_lock(&d->mx);
+    if (d->q_head == d->q_tail) {
+        mp_mutex_unlock(&d->mx);
+        return 0;
+    }
+    for (size_t j = 0; j < sizeof(uint16_t); j++) {
+        ((uint8_t*)&len)[j] = d->q_data[(d->q_tail + j) % d->q_size];
+    }
+
+    int rc = (int)len;
+    if ((size_t)len > cap) {
+        rc = P1150_ESIZE;
+    } else {
+        size_t data_start = (d->q_tail + sizeof(uint16_t)) % d->q_size;
+        size_t space_to_end = d->q_size - data_start;
+        if ((size_t)len <= space_to_end) {
+            memcpy(buf, d->q_data + data_start, (size_t)len);
+        } else {
+            memcpy(buf, d->q_data + data_start, space_to_end);
+            memcpy(buf + space_to_end, d->q_data, (size_t)len - space_to_end);
+        }
+        d->perf.delivered_frames++;
+        d->perf.delivered_bytes += (uint64_t)len;
+    }
+    d->q_tail += sizeof(uint16_t) + (size_t)len;
+    d->q_frames--;
+    mp_mutex_unlock(&d->mx);
+    return rc;
+}
+
+int p1150_frames_pop(p1150_t* d, uint8_t* buf, size_t cap, size_t max_frames, size_t* used) {
+    size_t at = 0;
+    int frames = 0;
+
+    mp_mutex_lock(&d->mx);
+    while (d->q_head != d->q_tail && (size_t)frames < max_frames) {
+        uint16_t len = 0;
+        for (size_t j = 0; j < sizeof(uint16_t); j++) {
+            ((uint8_t*)&len)[j] = d->q_data[(d->q_tail + j) % d->q_size];
+        }
+        size_t rec = sizeof(uint16_t) + (size_t)len;
+        if (at + rec > cap) break;
+
+        // the record is stored the same way in the queue
+        size_t start = d->q_tail % d->q_size;
+        size_t first = d->q_size - start < rec ? d->q_size - start : rec;
+        memcpy(buf + at, d->q_data + start, first);
+        memcpy(buf + at + first, d->q_data, rec - first);
+        at += rec;
+        frames++;
+        d->q_tail += rec;
+        d->q_frames--;
+        d->perf.delivered_frames++;
+        d->perf.delivered_bytes += (uint64_t)len;
+    }
+    mp_mutex_unlock(&d->mx);
+    *used = at;
+    return frames;
+}
+
+static void post_event(p1150_t* d, unsigned ev) {
+    mp_mutex_lock(&d->mx);
+    d->events |= ev;
+    mp_cond_broadcast(&d->cv);
+    mp_mutex_unlock(&d->mx);
+}
+
+unsigned p1150_wait(p1150_t* d, unsigned timeout_ms) {
+    uint64_t deadline = mp_now_ms() + timeout_ms;
+    unsigned ev;
+
+    mp_mutex_lock(&d->mx);
+    d->waiters++;
+    for (;;) {
+        if (d->q_head != d->q_tail || d->events || !d->alive) break;
+        uint64_t now = mp_now_ms();
+        if (now >= deadline) break;
+        mp_cond_wait_ms(&d->cv, &d->mx, (unsigned)(deadline - now));
+    }
+    d->waiters--;
+    ev = d->events;
+    d->events = 0;
+    if (d->q_head != d->q_tail) ev |= P1150_EV_FRAME;
+    if (!d->alive) ev |= P1150_EV_STOPPED;
+    mp_mutex_unlock(&d->mx);
+    return ev;
+}
+
+void p1150_consumed(p1150_t* d, uint64_t n) {
+    d->consumed_frames += n;
+    d->consumer_acks = 1;
+}
+
+int p1150_mux_split(const uint8_t* frame, size_t n, p1150_mux_t* m) {
+    memset(m, 0, sizeof(*m));
+    if (n == 0) return P1150_EARG;
+    m->type = frame[0] & 3;
+    if (m->type == P1150_MUX_PORT) {
+        m->port = frame[0] >> 2;
+        m->p = frame + 1;
+        m->n = n - 1;
+        return 0;
+    }
+    // log record: the mux byte is the low byte of the format address
+    if (n < 4) return P1150_EARG;
+    m->addr = (uint32_t)frame[0] | ((uint32_t)frame[1] << 8) | ((uint32_t)frame[2] << 16) | ((uint32_t)frame[3] << 24);
+    m->target = (m->addr >> 20) & 0xfu;
+    m->p = frame + 4;
+    m->n = n - 4;
+    return 0;
+}
+
+// ----------------- Frame intake and backlog telemetry -----------------
+
+// Reader thread: one decoded frame.  ADC frames are parsed natively into the
+// sample ring and the analysis modules before being queued raw.
+static void frame_in(p1150_t* d, const uint8_t* data, int len) {
+    int adc = len > 1 && data[0] == ADC_FRAME_MUX_BYTE;
+    int queue = !adc || d->queue_adc;
+    if (adc) {
+        adc_frame_t f;
+        if (adc_frame_parse(data + 1, (size_t)len - 1, &f) == 0) {
+            uint64_t n = adc_frame_samples(&f);
+            d->perf.adc_frames++;
+            // reaction latency first, before any analysis of the frame
+            ctl_feed(&d->ctl, d->perf.adc_samples, &f, d->rx_ns);
+            sweep_feed(&d->sweep, d->perf.adc_samples, &f);
+            if (sample_ring_enabled(&d->sring)) (void)sample_ring_publish(&d->sring, &f);
+            if (digital_enabled(&d->digital)) {
+                uint64_t m = (f.present & ADC_HAS_D01) && f.d01.n < n ? f.d01.n : n;
+                if (!(f.present & ADC_HAS_D01)) m = 0;
+                digital_append(&d->digital, f.d01.p, (size_t)m);
+                if (n > m) digital_append(&d->digital, NULL, (size_t)(n - m));
+            }
+            gated_feed(&d->gated, d->perf.adc_samples, &f);
+            chist_feed(&d->chist, &f);
+            hist_feed(&d->hist, &f);
+            seg_feed(&d->seg, d->perf.adc_samples, &f);
+            mask_feed(&d->mask, d->perf.adc_samples, &f);
+            if (f.present & ADC_HAS_C) (void)sclock_feed(&d->sclock, f.c, (uint32_t)n, mp_now_ns(), d->perf.adc_samples);
+            d->perf.adc_samples += n;
+            if (f.present & ADC_HAS_A) {
+                uint32_t a = f.a > UINT32_MAX ? UINT32_MAX : (uint32_t)f.a;
+                d->fw_backlog = a;
+                if (a > d->fw_backlog_peak) d->fw_backlog_peak = a;
+            }
+        } else {
+            d->perf.adc_parse_errors++;
+        }
+    } else if (len > 1 && data[0] == P1150_MUX_PORT && d->sweep.state == SWEEP_ACK) {
+        // port 0 command response, the sweep marks where it arrived in the stream
+        cmd_response_t r;
+        if (cmd_response_parse(data + 1, (size_t)len - 1, &r) == 0) sweep_response(&d->sweep, &r, d->perf.adc_samples);
+    } else if (len > 1 && data[0] == PLOT_MUX_BYTE && plot_enabled(&d->plot)) {
+        // debug plotter, decoded here and only queued when Python still wants the items
+        (void)plot_feed(&d->plot, data + 1, (size_t)len - 1, d->perf.adc_samples);
+        queue = d->plot.forward;
+    }
+    if (queue) (void)q_push(d, data, len);
+    d->perf.rx_frames++;
+}
+
+// Reader thread: sample every backlog once per PRESSURE_PERIOD_MS
+static void pipeline_sample(p1150_t* d) {
+    uint64_t t = mp_now_ms();
+    if (t < d->pressure_next_ms) return;
+    d->pressure_next_ms = t + PRESSURE_PERIOD_MS;
+
+    pressure_sample_t s;
+    memset(&s, 0, sizeof(s));
+    s.t_ms = t;
+    size_t used, frames;
+    p1150_queue_used(d, &used, &frames);
+    s.ring_used = (uint32_t)used;
+    s.deliver_lag = (uint32_t)frames;
+    s.fw_backlog = d->fw_backlog;
+    if (d->consumer_acks) {
+        uint64_t dl = d->perf.delivered_frames, c = d->consumed_frames;
+        s.consumer_lag = dl > c ? (uint32_t)(dl - c) : 0;
+    }
+
+    // smoothed throughput, converts frame lags to time (Little's law)
+    uint64_t rx = d->perf.rx_frames;
+    if (d->pressure_last_ms && t > d->pressure_last_ms) {
+        double fps = (double)(rx - d->pressure_last_frames) * 1000.0 / (double)(t - d->pressure_last_ms);
+        d->frames_per_s = d->frames_per_s * 0.8 + fps * 0.2;
+    }
+    d->pressure_last_ms = t;
+    d->pressure_last_frames = rx;
+
+    if (pressure_add(&d->pressure, &s, (uint32_t)d->q_size)) {
+        if (d->pressure.warn) d->perf.pressure_warnings++;
+        post_event(d, P1150_EV_PRESSURE);
+    }
+}
+
+// Reader thread: split raw bytes on 0x00 delimiters, COBS decode complete frames
+typedef struct {
+    uint8_t buf[P1150_FRAME_MAX];
+    size_t  len;
+    uint8_t out[P1150_FRAME_MAX];
+} rx_framer_t;
+
+static void rx_bytes(p1150_t* d, rx_framer_t* fr, const uint8_t* p, size_t n) {
+    const uint8_t* end = p + n;
+
+    while (p < end) {
+        const uint8_t* z = (const uint8_t*)memchr(p, 0x00, (size_t)(end - p));
+        const uint8_t* q = z ? z : end;
+
+        size_t chunk = (size_t)(q - p);
+        if (chunk) {
+            if (fr->len + chunk <= sizeof(fr->buf)) {
+                memcpy(fr->buf + fr->len, p, chunk);
+                fr->len += chunk;
+            } else {
+                fr->len = 0;  // overflow -> drop partial to resync
+            }
+        }
+        if (!z) break;
+
+        if (fr->len > 0) {
+            int olen = cobs_decode(fr->buf, fr->len, fr->out, sizeof(fr->out));
+            if (olen >= 0) {
+                frame_in(d, fr->out, olen);
+            } else {
+                d->perf.cobs_decode_errors++;
+            }
+        }
+        fr->len = 0;
+        p = z + 1;
+        if (!d->alive) break;
+    }
+}
+
+// ----------------- Platform-specific serial I/O -----------------
+#ifdef _WIN32
+
+static void cancel_all_io_win(HANDLE h) {
+    if (!h || h == INVALID_HANDLE_VALUE) return;
+    CancelIoEx(h, NULL);
+    DWORD ce = 0; COMSTAT st = {0};
+    ClearCommError(h, &ce, &st);
+    PurgeComm(h, PURGE_RXABORT | PURGE_TXABORT | PURGE_RXCLEAR | PURGE_TXCLEAR);
+}
+
+static HANDLE open_serial_win(const char* port, int baud) {
+    char name[256];
+    if (strncmp(port, "\\\\.\\", 4) == 0) {
+        strncpy(name, port, sizeof(name)-1);
+        name[sizeof(name)-1] = 0;
+    } else {
+        snprintf(name, sizeof(name), "\\\\.\\%s", port);
+    }
+
+    HANDLE h = CreateFileA(
+        name, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+        OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL);
+    if (h == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "CreateFile failed for %s, err=%lu\n", name, GetLastError());
+        return INVALID_HANDLE_VALUE;
+    }
+
+    SetupComm(h, 64 * 1024, 4 * 1024);
+    PurgeComm(h, PURGE_RXCLEAR | PURGE_TXCLEAR | PURGE_RXABORT | PURGE_TXABORT);
+
+    DCB dcb = (DCB){0};
+    dcb.DCBlength = sizeof(DCB);
+    if (!GetCommState(h, &dcb)) {
+        fprintf(stderr, "GetCommState failed, err=%lu\n", GetLastError());
+        CloseHandle(h);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    dcb.fBinary       = TRUE;
+    dcb.fAbortOnError = FALSE;
+
+    dcb.BaudRate = baud;
+    dcb.ByteSize = 8;
+    dcb.Parity   = NOPARITY;
+    dcb.StopBits = ONESTOPBIT;
+
+    dcb.fOutxCtsFlow = FALSE;
+    dcb.fOutxDsrFlow = FALSE;
+    dcb.fOutX = FALSE;
+    dcb.fInX  = FALSE;
+
+    dcb.fDtrControl = DTR_CONTROL_ENABLE;
+    dcb.fRtsControl = RTS_CONTROL_ENABLE;
+
+    if (!SetCommState(h, &dcb)) {
+        fprintf(stderr, "SetCommState failed, err=%lu\n", GetLastError());
+        CloseHandle(h);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    // Set no timeouts (non-blocking behavior controlled by our read logic)
+    COMMTIMEOUTS to = (COMMTIMEOUTS){0};
+    to.ReadIntervalTimeout = 0;
+    to.ReadTotalTimeoutMultiplier = 0;
+    to.ReadTotalTimeoutConstant = 0;
+    to.WriteTotalTimeoutMultiplier = 0;
+    to.WriteTotalTimeoutConstant = 0;
+    if (!SetCommTimeouts(h, &to)) {
+        fprintf(stderr, "SetCommTimeouts failed, err=%lu\n", GetLastError());
+        CloseHandle(h);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    if (!SetCommMask(h, EV_RXCHAR | EV_ERR | EV_BREAK)) {
+        fprintf(stderr, "SetCommMask failed, err=%lu\n", GetLastError());
+        CloseHandle(h);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    DWORD ce = 0; COMSTAT st = {0};
+    ClearCommError(h, &ce, &st);
+    EscapeCommFunction(h, SETRTS);
+    EscapeCommFunction(h, SETDTR);
+    EscapeCommFunction(h, CLRDTR);
+    Sleep(10);
+    EscapeCommFunction(h, SETDTR);
+
+    return h;
+}
+
+static int serial_write_win(HANDLE h, const uint8_t* data, size_t len, unsigned timeout_ms) {
+    OVERLAPPED ov = (OVERLAPPED){0};
+    ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!ov.hEvent) return -1;
+
+    DWORD written = 0;
+    BOOL ok = WriteFile(h, data, (DWORD)len, NULL, &ov);
+    if (!ok) {
+        DWORD err = GetLastError();
+        if (err == ERROR_IO_PENDING) {
+            DWORD wait_rc = WaitForSingleObject(ov.hEvent, timeout_ms);
+            if (wait_rc == WAIT_TIMEOUT) {
+                if (!CancelIoEx(h, &ov)) CancelIo(h);
+                DWORD ce = 0; COMSTAT st = {0};
+                ClearCommError(h, &ce, &st);
+                CloseHandle(ov.hEvent);
+                return 0;
+            }
+            if (!GetOverlappedResult(h, &ov, &written, FALSE)) {
+                CloseHandle(ov.hEvent);
+                return -1;
+            }
+        } else {
+            CloseHandle(ov.hEvent);
+            return -1;
+        }
+    } else {
+        if (!GetOverlappedResult(h, &ov, &written, TRUE)) {
+            CloseHandle(ov.hEvent);
+            return -1;
+        }
+    }
+
+    CloseHandle(ov.hEvent);
+    return (int)written;
+}
+
+// Windows non-blocking read: we poll cbInQue; if zero => return 0.
+// If > 0, issue overlapped ReadFile and allow a minimal wait so completion
+// can materialize; otherwise treat as no data.
+static int serial_read_win(HANDLE h, uint8_t* buf, size_t cap) {
+    DWORD errs = 0; COMSTAT st = {0};
+    ClearCommError(h, &errs, &st);
+
+    if (st.cbInQue == 0) {
+        return 0;
+    }
+
+    DWORD to_read = st.cbInQue;
+    if (to_read > cap) to_read = (DWORD)cap;
+
+    OVERLAPPED ov = (OVERLAPPED){0};
+    ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!ov.hEvent) return -1;
+
+    DWORD got = 0;
+    BOOL ok = ReadFile(h, buf, to_read, NULL, &ov);
+    if (!ok) {
+        DWORD err = GetLastError();
+        if (err == ERROR_IO_PENDING) {
+            // Slightly longer wait to avoid busy loop while still low latency
+            DWORD rc = WaitForSingleObject(ov.hEvent, 3);
+            if (rc == WAIT_TIMEOUT) {
+                CancelIoEx(h, &ov);
+                DWORD ce2 = 0; COMSTAT st2 = {0};
+                ClearCommError(h, &ce2, &st2);
+                CloseHandle(ov.hEvent);
+                return 0;
+            }
+            if (!GetOverlappedResult(h, &ov, &got, FALSE)) {
+                CloseHandle(ov.hEvent);
+                return -1;
+            }
+        } else if (err == ERROR_OPERATION_ABORTED) {
+            CloseHandle(ov.hEvent);
+            return 0;
+        } else {
+            CloseHandle(ov.hEvent);
+            return -1;
+        }
+    } else {
+        if (!GetOverlappedResult(h, &ov, &got, TRUE)) {
+            CloseHandle(ov.hEvent);
+            return -1;
+        }
+    }
+
+    CloseHandle(ov.hEvent);
+    return (int)got;
+}
+
+static void close_serial_win(HANDLE h) {
+    if (h && h != INVALID_HANDLE_VALUE) {
+        CloseHandle(h);
+    }
+}
+
+static inline int port_open(const p1150_t* d) {
+    return d->h_port && d->h_port != INVALID_HANDLE_VALUE;
+}
+
+#else // POSIX
+
+static int set_interface_attribs(int fd, int speed) {
+    struct termios tty;
+    if (tcgetattr(fd, &tty) != 0) {
+        perror("tcgetattr");
+        return -1;
+    }
+    cfmakeraw(&tty);
+
+    speed_t spd = B115200;
+    switch (speed) {
+        case 9600: spd = B9600; break;
+        case 19200: spd = B19200; break;
+        case 38400: spd = B38400; break;
+        case 57600: spd = B57600; break;
+        case 115200: spd = B115200; break;
+        default: spd = B115200; break;
+    }
+    cfsetispeed(&tty, spd);
+    cfsetospeed(&tty, spd);
+
+    tty.c_cflag |= (CLOCAL | CREAD);
+    tty.c_cflag &= ~CSIZE;
+    tty.c_cflag |= CS8;
+    tty.c_cflag &= ~(PARENB | CSTOPB | CRTSCTS);
+
+    // Non-blocking read by default
+    tty.c_cc[VTIME] = 0;
+    tty.c_cc[VMIN]  = 0;
+
+    if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+        perror("tcsetattr");
+        return -1;
+    }
+    return 0;
+}
+
+static int open_serial_posix(const char* port, int baud) {
+    int fd = open(port, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) {
+        perror("open");
+        return -1;
+    }
+    if (set_interface_attribs(fd, baud) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// The fd is non-blocking: a large batch may only be partly taken, wait for the
+// rest (up to timeout_ms per wait, like the Windows write timeout).  wait_ns, if
+// given, adds the time spent waiting for the port to take more.
+static int serial_write_posix(int fd, const uint8_t* data, size_t len, unsigned timeout_ms,
+                              uint64_t* wait_ns) {
+    size_t off = 0;
+    while (off < len) {
+        ssize_t w = write(fd, data + off, len - off);
+        if (w > 0) {
+            off += (size_t)w;
+            continue;
+        }
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            fd_set wfds;
+            FD_ZERO(&wfds);
+            FD_SET(fd, &wfds);
+            struct timeval tv = { (time_t)(timeout_ms / 1000u), (suseconds_t)(timeout_ms % 1000u) * 1000 };
+            uint64_t t0 = mp_now_ns();
+            int ready = select(fd + 1, NULL, &wfds, NULL, &tv);
+            if (wait_ns) *wait_ns += mp_now_ns() - t0;
+            if (ready > 0) continue;
+        }
+        return off ? (int)off : -1;
+    }
+    return (int)off;
+}
+
+// POSIX non-blocking drain: read() until EAGAIN/EWOULDBLOCK or cap reached.
+static int serial_read_posix(int fd, uint8_t* buf, size_t cap) {
+    if (cap == 0) return 0;
+
+    ssize_t total = 0;
+    for (;;) {
+        ssize_t r = read(fd, buf + total, cap - (size_t)total);
+        if (r > 0) {
+            total += r;
+            if ((size_t)total >= cap) break;
+            continue;
+        }
+        if (r == 0) {
+            break;
+        }
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+    }
+    return (int)total;
+}
+
+static void close_serial_posix(int fd) {
+    if (fd >= 0) close(fd);
+}
+
+static inline int port_open(const p1150_t* d) {
+    return d->fd >= 0;
+}
+
+#endif
+
+// ----------------- Hot-plug reconnect -----------------
+
+static void link_down(p1150_t* d) {
+    d->link_up = 0;
+    d->link_down_ms = mp_now_ms();
+    d->perf.disconnects++;
+    post_event(d, P1150_EV_LINK);
+}
+
+static void link_restored(p1150_t* d) {
+    uint64_t latency = mp_now_ms() - d->link_down_ms;
+    d->last_reconnect_ms = latency;
+    if (latency > d->max_reconnect_ms) d->max_reconnect_ms = latency;
+    d->perf.reconnects++;
+    d->link_up = 1;
+    post_event(d, P1150_EV_LINK);
+
+    char msg[400];
+    snprintf(msg, sizeof(msg), "libp1150: reconnected %s in %" PRIu64 " ms", d->cur_port, latency);
+    p1150_log(msg);
+}
+
+#ifdef _WIN32
+
+// Reader thread only. Returns 1 when the port is back, 0 if shutdown came first.
+static int link_recover(p1150_t* d) {
+    mp_mutex_lock(&d->io_mx);
+    close_serial_win(d->h_port);
+    d->h_port = INVALID_HANDLE_VALUE;
+    mp_mutex_unlock(&d->io_mx);
+    link_down(d);
+
+    // COM port names are stable per device on Windows, wait for it to exist again
+    const char* dos = d->cur_port;
+    if (strncmp(dos, "\\\\.\\", 4) == 0) dos += 4;
+    char target[512];
+
+    while (d->alive) {
+        Sleep(50);
+        if (!QueryDosDeviceA(dos, target, sizeof(target))) continue;
+        HANDLE h = open_serial_win(d->cur_port, d->baud);
+        if (h == INVALID_HANDLE_VALUE) continue;
+
+        mp_mutex_lock(&d->io_mx);
+        d->h_port = h;
+        mp_mutex_unlock(&d->io_mx);
+        link_restored(d);
+        return 1;
+    }
+    return 0;
+}
+
+#else
+
+// Reader thread only.  Close the dead fd, wait for the same device to come back
+// (by USB serial number when known, else by port name) and reopen it in place.
+// Returns 1 when the port is back, 0 if shutdown came first.
+static int link_recover(p1150_t* d) {
+    mp_mutex_lock(&d->io_mx);
+    close_serial_posix(d->fd);
+    d->fd = -1;
+    mp_mutex_unlock(&d->io_mx);
+    link_down(d);
+
+    hotplug_t hp;
+    hotplug_open(&hp);
+
+    uint64_t scan_until = 0;   // after a uevent, rescan quickly while udev settles the node
+    uint64_t next_scan = 0;
+    int rc = 0;
+
+    while (d->alive) {
+        int ev = hotplug_wait(&hp, 50);
+        uint64_t t = mp_now_ms();
+        if (ev) scan_until = t + 2000;
+        if (t < next_scan && t >= scan_until) continue;
+        next_scan = t + ((hp.fd >= 0) ? 500 : 50);
+
+        char port[256];
+        if (d->sn[0]) {
+            if (hotplug_find_port(d->sn, port, sizeof(port)) != 0) continue;
+        } else {
+            strncpy(port, d->cur_port, sizeof(port) - 1);
+            port[sizeof(port) - 1] = 0;
+            if (access(port, F_OK) != 0) continue;
+        }
+
+        int fd = open(port, O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (fd < 0) continue;  // node may exist before udev fixes permissions
+        if (set_interface_attribs(fd, d->baud) != 0) {
+            close(fd);
+            continue;
+        }
+
+        mp_mutex_lock(&d->io_mx);
+        d->fd = fd;
+        snprintf(d->cur_port, sizeof(d->cur_port), "%s", port);
+        mp_mutex_unlock(&d->io_mx);
+        link_restored(d);
+        rc = 1;
+        break;
+    }
+
+    hotplug_close(&hp);
+    return rc;
+}
+
+#endif
+
+// ----------------- Threads -----------------
+
+static inline void cpu_account(uint64_t* acc, uint64_t* prev) {
+    uint64_t now = mp_thread_cpu_ns();
+    if (now >= *prev) *acc += now - *prev;
+    *prev = now;
+}
+
+#ifdef _WIN32
+
+// Wait for EV_RXCHAR (or error/break) with a short timeout.
+// Returns 1 if an event fired, 0 on timeout, -1 on error.
+static int wait_for_rx_win(HANDLE h, DWORD timeout_ms) {
+    DWORD mask = 0;
+    OVERLAPPED ov = {0};
+    ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!ov.hEvent) return -1;
+
+    // Ensure we’re listening for RX events
+    if (!SetCommMask(h, EV_RXCHAR | EV_ERR | EV_BREAK)) {
+        CloseHandle(ov.hEvent);
+        return -1;
+    }
+
+    BOOL ok = WaitCommEvent(h, &mask, &ov);
+    if (!ok) {
+        DWORD err = GetLastError();
+        if (err == ERROR_IO_PENDING) {
+            DWORD rc = WaitForSingleObject(ov.hEvent, timeout_ms);
+            if (rc == WAIT_TIMEOUT) {
+                CancelIoEx(h, &ov);
+                DWORD ce = 0; COMSTAT st = {0};
+                ClearCommError(h, &ce, &st);
+                CloseHandle(ov.hEvent);
+                return 0; // no event in time
+            }
+            // completion occurred; fall-through to success
+        } else if (err == ERROR_INVALID_PARAMETER) {
+            // Some drivers don’t signal events reliably; treat as timeout
+            CloseHandle(ov.hEvent);
+            return 0;
+        } else if (err == ERROR_OPERATION_ABORTED) {
+            CloseHandle(ov.hEvent);
+            return 0;
+        } else {
+            CloseHandle(ov.hEvent);
+            return -1;
+        }
+    } else {
+        // Synchronous success; mask already set
+        (void)mask;
+    }
+
+    CloseHandle(ov.hEvent);
+    return 1;
+}
+
+static void* reader_thread(void* param) {
+    p1150_t* d = (p1150_t*)param;
+    uint8_t inbuf[RX_CHUNK];
+    rx_framer_t* fr = (rx_framer_t*)calloc(1, sizeof(rx_framer_t));
+    if (!fr) return NULL;
+
+    set_current_thread_highest_priority();
+    uint64_t cpu_prev_ns = mp_thread_cpu_ns();
+    uint32_t cpu_sample_ctr = 0;
+
+    int idle_backoff_ms = 0; // adaptive: 0, 1, 2, 3 (cap small to keep latency)
+
+    while (d->alive) {
+        if (++cpu_sample_ctr >= CPU_SAMPLE_EVERY_N_LOOPS) {
+            cpu_account(&d->perf.cpu_reader_ns, &cpu_prev_ns);
+            cpu_sample_ctr = 0;
+        }
+
+        if (!port_open(d)) break;
+        pipeline_sample(d);
+
+        // Non-blocking drain
+        int n = serial_read_win(d->h_port, inbuf, sizeof(inbuf));
+        if (!d->alive) break;
+
+        if (n < 0) {
+            DWORD ce = 0; COMSTAT st = {0};
+            if (!ClearCommError(d->h_port, &ce, &st) && d->reconnect) {
+                // device removed, wait for it to come back
+                if (link_recover(d)) { fr->len = 0; continue; }
+                break;
+            }
+            Sleep(10);
+            continue;
+        }
+
+        if (n > 0) {
+            // got data -> reset backoff
+            idle_backoff_ms = 0;
+            d->perf.rx_bytes += (uint64_t)n;
+            d->rx_ns = mp_now_ns();
+            rx_bytes(d, fr, inbuf, (size_t)n);
+            continue;
+        }
+
+        // n == 0: nothing available right now.
+        // Use event-driven wait to avoid spinning.
+        int ev = wait_for_rx_win(d->h_port, 3);
+        if (ev == 1) {
+            continue;
+        } else if (ev < 0) {
+            // Treat as transient error; small sleep to avoid hot loop
+            Sleep(2);
+        } else {
+            // Timeout: apply tiny adaptive backoff
+            if (idle_backoff_ms < 3) idle_backoff_ms++;
+            d->perf.rx_idle_loops++;
+            Sleep(idle_backoff_ms);
+        }
+    }
+    cpu_account(&d->perf.cpu_reader_ns, &cpu_prev_ns);
+    free(fr);
+    return NULL;
+}
+
+#else
+
+static void* reader_thread(void* param) {
+    p1150_t* d = (p1150_t*)param;
+    uint8_t inbuf[RX_CHUNK];
+    rx_framer_t* fr = (rx_framer_t*)calloc(1, sizeof(rx_framer_t));
+    if (!fr) return NULL;
+
+    set_current_thread_highest_priority();
+    uint64_t cpu_prev_ns = mp_thread_cpu_ns();
+    uint32_t cpu_sample_ctr = 0;
+
+    while (d->alive) {
+        if (++cpu_sample_ctr >= CPU_SAMPLE_EVERY_N_LOOPS) {
+            cpu_account(&d->perf.cpu_reader_ns, &cpu_prev_ns);
+            cpu_sample_ctr = 0;
+        }
+
+        pipeline_sample(d);
+
+        fd_set read_fds;
+        FD_ZERO(&read_fds);
+        if (d->fd < 0) break;
+        FD_SET(d->fd, &read_fds);
+
+        struct timeval timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 100000; // 100ms timeout to remain responsive
+
+        int rv = select(d->fd + 1, &read_fds, NULL, NULL, &timeout);
+        if (!d->alive) break;
+
+        if (rv < 0) {
+            if (errno == EINTR) continue; // Interrupted by signal, just loop again
+            if (d->reconnect && link_recover(d)) { fr->len = 0; continue; }
+            break; // A real error occurred
+        }
+        if (rv == 0) {
+            continue; // Timeout, no data. Loop to check alive.
+        }
+
+        int n = serial_read_posix(d->fd, inbuf, sizeof(inbuf));
+        if (!d->alive) break;
+
+        if (n <= 0) {
+            // Error or EOF: device gone, wait for it to come back if enabled
+            if (d->reconnect && link_recover(d)) { fr->len = 0; continue; }
+            break;
+        }
+        d->perf.rx_bytes += (uint64_t)n;
+        d->rx_ns = mp_now_ns();
+        rx_bytes(d, fr, inbuf, (size_t)n);
+    }
+    cpu_account(&d->perf.cpu_reader_ns, &cpu_prev_ns);
+    free(fr);
+    return NULL;
+}
+
+#endif
+
+// Length of the first slice of b: cut between two 0x00 (closing delimiter or padding of
+// one frame, opening delimiter of the next) at a multiple of 4 bytes, so a direct write
+// only ever lands between whole frames.  Up to TX_SLICE when the frames allow it.
+static size_t tx_slice(const uint8_t* b, size_t total) {
+    if (total <= TX_SLICE) return total;
+    for (size_t e = TX_SLICE & ~(size_t)3; e >= 4; e -= 4) {
+        if (!b[e - 1] && !b[e]) return e;
+    }
+    for (size_t e = (TX_SLICE & ~(size_t)3) + 4; e < total; e += 4) {
+        if (!b[e - 1] && !b[e]) return e;
+    }
+    return total;
+}
+
+// Drains the TX queue, everything queued meanwhile goes out together.  io_mx is taken
+// per slice of whole frames and the writer steps aside between slices while the reader
+// thread waits to write a control command (see direct_write()).
+static void* writer_thread(void* param) {
+    p1150_t* d = (p1150_t*)param;
+    uint8_t buf[TX_CHUNK];
+    uint64_t cpu_prev_ns = mp_thread_cpu_ns();
+    uint32_t cpu_sample_ctr = 0;
+
+    while (d->alive) {
+        if (++cpu_sample_ctr >= CPU_SAMPLE_EVERY_N_LOOPS) {
+            cpu_account(&d->perf.cpu_writer_ns, &cpu_prev_ns);
+            cpu_sample_ctr = 0;
+        }
+
+        mp_mutex_lock(&d->tx_mx);
+        while (d->alive && d->tx_head == d->tx_tail) mp_cond_wait_ms(&d->tx_cv, &d->tx_mx, 100);
+        size_t total = d->tx_head - d->tx_tail;
+        if (total > sizeof(buf)) total = sizeof(buf);
+        size_t at = d->tx_tail % d->tx_size;
+        size_t first = d->tx_size - at < total ? d->tx_size - at : total;
+        memcpy(buf, d->tx_data + at, first);
+        memcpy(buf + first, d->tx_data, total - first);
+        d->tx_tail += total;
+        mp_mutex_unlock(&d->tx_mx);
+
+        for (size_t off = 0; off < total && d->alive;) {
+            size_t n = tx_slice(buf + off, total - off);
+            while (d->io_urgent) mp_thread_yield();
+
+            mp_mutex_lock(&d->io_mx);
+            if (port_open(d)) {
+#ifdef _WIN32
+                (void)serial_write_win(d->h_port, buf + off, n, TX_WRITE_MS);
+#else
+                (void)serial_write_posix(d->fd, buf + off, n, TX_WRITE_MS, NULL);
+#endif
+                d->perf.tx_batches++;
+                d->perf.tx_bytes += (uint64_t)n;
+            } else {
+                d->perf.tx_dropped++;  // link down
+            }
+            mp_mutex_unlock(&d->io_mx);
+            off += n;
+        }
+    }
+    cpu_account(&d->perf.cpu_writer_ns, &cpu_prev_ns);
+    return NULL;
+}
+
+// ----------------- TX -----------------
+
+int p1150_write(p1150_t* d, const void* data, size_t n) {
+    if (n == 0) return 0;
+    if (!d->alive) return P1150_ESTOPPED;
+
+    mp_mutex_lock(&d->tx_mx);
+    if (n > d->tx_size - (d->tx_head - d->tx_tail)) {
+        d->perf.tx_dropped++;
+        mp_mutex_unlock(&d->tx_mx);
+        return P1150_EFULL;
+    }
+    size_t at = d->tx_head % d->tx_size;
+    size_t first = d->tx_size - at < n ? d->tx_size - at : n;
+    memcpy(d->tx_data + at, data, first);
+    memcpy(d->tx_data, (const uint8_t*)data + first, n - first);
+    d->tx_head += n;
+    mp_cond_broadcast(&d->tx_cv);
+    mp_mutex_unlock(&d->tx_mx);
+    return 0;
+}
+
+int p1150_frame(unsigned port, const void* payload, size_t n, uint8_t* out, size_t cap) {
+    if (port > 63 || n + 1 > P1150_FRAME_MAX) return P1150_EARG;
+    if (cap < 1 + (n + 1) + (n + 1) / 254 + 1 + 1 + 3) return P1150_ESIZE;
+
+    uint8_t stack_raw[512];
+    uint8_t* raw = n + 1 <= sizeof(stack_raw) ? stack_raw : (uint8_t*)malloc(n + 1);
+    if (!raw) return P1150_ENOMEM;
+    raw[0] = (uint8_t)((port << 2) | P1150_MUX_PORT);
+    memcpy(raw + 1, payload, n);
+
+    // 0x00 + COBS + 0x00, STM32 USB DMA CDC wants a multiple of 4 bytes
+    size_t m = 0;
+    out[m++] = 0x00;
+    m += cobs_encode(raw, n + 1, out + m);
+    out[m++] = 0x00;
+    while (m % 4) out[m++] = 0x00;
+    if (raw != stack_raw) free(raw);
+    return (int)m;
+}
+
+int p1150_send(p1150_t* d, unsigned port, const void* payload, size_t n) {
+    if (port > 63 || n + 1 > P1150_FRAME_MAX) return P1150_EARG;
+
+    uint8_t stack_enc[600];
+    size_t enc_cap = 1 + (n + 1) + (n + 1) / 254 + 1 + 1 + 3;
+    uint8_t* enc = enc_cap <= sizeof(stack_enc) ? stack_enc : (uint8_t*)malloc(enc_cap);
+    if (!enc) return P1150_ENOMEM;
+    int rc = p1150_frame(port, payload, n, enc, enc_cap);
+    if (rc > 0) rc = p1150_write(d, enc, (size_t)rc);
+    if (enc != stack_enc) free(enc);
+    return rc;
+}
+
+int p1150_cmd_adc(p1150_t* d, int enable) {
+    // CBOR {"f": "cmd_adc", "en": <bool>}
+    static const uint8_t cmd[] = { 0xa2, 0x61, 'f', 0x67, 'c', 'm', 'd', '_', 'a', 'd', 'c',
+                                   0x62, 'e', 'n', 0xf4 };
+    uint8_t buf[sizeof(cmd)];
+    memcpy(buf, cmd, sizeof(cmd));
+    if (enable) buf[sizeof(cmd) - 1] = 0xf5;
+    return p1150_send(d, 0, buf, sizeof(buf));
+}
+
+// Reader thread: a control action or sweep step.  Written directly instead of through
+// the TX queue, the command does not wait for the writer thread to wake up.  io_urgent
+// makes the writer yield io_mx after its current slice of whole frames, and the write
+// gives up after DIRECT_WRITE_MS so a port that stopped taking data does not stall the
+// reader.  wait_ns, if given, is the time spent waiting for the writer's slice or a
+// full port, 0 when the command went straight out.
+static int direct_write(p1150_t* d, const uint8_t* p, size_t n, uint64_t* wait_ns) {
+    int rc = P1150_ESTOPPED;
+    uint64_t waited = 0;
+    d->io_urgent = 1;
+    if (!mp_mutex_trylock(&d->io_mx)) {
+        uint64_t t0 = mp_now_ns();
+        mp_mutex_lock(&d->io_mx);
+        waited = mp_now_ns() - t0;
+    }
+    d->io_urgent = 0;
+    if (port_open(d)) {
+#ifdef _WIN32
+        int w = serial_write_win(d->h_port, p, n, DIRECT_WRITE_MS);
+#else
+        int w = serial_write_posix(d->fd, p, n, DIRECT_WRITE_MS, &waited);
+#endif
+        rc = w == (int)n ? 0 : P1150_EIO;
+        d->perf.tx_batches++;
+        d->perf.tx_bytes += (uint64_t)(w > 0 ? w : 0);
+    } else {
+        d->perf.tx_dropped++;  // link down
+    }
+    mp_mutex_unlock(&d->io_mx);
+    if (waited) d->perf.tx_direct_blocked++;
+    if (wait_ns) *wait_ns = waited;
+    return rc;
+}
+
+static int ctl_emit(void* ctx, const uint8_t* p, size_t n, uint64_t* wait_ns) {
+    p1150_t* d = (p1150_t*)ctx;
+    d->perf.ctl_actions++;
+    return direct_write(d, p, n, wait_ns);
+}
+
+static int sweep_emit(void* ctx, const uint8_t* p, size_t n, uint64_t* wait_ns) {
+    return direct_write((p1150_t*)ctx, p, n, wait_ns);
+}
+
+// ----------------- Lifecycle -----------------
+
+static void free_modules(p1150_t* d, int stage) {
+    if (stage > 12) plot_free(&d->plot);
+    if (stage > 11) sweep_free(&d->sweep);
+    if (stage > 10) seqcap_free(&d->seqcap);
+    if (stage > 9) hist_free(&d->hist);
+    if (stage > 8) ctl_free(&d->ctl);
+    if (stage > 7) mask_free(&d->mask);
+    if (stage > 6) sclock_free(&d->sclock);
+    if (stage > 5) recorder_free(&d->rec);
+    if (stage > 4) seg_free(&d->seg);
+    if (stage > 3) chist_free(&d->chist);
+    if (stage > 2) gated_free(&d->gated);
+    if (stage > 1) digital_free(&d->digital);
+    if (stage > 0) sample_ring_free(&d->sring);
+}
+
+int p1150_create(p1150_t** out, const char* port, const p1150_config_t* cfg) {
+    p1150_config_t def;
+    if (!cfg) {
+        p1150_config_default(&def);
+        cfg = &def;
+    }
+    *out = NULL;
+    if (!port) return P1150_EARG;
+    if (cfg->sample_ring_log2 && (cfg->sample_ring_log2 < SR_MIN_LOG2 || cfg->sample_ring_log2 > SR_MAX_LOG2)) return P1150_EARG;
+    if (cfg->digital_log2 && (cfg->digital_log2 < DIG_MIN_LOG2 || cfg->digital_log2 > DIG_MAX_LOG2)) return P1150_EARG;
+
+    p1150_t* d = (p1150_t*)calloc(1, sizeof(p1150_t));
+    if (!d) return P1150_ENOMEM;
+
+    int stage = 0, err;
+    if (sample_ring_init(&d->sring, cfg->sample_ring_log2) != 0) goto fail;
+    stage++;
+    if (digital_init(&d->digital, cfg->digital_log2) != 0) goto fail;
+    stage++;
+    err = gated_init(&d->gated);
+    stage++;
+    if (err) goto fail;
+    err = chist_init(&d->chist);
+    stage++;
+    if (err) goto fail;
+    err = seg_init(&d->seg);
+    stage++;
+    if (err) goto fail;
+    recorder_init(&d->rec);
+    stage++;
+    sclock_init(&d->sclock, ADC_SAMPLE_RATE_HZ);
+    stage++;
+    err = mask_init(&d->mask);
+    stage++;
+    if (err) goto fail;
+    err = ctl_init(&d->ctl, ctl_emit, d);
+    stage++;
+    if (err) goto fail;
+    hist_init(&d->hist);
+    stage++;
+    seqcap_init(&d->seqcap);
+    stage++;
+    sweep_init(&d->sweep, sweep_emit, d);
+    stage++;
+    plot_init(&d->plot);
+    stage++;
+
+    d->q_size = cfg->queue_bytes ? cfg->queue_bytes : P1150_QUEUE_DEFAULT;
+    d->tx_size = cfg->tx_bytes ? cfg->tx_bytes : P1150_TX_DEFAULT;
+    d->q_data = (uint8_t*)malloc(d->q_size);
+    d->tx_data = (uint8_t*)malloc(d->tx_size);
+    d->port = (char*)malloc(strlen(port) + 1);
+    if (!d->q_data || !d->tx_data || !d->port) goto fail;
+    strcpy(d->port, port);
+
+    d->baud = cfg->baud ? cfg->baud : 115200;
+    d->queue_adc = cfg->queue_adc;
+    d->reconnect = cfg->reconnect;
+    if (cfg->sn) strncpy(d->sn, cfg->sn, sizeof(d->sn) - 1);
+    strncpy(d->cur_port, port, sizeof(d->cur_port) - 1);
+#ifdef _WIN32
+    d->h_port = NULL;
+#else
+    d->fd = -1;
+#endif
+
+    mp_mutex_init(&d->mx);
+    mp_cond_init(&d->cv);
+    mp_mutex_init(&d->tx_mx);
+    mp_cond_init(&d->tx_cv);
+    mp_mutex_init(&d->io_mx);
+    pressure_init(&d->pressure);
+
+    *out = d;
+    return 0;
+
+fail:
+    free_modules(d, stage);
+    free(d->q_data);
+    free(d->tx_data);
+    free(d->port);
+    free(d);
+    return P1150_ENOMEM;
+}
+
+void p1150_destroy(p1150_t* d) {
+    if (!d) return;
+    p1150_stop(d);
+    free_modules(d, 13);
+    pressure_destroy(&d->pressure);
+    mp_mutex_destroy(&d->io_mx);
+    mp_cond_destroy(&d->tx_cv);
+    mp_mutex_destroy(&d->tx_mx);
+    mp_cond_destroy(&d->cv);
+    mp_mutex_destroy(&d->mx);
+    free(d->q_data);
+    free(d->tx_data);
+    free(d->port);
+    free(d);
+}
+
+int p1150_start(p1150_t* d) {
+    if (d->threads) return 0;
+#ifdef _WIN32
+    HANDLE h = open_serial_win(d->cur_port, d->baud);
+    if (h == INVALID_HANDLE_VALUE) return P1150_EOPEN;
+    d->h_port = h;
+#else
+    int fd = open_serial_posix(d->cur_port, d->baud);
+    if (fd < 0) return P1150_EOPEN;
+    d->fd = fd;
+#endif
+
+    // remember who we are talking to, so the same device can be found after re-enumeration
+    if (d->reconnect && !d->sn[0]) {
+        (void)hotplug_sn_for_port(d->cur_port, d->sn, sizeof(d->sn));
+    }
+    d->link_up = 1;
+    d->alive = 1;
+    d->sring.closed = 0;
+
+    if (mp_thread_start(&d->read_thread, reader_thread, d) != 0) {
+        p1150_stop(d);
+        return P1150_ETHREAD;
+    }
+    d->threads = 1;
+    if (mp_thread_start(&d->write_thread, writer_thread, d) != 0) {
+        p1150_stop(d);
+        return P1150_ETHREAD;
+    }
+    return 0;
+}
+
+void p1150_stop(p1150_t* d) {
+    d->alive = 0;
+
+    sample_ring_close(&d->sring);  // release consumers blocked in sample_ring_wait
+    recorder_stop(&d->rec);
+    seqcap_stop(&d->seqcap);
+    post_event(d, P1150_EV_STOPPED);
+    mp_mutex_lock(&d->tx_mx);
+    mp_cond_broadcast(&d->tx_cv);
+    mp_mutex_unlock(&d->tx_mx);
+
+#ifdef _WIN32
+    if (port_open(d)) {
+        SetCommMask(d->h_port, 0);
+        cancel_all_io_win(d->h_port);
+        EscapeCommFunction(d->h_port, CLRDTR);
+        EscapeCommFunction(d->h_port, CLRRTS);
+    }
+#endif
+    if (d->threads) {
+        mp_thread_join(&d->read_thread);
+        mp_thread_join(&d->write_thread);
+        d->threads = 0;
+    }
+#ifdef _WIN32
+    if (port_open(d)) close_serial_win(d->h_port);
+    d->h_port = NULL;
+#else
+    close_serial_posix(d->fd);
+    d->fd = -1;
+#endif
+    d->link_up = 0;
+}
+
+int p1150_running(p1150_t* d) {
+    // with reconnect the threads keep running while the port is away
+    if (!d->alive || !d->threads) return 0;
+    return d->reconnect || port_open(d);
+}
+
+// ----------------- State -----------------
+
+void p1150_perf(p1150_t* d, p1150_perf_t* out) {
+    *out = d->perf;
+}
+
+void p1150_link(p1150_t* d, p1150_link_t* out) {
+    memset(out, 0, sizeof(*out));
+    int up = d->link_up;
+    out->connected = up;
+    mp_mutex_lock(&d->io_mx);
+    snprintf(out->port, sizeof(out->port), "%s", d->cur_port);
+    mp_mutex_unlock(&d->io_mx);
+    snprintf(out->sn, sizeof(out->sn), "%s", d->sn);
+    out->disconnects = d->perf.disconnects;
+    out->reconnects = d->perf.reconnects;
+    out->down_ms = up ? 0 : mp_now_ms() - d->link_down_ms;
+    out->last_reconnect_ms = d->last_reconnect_ms;
+    out->max_reconnect_ms = d->max_reconnect_ms;
+}
+
+uint64_t p1150_samples(p1150_t* d) { return d->perf.adc_samples; }
+
+void p1150_memory(p1150_t* d, p1150_mem_t* out) {
+    memset(out, 0, sizeof(*out));
+    out->ring = d->sring.capacity * SR_SAMPLE_BYTES;
+    if (digital_enabled(&d->digital)) {
+        out->digital = DIG_LINES * (((uint64_t)1 << DIG_EDGES_LOG2) * sizeof(uint64_t) + d->digital.bits_capacity / 8);
+    }
+    out->queue = d->q_size;
+    out->tx = d->tx_size;
+    if (d->threads) out->threads = sizeof(rx_framer_t) + RX_CHUNK + TX_CHUNK;
+
+    hist_info_t hi;
+    hist_info(&d->hist, &hi);
+    out->history = hi.bytes;
+
+    recorder_t* r = &d->rec;
+    mp_mutex_lock(&r->mx);
+    if (r->st.running) {
+        out->recorder = (uint64_t)(r->cfg.pre + r->cfg.post) * REC_EVENT_BYTES_PER_SAMPLE
+                      + REC_BG_BLOCKS * sizeof(rec_bg_block_t);
+    }
+    mp_mutex_unlock(&r->mx);
+
+    mp_mutex_lock(&d->seqcap.mx);
+    for (int b = 0; b < SEQCAP_BUFS; b++) {
+        if (d->seqcap.buf[b].mem) out->seqcap += d->seqcap.bytes;
+    }
+    mp_mutex_unlock(&d->seqcap.mx);
+
+    plot_info_t pi;
+    plot_info(&d->plot, &pi);
+    out->plot = pi.bytes;
+
+    sweep_t* s = &d->sweep;
+    mp_mutex_lock(&s->mx);
+    if (s->n_steps) {
+        out->sweep = (uint64_t)s->n_steps * sizeof(sweep_step_t) + ((uint64_t)s->n_steps + 1) * sizeof(uint32_t)
+                   + s->cmd_off[s->n_steps];
+    }
+    mp_mutex_unlock(&s->mx);
+
+    out->device = sizeof(*d) + (d->port ? strlen(d->port) + 1 : 0);
+#define X(name) out->total += out->name;
+    P1150_MEM_FIELDS(X)
+#undef X
+}
+
+sample_ring_t* p1150_sample_ring(p1150_t* d) { return sample_ring_enabled(&d->sring) ? &d->sring : NULL; }
+digital_t*     p1150_digital(p1150_t* d)     { return digital_enabled(&d->digital) ? &d->digital : NULL; }
+gated_t*       p1150_gated(p1150_t* d)       { return &d->gated; }
+chist_t*       p1150_current_hist(p1150_t* d) { return &d->chist; }
+hist_t*        p1150_history(p1150_t* d)      { return &d->hist; }
+seg_t*         p1150_segments(p1150_t* d)    { return &d->seg; }
+recorder_t*    p1150_recorder(p1150_t* d)    { return &d->rec; }
+seqcap_t*      p1150_seqcap(p1150_t* d)      { return &d->seqcap; }
+sweep_t*       p1150_sweep(p1150_t* d)       { return &d->sweep; }
+plot_t*        p1150_plot(p1150_t* d)        { return &d->plot; }
+sclock_t*      p1150_sample_clock(p1150_t* d) { return &d->sclock; }
+mask_t*        p1150_mask(p1150_t* d)        { return &d->mask; }
+ctl_t*         p1150_control(p1150_t* d)     { return &d->ctl; }
+pressure_t*    p1150_pressure(p1150_t* d)    { return &d->pressure; }
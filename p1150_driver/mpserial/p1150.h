@@ -0,0 +1,225 @@
+// p1150.h
+// libp1150: the native P1150 serial core with a plain C API, no Python involved.
+//
+// A p1150_t owns the serial port and two threads:
+//   reader - COBS framing, every ADC frame decoded into the sample ring and the
+//            analysis modules (digital, gated, histogram, segmentation, mask test,
+//            sample clock), every frame also queued raw for p1150_frame_pop()
+//            (command responses, logs, ...); control rules (control.h) are evaluated
+//            first and write their commands to the port directly
+//   writer - drains the TX queue filled by p1150_write() / p1150_send() and
+//            coalesces it into as few OS writes as possible
+// plus optional hot-plug reconnect and backlog (pressure) telemetry.
+//
+// mp_serial_ext is a thin Python wrapper over this API.  C/C++ programs link
+// libp1150.a / libp1150.so (see Makefile) and read samples in place from the sample
+// ring, see examples/p1150_stream.cpp.  The module headers (sample_ring.h, digital.h,
+// ...) are part of the API, p1150_sample_ring() etc. return the device's instances.
+//
+// Functions return 0 / a count on success and a negative P1150_E* code on failure.
+#ifndef MP_SERIAL_P1150_H
+#define MP_SERIAL_P1150_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sample_ring.h"
+#include "digital.h"
+#include "gated.h"
+#include "current_hist.h"
+#include "history.h"
+#include "segment.h"
+#include "recorder.h"
+#include "rec_search.h"
+#include "seqcap.h"
+#include "sweep.h"
+#include "plot.h"
+#include "sample_clock.h"
+#include "mask.h"
+#include "control.h"
+#include "decode_pool.h"
+#include "pressure.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define P1150_EARG      (-1)   // bad argument or configuration
+#define P1150_ENOMEM    (-2)
+#define P1150_EOPEN     (-3)   // serial port could not be opened
+#define P1150_EFULL     (-4)   // TX queue full
+#define P1150_ESTOPPED  (-5)   // not started, or stopped
+#define P1150_ESIZE     (-6)   // frame larger than the buffer given
+#define P1150_ETHREAD   (-7)
+#define P1150_EIO       (-8)   // serial write failed
+
+#define P1150_FRAME_MAX      65536
+#define P1150_QUEUE_DEFAULT  (1024u * 1024u)   // raw frame queue, bytes
+#define P1150_TX_DEFAULT     (256u * 1024u)    // TX queue, bytes
+
+// Cumulative counters since p1150_create()
+#define P1150_PERF_COUNTERS(X)  \
+    X(rx_bytes)                 \
+    X(rx_frames)                \
+    X(cobs_decode_errors)       \
+    X(ring_push_dropped)        \
+    X(ring_dropped)             \
+    X(delivered_frames)         \
+    X(delivered_bytes)          \
+    X(tx_batches)               \
+    X(tx_bytes)                 \
+    X(rx_idle_loops)            \
+    X(cpu_reader_ns)            \
+    X(cpu_writer_ns)            \
+    X(cpu_deliver_ns)           \
+    X(tx_dropped)               \
+    X(disconnects)              \
+    X(reconnects)               \
+    X(adc_frames)               \
+    X(adc_samples)              \
+    X(adc_parse_errors)         \
+    X(pressure_warnings)        \
+    X(ctl_actions)              \
+    X(tx_direct_blocked)
+
+typedef struct {
+#define X(name) uint64_t name;
+    P1150_PERF_COUNTERS(X)
+#undef X
+} p1150_perf_t;
+
+typedef struct {
+    int         baud;              // 115200
+    const char* sn;                // USB serial number to re-find the device, NULL: from sysfs
+    int         reconnect;         // reopen the same device in place after a disconnect
+    unsigned    sample_ring_log2;  // 0 off, else SR_MIN_LOG2..SR_MAX_LOG2
+    unsigned    digital_log2;      // 0 off, else DIG_MIN_LOG2..DIG_MAX_LOG2
+    size_t      queue_bytes;       // raw frame queue, 0: P1150_QUEUE_DEFAULT
+    size_t      tx_bytes;          // TX queue, 0: P1150_TX_DEFAULT
+    int         queue_adc;         // also queue ADC frames raw (the Python pipeline decodes
+                                   // them again), 0 when only the sample ring is read
+} p1150_config_t;
+
+typedef struct {
+    int      connected;
+    char     port[256];
+    char     sn[64];
+    uint64_t disconnects;
+    uint64_t reconnects;
+    uint64_t down_ms;
+    uint64_t last_reconnect_ms;
+    uint64_t max_reconnect_ms;
+} p1150_link_t;
+
+// Bytes held per subsystem (p1150_memory()), what is allocated now, 0 when off
+#define P1150_MEM_FIELDS(X) \
+    X(ring)                 /* ADC sample ring columns */ \
+    X(digital)              /* D0/D1 edge lists + packed bits */ \
+    X(queue)                /* raw frame queue */ \
+    X(tx)                   /* TX queue */ \
+    X(threads)              /* reader framer + reader/writer stack buffers */ \
+    X(history)              /* multi-resolution history levels */ \
+    X(recorder)             /* event window + background blocks, while recording */ \
+    X(seqcap)               /* segmented capture sequence blocks */ \
+    X(plot)                 /* debug plotter channel rings */ \
+    X(sweep)                /* sweep commands + step results */ \
+    X(device)               /* struct p1150 itself */
+
+typedef struct {
+#define X(name) uint64_t name;
+    P1150_MEM_FIELDS(X)
+#undef X
+    uint64_t total;
+} p1150_mem_t;
+
+typedef struct p1150 p1150_t;
+
+void        p1150_config_default(p1150_config_t* cfg);
+const char* p1150_strerror(int err);
+
+// Allocate a device and its modules, the port is not opened yet
+int  p1150_create(p1150_t** out, const char* port, const p1150_config_t* cfg);
+void p1150_destroy(p1150_t* d);                // stops first
+
+// Open the port and start the threads; no-op when running
+int  p1150_start(p1150_t* d);
+// Stop the threads and close the port; blocked waiters return
+void p1150_stop(p1150_t* d);
+// Threads running (and with reconnect off, the port open)
+int  p1150_running(p1150_t* d);
+
+// ----------------- TX -----------------
+
+// Queue bytes that are already framed (COBS, 0x00 delimited) as they are
+int  p1150_write(p1150_t* d, const void* data, size_t n);
+// Frame payload for a ucLog port: mux byte, COBS, delimiters, padded to 4 bytes
+int  p1150_send(p1150_t* d, unsigned port, const void* payload, size_t n);
+// {"f": "cmd_adc", "en": enable} on port 0, starts/stops the ADC stream
+int  p1150_cmd_adc(p1150_t* d, int enable);
+// Frame payload like p1150_send() into out without sending it (control actions);
+// returns the framed length, P1150_ESIZE when cap is too small
+int  p1150_frame(unsigned port, const void* payload, size_t n, uint8_t* out, size_t cap);
+
+// ----------------- RX: raw frames and events -----------------
+
+#define P1150_EV_FRAME     0x1u   // frames queued
+#define P1150_EV_LINK      0x2u   // link went down or came back, see p1150_link()
+#define P1150_EV_PRESSURE  0x4u   // pressure warning set or cleared
+#define P1150_EV_STOPPED   0x8u
+
+// Block until a frame is queued, an event is pending, stop or timeout; returns the
+// P1150_EV_* bits, LINK and PRESSURE are reported once
+unsigned p1150_wait(p1150_t* d, unsigned timeout_ms);
+
+// Pop one COBS-decoded frame (mux byte first); returns its length, 0 when the queue
+// is empty, P1150_ESIZE (frame dropped) when cap is too small
+int  p1150_frame_pop(p1150_t* d, uint8_t* buf, size_t cap);
+
+// Pop up to max_frames whole frames as <u16 len><frame> records into buf (one lock for
+// the batch, see decode_pool.h); returns the frames popped, *used the bytes written
+int  p1150_frames_pop(p1150_t* d, uint8_t* buf, size_t cap, size_t max_frames, size_t* used);
+
+// The application has consumed n popped frames, enables consumer lag in the pressure
+void p1150_consumed(p1150_t* d, uint64_t n);
+
+// ucLog mux: the first byte of a frame is (port << 2) | type
+#define P1150_MUX_PORT   3      // LOG_TYPE_PORT, payload for stream <port>
+typedef struct {
+    int            type;        // (mux & 3), P1150_MUX_PORT or a log record
+    unsigned       port;        // P1150_MUX_PORT: stream number
+    unsigned       target;      // log record: target digit of addr
+    uint32_t       addr;        // log record: format address
+    const uint8_t* p;           // payload (view into the frame)
+    size_t         n;
+} p1150_mux_t;
+
+// Split a popped frame; 0 on success, P1150_EARG if too short
+int  p1150_mux_split(const uint8_t* frame, size_t n, p1150_mux_t* m);
+
+// ----------------- State -----------------
+
+void     p1150_perf(p1150_t* d, p1150_perf_t* out);
+void     p1150_link(p1150_t* d, p1150_link_t* out);
+uint64_t p1150_samples(p1150_t* d);            // stream sample index (ADC samples parsed)
+void     p1150_memory(p1150_t* d, p1150_mem_t* out);
+
+sample_ring_t* p1150_sample_ring(p1150_t* d);  // NULL when disabled
+digital_t*     p1150_digital(p1150_t* d);      // NULL when disabled
+gated_t*       p1150_gated(p1150_t* d);
+chist_t*       p1150_current_hist(p1150_t* d);
+hist_t*        p1150_history(p1150_t* d);
+seg_t*         p1150_segments(p1150_t* d);
+recorder_t*    p1150_recorder(p1150_t* d);
+seqcap_t*      p1150_seqcap(p1150_t* d);
+sweep_t*       p1150_sweep(p1150_t* d);
+plot_t*        p1150_plot(p1150_t* d);
+sclock_t*      p1150_sample_clock(p1150_t* d);
+mask_t*        p1150_mask(p1150_t* d);
+ctl_t*         p1150_control(p1150_t* d);
+pressure_t*    p1150_pressure(p1150_t* d);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_P1150_H
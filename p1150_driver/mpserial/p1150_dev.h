@@ -0,0 +1,122 @@
+// p1150_dev.h
+// struct p1150, private to libp1150 and its in-tree wrapper mp_serial_ext.c.
+// Applications use p1150.h only.
+#ifndef MP_SERIAL_P1150_DEV_H
+#define MP_SERIAL_P1150_DEV_H
+
+#include "p1150.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct p1150 {
+    char*            port;
+    int              baud;
+    int              queue_adc;
+
+    volatile int     alive;            // reader/writer threads run
+    mp_thread_t      read_thread;
+    mp_thread_t      write_thread;
+    int              threads;          // started
+
+#ifdef _WIN32
+    HANDLE           h_port;
+#else
+    int              fd;
+#endif
+
+    p1150_perf_t     perf;
+
+    // Raw frame queue (reader -> p1150_frame_pop), <u16 len><frame> records.
+    // mx/cv also carry the events for p1150_wait().
+    uint8_t*         q_data;
+    size_t           q_size;           // bytes
+    size_t           q_head;           // continuous write index
+    size_t           q_tail;           // continuous read index
+    size_t           q_frames;         // frames queued (deliver lag)
+    unsigned         events;           // P1150_EV_LINK / P1150_EV_PRESSURE pending
+    int              waiters;
+    mp_mutex_t       mx;
+    mp_cond_t        cv;
+
+    // TX queue (p1150_write -> writer thread), plain bytes
+    uint8_t*         tx_data;
+    size_t           tx_size;
+    size_t           tx_head;
+    size_t           tx_tail;
+    mp_mutex_t       tx_mx;
+    mp_cond_t        tx_cv;
+
+    // Hot-plug reconnect: the reader thread swaps the port in place under io_mx,
+    // threads, rings and stats all stay alive across the outage
+    int              reconnect;
+    char             sn[64];           // USB serial number, used to re-find the device
+    char             cur_port[256];    // may differ from port after re-enumeration
+    volatile int     link_up;
+    uint64_t         link_down_ms;
+    uint64_t         last_reconnect_ms;
+    uint64_t         max_reconnect_ms;
+    mp_mutex_t       io_mx;
+    volatile int     io_urgent;        // reader thread waits for io_mx, the writer yields
+
+    // Backlog telemetry: firmware "a" is parsed natively from each ADC frame, the
+    // reader thread samples all backlogs every PRESSURE_PERIOD_MS (see pressure.h)
+    pressure_t       pressure;
+    volatile uint32_t fw_backlog;
+    uint32_t         fw_backlog_peak;
+    volatile uint64_t consumed_frames;  // acknowledged by the consumer
+    volatile int     consumer_acks;     // consumer lag is only known once it acks
+    uint64_t         pressure_next_ms;
+    uint64_t         pressure_last_ms;
+    uint64_t         pressure_last_frames;
+    double           frames_per_s;
+
+    // Shared ADC sample ring, decoded by the reader thread, read in place by any
+    // number of consumers (see sample_ring.h)
+    sample_ring_t    sring;
+
+    // D0/D1 edge lists + packed bits, indexed by stream sample index (perf.adc_samples)
+    digital_t        digital;
+
+    // D0/D1 gated current statistics, per state and per pulse
+    gated_t          gated;
+
+    // log-binned i/isnk distribution, total + time slots
+    chist_t          chist;
+    hist_t           hist;
+
+    // power state segmentation of i
+    seg_t            seg;
+
+    // event-triggered recorder, follows the sample ring
+    recorder_t       rec;
+
+    // segmented memory capture, follows the sample ring
+    seqcap_t         seqcap;
+
+    // VOUT sweep sequencer, steps run by the reader thread
+    sweep_t          sweep;
+
+    // firmware debug plotter (port 2) channels, fed by the reader thread
+    plot_t           plot;
+
+    // frame counter -> absolute sample index, device/host clock fit
+    sclock_t         sclock;
+
+    // pass/fail mask test, evaluated per frame
+    mask_t           mask;
+
+    // closed-loop control rules, evaluated first, actions written by the reader thread
+    ctl_t            ctl;
+    uint64_t         rx_ns;            // reader: when the bytes being framed were read
+};
+
+// Raw frame queue occupancy, bytes and frames (takes mx)
+void p1150_queue_used(p1150_t* d, size_t* bytes, size_t* frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_P1150_DEV_H
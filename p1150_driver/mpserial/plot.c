@@ -0,0 +1,210 @@
+// plot.c
+#include "plot.h"
+
+#include <math.h>
+#include <string.h>
+
+void plot_init(plot_t* p) {
+    memset(p, 0, sizeof(*p));
+    mp_mutex_init(&p->mx);
+}
+
+static void free_channels(plot_t* p) {
+    free(p->mem);
+    p->mem = NULL;
+    memset(p->ch, 0, sizeof(p->ch));
+    p->max_channels = p->n_channels = 0;
+    p->capacity = 0;
+    p->items = p->errors = p->unbound = 0;
+}
+
+void plot_free(plot_t* p) {
+    free_channels(p);
+    mp_mutex_destroy(&p->mx);
+}
+
+int plot_config(plot_t* p, uint32_t max_channels, uint64_t capacity, int forward) {
+    if (max_channels > PLOT_MAX_CHANNELS || (max_channels && capacity == 0)) return -1;
+    if (max_channels && capacity > SIZE_MAX / sizeof(plot_point_t) / max_channels) return -1;
+
+    // allocated outside the lock, the reader thread keeps feeding the old rings meanwhile
+    plot_point_t* mem = NULL;
+    if (max_channels) {
+        mem = (plot_point_t*)malloc((size_t)max_channels * (size_t)capacity * sizeof(plot_point_t));
+        if (!mem) {
+            mp_mutex_lock(&p->mx);
+            free_channels(p);
+            mp_mutex_unlock(&p->mx);
+            return -2;
+        }
+    }
+
+    mp_mutex_lock(&p->mx);
+    free_channels(p);
+    p->mem = mem;
+    p->max_channels = max_channels;
+    p->capacity = max_channels ? capacity : 0;
+    for (uint32_t k = 0; k < max_channels; k++) p->ch[k].pts = mem + (size_t)k * (size_t)capacity;
+    p->forward = forward;
+    mp_mutex_unlock(&p->mx);
+    return 0;
+}
+
+// ----------------- Feeding (reader thread, lock held) -----------------
+
+static plot_chan_t* bind(plot_t* p, const uint8_t* name, size_t len) {
+    if (len >= PLOT_NAME_MAX) len = PLOT_NAME_MAX - 1;
+    for (uint32_t k = 0; k < p->n_channels; k++) {
+        plot_chan_t* c = &p->ch[k];
+        if (strncmp(c->name, (const char*)name, len) == 0 && c->name[len] == '\0') return c;
+    }
+    if (p->n_channels == p->max_channels) return NULL;
+    plot_chan_t* c = &p->ch[p->n_channels++];
+    memcpy(c->name, name, len);
+    c->name[len] = '\0';
+    return c;
+}
+
+static void on_value(void* ctx, const uint8_t* name, size_t name_len, const float* v, size_t n,
+                     size_t off, size_t total) {
+    plot_t* p = (plot_t*)ctx;
+    plot_chan_t* c = bind(p, name, name_len);
+    if (!c) {
+        p->unbound += n;
+        return;
+    }
+    if (off == 0) {
+        // the first item of a channel has nothing to spread over
+        c->spread_from = c->items && total > 1 ? c->last_seq : p->seq;
+        c->spread_to = p->seq;
+    }
+    const uint64_t span = c->spread_to - c->spread_from;
+    for (size_t k = 0; k < n; k++) {
+        plot_point_t* q = &c->pts[c->done % p->capacity];
+        const uint64_t j = off + k + 1;
+        q->seq = span ? c->spread_from + (uint64_t)((double)span * (double)j / (double)total) : c->spread_to;
+        q->value = v[k];
+        q->item = (uint32_t)p->items;
+        c->done++;
+    }
+    if (off + n == total) {
+        c->last_seq = p->seq;
+        c->items++;
+    }
+}
+
+int plot_feed(plot_t* p, const uint8_t* buf, size_t len, uint64_t seq) {
+    if (!plot_enabled(p)) return 0;
+    mp_mutex_lock(&p->mx);
+    int rv = 0;
+    if (plot_enabled(p)) {
+        p->seq = seq;
+        rv = plot_item_parse(buf, len, on_value, p);
+        if (rv != 0) p->errors++;
+        p->items++;
+    }
+    mp_mutex_unlock(&p->mx);
+    return rv;
+}
+
+// ----------------- Readers -----------------
+
+void plot_info(plot_t* p, plot_info_t* out) {
+    mp_mutex_lock(&p->mx);
+    out->max_channels = p->max_channels;
+    out->n_channels = p->n_channels;
+    out->capacity = p->capacity;
+    out->items = p->items;
+    out->errors = p->errors;
+    out->unbound = p->unbound;
+    out->bytes = (uint64_t)p->max_channels * p->capacity * sizeof(plot_point_t);
+    out->forward = p->forward;
+    mp_mutex_unlock(&p->mx);
+}
+
+int plot_channel(plot_t* p, const char* name) {
+    int ch = -1;
+    mp_mutex_lock(&p->mx);
+    for (uint32_t k = 0; k < p->n_channels && ch < 0; k++) {
+        if (strncmp(p->ch[k].name, name, PLOT_NAME_MAX - 1) == 0) ch = (int)k;
+    }
+    mp_mutex_unlock(&p->mx);
+    return ch;
+}
+
+int plot_channel_info(plot_t* p, int ch, char* name, uint64_t* done, uint64_t* items, uint64_t* last_seq) {
+    int rv = -1;
+    mp_mutex_lock(&p->mx);
+    if (ch >= 0 && (uint32_t)ch < p->n_channels) {
+        const plot_chan_t* c = &p->ch[ch];
+        memcpy(name, c->name, PLOT_NAME_MAX);
+        *done = c->done;
+        *items = c->items;
+        *last_seq = c->last_seq;
+        rv = 0;
+    }
+    mp_mutex_unlock(&p->mx);
+    return rv;
+}
+
+size_t plot_read(plot_t* p, int ch, uint64_t since, plot_point_t* out, size_t cap, uint64_t* first) {
+    size_t cnt = 0;
+    mp_mutex_lock(&p->mx);
+    *first = 0;
+    if (ch >= 0 && (uint32_t)ch < p->n_channels) {
+        const plot_chan_t* c = &p->ch[ch];
+        const uint64_t lo = c->done > p->capacity ? c->done - p->capacity : 0;
+        uint64_t k = since;
+        if (since == PLOT_LAST) k = c->done > cap ? c->done - cap : 0;
+        if (k < lo) k = lo;
+        *first = k;
+        for (; k < c->done && cnt < cap; k++) out[cnt++] = c->pts[k % p->capacity];
+    }
+    mp_mutex_unlock(&p->mx);
+    return cnt;
+}
+
+uint64_t plot_lod(plot_t* p, int ch, uint64_t seq0, uint64_t seq1, plot_bucket_t* out, size_t n) {
+    for (size_t b = 0; b < n; b++) {
+        out[b].min = out[b].max = out[b].mean = NAN;
+        out[b].n = 0;
+    }
+    if (n == 0 || seq1 <= seq0) return 0;
+
+    uint64_t folded = 0;
+    mp_mutex_lock(&p->mx);
+    if (ch >= 0 && (uint32_t)ch < p->n_channels) {
+        const plot_chan_t* c = &p->ch[ch];
+        uint64_t lo = c->done > p->capacity ? c->done - p->capacity : 0, hi = c->done;
+        // points are in stream order, first one at or after seq0
+        while (lo < hi) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            if (c->pts[mid % p->capacity].seq < seq0) lo = mid + 1;
+            else hi = mid;
+        }
+        const double scale = (double)n / (double)(seq1 - seq0);
+        double sum = 0.0;
+        size_t cur = SIZE_MAX;
+        for (uint64_t k = lo; k < c->done; k++) {
+            const plot_point_t* q = &c->pts[k % p->capacity];
+            if (q->seq >= seq1) break;
+            if (isnan(q->value)) continue;
+            size_t b = (size_t)((double)(q->seq - seq0) * scale);
+            if (b >= n) b = n - 1;
+            if (b != cur) {
+                if (cur != SIZE_MAX) out[cur].mean = (float)(sum / out[cur].n);
+                cur = b;
+                sum = 0.0;
+            }
+            plot_bucket_t* o = &out[b];
+            if (o->n == 0 || q->value < o->min) o->min = q->value;
+            if (o->n == 0 || q->value > o->max) o->max = q->value;
+            sum += q->value;
+            o->n++;
+            folded++;
+        }
+        if (cur != SIZE_MAX) out[cur].mean = (float)(sum / out[cur].n);
+    }
+    mp_mutex_unlock(&p->mx);
+    return folded;
+}
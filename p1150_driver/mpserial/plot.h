@@ -0,0 +1,113 @@
+// plot.h
+// Firmware debug plotter stream (ucLog port 2) decoded into named channel rings.
+//
+// Every port 2 item is a CBOR map of channel name to samples (plot_item_parse()).  The
+// reader thread appends the samples of each channel to its own ring of points,
+// preallocated by plot_config() for up to max_channels names, bound in order of first
+// appearance.  Points are stamped with the stream sample index, the time axis of the
+// ADC channels, so firmware variables line up with the current: the samples a channel
+// sent in one item are spread evenly over the stream samples since its previous item
+// (the firmware batches what it sampled meanwhile), a single sample is placed at the
+// arrival.  Readers copy points since a number (plot_read()) or min/max/mean buckets
+// over a stream range (plot_lod()), nothing reaches Python per item unless forwarded.
+#ifndef MP_SERIAL_PLOT_H
+#define MP_SERIAL_PLOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mp_platform.h"
+#include "adc_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PLOT_PORT          2
+#define PLOT_MUX_BYTE      ((PLOT_PORT << 2) | 3)
+#define PLOT_MAX_CHANNELS  64
+#define PLOT_NAME_MAX      32          // including the terminator, longer names are cut
+#define PLOT_LAST          UINT64_MAX  // plot_read(): the newest points
+
+typedef struct {                // 16 bytes, read by Python
+    uint64_t seq;               // stream sample index
+    float    value;
+    uint32_t item;              // port 2 item number, groups the samples sent together
+} plot_point_t;
+
+typedef struct {                // 16 bytes, read by Python
+    float    min;
+    float    max;
+    float    mean;
+    uint32_t n;                 // points in the bucket, 0 empty (NaN min/max/mean)
+} plot_bucket_t;
+
+typedef struct {
+    char          name[PLOT_NAME_MAX];
+    plot_point_t* pts;          // capacity points, in the shared block
+    uint64_t      done;         // points written since the configuration
+    uint64_t      items;
+    uint64_t      last_seq;     // stream sample index of the previous item
+    uint64_t      spread_from;  // item in progress: samples spread over (from, to]
+    uint64_t      spread_to;
+} plot_chan_t;
+
+typedef struct {
+    uint32_t max_channels;
+    uint32_t n_channels;
+    uint64_t capacity;          // points per channel, 0 plotter off
+    uint64_t items;             // port 2 items decoded
+    uint64_t errors;            // malformed items
+    uint64_t unbound;           // samples of names beyond max_channels
+    uint64_t bytes;
+    int      forward;
+} plot_info_t;
+
+typedef struct {
+    plot_chan_t   ch[PLOT_MAX_CHANNELS];
+    uint32_t      max_channels;
+    uint32_t      n_channels;
+    uint64_t      capacity;
+    plot_point_t* mem;
+    volatile int  forward;      // the items still go to Python as well
+    uint64_t      items, errors, unbound;
+
+    // item being fed (reader thread)
+    uint64_t      seq;
+    mp_mutex_t    mx;           // reader thread feeds, Python configures/reads
+} plot_t;
+
+void plot_init(plot_t* p);
+void plot_free(plot_t* p);
+
+// Replace the channels (all unbound, points dropped) with max_channels rings of capacity
+// points each; max_channels 0 turns the plotter off.  0, -1 bad arguments, -2 allocation
+// (plotter off)
+int  plot_config(plot_t* p, uint32_t max_channels, uint64_t capacity, int forward);
+static inline int plot_enabled(const plot_t* p) { return p->capacity != 0; }
+
+// Reader thread: one port 2 item (mux byte stripped) arriving at stream sample index seq.
+// 0, -1 malformed
+int  plot_feed(plot_t* p, const uint8_t* buf, size_t len, uint64_t seq);
+
+void plot_info(plot_t* p, plot_info_t* out);
+
+// Channel index of name, -1 not seen (yet)
+int  plot_channel(plot_t* p, const char* name);
+
+// Name, points written and last item stream index of channel ch; 0, -1 no such channel
+int  plot_channel_info(plot_t* p, int ch, char* name, uint64_t* done, uint64_t* items, uint64_t* last_seq);
+
+// Points of channel ch numbered since and later (PLOT_LAST: the newest cap), clipped to
+// the retained ones; *first is the number of out[0].  Returns the count.
+size_t plot_read(plot_t* p, int ch, uint64_t since, plot_point_t* out, size_t cap, uint64_t* first);
+
+// Level of detail: the retained points of channel ch in stream samples [seq0, seq1)
+// folded into n equal buckets.  Returns the points folded.
+uint64_t plot_lod(plot_t* p, int ch, uint64_t seq0, uint64_t seq1, plot_bucket_t* out, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_PLOT_H
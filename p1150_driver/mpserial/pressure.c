@@ -0,0 +1,78 @@
+// pressure.c
+#include "pressure.h"
+
+#include <string.h>
+
+void pressure_init(pressure_t* p) {
+    memset(p, 0, sizeof(*p));
+    // firmware warns at 4096 and is in trouble by 32768, loss shortly after
+    p->cfg.fw_backlog_max   = 65536;
+    p->cfg.consumer_lag_max = 25000;   // 10 s at 2500 frames/s
+    p->cfg.warn_level       = 0.5;
+    p->cfg.clear_level      = 0.25;
+    p->cfg.horizon_ms       = 2000;
+    p->eta_ms = PRESSURE_ETA_NONE;
+    mp_mutex_init(&p->mx);
+}
+
+void pressure_destroy(pressure_t* p) {
+    mp_mutex_destroy(&p->mx);
+}
+
+static float frac(uint32_t v, uint32_t max) {
+    if (max == 0) return 0.0f;
+    float f = (float)v / (float)max;
+    return f > 1.0f ? 1.0f : f;
+}
+
+// Least-squares slope of the last PRESSURE_TREND_N samples, per second
+static float trend_slope(const pressure_t* p) {
+    uint64_t n = p->n < PRESSURE_TREND_N ? p->n : PRESSURE_TREND_N;
+    if (n < 3) return 0.0f;
+
+    const pressure_sample_t* last = &p->hist[(p->n - 1) % PRESSURE_HISTORY];
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (uint64_t k = 0; k < n; k++) {
+        const pressure_sample_t* s = &p->hist[(p->n - 1 - k) % PRESSURE_HISTORY];
+        double x = -(double)(last->t_ms - s->t_ms) / 1000.0;
+        double y = s->pressure;
+        sx += x; sy += y; sxx += x * x; sxy += x * y;
+    }
+    double den = (double)n * sxx - sx * sx;
+    if (den <= 0.0) return 0.0f;
+    return (float)(((double)n * sxy - sx * sy) / den);
+}
+
+int pressure_add(pressure_t* p, pressure_sample_t* s, uint32_t ring_size) {
+    mp_mutex_lock(&p->mx);
+    float pr = frac(s->fw_backlog, p->cfg.fw_backlog_max);
+    float r  = frac(s->ring_used, ring_size);
+    float c  = frac(s->consumer_lag, p->cfg.consumer_lag_max);
+    if (r > pr) pr = r;
+    if (c > pr) pr = c;
+    s->pressure = pr;
+
+    p->hist[p->n % PRESSURE_HISTORY] = *s;
+    p->n++;
+    if (pr > p->peak) p->peak = pr;
+
+    p->slope = trend_slope(p);
+    p->eta_ms = PRESSURE_ETA_NONE;
+    if (p->slope > 1e-4f) {
+        double eta = (1.0 - pr) / p->slope * 1000.0;
+        p->eta_ms = eta < (double)UINT32_MAX ? (uint32_t)eta : PRESSURE_ETA_NONE;
+    }
+
+    int trending = pr >= PRESSURE_TREND_FLOOR && p->eta_ms <= p->cfg.horizon_ms;
+    int warn = p->warn;
+    if (!warn && (pr >= p->cfg.warn_level || trending)) {
+        warn = 1;
+        p->warn_events++;
+    } else if (warn && pr < p->cfg.clear_level && !trending) {
+        warn = 0;
+    }
+    int changed = warn != p->warn;
+    p->warn = warn;
+    mp_mutex_unlock(&p->mx);
+    return changed;
+}
@@ -0,0 +1,71 @@
+// pressure.h
+// Pipeline backlog telemetry.
+//
+// Every stage between the ADC and the application can fall behind:
+//   firmware  - "a" field of each ADC frame, the device side backlog
+//   ring      - native byte ring between reader and deliver threads
+//   deliver   - frames in the ring, not yet handed to Python
+//   consumer  - frames handed to Python, not yet acknowledged by the consumer
+// The reader thread samples all of them at a fixed period into a time series and
+// folds them into one "pressure" value: the worst stage as a fraction of the point
+// where it starts losing data (0 = idle, 1 = loss).  A least-squares slope over the
+// last second predicts when 1 will be reached, so the application can shed load
+// before anything is dropped.
+#ifndef MP_SERIAL_PRESSURE_H
+#define MP_SERIAL_PRESSURE_H
+
+#include <stdint.h>
+
+#include "mp_platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PRESSURE_PERIOD_MS     100
+#define PRESSURE_HISTORY       600     // 60 s at PRESSURE_PERIOD_MS
+#define PRESSURE_TREND_N       10      // samples in the slope fit
+#define PRESSURE_TREND_FLOOR   0.1f    // no trend warnings below this pressure
+#define PRESSURE_ETA_NONE      UINT32_MAX
+
+typedef struct {
+    uint64_t t_ms;
+    uint32_t fw_backlog;
+    uint32_t ring_used;       // bytes
+    uint32_t deliver_lag;     // frames
+    uint32_t consumer_lag;    // frames
+    float    pressure;
+} pressure_sample_t;
+
+typedef struct {
+    uint32_t fw_backlog_max;    // firmware backlog where the device starts dropping
+    uint32_t consumer_lag_max;  // frames the consumer may fall behind
+    double   warn_level;        // enter warning at/above this pressure
+    double   clear_level;       // leave warning below this pressure
+    uint32_t horizon_ms;        // or when loss is predicted within this time
+} pressure_cfg_t;
+
+typedef struct {
+    pressure_cfg_t    cfg;
+    mp_mutex_t        mx;       // reader thread writes, Python reads
+    pressure_sample_t hist[PRESSURE_HISTORY];
+    uint64_t          n;        // samples written
+    float             slope;    // pressure per second
+    uint32_t          eta_ms;   // predicted time to 1.0, PRESSURE_ETA_NONE if not rising
+    float             peak;
+    int               warn;
+    uint64_t          warn_events;
+} pressure_t;
+
+void pressure_init(pressure_t* p);
+void pressure_destroy(pressure_t* p);
+
+// Record one sample, s->pressure is computed here.  Returns 1 if the warning
+// state changed.  ring_size is the native ring capacity in bytes.
+int  pressure_add(pressure_t* p, pressure_sample_t* s, uint32_t ring_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_PRESSURE_H
@@ -0,0 +1,260 @@
+// prom_export.c
+#include "prom_export.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #include <winsock2.h>
+  #include <ws2tcpip.h>
+  #include <windows.h>
+  #define sock_close closesocket
+#else
+  #include <unistd.h>
+  #include <errno.h>
+  #include <sys/types.h>
+  #include <sys/socket.h>
+  #include <sys/select.h>
+  #include <sys/un.h>
+  #include <netdb.h>
+  #include <netinet/in.h>
+  #define sock_close close
+#endif
+
+// A scraper that hangs up mid-reply must not raise SIGPIPE in the host process:
+// MSG_NOSIGNAL per send where it exists, SO_NOSIGPIPE on the socket on macOS/BSD
+#ifdef MSG_NOSIGNAL
+  #define PROM_SEND_FLAGS MSG_NOSIGNAL
+#else
+  #define PROM_SEND_FLAGS 0
+#endif
+
+// ----------------- Formatting -----------------
+
+typedef struct {
+    char*  buf;
+    size_t cap;
+    size_t len;
+} prom_out_t;
+
+static void out_printf(prom_out_t* o, const char* fmt, ...) {
+    if (o->len >= o->cap) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(o->buf + o->len, o->cap - o->len, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    o->len += (size_t)n;
+    if (o->len >= o->cap) o->len = o->cap - 1;  // truncated
+}
+
+// Metric names may only contain [a-zA-Z0-9_]
+static void sanitize_name(const char* in, char* out, size_t cap) {
+    size_t j = 0;
+    for (size_t i = 0; in[i] && j + 1 < cap; i++) {
+        char c = in[i];
+        int ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+        out[j++] = ok ? c : '_';
+    }
+    out[j] = 0;
+}
+
+static void escape_label(const char* in, char* out, size_t cap) {
+    size_t j = 0;
+    for (size_t i = 0; in[i] && j + 2 < cap; i++) {
+        char c = in[i];
+        if (c == '"' || c == '\\') out[j++] = '\\';
+        if (c == '\n') { out[j++] = '\\'; c = 'n'; }
+        out[j++] = c;
+    }
+    out[j] = 0;
+}
+
+size_t prom_format(const stats_page_t* snap, char* buf, size_t cap) {
+    prom_out_t o = { buf, cap, 0 };
+    char name[STATS_NAME_LEN + 16];
+    char port[160];
+
+    if (cap == 0) return 0;
+    buf[0] = 0;
+    escape_label(snap->port, port, sizeof(port));
+
+    out_printf(&o, "# TYPE p1150_stats_publish_count counter\n");
+    out_printf(&o, "p1150_stats_publish_count{port=\"%s\"} %llu\n", port,
+               (unsigned long long)snap->publish_count);
+
+    for (uint32_t k = 0; k < snap->n_entries && k < STATS_MAX_ENTRIES; k++) {
+        const stats_entry_t* e = &snap->entries[k];
+        sanitize_name(e->name, name, sizeof(name));
+        if (e->kind == STATS_KIND_COUNTER) {
+            size_t nl = strlen(name);
+            if (nl < 6 || strcmp(name + nl - 6, "_total") != 0) strcat(name, "_total");
+            out_printf(&o, "# TYPE p1150_%s counter\n", name);
+        } else {
+            out_printf(&o, "# TYPE p1150_%s gauge\n", name);
+        }
+        out_printf(&o, "p1150_%s{port=\"%s\"} %.17g\n", name, port, e->value);
+    }
+
+    for (uint32_t k = 0; k < snap->n_hists && k < STATS_MAX_HISTS; k++) {
+        const stats_hist_t* sh = &snap->hists[k];
+        uint64_t cum = 0;
+        sanitize_name(sh->name, name, sizeof(name));
+        out_printf(&o, "# TYPE p1150_%s histogram\n", name);
+        for (unsigned b = 0; b < STATS_HIST_BUCKETS - 1; b++) {
+            cum += sh->h.buckets[b];
+            // bucket b holds integer values < 2^b, i.e. le = 2^b - 1
+            out_printf(&o, "p1150_%s_bucket{port=\"%s\",le=\"%llu\"} %llu\n", name, port,
+                       (unsigned long long)(log2_hist_upper(b) - 1), (unsigned long long)cum);
+        }
+        out_printf(&o, "p1150_%s_bucket{port=\"%s\",le=\"+Inf\"} %llu\n", name, port,
+                   (unsigned long long)sh->h.count);
+        out_printf(&o, "p1150_%s_sum{port=\"%s\"} %llu\n", name, port, (unsigned long long)sh->h.sum);
+        out_printf(&o, "p1150_%s_count{port=\"%s\"} %llu\n", name, port, (unsigned long long)sh->h.count);
+    }
+    return o.len;
+}
+
+// ----------------- Sockets -----------------
+
+int prom_listen(prom_listener_t* l, const char* spec) {
+    memset(l, 0, sizeof(*l));
+    l->fd = PROM_INVALID_SOCK;
+    if (!spec || !spec[0]) return -1;
+
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return -1;
+#endif
+
+    if (strncmp(spec, "unix:", 5) == 0) {
+#ifdef _WIN32
+        fprintf(stderr, "prom_listen: unix sockets not supported on this platform\n");
+        return -1;
+#else
+        const char* path = spec + 5;
+        struct sockaddr_un sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        if (strlen(path) >= sizeof(sa.sun_path)) return -1;
+        strcpy(sa.sun_path, path);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) { perror("socket"); return -1; }
+        unlink(path);  // stale socket from a previous run
+        if (bind(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0 || listen(fd, 4) != 0) {
+            perror("prom_listen unix");
+            close(fd);
+            return -1;
+        }
+        l->fd = fd;
+        strncpy(l->unix_path, path, sizeof(l->unix_path) - 1);
+        return 0;
+#endif
+    }
+
+    // TCP: "tcp:host:port" or "host:port"
+    const char* hp = (strncmp(spec, "tcp:", 4) == 0) ? spec + 4 : spec;
+    char host[128];
+    const char* colon = strrchr(hp, ':');
+    if (!colon || (size_t)(colon - hp) >= sizeof(host)) return -1;
+    memcpy(host, hp, (size_t)(colon - hp));
+    host[colon - hp] = 0;
+
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    if (getaddrinfo(host[0] ? host : NULL, colon + 1, &hints, &res) != 0 || !res) {
+        fprintf(stderr, "prom_listen: cannot resolve '%s'\n", spec);
+        return -1;
+    }
+
+    prom_sock_t fd = (prom_sock_t)socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd == PROM_INVALID_SOCK) { freeaddrinfo(res); return -1; }
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&one, sizeof(one));
+    if (bind(fd, res->ai_addr, (int)res->ai_addrlen) != 0 || listen(fd, 4) != 0) {
+        fprintf(stderr, "prom_listen: bind/listen failed for '%s'\n", spec);
+        sock_close(fd);
+        freeaddrinfo(res);
+        return -1;
+    }
+    freeaddrinfo(res);
+    l->fd = fd;
+    return 0;
+}
+
+void prom_close(prom_listener_t* l) {
+    if (l->fd != PROM_INVALID_SOCK) {
+        sock_close(l->fd);
+        l->fd = PROM_INVALID_SOCK;
+    }
+#ifndef _WIN32
+    if (l->unix_path[0]) unlink(l->unix_path);
+#endif
+    l->unix_path[0] = 0;
+}
+
+int prom_wait(prom_listener_t* l, int timeout_ms) {
+    if (l->fd == PROM_INVALID_SOCK) return -1;
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    FD_SET(l->fd, &rfds);
+    struct timeval tv;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+    int rv = select((int)l->fd + 1, &rfds, NULL, NULL, &tv);
+    if (rv < 0) {
+#ifndef _WIN32
+        if (errno == EINTR) return 0;
+#endif
+        return -1;
+    }
+    return rv > 0 ? 1 : 0;
+}
+
+static void send_all(prom_sock_t c, const char* p, size_t n) {
+    while (n > 0) {
+        int w = (int)send(c, p, (int)n, PROM_SEND_FLAGS);
+        if (w <= 0) return;
+        p += w;
+        n -= (size_t)w;
+    }
+}
+
+void prom_serve_one(prom_listener_t* l, const char* text, size_t len) {
+    prom_sock_t c = (prom_sock_t)accept(l->fd, NULL, NULL);
+    if (c == PROM_INVALID_SOCK) return;
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(c, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+    // Give the client a short window to send its request line (HTTP scrapers always do)
+    char req[512];
+    int got = 0;
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    FD_SET(c, &rfds);
+    struct timeval tv = { 0, 50000 };
+    if (select((int)c + 1, &rfds, NULL, NULL, &tv) > 0) {
+        got = (int)recv(c, req, sizeof(req) - 1, 0);
+    }
+
+    if (got >= 3 && strncmp(req, "GET", 3) == 0) {
+        char hdr[160];
+        int hn = snprintf(hdr, sizeof(hdr),
+                          "HTTP/1.0 200 OK\r\n"
+                          "Content-Type: text/plain; version=0.0.4\r\n"
+                          "Content-Length: %zu\r\n\r\n", len);
+        send_all(c, hdr, (size_t)hn);
+    }
+    send_all(c, text, len);
+    sock_close(c);
+}
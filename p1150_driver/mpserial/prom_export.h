@@ -0,0 +1,48 @@
+// prom_export.h
+// Minimal Prometheus text exporter for a stats_page_t snapshot.
+//
+// Listens on a local Unix socket ("unix:/tmp/p1150.sock") or TCP ("tcp:127.0.0.1:9150",
+// or just "127.0.0.1:9150").  Each connection gets one response: an HTTP/1.0 reply when the
+// client sent a GET (Prometheus scraper, curl), otherwise the bare text (nc, socat).
+#ifndef MP_SERIAL_PROM_EXPORT_H
+#define MP_SERIAL_PROM_EXPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "stats_page.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef _WIN32
+typedef uintptr_t prom_sock_t;
+#define PROM_INVALID_SOCK ((prom_sock_t)~(uintptr_t)0)
+#else
+typedef int prom_sock_t;
+#define PROM_INVALID_SOCK (-1)
+#endif
+
+typedef struct {
+    prom_sock_t fd;
+    char        unix_path[108];   // non-empty when bound to a Unix socket (unlinked on close)
+} prom_listener_t;
+
+// Returns 0 on success
+int  prom_listen(prom_listener_t* l, const char* spec);
+void prom_close(prom_listener_t* l);
+
+// Wait up to timeout_ms for a client; returns 1 if one is pending, 0 on timeout, -1 on error
+int  prom_wait(prom_listener_t* l, int timeout_ms);
+
+// Accept one pending client and send it the text
+void prom_serve_one(prom_listener_t* l, const char* text, size_t len);
+
+// Render the snapshot in Prometheus text exposition format; returns bytes written
+size_t prom_format(const stats_page_t* snap, char* buf, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_PROM_EXPORT_H
@@ -0,0 +1,424 @@
+// rec_search.c
+#include "rec_search.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    uint64_t    chunk;          // payload offset
+    rec_event_t ev;
+    uint64_t    from;           // first sample not already in an earlier window
+} rs_window_t;
+
+typedef struct {
+    uint32_t  first, last;      // windows [first, last)
+    rs_hit_t* hits;
+    size_t    n, cap;
+    int       done;
+    int       failed;
+} rs_unit_t;
+
+typedef struct {
+    const uint8_t*     data;
+    const rs_cfg_t*    cfg;
+    const rs_window_t* win;
+    rs_unit_t*         units;
+    uint32_t           n_units;
+
+    mp_mutex_t         mx;
+    uint32_t           next;        // next unit to hand out
+    uint32_t           prefix;      // units [0, prefix) done
+    uint64_t           prefix_hits;
+    int                stop;        // max_hits reached by the done prefix
+} rs_job_t;
+
+static int hits_push(rs_hit_t** hits, size_t* n, size_t* cap, const rs_hit_t* h) {
+    if (*n == *cap) {
+        size_t c = *cap ? *cap * 2 : 256;
+        rs_hit_t* p = (rs_hit_t*)realloc(*hits, c * sizeof(rs_hit_t));
+        if (!p) return -1;
+        *hits = p;
+        *cap = c;
+    }
+    (*hits)[(*n)++] = *h;
+    return 0;
+}
+
+static int hit_cmp(const void* a, const void* b) {
+    const rs_hit_t* x = (const rs_hit_t*)a;
+    const rs_hit_t* y = (const rs_hit_t*)b;
+    if (x->seq != y->seq) return x->seq < y->seq ? -1 : 1;
+    return (int)x->trigger - (int)y->trigger;
+}
+
+// ----------------- Index (calling thread) -----------------
+
+typedef struct {
+    rs_window_t* win;
+    size_t       n_win, cap_win;
+    uint64_t*    bg;            // background chunk payload offsets
+    size_t       n_bg, cap_bg;
+    uint64_t     bg_blocks;
+} rs_index_t;
+
+static int grow(void** p, size_t* cap, size_t n, size_t es) {
+    if (n < *cap) return 0;
+    size_t c = *cap ? *cap * 2 : 1024;
+    void* q = realloc(*p, c * es);
+    if (!q) return -1;
+    *p = q;
+    *cap = c;
+    return 0;
+}
+
+// Blocks of a background chunk that are actually there
+static uint32_t bg_blocks(const uint8_t* payload, uint32_t size) {
+    rec_background_t bh;
+    memcpy(&bh, payload, sizeof(bh));
+    uint32_t fit = (uint32_t)((size - sizeof(bh)) / sizeof(rec_bg_block_t));
+    return bh.blocks < fit ? bh.blocks : fit;
+}
+
+static int build_index(const uint8_t* data, size_t len, uint32_t header_size, rs_index_t* ix) {
+    size_t off = header_size;
+    uint64_t end_max = 0;
+    while (off + sizeof(rec_chunk_t) <= len) {
+        rec_chunk_t c;
+        memcpy(&c, data + off, sizeof(c));
+        off += sizeof(c);
+        if (c.size > len - off) break;   // cut short, e.g. the process was killed mid-write
+
+        if (c.type == REC_CHUNK_EVENT && c.size >= sizeof(rec_event_t)) {
+            rs_window_t w;
+            memcpy(&w.ev, data + off, sizeof(rec_event_t));
+            if ((uint64_t)w.ev.n * REC_EVENT_BYTES_PER_SAMPLE <= c.size - sizeof(rec_event_t)) {
+                if (grow((void**)&ix->win, &ix->cap_win, ix->n_win, sizeof(rs_window_t)) != 0) return -1;
+                w.chunk = off;
+                w.from = end_max > w.ev.start_seq ? end_max : w.ev.start_seq;
+                if (w.ev.start_seq + w.ev.n > end_max) end_max = w.ev.start_seq + w.ev.n;
+                ix->win[ix->n_win++] = w;
+            }
+        } else if (c.type == REC_CHUNK_BACKGROUND && c.size >= sizeof(rec_background_t)) {
+            if (grow((void**)&ix->bg, &ix->cap_bg, ix->n_bg, sizeof(uint64_t)) != 0) return -1;
+            ix->bg[ix->n_bg++] = off;
+            ix->bg_blocks += bg_blocks(data + off, c.size);
+        }
+        off += c.size;
+    }
+    return 0;
+}
+
+// ----------------- Event windows (workers) -----------------
+
+// Column of n elements of es bytes at p, copied to scratch when it is not aligned
+static const void* aligned_col(const uint8_t* p, size_t n, size_t es, uint8_t* scratch) {
+    if (((uintptr_t)p & (es - 1)) == 0) return p;
+    memcpy(scratch, p, n * es);
+    return scratch;
+}
+
+static int search_window(const rs_job_t* j, const rs_window_t* w, rs_unit_t* u, uint8_t* scratch) {
+    const size_t n = w->ev.n;
+    const uint8_t* p = j->data + w->chunk + sizeof(rec_event_t);
+    const float* ci = (const float*)aligned_col(p, n, 4, scratch);
+    const float* cs = (const float*)aligned_col(p + 4 * n, n, 4, scratch + 4 * n);
+    const uint8_t* cd = p + 10 * n;
+    const uint8_t* cc = p + 11 * n;
+    const rec_last_t none = { 0, 0.0f, 0.0f, 0, 0 };
+    const size_t first = u->n;
+
+    for (uint32_t t = 0; t < j->cfg->n_trig; t++) {
+        const rec_trigger_t* tr = &j->cfg->trig[t];
+        size_t k = 0;
+        for (;;) {
+            size_t h = rec_trig_find(tr, ci, cs, cd, cc, &none, k, n);
+            if (h >= n) break;
+            k = h + 1;
+            if (w->ev.start_seq + h < w->from) continue;
+
+            rs_hit_t hit;
+            hit.seq = w->ev.start_seq + h;
+            hit.event = w->ev.number;
+            hit.chunk = w->chunk;
+            hit.index = (uint32_t)h;
+            hit.n = (uint32_t)n;
+            hit.trigger = (uint16_t)t;
+            hit.flags = (w->ev.flags & REC_EVENT_TRUNCATED) ? RS_HIT_TRUNCATED : 0;
+            switch (tr->kind) {
+            case REC_TRIG_CURRENT: hit.value = (tr->source ? cs : ci)[h]; break;
+            case REC_TRIG_DIGITAL: hit.value = (float)((cd[h] >> (tr->source & 1u)) & 1u); break;
+            default:               hit.value = (float)cc[h]; break;
+            }
+            if (hits_push(&u->hits, &u->n, &u->cap, &hit) != 0) return -1;
+        }
+    }
+    if (j->cfg->n_trig > 1 && u->n - first > 1) {
+        qsort(u->hits + first, u->n - first, sizeof(rs_hit_t), hit_cmp);
+    }
+    return 0;
+}
+
+static void* worker_fn(void* param) {
+    rs_job_t* j = (rs_job_t*)param;
+    uint8_t* scratch = NULL;
+    size_t scratch_cap = 0;
+
+    for (;;) {
+        mp_mutex_lock(&j->mx);
+        uint32_t ui = j->next;
+        if (j->stop || ui >= j->n_units) {
+            mp_mutex_unlock(&j->mx);
+            break;
+        }
+        j->next++;
+        mp_mutex_unlock(&j->mx);
+
+        rs_unit_t* u = &j->units[ui];
+        for (uint32_t w = u->first; w < u->last && !u->failed; w++) {
+            size_t need = (size_t)j->win[w].ev.n * 8;
+            if (need > scratch_cap) {
+                uint8_t* s = (uint8_t*)realloc(scratch, need);
+                if (!s) {
+                    u->failed = 1;
+                    break;
+                }
+                scratch = s;
+                scratch_cap = need;
+            }
+            if (search_window(j, &j->win[w], u, scratch) != 0) u->failed = 1;
+        }
+
+        mp_mutex_lock(&j->mx);
+        u->done = 1;
+        while (j->prefix < j->n_units && j->units[j->prefix].done) {
+            j->prefix_hits += j->units[j->prefix].n;
+            j->prefix++;
+        }
+        if (j->cfg->max_hits && j->prefix_hits > j->cfg->max_hits) j->stop = 1;
+        mp_mutex_unlock(&j->mx);
+    }
+    free(scratch);
+    return NULL;
+}
+
+// ----------------- Background (calling thread) -----------------
+
+// Whether [seq, seq + n) overlaps an event window; windows are in sample order
+static int in_windows(const rs_index_t* ix, uint64_t seq, uint64_t n) {
+    size_t lo = 0, hi = ix->n_win;
+    while (lo < hi) {   // first window starting at or after seq + n
+        size_t m = (lo + hi) / 2;
+        if (ix->win[m].ev.start_seq < seq + n) lo = m + 1;
+        else hi = m;
+    }
+    for (size_t k = lo; k > 0 && lo - k < 2; k--) {
+        const rec_event_t* e = &ix->win[k - 1].ev;
+        if (e->start_seq + e->n > seq) return 1;
+    }
+    return 0;
+}
+
+static int search_background(const uint8_t* data, const rs_cfg_t* cfg, const rs_index_t* ix,
+                             rs_hit_t** hits, size_t* n_hits) {
+    size_t cap = 0;
+    for (uint32_t t = 0; t < cfg->n_trig; t++) {
+        const rec_trigger_t* tr = &cfg->trig[t];
+        if (tr->kind != REC_TRIG_CURRENT || tr->source != 0) continue;
+        const float l = tr->level_ma;
+        int below = 0, above = 0;   // a block reached the other side of the level
+        uint64_t expect = UINT64_MAX;
+
+        for (size_t c = 0; c < ix->n_bg; c++) {
+            rec_background_t bh;
+            rec_chunk_t ch;
+            memcpy(&bh, data + ix->bg[c], sizeof(bh));
+            memcpy(&ch, data + ix->bg[c] - sizeof(ch), sizeof(ch));
+            const uint32_t nb = bg_blocks(data + ix->bg[c], ch.size);
+            if (bh.start_seq != expect) below = above = 0;   // gap, the recorder restarted its blocks
+            expect = bh.start_seq + (uint64_t)nb * bh.decim;
+
+            const uint8_t* p = data + ix->bg[c] + sizeof(bh);
+            for (uint32_t b = 0; b < nb; b++) {
+                rec_bg_block_t blk;
+                memcpy(&blk, p + (size_t)b * sizeof(blk), sizeof(blk));
+                if (blk.i_min < l) below = 1;
+                if (blk.i_max >= l) above = 1;
+                int rise = tr->slope >= 0 && below && blk.i_max >= l;
+                int fall = tr->slope <= 0 && above && blk.i_min < l;
+                if (!rise && !fall) continue;
+                if (rise) below = 0;
+                if (fall) above = 0;
+
+                uint64_t seq = bh.start_seq + (uint64_t)b * bh.decim;
+                if (in_windows(ix, seq, bh.decim)) continue;
+                rs_hit_t hit;
+                hit.seq = seq;
+                hit.event = UINT64_MAX;
+                hit.chunk = ix->bg[c];
+                hit.index = b;
+                hit.n = nb;
+                hit.trigger = (uint16_t)t;
+                hit.flags = RS_HIT_BACKGROUND;
+                hit.value = rise ? blk.i_max : blk.i_min;
+                if (hits_push(hits, n_hits, &cap, &hit) != 0) return -1;
+            }
+        }
+    }
+    if (*n_hits > 1) qsort(*hits, *n_hits, sizeof(rs_hit_t), hit_cmp);
+    return 0;
+}
+
+// ----------------- Search -----------------
+
+int rs_search(const uint8_t* data, size_t len, const rs_cfg_t* cfg, rs_result_t* out) {
+    memset(out, 0, sizeof(*out));
+    if (cfg->n_trig == 0 || cfg->n_trig > REC_MAX_TRIGGERS || cfg->workers > RS_MAX_WORKERS) return -1;
+    for (uint32_t t = 0; t < cfg->n_trig; t++) {
+        uint8_t k = cfg->trig[t].kind;
+        if (k != REC_TRIG_CURRENT && k != REC_TRIG_DIGITAL && k != REC_TRIG_D0S) return -1;
+        if (k == REC_TRIG_CURRENT && isnan(cfg->trig[t].level_ma)) return -1;
+    }
+
+    rec_file_header_t h;
+    if (len < sizeof(h)) return -3;
+    memcpy(&h, data, sizeof(h));
+    if (memcmp(h.magic, REC_MAGIC, 8) != 0 || h.version != REC_VERSION ||
+        h.header_size < sizeof(h) || h.header_size > len) {
+        return -3;
+    }
+
+    uint64_t t0 = mp_now_ns();
+    rs_index_t ix;
+    memset(&ix, 0, sizeof(ix));
+    rs_job_t j;
+    memset(&j, 0, sizeof(j));
+    rs_hit_t* bg_hits = NULL;
+    size_t n_bg_hits = 0;
+    int rv = -2;
+
+    if (build_index(data, len, h.header_size, &ix) != 0) goto done;
+    out->st.bytes = len;
+    out->st.index_ns = mp_now_ns() - t0;
+    t0 = mp_now_ns();
+
+    // runs of windows of about RS_UNIT_SAMPLES each
+    j.units = (rs_unit_t*)calloc(ix.n_win ? ix.n_win : 1, sizeof(rs_unit_t));
+    if (!j.units) goto done;
+    for (size_t w = 0; w < ix.n_win;) {
+        rs_unit_t* u = &j.units[j.n_units++];
+        uint64_t s = 0;
+        u->first = (uint32_t)w;
+        while (w < ix.n_win && (s == 0 || s + ix.win[w].ev.n <= RS_UNIT_SAMPLES)) {
+            s += ix.win[w].ev.n;
+            out->st.samples += ix.win[w].ev.n;
+            w++;
+        }
+        u->last = (uint32_t)w;
+    }
+    out->st.events = ix.n_win;
+    out->st.units = j.n_units;
+
+    j.data = data;
+    j.cfg = cfg;
+    j.win = ix.win;
+    mp_mutex_init(&j.mx);
+
+    uint32_t workers = cfg->workers ? cfg->workers : 1;
+    if (workers > j.n_units) workers = j.n_units ? j.n_units : 1;
+    mp_thread_t th[RS_MAX_WORKERS];
+    uint32_t started = 0;
+    for (; started < workers - 1; started++) {
+        if (mp_thread_start(&th[started], worker_fn, &j) != 0) break;
+    }
+    out->st.workers = started + 1;
+
+    // the calling thread does the background, then joins the workers
+    int bg_rv = 0;
+    if (cfg->flags & RS_BACKGROUND) {
+        bg_rv = search_background(data, cfg, &ix, &bg_hits, &n_bg_hits);
+        out->st.bg_blocks = ix.bg_blocks;
+    }
+    worker_fn(&j);
+    for (uint32_t k = 0; k < started; k++) mp_thread_join(&th[k]);
+    mp_mutex_destroy(&j.mx);
+
+    int failed = bg_rv != 0;
+    size_t total = n_bg_hits;
+    for (uint32_t u = 0; u < j.n_units; u++) {
+        failed |= j.units[u].failed;
+        total += j.units[u].n;
+    }
+    if (failed) goto done;
+
+    // units are in sample order, merge the background hits in
+    out->hits = (rs_hit_t*)malloc((total ? total : 1) * sizeof(rs_hit_t));
+    if (!out->hits) goto done;
+    size_t b = 0;
+    for (uint32_t u = 0; u < j.n_units && j.units[u].done; u++) {
+        for (size_t k = 0; k < j.units[u].n; k++) {
+            const rs_hit_t* e = &j.units[u].hits[k];
+            while (b < n_bg_hits && hit_cmp(&bg_hits[b], e) < 0) out->hits[out->n++] = bg_hits[b++];
+            out->hits[out->n++] = *e;
+        }
+    }
+    if (!j.stop) {
+        while (b < n_bg_hits) out->hits[out->n++] = bg_hits[b++];
+    }
+    if (cfg->max_hits && out->n > cfg->max_hits) {
+        out->n = (size_t)cfg->max_hits;
+        out->st.limited = 1;
+    }
+    out->st.limited |= j.stop;
+    out->st.hits = out->n;
+    out->st.search_ns = mp_now_ns() - t0;
+    rv = 0;
+
+done:
+    for (uint32_t u = 0; j.units && u < j.n_units; u++) free(j.units[u].hits);
+    free(j.units);
+    free(bg_hits);
+    free(ix.win);
+    free(ix.bg);
+    if (rv != 0) rs_result_free(out);
+    return rv;
+}
+
+void rs_result_free(rs_result_t* r) {
+    free(r->hits);
+    r->hits = NULL;
+    r->n = 0;
+}
+
+size_t rs_context(const uint8_t* data, size_t len, const rs_hit_t* h, uint32_t pre, uint32_t post,
+                  float* i, float* isnk, uint16_t* a0, uint8_t* d01, uint8_t* d0s) {
+    const size_t w = (size_t)pre + post;
+    for (size_t k = 0; k < w; k++) {
+        if (i) i[k] = NAN;
+        if (isnk) isnk[k] = NAN;
+    }
+    if (a0) memset(a0, 0, w * sizeof(uint16_t));
+    if (d01) memset(d01, 0, w);
+    if (d0s) memset(d0s, 0, w);
+
+    const uint64_t n = h->n;
+    if ((h->flags & RS_HIT_BACKGROUND) || h->chunk > len ||
+        sizeof(rec_event_t) + n * REC_EVENT_BYTES_PER_SAMPLE > len - h->chunk) {
+        return 0;
+    }
+    // window samples [lo, hi) land at row offset lo - (index - pre)
+    int64_t start = (int64_t)h->index - (int64_t)pre;
+    int64_t lo = start < 0 ? 0 : start;
+    int64_t hi = (int64_t)h->index + (int64_t)post;
+    if (hi > (int64_t)n) hi = (int64_t)n;
+    if (hi <= lo) return 0;
+    const size_t at = (size_t)(lo - start), cnt = (size_t)(hi - lo);
+
+    const uint8_t* p = data + h->chunk + sizeof(rec_event_t);
+    if (i) memcpy(i + at, p + 4 * lo, cnt * 4);
+    if (isnk) memcpy(isnk + at, p + 4 * n + 4 * lo, cnt * 4);
+    if (a0) memcpy(a0 + at, p + 8 * n + 2 * lo, cnt * 2);
+    if (d01) memcpy(d01 + at, p + 10 * n + lo, cnt);
+    if (d0s) memcpy(d0s + at, p + 11 * n + lo, cnt);
+    return cnt;
+}
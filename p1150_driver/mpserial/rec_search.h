@@ -0,0 +1,94 @@
+// rec_search.h
+// Offline trigger search over a recording (recording.h) held in memory, typically the
+// mapped file.
+//
+// One sequential pass walks the chunk headers and indexes the event windows, then
+// worker threads scan runs of windows in parallel with the live recorder's trigger
+// semantics (rec_trig_find(): level crossing with slope, D0/D1 edge, d0s character
+// start).  Unlike the recorder, which waits for the post-trigger samples after a hit,
+// every trigger is followed on its own through every window: a crossing is reported
+// each time the value went back beyond the level and crosses again.  Hits come back
+// sorted by sample index; samples a window shares with the previous one (its
+// pre-trigger part) are reported once.
+//
+// With RS_BACKGROUND the decimated background blocks outside the event windows are
+// searched too, for current triggers on i: a block counts as crossing when its
+// i_min/i_max straddle the level after a block on the other side.  Those hits are
+// block resolution only and carry RS_HIT_BACKGROUND.
+#ifndef MP_SERIAL_REC_SEARCH_H
+#define MP_SERIAL_REC_SEARCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mp_platform.h"
+#include "recording.h"
+#include "recorder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RS_MAX_WORKERS     64
+#define RS_UNIT_SAMPLES    (256u * 1024u)   // samples of event windows per work unit
+
+#define RS_BACKGROUND      0x0001u          // rs_cfg_t.flags
+
+#define RS_HIT_BACKGROUND  0x0001u          // rs_hit_t.flags
+#define RS_HIT_TRUNCATED   0x0002u          // the window is REC_EVENT_TRUNCATED
+
+typedef struct {
+    uint32_t      n_trig;
+    rec_trigger_t trig[REC_MAX_TRIGGERS];
+    uint32_t      workers;      // 0: 1
+    uint32_t      flags;        // RS_*
+    uint64_t      max_hits;     // first hits kept, 0: all
+} rs_cfg_t;
+
+typedef struct {                // 40 bytes, read by Python
+    uint64_t seq;               // sample index (first sample of the block for background hits)
+    uint64_t event;             // event number, UINT64_MAX for background hits
+    uint64_t chunk;             // offset of the chunk payload in the recording
+    uint32_t index;             // sample in the window, block in the background chunk
+    uint32_t n;                 // samples in the window, blocks in the chunk
+    uint16_t trigger;           // index into rs_cfg_t.trig
+    uint16_t flags;             // RS_HIT_*
+    float    value;             // mA (block i_max/i_min), 0/1 for D0/D1, the d0s character
+} rs_hit_t;
+
+typedef struct {
+    uint64_t bytes;
+    uint64_t events;            // windows searched
+    uint64_t samples;
+    uint64_t bg_blocks;
+    uint64_t hits;
+    int      limited;           // more than max_hits, the rest were not searched for
+    uint32_t workers;
+    uint32_t units;
+    uint64_t index_ns;
+    uint64_t search_ns;
+} rs_stats_t;
+
+typedef struct {
+    rs_hit_t*  hits;
+    size_t     n;
+    rs_stats_t st;
+} rs_result_t;
+
+// Search the recording data[0, len).  0 on success (out->hits is freed with
+// rs_result_free()), -1 bad configuration, -2 allocation or thread failure, -3 not a
+// recording (magic, version, header)
+int  rs_search(const uint8_t* data, size_t len, const rs_cfg_t* cfg, rs_result_t* out);
+void rs_result_free(rs_result_t* r);
+
+// Samples [index - pre, index + post) of the window of event hit h into the columns
+// (any may be NULL, each pre + post long); outside the window i/isnk are NaN, the rest 0.
+// Returns the samples that came from the window, 0 for background hits.
+size_t rs_context(const uint8_t* data, size_t len, const rs_hit_t* h, uint32_t pre, uint32_t post,
+                  float* i, float* isnk, uint16_t* a0, uint8_t* d01, uint8_t* d0s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_REC_SEARCH_H
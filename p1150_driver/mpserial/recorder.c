@@ -0,0 +1,387 @@
+// recorder.c
+#include "recorder.h"
+
+#include <errno.h>
+#include <string.h>
+
+void recorder_init(recorder_t* r) {
+    memset(r, 0, sizeof(*r));
+    r->cons = -1;
+    mp_mutex_init(&r->mx);
+}
+
+void recorder_free(recorder_t* r) {
+    recorder_stop(r);
+    mp_mutex_destroy(&r->mx);
+}
+
+void recorder_stats(recorder_t* r, rec_stats_t* out) {
+    mp_mutex_lock(&r->mx);
+    *out = r->st;
+    mp_mutex_unlock(&r->mx);
+}
+
+// ----------------- File output (recorder thread) -----------------
+
+static void write_chunk(recorder_t* r, uint32_t type, const void* a, size_t na, const void* b, size_t nb) {
+    rec_chunk_t c = { type, (uint32_t)(na + nb) };
+    int ok = fwrite(&c, sizeof(c), 1, r->fp) == 1
+          && (na == 0 || fwrite(a, na, 1, r->fp) == 1)
+          && (nb == 0 || fwrite(b, nb, 1, r->fp) == 1);
+
+    mp_mutex_lock(&r->mx);
+    if (ok) r->st.bytes += sizeof(c) + na + nb;
+    else if (!r->st.error) r->st.error = errno ? errno : EIO;
+    mp_mutex_unlock(&r->mx);
+}
+
+static void bg_flush(recorder_t* r) {
+    if (r->bg_n == 0) return;
+    rec_background_t h = { r->bg_seq, r->bg_n, r->cfg.decim };
+    write_chunk(r, REC_CHUNK_BACKGROUND, &h, sizeof(h), r->bg, r->bg_n * sizeof(rec_bg_block_t));
+    mp_mutex_lock(&r->mx);
+    r->st.bg_blocks += r->bg_n;
+    mp_mutex_unlock(&r->mx);
+    r->bg_seq += (uint64_t)r->bg_n * r->cfg.decim;
+    r->bg_n = 0;
+}
+
+// Start background blocks over at seq (first sample, or after a gap)
+static void bg_restart(recorder_t* r, uint64_t seq) {
+    bg_flush(r);
+    r->bg_fill = 0;
+    r->bg_seq = seq;
+}
+
+static void bg_add(recorder_t* r, const float* ci, const float* cs, size_t n) {
+    for (size_t k = 0; k < n; k++) {
+        float v = ci[k];
+        if (r->bg_fill == 0 || v < r->bg_i_min) r->bg_i_min = v;
+        if (r->bg_fill == 0 || v > r->bg_i_max) r->bg_i_max = v;
+        r->bg_i_sum += v;
+        r->bg_isnk_sum += cs[k];
+        if (++r->bg_fill == r->cfg.decim) {
+            rec_bg_block_t* b = &r->bg[r->bg_n++];
+            b->i_mean = (float)(r->bg_i_sum / r->cfg.decim);
+            b->i_min = r->bg_i_min;
+            b->i_max = r->bg_i_max;
+            b->isnk_mean = (float)(r->bg_isnk_sum / r->cfg.decim);
+            r->bg_fill = 0;
+            r->bg_i_sum = r->bg_isnk_sum = 0.0;
+            if (r->bg_n == REC_BG_BLOCKS) bg_flush(r);
+        }
+    }
+}
+
+// Copy n samples of column c starting at seq out of the ring
+static uint8_t* copy_col(const sample_ring_t* ring, int c, size_t es, uint64_t seq, uint64_t n, uint8_t* dst) {
+    uint64_t off = seq & ring->mask;
+    uint64_t first = ring->capacity - off < n ? ring->capacity - off : n;
+    memcpy(dst, (const uint8_t*)ring->col[c] + off * es, (size_t)(first * es));
+    if (n > first) memcpy(dst + first * es, ring->col[c], (size_t)((n - first) * es));
+    return dst + n * es;
+}
+
+static void write_event(recorder_t* r) {
+    sample_ring_t* ring = r->ring;
+    uint64_t end = r->trig_seq + r->cfg.post;
+    uint64_t start = r->trig_seq > r->cfg.pre ? r->trig_seq - r->cfg.pre : 0;
+    if (start < r->st.start_seq) start = r->st.start_seq;
+    uint64_t oldest = mp_load_acquire_u64(&ring->claim);
+    oldest = oldest > ring->capacity ? oldest - ring->capacity : 0;
+    uint16_t flags = 0;
+    if (start < oldest) {
+        start = oldest;
+        flags |= REC_EVENT_TRUNCATED;
+    }
+    // the thread fell more than post samples behind: the whole window is gone, the
+    // event is still written (empty, truncated) so the trigger is not lost silently
+    uint64_t n = start < end ? end - start : 0;
+    if (!n) {
+        start = end;
+        flags |= REC_EVENT_TRUNCATED;
+    }
+    if (n > (uint64_t)r->cfg.pre + r->cfg.post) n = (uint64_t)r->cfg.pre + r->cfg.post;
+
+    uint8_t* p = r->win;
+    if (n) {
+        p = copy_col(ring, SR_COL_I, 4, start, n, p);
+        p = copy_col(ring, SR_COL_ISNK, 4, start, n, p);
+        p = copy_col(ring, SR_COL_A0, 2, start, n, p);
+        p = copy_col(ring, SR_COL_D01, 1, start, n, p);
+        p = copy_col(ring, SR_COL_D0S, 1, start, n, p);
+    }
+
+    // the producer may have lapped the window while it was copied
+    mp_fence_acquire();
+    uint64_t claim = mp_load_acquire_u64(&ring->claim);
+    if (claim > ring->capacity && claim - ring->capacity > start) flags |= REC_EVENT_TRUNCATED;
+
+    rec_event_t e;
+    memset(&e, 0, sizeof(e));
+    mp_mutex_lock(&r->mx);
+    e.number = r->st.events;
+    mp_mutex_unlock(&r->mx);
+    e.trigger_seq = r->trig_seq;
+    e.start_seq = start;
+    e.n = (uint32_t)n;
+    e.trigger = r->trig_idx;
+    e.flags = flags;
+    e.host_ns = r->trig_ns;
+    write_chunk(r, REC_CHUNK_EVENT, &e, sizeof(e), r->win, (size_t)(p - r->win));
+
+    mp_mutex_lock(&r->mx);
+    r->st.events++;
+    if (flags & REC_EVENT_TRUNCATED) r->st.truncated++;
+    r->st.pending = 0;
+    mp_mutex_unlock(&r->mx);
+}
+
+// ----------------- Trigger evaluation -----------------
+
+size_t rec_trig_find(const rec_trigger_t* t, const float* ci, const float* cs, const uint8_t* cd,
+                     const uint8_t* cc, const rec_last_t* last, size_t k, size_t n) {
+    if (k == 0 && !last->have) k = 1;   // no previous sample for the very first one
+    switch (t->kind) {
+    case REC_TRIG_CURRENT: {
+        const float* c = t->source ? cs : ci;
+        const float l = t->level_ma;
+        float prev = k ? c[k - 1] : (t->source ? last->isnk : last->i);
+        for (; k < n; k++) {
+            float v = c[k];
+            if ((t->slope >= 0 && prev < l && v >= l) || (t->slope <= 0 && prev >= l && v < l)) return k;
+            prev = v;
+        }
+        return n;
+    }
+    case REC_TRIG_DIGITAL: {
+        const unsigned sh = t->source & 1u;
+        unsigned prev = ((k ? cd[k - 1] : last->d01) >> sh) & 1u;
+        for (; k < n; k++) {
+            unsigned v = (cd[k] >> sh) & 1u;
+            if (v != prev && (t->slope == 0 || (t->slope > 0) == (v == 1u))) return k;
+            prev = v;
+        }
+        return n;
+    }
+    case REC_TRIG_D0S: {
+        // fires where the character starts, not on every sample it lasts
+        while (k < n) {
+            const uint8_t* hit = (const uint8_t*)memchr(cc + k, t->ch, n - k);
+            if (!hit) return n;
+            k = (size_t)(hit - cc);
+            if ((k ? cc[k - 1] : last->d0s) != t->ch) return k;
+            k++;
+        }
+        return n;
+    }
+    default:
+        return n;
+    }
+}
+
+// One contiguous ring segment [seq, seq + n)
+static void scan(recorder_t* r, uint64_t seq, size_t n) {
+    sample_ring_t* ring = r->ring;
+    size_t off = (size_t)(seq & ring->mask);
+    const float* ci = (const float*)ring->col[SR_COL_I] + off;
+    const float* cs = (const float*)ring->col[SR_COL_ISNK] + off;
+    const uint8_t* cd = (const uint8_t*)ring->col[SR_COL_D01] + off;
+    const uint8_t* cc = (const uint8_t*)ring->col[SR_COL_D0S] + off;
+
+    bg_add(r, ci, cs, n);
+
+    size_t k = 0;
+    while (k < n) {
+        int pending;
+        mp_mutex_lock(&r->mx);
+        pending = r->st.pending;
+        mp_mutex_unlock(&r->mx);
+
+        if (pending) {
+            uint64_t end = r->trig_seq + r->cfg.post;
+            if (end > seq + n) break;
+            write_event(r);
+            k = end > seq ? (size_t)(end - seq) : 0;   // re-armed from the end of the window
+            continue;
+        }
+
+        size_t hit = n;
+        uint16_t idx = 0;
+        for (uint32_t t = 0; t < r->cfg.n_trig; t++) {
+            size_t h = rec_trig_find(&r->cfg.trig[t], ci, cs, cd, cc, &r->last, k, hit);
+            if (h < hit) { hit = h; idx = (uint16_t)t; }
+        }
+        if (hit == n) break;
+
+        r->trig_seq = seq + hit;
+        r->trig_idx = idx;
+        r->trig_ns = mp_unix_ns();
+        mp_mutex_lock(&r->mx);
+        r->st.pending = 1;
+        mp_mutex_unlock(&r->mx);
+        k = hit + 1;
+    }
+
+    r->last.i = ci[n - 1];
+    r->last.isnk = cs[n - 1];
+    r->last.d01 = cd[n - 1];
+    r->last.d0s = cc[n - 1];
+    r->last.have = 1;
+}
+
+// Process everything readable now
+static void drain(recorder_t* r) {
+    sample_ring_t* ring = r->ring;
+    uint64_t start;
+    uint64_t n = sample_ring_poll(ring, r->cons, &start);
+    if (n == 0) return;
+    if (start != r->st.seq) {
+        // lapped: samples skipped, the pending window (if any) comes out truncated
+        mp_mutex_lock(&r->mx);
+        r->st.lost += start - r->st.seq;
+        mp_mutex_unlock(&r->mx);
+        r->last.have = 0;
+        bg_restart(r, start);
+    }
+
+    uint64_t s = start, end = start + n;
+    while (s < end) {
+        uint64_t off = s & ring->mask;
+        uint64_t len = ring->capacity - off < end - s ? ring->capacity - off : end - s;
+        scan(r, s, (size_t)len);
+        s += len;
+    }
+    mp_mutex_lock(&r->mx);
+    r->st.seq = end;
+    mp_mutex_unlock(&r->mx);
+    (void)sample_ring_commit(ring, r->cons, n);
+}
+
+static void* recorder_thread(void* param) {
+    recorder_t* r = (recorder_t*)param;
+    sample_ring_t* ring = r->ring;
+
+    while (r->alive) {
+        if (sample_ring_wait(ring, r->cons, REC_WAKE, 100) == 0) {
+            if (ring->closed) mp_sleep_ms(10);
+            continue;
+        }
+        drain(r);
+    }
+    drain(r);   // what arrived up to the stop
+    return NULL;
+}
+
+// ----------------- Control -----------------
+
+int recorder_start(recorder_t* r, sample_ring_t* ring, const char* path, const rec_cfg_t* cfg) {
+    recorder_stop(r);
+    if (!sample_ring_enabled(ring) || cfg->decim == 0 || cfg->n_trig > REC_MAX_TRIGGERS
+        || (uint64_t)cfg->pre + cfg->post > ring->capacity / 2 || cfg->post == 0) {
+        return -1;
+    }
+
+    r->win = (uint8_t*)malloc((size_t)(cfg->pre + cfg->post) * REC_EVENT_BYTES_PER_SAMPLE);
+    r->bg = (rec_bg_block_t*)malloc(REC_BG_BLOCKS * sizeof(rec_bg_block_t));
+    if (!r->win || !r->bg) {
+        free(r->win); free(r->bg);
+        r->win = NULL; r->bg = NULL;
+        errno = ENOMEM;
+        return -2;
+    }
+
+    r->fp = fopen(path, "wb");
+    if (!r->fp) {
+        free(r->win); free(r->bg);
+        r->win = NULL; r->bg = NULL;
+        return -2;
+    }
+
+    r->cons = sample_ring_attach(ring, "recorder", SR_POLICY_OVERWRITE, REC_WAKE);
+    if (r->cons < 0) {
+        fclose(r->fp);
+        r->fp = NULL;
+        free(r->win); free(r->bg);
+        r->win = NULL; r->bg = NULL;
+        return -3;
+    }
+
+    r->ring = ring;
+    r->cfg = *cfg;
+    r->last.have = 0;
+    r->bg_n = 0;
+    r->bg_fill = 0;
+    uint64_t start;
+    (void)sample_ring_poll(ring, r->cons, &start);
+    r->bg_seq = start;
+
+    mp_mutex_lock(&r->mx);
+    memset(&r->st, 0, sizeof(r->st));
+    r->st.running = 1;
+    r->st.start_seq = start;
+    r->st.seq = start;
+    mp_mutex_unlock(&r->mx);
+
+    rec_file_header_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, REC_MAGIC, sizeof(h.magic));
+    h.version = REC_VERSION;
+    h.header_size = sizeof(h);
+    h.sample_rate = ADC_SAMPLE_RATE_HZ;
+    h.pre = cfg->pre;
+    h.post = cfg->post;
+    h.decim = cfg->decim;
+    h.start_seq = start;
+    h.start_unix_ns = mp_unix_ns();
+    h.n_trig = cfg->n_trig;
+    memcpy(h.trig, cfg->trig, sizeof(h.trig));
+    if (fwrite(&h, sizeof(h), 1, r->fp) == 1) r->st.bytes = sizeof(h);
+
+    r->alive = 1;
+    if (mp_thread_start(&r->th, recorder_thread, r) != 0) {
+        r->alive = 0;
+        sample_ring_detach(ring, r->cons);
+        r->cons = -1;
+        fclose(r->fp);
+        r->fp = NULL;
+        r->st.running = 0;
+        return -4;
+    }
+    return 0;
+}
+
+void recorder_stop(recorder_t* r) {
+    if (!r->fp) return;
+    r->alive = 0;
+    mp_thread_join(&r->th);
+    sample_ring_detach(r->ring, r->cons);
+    r->cons = -1;
+
+    bg_flush(r);
+    rec_end_t e;
+    mp_mutex_lock(&r->mx);
+    e.end_seq = r->st.seq;
+    e.events = r->st.events;
+    e.truncated = r->st.truncated;
+    e.bg_blocks = r->st.bg_blocks;
+    e.lost = r->st.lost;
+    mp_mutex_unlock(&r->mx);
+    write_chunk(r, REC_CHUNK_END, &e, sizeof(e), NULL, 0);
+
+    if (fclose(r->fp) != 0) {
+        mp_mutex_lock(&r->mx);
+        if (!r->st.error) r->st.error = errno ? errno : EIO;
+        mp_mutex_unlock(&r->mx);
+    }
+    r->fp = NULL;
+    free(r->win);
+    free(r->bg);
+    r->win = NULL;
+    r->bg = NULL;
+
+    mp_mutex_lock(&r->mx);
+    r->st.running = 0;
+    r->st.pending = 0;
+    mp_mutex_unlock(&r->mx);
+}
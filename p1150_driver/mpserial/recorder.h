@@ -0,0 +1,106 @@
+// recorder.h
+// Event-triggered recorder for long soak tests.
+//
+// A native thread follows the sample ring as an overwrite consumer (it never holds up
+// the stream).  The ring itself is the rolling pre-trigger buffer: for every new batch
+//   - triggers (current level crossing, D0/D1 edge, d0s character, OR-ed) are
+//     evaluated at full rate over the ring columns in place
+//   - once the post-trigger part has arrived, [trigger - pre, trigger + post) is
+//     copied out of the ring and appended to the file as one event
+//   - i/isnk are decimated into min/max/mean background blocks, so the file also
+//     shows what happened between events
+// Only the windows and the background reach the disk, see recording.h for the format.
+#ifndef MP_SERIAL_RECORDER_H
+#define MP_SERIAL_RECORDER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mp_platform.h"
+#include "sample_ring.h"
+#include "recording.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define REC_BG_BLOCKS   1024       // background blocks per chunk
+#define REC_WAKE        1024       // samples per recorder wake-up
+
+typedef struct {
+    uint32_t      pre;
+    uint32_t      post;
+    uint32_t      decim;
+    uint32_t      n_trig;
+    rec_trigger_t trig[REC_MAX_TRIGGERS];
+} rec_cfg_t;
+
+// Last sample before a column segment, trigger edges need it
+typedef struct {
+    int      have;
+    float    i, isnk;
+    uint8_t  d01;
+    uint8_t  d0s;
+} rec_last_t;
+
+typedef struct {
+    int      running;
+    uint64_t start_seq;
+    uint64_t seq;          // next sample to scan
+    uint64_t events;
+    uint64_t truncated;
+    uint64_t bg_blocks;
+    uint64_t bytes;
+    uint64_t lost;         // samples overwritten before the recorder saw them
+    int      pending;      // trigger seen, waiting for the post-trigger samples
+    int      error;        // errno of the first write error, 0 if none
+} rec_stats_t;
+
+typedef struct {
+    sample_ring_t*  ring;
+    int             cons;
+    FILE*           fp;
+    rec_cfg_t       cfg;
+    mp_thread_t     th;
+    volatile int    alive;
+
+    // recorder thread only
+    rec_last_t      last;
+    uint64_t        trig_seq;
+    uint16_t        trig_idx;
+    uint64_t        trig_ns;
+    uint8_t*        win;          // event window copy
+    uint32_t        bg_fill;
+    double          bg_i_sum, bg_isnk_sum;
+    float           bg_i_min, bg_i_max;
+    rec_bg_block_t* bg;
+    uint32_t        bg_n;
+    uint64_t        bg_seq;       // first sample of bg[0]
+
+    mp_mutex_t      mx;           // stats
+    rec_stats_t     st;
+} recorder_t;
+
+void recorder_init(recorder_t* r);
+void recorder_free(recorder_t* r);     // stops first
+
+// Open path (truncated), attach to the ring and start the thread.  0 on success,
+// -1 bad configuration, -2 file error (errno), -3 no free ring consumer, -4 thread
+int  recorder_start(recorder_t* r, sample_ring_t* ring, const char* path, const rec_cfg_t* cfg);
+
+// Flush, write the end chunk and close; no-op when not running
+void recorder_stop(recorder_t* r);
+
+void recorder_stats(recorder_t* r, rec_stats_t* out);
+
+// First offset in [k, n) where trigger t fires over the columns i, isnk (mA), d01, d0s,
+// n if none.  Offset 0 compares against last (skipped when !last->have).  The live
+// recorder and the offline search (rec_search.h) share these semantics.
+size_t rec_trig_find(const rec_trigger_t* t, const float* ci, const float* cs, const uint8_t* cd,
+                     const uint8_t* cc, const rec_last_t* last, size_t k, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_RECORDER_H
@@ -0,0 +1,95 @@
+// recording.h
+// On-disk format of event-triggered recordings (recorder.c writes, readers parse).
+//
+//   rec_file_header_t                          once, header_size bytes
+//   { rec_chunk_t, payload[size] } ...         until end of file
+// Chunks
+//   REC_CHUNK_EVENT       rec_event_t, then the window as columns
+//                         i <f4[n] mA, isnk <f4[n] mA, a0 <u2[n], d01 u1[n], d0s u1[n]
+//   REC_CHUNK_BACKGROUND  rec_background_t, then blocks x rec_bg_block_t
+//   REC_CHUNK_END         rec_end_t, written by a clean stop
+// Everything is little-endian, sample indexes are sample ring sequence numbers.
+// Unknown chunk types are skipped by size.
+#ifndef MP_SERIAL_RECORDING_H
+#define MP_SERIAL_RECORDING_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define REC_MAGIC          "P1150REC"
+#define REC_VERSION        1
+#define REC_MAX_TRIGGERS   8
+
+enum { REC_TRIG_NONE, REC_TRIG_CURRENT, REC_TRIG_DIGITAL, REC_TRIG_D0S };
+enum { REC_CHUNK_EVENT = 1, REC_CHUNK_BACKGROUND = 2, REC_CHUNK_END = 3 };
+
+#define REC_EVENT_TRUNCATED  0x0001u   // part of the window was overwritten before it was saved
+
+typedef struct {                // 16 bytes
+    uint8_t  kind;              // REC_TRIG_*
+    uint8_t  source;            // CURRENT: 0 i, 1 isnk; DIGITAL: line 0 D0, 1 D1
+    int8_t   slope;             // +1 rise, -1 fall, 0 either (CURRENT, DIGITAL)
+    uint8_t  ch;                // D0S: status character
+    float    level_ma;          // CURRENT
+    uint32_t reserved[2];
+} rec_trigger_t;
+
+typedef struct {                // 192 bytes
+    char          magic[8];
+    uint32_t      version;
+    uint32_t      header_size;
+    uint32_t      sample_rate;
+    uint32_t      pre;          // samples before the trigger
+    uint32_t      post;         // samples from the trigger on
+    uint32_t      decim;        // samples per background block
+    uint64_t      start_seq;
+    uint64_t      start_unix_ns;
+    uint32_t      n_trig;
+    uint32_t      reserved[3];
+    rec_trigger_t trig[REC_MAX_TRIGGERS];
+} rec_file_header_t;
+
+typedef struct {
+    uint32_t type;              // REC_CHUNK_*
+    uint32_t size;              // payload bytes following
+} rec_chunk_t;
+
+typedef struct {                // 40 bytes
+    uint64_t number;
+    uint64_t trigger_seq;
+    uint64_t start_seq;         // first sample of the window
+    uint32_t n;                 // samples in the window
+    uint16_t trigger;           // index into rec_file_header_t.trig
+    uint16_t flags;             // REC_EVENT_*
+    uint64_t host_ns;           // wall clock when the trigger was found
+} rec_event_t;
+
+typedef struct {                // 16 bytes
+    uint64_t start_seq;         // first sample of the first block
+    uint32_t blocks;
+    uint32_t decim;
+} rec_background_t;
+
+typedef struct {                // 16 bytes
+    float i_mean, i_min, i_max;
+    float isnk_mean;
+} rec_bg_block_t;
+
+typedef struct {                // 40 bytes
+    uint64_t end_seq;
+    uint64_t events;
+    uint64_t truncated;
+    uint64_t bg_blocks;
+    uint64_t lost;              // samples the recorder fell behind the ring
+} rec_end_t;
+
+#define REC_EVENT_BYTES_PER_SAMPLE (4 + 4 + 2 + 1 + 1)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_RECORDING_H
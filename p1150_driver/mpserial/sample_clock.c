@@ -0,0 +1,177 @@
+// sample_clock.c
+#include "sample_clock.h"
+
+#include <math.h>
+#include <string.h>
+
+#define SC_BREAKS_MASK  (((uint64_t)1 << SC_BREAKS_LOG2) - 1)
+
+void sclock_init(sclock_t* s, uint32_t rate) {
+    memset(s, 0, sizeof(*s));
+    s->rate = rate;
+    mp_mutex_init(&s->mx);
+}
+
+void sclock_free(sclock_t* s) {
+    mp_mutex_destroy(&s->mx);
+}
+
+// Counter width guess for wrap detection: the firmware counter is a 16 or 32 bit
+// integer, anything narrower is taken as a restart
+static inline uint64_t span_of(uint64_t v) {
+    if (v < ((uint64_t)1 << 16)) return (uint64_t)1 << 16;
+    if (v < ((uint64_t)1 << 32)) return (uint64_t)1 << 32;
+    return 0;
+}
+
+// lock held: least squares over the bucket minima
+static void refit(sclock_t* s) {
+    uint64_t m = s->n_pts < SC_POINTS ? s->n_pts : SC_POINTS;
+    double mx = 0.0, my = 0.0;
+    for (uint64_t k = 0; k < m; k++) {
+        mx += s->pts[k].dev_s;
+        my += s->pts[k].resid_s;
+    }
+    mx /= (double)m;
+    my /= (double)m;
+
+    double sxx = 0.0, sxy = 0.0;
+    for (uint64_t k = 0; k < m; k++) {
+        double dx = s->pts[k].dev_s - mx;
+        sxx += dx * dx;
+        sxy += dx * (s->pts[k].resid_s - my);
+    }
+    double b = sxx > 0.0 ? sxy / sxx : 0.0;
+    double a = my - b * mx;
+
+    double ss = 0.0;
+    for (uint64_t k = 0; k < m; k++) {
+        double e = s->pts[k].resid_s - (a + b * s->pts[k].dev_s);
+        ss += e * e;
+    }
+    s->st.offset_s = a;
+    s->st.drift = b;
+    s->st.jitter_s = sqrt(ss / (double)m);
+    s->st.points = (uint32_t)m;
+    s->st.valid = 1;
+}
+
+// lock held: drop the fit (device clock restarted, the index gap is unknown)
+static void fit_reset(sclock_t* s) {
+    s->n_pts = 0;
+    s->bucket_has = 0;
+    s->st.points = 0;
+    s->st.valid = 0;
+}
+
+static void add_break(sclock_t* s, uint64_t stream, uint64_t abs) {
+    sc_break_t* b = &s->breaks[s->n_breaks & SC_BREAKS_MASK];
+    b->stream = stream;
+    b->abs = abs;
+    s->n_breaks++;
+}
+
+uint64_t sclock_feed(sclock_t* s, uint64_t c, uint32_t n, uint64_t host_ns, uint64_t stream) {
+    mp_mutex_lock(&s->mx);
+    sc_info_t* st = &s->st;
+    uint64_t abs;
+
+    if (!s->primed) {
+        s->primed = 1;
+        st->origin_mono_ns = host_ns;
+        st->origin_unix_ns = mp_unix_ns() - (mp_now_ns() - host_ns);
+        abs = 0;
+        add_break(s, stream, abs);
+    } else {
+        uint64_t next = st->abs + st->n;
+        uint64_t w = span_of(st->c);
+        if (c > st->c) {
+            uint64_t d = c - st->c;
+            abs = next + (d - 1) * n;
+            if (d > 1) {
+                st->lost_frames += d - 1;
+                st->lost_samples += (d - 1) * n;
+            }
+        } else if (w && st->c >= w - w / 16 && c < w / 16) {
+            uint64_t d = c + w - st->c;
+            st->wraps++;
+            abs = next + (d - 1) * n;
+            if (d > 1) {
+                st->lost_frames += d - 1;
+                st->lost_samples += (d - 1) * n;
+            }
+        } else {
+            // counter restarted: new epoch right after the last known sample
+            st->epoch++;
+            abs = next;
+            fit_reset(s);
+        }
+        if (abs != next) add_break(s, stream, abs);
+    }
+    st->c = c;
+    st->abs = abs;
+    st->n = n;
+    st->frames++;
+
+    // arrival above the device time of the frame's last sample
+    double dev = (double)(abs + n) / (double)s->rate;
+    double resid = (double)(host_ns - st->origin_mono_ns) / 1e9 - dev;
+    uint64_t bucket = (uint64_t)(dev / SC_BUCKET_S);
+    if (s->bucket_has && bucket != s->bucket) {
+        s->pts[s->n_pts % SC_POINTS] = (sc_point_t){ s->bucket_dev, s->bucket_min };
+        s->n_pts++;
+        refit(s);
+        s->bucket_has = 0;
+    }
+    if (!s->bucket_has || resid < s->bucket_min) {
+        s->bucket_min = resid;
+        s->bucket_dev = dev;
+    }
+    s->bucket = bucket;
+    s->bucket_has = 1;
+    if (!st->valid) st->offset_s = s->bucket_min;   // coarse until the first bucket closes
+    st->latency_s = resid - (st->offset_s + st->drift * dev);
+
+    mp_mutex_unlock(&s->mx);
+    return abs;
+}
+
+void sclock_info(sclock_t* s, sc_info_t* out) {
+    mp_mutex_lock(&s->mx);
+    *out = s->st;
+    if (!s->st.valid && s->bucket_has) out->valid = 1;   // coarse offset only
+    mp_mutex_unlock(&s->mx);
+}
+
+int sclock_frame(sclock_t* s, uint64_t c, uint64_t* abs, uint32_t* n) {
+    mp_mutex_lock(&s->mx);
+    int ok = s->primed;
+    if (ok) {
+        // signed distance in counter space, within half the counter span
+        uint64_t w = span_of(s->st.c > c ? s->st.c : c);
+        int64_t d = (int64_t)(c - s->st.c);
+        if (w) {
+            d = (int64_t)((c - s->st.c) & (w - 1));
+            if ((uint64_t)d >= w / 2) d -= (int64_t)w;
+        }
+        *abs = (uint64_t)((int64_t)s->st.abs + d * (int64_t)s->st.n);
+        *n = s->st.n;
+    }
+    mp_mutex_unlock(&s->mx);
+    return ok;
+}
+
+uint64_t sclock_stream_to_abs(sclock_t* s, uint64_t stream) {
+    mp_mutex_lock(&s->mx);
+    uint64_t abs = stream;
+    uint64_t lo = s->n_breaks > SC_BREAKS_MASK + 1 ? s->n_breaks - (SC_BREAKS_MASK + 1) : 0;
+    for (uint64_t k = s->n_breaks; k > lo; k--) {
+        const sc_break_t* b = &s->breaks[(k - 1) & SC_BREAKS_MASK];
+        if (b->stream <= stream) {
+            abs = b->abs + (stream - b->stream);
+            break;
+        }
+    }
+    mp_mutex_unlock(&s->mx);
+    return abs;
+}
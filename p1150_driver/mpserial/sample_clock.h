@@ -0,0 +1,93 @@
+// sample_clock.h
+// Device sample clock from the ADC frame counter, fitted to host time.
+//
+// The frame counter "c" of every ADC frame is unwrapped into an absolute sample index:
+// missing frames leave a gap of their samples, a counter that restarts (device reset)
+// starts a new epoch and continues after the last index.  Unlike the stream sample
+// index (samples actually received) the absolute index advances in device time.
+//
+// Host time: each frame is stamped on arrival (monotonic clock).  Arrival is the
+// device time of its last sample plus a USB/OS latency that is never negative, so
+// per 1 s bucket of device time the minimum of (host - device) is kept, and a least
+// squares line through the last SC_POINTS minima gives offset and drift:
+//   host_s = device_s + offset_s + drift * device_s
+// Host times are relative to the arrival of the first frame (origin), which is also
+// recorded as a Unix time so results can be matched against wall clock stamps.
+#ifndef MP_SERIAL_SAMPLE_CLOCK_H
+#define MP_SERIAL_SAMPLE_CLOCK_H
+
+#include <stdint.h>
+
+#include "mp_platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SC_BUCKET_S      1.0
+#define SC_POINTS        64        // fit window, buckets
+#define SC_BREAKS_LOG2   10        // stream -> absolute index breakpoints kept
+
+typedef struct {
+    double dev_s;
+    double resid_s;                // min(host - device) in the bucket
+} sc_point_t;
+
+typedef struct {
+    uint64_t stream;               // stream sample index
+    uint64_t abs;                  // absolute sample index of the same sample
+} sc_break_t;
+
+typedef struct {
+    uint64_t frames;
+    uint64_t c;                    // raw counter of the last frame
+    uint64_t abs;                  // absolute index of its first sample
+    uint32_t n;                    // its samples
+    uint64_t epoch;                // counter restarts
+    uint64_t wraps;
+    uint64_t lost_frames;
+    uint64_t lost_samples;
+    uint64_t origin_mono_ns;
+    uint64_t origin_unix_ns;
+    uint32_t points;               // used in the fit
+    int      valid;                // offset known (>= 1 point), drift needs 2
+    double   offset_s;
+    double   drift;                // host s per device s - 1
+    double   jitter_s;             // rms of the bucket minima around the fit
+    double   latency_s;            // last frame arrival above the fit
+} sc_info_t;
+
+typedef struct {
+    int        primed;
+    uint32_t   rate;
+    sc_info_t  st;
+    uint64_t   bucket;
+    int        bucket_has;
+    double     bucket_min, bucket_dev;
+    sc_point_t pts[SC_POINTS];
+    uint64_t   n_pts;
+    sc_break_t breaks[(size_t)1 << SC_BREAKS_LOG2];
+    uint64_t   n_breaks;
+    mp_mutex_t mx;                 // reader thread feeds, Python reads
+} sclock_t;
+
+void sclock_init(sclock_t* s, uint32_t rate);
+void sclock_free(sclock_t* s);
+
+// Reader thread: one frame with counter c and n samples, received at host_ns
+// (mp_now_ns) as stream sample index stream; returns its absolute start index
+uint64_t sclock_feed(sclock_t* s, uint64_t c, uint32_t n, uint64_t host_ns, uint64_t stream);
+
+void sclock_info(sclock_t* s, sc_info_t* out);
+
+// Absolute start index and samples of a recent frame by its counter; 0 if unknown
+int  sclock_frame(sclock_t* s, uint64_t c, uint64_t* abs, uint32_t* n);
+
+// Absolute index of a stream sample index (within the retained breakpoints)
+uint64_t sclock_stream_to_abs(sclock_t* s, uint64_t stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_SAMPLE_CLOCK_H
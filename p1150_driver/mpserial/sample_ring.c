@@ -0,0 +1,184 @@
+// sample_ring.c
+#include "sample_ring.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const size_t sr_col_size[SR_NCOLS] = { 4, 4, 2, 1, 1 };
+
+int sample_ring_init(sample_ring_t* r, unsigned capacity_log2) {
+    memset(r, 0, sizeof(*r));
+    mp_mutex_init(&r->mx);
+    mp_cond_init(&r->cv);
+    if (capacity_log2 == 0) return 0;  // disabled
+    if (capacity_log2 < SR_MIN_LOG2 || capacity_log2 > SR_MAX_LOG2) return -1;
+
+    r->capacity = (uint64_t)1 << capacity_log2;
+    r->mask = r->capacity - 1;
+    for (int c = 0; c < SR_NCOLS; c++) {
+        r->col[c] = calloc((size_t)r->capacity, sr_col_size[c]);
+        if (!r->col[c]) {
+            sample_ring_free(r);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void sample_ring_free(sample_ring_t* r) {
+    for (int c = 0; c < SR_NCOLS; c++) {
+        free(r->col[c]);
+        r->col[c] = NULL;
+    }
+    r->capacity = 0;
+    mp_cond_destroy(&r->cv);
+    mp_mutex_destroy(&r->mx);
+}
+
+void sample_ring_close(sample_ring_t* r) {
+    mp_mutex_lock(&r->mx);
+    r->closed = 1;
+    mp_cond_broadcast(&r->cv);
+    mp_mutex_unlock(&r->mx);
+}
+
+// ----------------- Producer -----------------
+
+// n samples of one column from a frame byte string, zero filled if short
+static void put_col(sample_ring_t* r, int c, uint64_t seq, const adc_bytes_t* b, size_t n) {
+    size_t es = sr_col_size[c];
+    size_t have = b->p ? b->n / es : 0;
+    uint8_t* dst = (uint8_t*)r->col[c];
+
+    for (size_t k = 0; k < n; k++) {
+        size_t idx = (size_t)((seq + k) & r->mask);
+        if (k >= have) {
+            memset(dst + idx * es, 0, es);
+        } else if (c == SR_COL_I || c == SR_COL_ISNK) {
+            float v;
+            memcpy(&v, b->p + k * 4, 4);
+            ((float*)r->col[c])[idx] = (float)((double)v / 1000000.0);
+        } else {
+            memcpy(dst + idx * es, b->p + k * es, es);
+        }
+    }
+}
+
+uint64_t sample_ring_publish(sample_ring_t* r, const adc_frame_t* f) {
+    uint64_t n = adc_frame_samples(f);
+    if (!r->capacity || n == 0) return 0;
+    if (n > r->capacity) n = r->capacity;
+
+    uint64_t head = r->head;
+
+    // gating consumers: never overwrite what they have not read yet
+    for (int k = 0; k < SR_MAX_CONSUMERS; k++) {
+        const sr_consumer_t* c = &r->cons[k];
+        if (c->active && c->policy == SR_POLICY_GATE && head + n - c->cursor > r->capacity) {
+            r->dropped += n;
+            return 0;
+        }
+    }
+
+    // overwrite consumers re-check claim after copying: it must be visible before any
+    // of the column stores that follow (seqlock, see sample_ring_commit())
+    mp_store_release_u64(&r->claim, head + n);
+    mp_fence_release();
+    put_col(r, SR_COL_I,    head, &f->i,    (size_t)n);
+    put_col(r, SR_COL_ISNK, head, &f->isnk, (size_t)n);
+    put_col(r, SR_COL_A0,   head, &f->a0,   (size_t)n);
+    put_col(r, SR_COL_D01,  head, &f->d01,  (size_t)n);
+    put_col(r, SR_COL_D0S,  head, &f->d0s,  (size_t)n);
+    mp_store_release_u64(&r->head, head + n);
+
+    mp_mutex_lock(&r->mx);
+    if (r->waiters) mp_cond_broadcast(&r->cv);
+    mp_mutex_unlock(&r->mx);
+    return n;
+}
+
+// ----------------- Consumers -----------------
+
+int sample_ring_attach(sample_ring_t* r, const char* name, int policy, uint64_t wake) {
+    int id = -1;
+    mp_mutex_lock(&r->mx);
+    for (int k = 0; k < SR_MAX_CONSUMERS; k++) {
+        sr_consumer_t* c = &r->cons[k];
+        if (c->active) continue;
+        memset(c, 0, sizeof(*c));
+        snprintf(c->name, sizeof(c->name), "%s", name ? name : "");
+        c->policy = policy;
+        c->wake = wake ? wake : 1;
+        c->cursor = mp_load_acquire_u64(&r->head);
+        c->active = 1;
+        id = k;
+        break;
+    }
+    mp_mutex_unlock(&r->mx);
+    return id;
+}
+
+void sample_ring_detach(sample_ring_t* r, int id) {
+    if (id < 0 || id >= SR_MAX_CONSUMERS) return;
+    mp_mutex_lock(&r->mx);
+    r->cons[id].active = 0;
+    mp_mutex_unlock(&r->mx);
+}
+
+uint64_t sample_ring_poll(sample_ring_t* r, int id, uint64_t* start) {
+    sr_consumer_t* c = &r->cons[id];
+    uint64_t head = mp_load_acquire_u64(&r->head);
+    uint64_t claim = mp_load_acquire_u64(&r->claim);
+
+    // lapped: skip to the oldest sample the producer is not about to overwrite
+    if (c->policy == SR_POLICY_OVERWRITE && claim > r->capacity && c->cursor < claim - r->capacity) {
+        uint64_t oldest = claim - r->capacity;
+        c->overrun += oldest - c->cursor;
+        c->cursor = oldest;
+    }
+
+    uint64_t avail = head - c->cursor;
+    if (avail > c->max_lag) c->max_lag = avail;
+    if (start) *start = c->cursor;
+    return avail;
+}
+
+uint64_t sample_ring_wait(sample_ring_t* r, int id, uint64_t min, unsigned timeout_ms) {
+    sr_consumer_t* c = &r->cons[id];
+    uint64_t need = min ? min : c->wake;
+    uint64_t deadline = mp_now_ns() / 1000000u + timeout_ms;
+
+    mp_mutex_lock(&r->mx);
+    r->waiters++;
+    for (;;) {
+        uint64_t head = mp_load_acquire_u64(&r->head);
+        if (head - c->cursor >= need || r->closed) break;
+        uint64_t now = mp_now_ns() / 1000000u;
+        if (now >= deadline) break;
+        mp_cond_wait_ms(&r->cv, &r->mx, (unsigned)(deadline - now));
+    }
+    r->waiters--;
+    mp_mutex_unlock(&r->mx);
+
+    uint64_t avail = sample_ring_poll(r, id, NULL);
+    return avail >= need ? avail : 0;
+}
+
+uint64_t sample_ring_commit(sample_ring_t* r, int id, uint64_t n) {
+    sr_consumer_t* c = &r->cons[id];
+    uint64_t head = mp_load_acquire_u64(&r->head);
+    uint64_t start = c->cursor;
+    if (n > head - start) n = head - start;
+
+    uint64_t overwritten = 0;
+    if (c->policy == SR_POLICY_OVERWRITE) {
+        mp_fence_acquire();   // the consumer's copy happens before the claim re-check
+        uint64_t claim = mp_load_acquire_u64(&r->claim);
+        uint64_t oldest = claim > r->capacity ? claim - r->capacity : 0;
+        if (start < oldest) overwritten = (oldest - start < n) ? oldest - start : n;
+    }
+
+    mp_store_release_u64(&c->cursor, start + n);
+    c->consumed += n;
+    return overwritten;
+}
@@ -0,0 +1,101 @@
+// sample_ring.h
+// Shared ADC sample ring with independent consumer cursors (disruptor style).
+//
+// The reader thread is the single producer: each ADC frame is decoded straight into
+// column arrays (i, isnk, a0, d01, d0s) indexed by the absolute sample sequence
+// number modulo the capacity.  Consumers never get copies, they read the columns in
+// place between their own cursor and the published head, then commit.
+//
+// Every consumer has its own
+//   cursor  - next sample sequence number to read, lag = head - cursor
+//   policy  - SR_POLICY_OVERWRITE: the producer never waits, a consumer that falls
+//             a full ring behind is lapped (cursor jumps, samples counted as overrun)
+//             SR_POLICY_GATE: the producer never overwrites unread samples of this
+//             consumer, when it is full new frames are dropped for everyone (counted)
+//   wake    - sample_ring_wait() returns once this many samples are available
+// so a slow plotter (overwrite) cannot stall a recorder (gate) and vice versa.
+//
+// Overwrite consumers read without a lock, sample_ring_commit() reports how many of
+// the samples just read may have been overwritten meanwhile (0 = data was valid).
+#ifndef MP_SERIAL_SAMPLE_RING_H
+#define MP_SERIAL_SAMPLE_RING_H
+
+#include <stdint.h>
+
+#include "mp_platform.h"
+#include "adc_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SR_MAX_CONSUMERS   16
+#define SR_NAME_LEN        32
+#define SR_MIN_LOG2        10
+#define SR_MAX_LOG2        26
+
+#define SR_POLICY_OVERWRITE 0
+#define SR_POLICY_GATE      1
+
+// Columns, same units as the Python pipeline: i/isnk in mA (firmware value / 1e6)
+enum { SR_COL_I, SR_COL_ISNK, SR_COL_A0, SR_COL_D01, SR_COL_D0S, SR_NCOLS };
+
+typedef struct {
+    int               active;
+    char              name[SR_NAME_LEN];
+    int               policy;
+    volatile uint64_t cursor;     // next sample to read
+    uint64_t          wake;       // samples available before a waiter is woken
+    uint64_t          overrun;    // samples lost by being lapped
+    uint64_t          consumed;   // samples committed
+    uint64_t          max_lag;
+} sr_consumer_t;
+
+typedef struct {
+    void*             col[SR_NCOLS];
+    uint64_t          capacity;   // samples, power of two
+    uint64_t          mask;
+    volatile uint64_t claim;      // producer is writing [head, claim)
+    volatile uint64_t head;       // samples published
+    uint64_t          dropped;    // samples not written, a gating consumer was full
+    volatile int      closed;
+
+    mp_mutex_t        mx;         // consumer table + waiters
+    mp_cond_t         cv;
+    int               waiters;
+    sr_consumer_t     cons[SR_MAX_CONSUMERS];
+} sample_ring_t;
+
+// Bytes per sample over all columns
+#define SR_SAMPLE_BYTES (4 + 4 + 2 + 1 + 1)
+
+int  sample_ring_init(sample_ring_t* r, unsigned capacity_log2);   // 0 on success
+void sample_ring_free(sample_ring_t* r);
+static inline int sample_ring_enabled(const sample_ring_t* r) { return r->capacity != 0; }
+
+// Producer (reader thread): append one decoded frame, returns samples written
+uint64_t sample_ring_publish(sample_ring_t* r, const adc_frame_t* f);
+
+// Wake all waiters and make further waits return immediately (shutdown)
+void sample_ring_close(sample_ring_t* r);
+
+// Consumers.  attach starts at the current head; returns id or -1 when full.
+int      sample_ring_attach(sample_ring_t* r, const char* name, int policy, uint64_t wake);
+void     sample_ring_detach(sample_ring_t* r, int id);
+
+// Readable range [*start, *start + n), after catching up a lapped consumer
+uint64_t sample_ring_poll(sample_ring_t* r, int id, uint64_t* start);
+
+// Block until min samples (0: the consumer's wake) are readable or timeout;
+// returns samples readable, 0 on timeout or close
+uint64_t sample_ring_wait(sample_ring_t* r, int id, uint64_t min, unsigned timeout_ms);
+
+// Advance the cursor by n; returns how many of those samples may have been
+// overwritten while they were read (always 0 for gating consumers)
+uint64_t sample_ring_commit(sample_ring_t* r, int id, uint64_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_SAMPLE_RING_H
@@ -0,0 +1,178 @@
+// segment.c
+#include "segment.h"
+
+#include <math.h>
+#include <string.h>
+
+#define SEG_RECORDS_CAP   ((uint64_t)1 << SEG_RECORDS_LOG2)
+#define SEG_RECORDS_MASK  (SEG_RECORDS_CAP - 1)
+
+static inline void acc_clear(seg_acc_t* a) {
+    memset(a, 0, sizeof(*a));
+}
+
+static inline void acc_merge(seg_acc_t* a, const seg_acc_t* b) {
+    if (b->n == 0) return;
+    if (a->n == 0 || b->peak > a->peak) a->peak = b->peak;
+    if (a->n == 0 || b->min < a->min) a->min = b->min;
+    a->n += b->n;
+    a->blocks += b->blocks;
+    a->sum += b->sum;
+    a->sum_y += b->sum_y;
+}
+
+int seg_init(seg_t* s) {
+    memset(s, 0, sizeof(*s));
+    mp_mutex_init(&s->mx);
+    s->recs = (seg_record_t*)calloc((size_t)SEG_RECORDS_CAP, sizeof(seg_record_t));
+    if (!s->recs) return -1;
+    s->cfg.block = 25;          // 200 us
+    s->cfg.k = 0.05;
+    s->cfg.h = 1.0;
+    s->cfg.floor_ma = 1e-4;
+    s->cfg.min_blocks = 4;
+    return 0;
+}
+
+void seg_free(seg_t* s) {
+    free(s->recs);
+    s->recs = NULL;
+    mp_mutex_destroy(&s->mx);
+}
+
+// lock held: restart the CUSUMs at the next block
+static void cusum_restart(seg_t* s) {
+    for (int d = 0; d < 2; d++) {
+        s->g[d] = 0.0;
+        acc_clear(&s->pend[d]);
+        s->pend_start[d] = s->next;
+        s->peak_pre[d] = s->full.peak;
+        s->min_pre[d] = s->full.min;
+    }
+}
+
+void seg_reset(seg_t* s, const seg_cfg_t* cfg, uint64_t base) {
+    mp_mutex_lock(&s->mx);
+    if (cfg) s->cfg = *cfg;
+    acc_clear(&s->blk);
+    acc_clear(&s->full);
+    s->next = base;
+    s->start = base;
+    s->n_recs = 0;
+    s->since = base;
+    cusum_restart(s);
+    mp_mutex_unlock(&s->mx);
+}
+
+static void record(seg_t* s, uint64_t start, const seg_acc_t* a, seg_record_t* r) {
+    r->number = s->n_recs;
+    r->start = start;
+    r->n = a->n;
+    r->charge_uc = a->sum * 1000.0 / ADC_SAMPLE_RATE_HZ;
+    r->mean_ma = a->n ? a->sum / (double)a->n : 0.0;
+    r->peak_ma = a->peak;
+    r->min_ma = a->min;
+}
+
+// lock held: the blocks of pend[d] start a new segment
+static void split(seg_t* s, int d) {
+    seg_acc_t old = s->full;
+    const seg_acc_t* p = &s->pend[d];
+    old.n -= p->n;
+    old.blocks -= p->blocks;
+    old.sum -= p->sum;
+    old.sum_y -= p->sum_y;
+    old.peak = s->peak_pre[d];
+    old.min = s->min_pre[d];
+
+    if (old.blocks != 0) {
+        record(s, s->start, &old, &s->recs[s->n_recs & SEG_RECORDS_MASK]);
+        s->n_recs++;
+        s->full = *p;
+        s->start = s->pend_start[d];
+    }
+    cusum_restart(s);
+}
+
+// lock held: one complete block
+static void block_done(seg_t* s) {
+    seg_acc_t* b = &s->blk;
+    double mean = b->sum / (double)b->n;
+    double y = log10(mean > s->cfg.floor_ma ? mean : s->cfg.floor_ma);
+    b->blocks = 1;
+    b->sum_y = y;
+
+    if (s->full.blocks < s->cfg.min_blocks) {
+        acc_merge(&s->full, b);
+        cusum_restart(s);
+    } else {
+        double mu = s->full.sum_y / (double)s->full.blocks;
+        double g[2] = { s->g[0] + (y - mu) - s->cfg.k, s->g[1] - (y - mu) - s->cfg.k };
+        acc_merge(&s->full, b);
+        for (int d = 0; d < 2; d++) {
+            if (g[d] <= 0.0) {
+                s->g[d] = 0.0;
+                acc_clear(&s->pend[d]);
+                s->pend_start[d] = s->next;
+                s->peak_pre[d] = s->full.peak;
+                s->min_pre[d] = s->full.min;
+            } else {
+                s->g[d] = g[d];
+                acc_merge(&s->pend[d], b);
+            }
+        }
+        if (s->g[0] > s->cfg.h) split(s, 0);
+        else if (s->g[1] > s->cfg.h) split(s, 1);
+    }
+    acc_clear(b);
+}
+
+void seg_feed(seg_t* s, uint64_t base, const adc_frame_t* f) {
+    size_t n = adc_frame_samples(f);
+    if (n == 0) return;
+
+    mp_mutex_lock(&s->mx);
+    if (base != s->next) {
+        // first frame after a reset, samples before it belong to no segment
+        if (s->full.n == 0 && s->blk.n == 0) {
+            s->start = base;
+            for (int d = 0; d < 2; d++) s->pend_start[d] = base;
+        }
+        s->next = base;
+    }
+    for (size_t k = 0; k < n; k++) {
+        float v;
+        memcpy(&v, f->i.p + k * 4, 4);
+        float ma = (float)((double)v / 1000000.0);
+        seg_acc_t* b = &s->blk;
+        if (b->n == 0 || ma > b->peak) b->peak = ma;
+        if (b->n == 0 || ma < b->min) b->min = ma;
+        b->n++;
+        b->sum += ma;
+        s->next++;
+        if (b->n >= s->cfg.block) block_done(s);
+    }
+    mp_mutex_unlock(&s->mx);
+}
+
+size_t seg_records(seg_t* s, uint64_t since, seg_record_t* out, size_t cap, uint64_t* next) {
+    size_t cnt = 0;
+    mp_mutex_lock(&s->mx);
+    uint64_t lo = s->n_recs > SEG_RECORDS_CAP ? s->n_recs - SEG_RECORDS_CAP : 0;
+    uint64_t k = since < lo ? lo : since;
+    for (; k < s->n_recs && cnt < cap; k++) {
+        out[cnt++] = s->recs[k & SEG_RECORDS_MASK];
+    }
+    *next = k;
+    mp_mutex_unlock(&s->mx);
+    return cnt;
+}
+
+int seg_open(seg_t* s, seg_record_t* out) {
+    mp_mutex_lock(&s->mx);
+    seg_acc_t a = s->full;
+    acc_merge(&a, &s->blk);
+    record(s, s->start, &a, out);
+    mp_mutex_unlock(&s->mx);
+    return a.n != 0;
+}
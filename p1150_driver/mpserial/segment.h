@@ -0,0 +1,95 @@
+// segment.h
+// Streaming power state segmentation of i (changepoint detection).
+//
+// Samples are averaged into blocks, each block mean is taken in the log domain
+//   y = log10(max(mean_ma, floor_ma))
+// so one threshold works from sleep (uA) to radio TX (100s of mA), and a two sided
+// CUSUM against the running mean of the open segment detects level changes:
+//   g+ = max(0, g+ + (y - mu) - k),  g- = max(0, g- - (y - mu) - k),  change if g > h
+// The change is dated back to the block after that CUSUM was last zero; the blocks
+// since then move to the new segment, so segment edges are not late by the detection
+// delay.  Closed segments (start, samples, mean, peak, min, charge) are numbered and
+// kept in a ring, small enough to cover whole soak tests.
+#ifndef MP_SERIAL_SEGMENT_H
+#define MP_SERIAL_SEGMENT_H
+
+#include <stdint.h>
+
+#include "mp_platform.h"
+#include "adc_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SEG_RECORDS_LOG2   14          // closed segments retained
+
+typedef struct {
+    uint64_t n;          // samples
+    uint64_t blocks;
+    double   sum;        // mA * samples
+    double   sum_y;      // block log means
+    float    peak;
+    float    min;
+} seg_acc_t;
+
+// Closed segment as handed to Python, fixed little-endian layout (48 bytes)
+typedef struct {
+    uint64_t number;
+    uint64_t start;      // stream sample index
+    uint64_t n;          // samples
+    double   charge_uc;
+    double   mean_ma;
+    float    peak_ma;
+    float    min_ma;
+} seg_record_t;
+
+typedef struct {
+    uint32_t block;         // samples per block
+    double   k;             // drift allowance, decades per block
+    double   h;             // decision threshold, decades
+    double   floor_ma;      // block means below are clamped (noise floor)
+    uint32_t min_blocks;    // open segment length before changes are tested
+} seg_cfg_t;
+
+typedef struct {
+    seg_cfg_t     cfg;
+
+    seg_acc_t     blk;            // block in progress
+    uint64_t      next;           // stream sample index of the next sample
+
+    uint64_t      start;          // open segment
+    seg_acc_t     full;
+    double        g[2];           // CUSUM up / down
+    seg_acc_t     pend[2];        // blocks since g[d] was last zero
+    uint64_t      pend_start[2];
+    float         peak_pre[2];    // open segment peak/min before pend[d]
+    float         min_pre[2];
+
+    seg_record_t* recs;
+    uint64_t      n_recs;         // closed segments ever
+    uint64_t      since;          // stream sample index of the last reset
+    mp_mutex_t    mx;             // reader thread feeds, Python reads
+} seg_t;
+
+int  seg_init(seg_t* s);          // 0 on success
+void seg_free(seg_t* s);
+
+// Reader thread: feed one frame starting at stream sample index base
+void seg_feed(seg_t* s, uint64_t base, const adc_frame_t* f);
+
+// Drop the open segment and all records; cfg NULL keeps the configuration
+void seg_reset(seg_t* s, const seg_cfg_t* cfg, uint64_t base);
+
+// Closed segments numbered >= since still retained, at most cap, oldest first;
+// *next is the number to pass as since on the next call
+size_t seg_records(seg_t* s, uint64_t since, seg_record_t* out, size_t cap, uint64_t* next);
+
+// Snapshot of the open segment (number = next record number); 0 if empty
+int  seg_open(seg_t* s, seg_record_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_SEGMENT_H
@@ -0,0 +1,395 @@
+// seqcap.c
+#include "seqcap.h"
+
+#include <math.h>
+#include <string.h>
+
+enum { SEQCAP_BUF_FREE, SEQCAP_BUF_FILL, SEQCAP_BUF_READY };
+
+// Column offsets of a sequence block
+typedef struct {
+    size_t i, isnk, a0, d01, d0s, segs, bytes;
+} seqcap_layout_t;
+
+static seqcap_layout_t layout(const seqcap_cfg_t* cfg) {
+    const size_t n = (size_t)cfg->segments * ((size_t)cfg->pre + cfg->post);
+    seqcap_layout_t l;
+    l.i = 0;
+    l.isnk = 4 * n;
+    l.a0 = 8 * n;
+    l.d01 = 10 * n;
+    l.d0s = 11 * n;
+    l.segs = (12 * n + 7) & ~(size_t)7;
+    l.bytes = l.segs + (size_t)cfg->segments * sizeof(seqcap_seg_t);
+    return l;
+}
+
+size_t seqcap_bytes(const seqcap_cfg_t* cfg) {
+    return layout(cfg).bytes;
+}
+
+static void free_bufs(seqcap_t* s) {
+    for (int b = 0; b < SEQCAP_BUFS; b++) {
+        free(s->buf[b].mem);
+        memset(&s->buf[b], 0, sizeof(seqcap_buf_t));
+    }
+    s->bytes = 0;
+}
+
+void seqcap_init(seqcap_t* s) {
+    memset(s, 0, sizeof(*s));
+    s->cons = -1;
+    s->cur = -1;
+    mp_mutex_init(&s->mx);
+    mp_cond_init(&s->cv);
+}
+
+void seqcap_free(seqcap_t* s) {
+    seqcap_stop(s);
+    free_bufs(s);
+    mp_cond_destroy(&s->cv);
+    mp_mutex_destroy(&s->mx);
+}
+
+void seqcap_stats(seqcap_t* s, seqcap_stats_t* out) {
+    mp_mutex_lock(&s->mx);
+    *out = s->st;
+    mp_mutex_unlock(&s->mx);
+}
+
+// ----------------- Capture (capture thread) -----------------
+
+// Copy n samples of column c starting at seq out of the ring
+static void copy_col(const sample_ring_t* ring, int c, size_t es, uint64_t seq, uint64_t n, uint8_t* dst) {
+    uint64_t off = seq & ring->mask;
+    uint64_t first = ring->capacity - off < n ? ring->capacity - off : n;
+    memcpy(dst, (const uint8_t*)ring->col[c] + off * es, (size_t)(first * es));
+    if (n > first) memcpy(dst + first * es, ring->col[c], (size_t)((n - first) * es));
+}
+
+// Sequence for a new trigger (lock held), -1 when none is free or capture is done
+static int take_slot(seqcap_t* s) {
+    if (s->cur >= 0) return s->cur;
+    if (!s->st.armed) return -1;
+    for (int b = 0; b < SEQCAP_BUFS; b++) {
+        seqcap_buf_t* v = &s->buf[b];
+        if (v->mem && v->state == SEQCAP_BUF_FREE) {
+            v->state = SEQCAP_BUF_FILL;
+            v->number = s->st.sequences;
+            v->fill = 0;
+            s->cur = b;
+            return b;
+        }
+    }
+    return -1;
+}
+
+static void write_segment(seqcap_t* s) {
+    sample_ring_t* ring = s->ring;
+    const seqcap_layout_t l = layout(&s->cfg);
+    const uint64_t w = (uint64_t)s->cfg.pre + s->cfg.post;
+    seqcap_buf_t* b = &s->buf[s->slot_buf];
+    const size_t at = (size_t)b->fill * (size_t)w;
+
+    // [lo, trig_seq + post), the first head samples of the slot are not available
+    uint64_t lo = s->trig_seq > s->cfg.pre ? s->trig_seq - s->cfg.pre : 0;
+    uint64_t head = s->cfg.pre - (s->trig_seq - lo);
+    uint64_t avail = s->st.start_seq;
+    uint64_t oldest = mp_load_acquire_u64(&ring->claim);
+    oldest = oldest > ring->capacity ? oldest - ring->capacity : 0;
+    if (oldest > avail) avail = oldest;
+    if (avail > lo) {
+        head += avail - lo;
+        lo = avail;
+    }
+    if (head > w) head = w;   // lapped past the end of the window: nothing left to copy
+    uint16_t flags = head ? REC_EVENT_TRUNCATED : 0;
+    const uint64_t n = w - head;
+
+    float* ci = (float*)(b->mem + l.i) + at;
+    float* cs = (float*)(b->mem + l.isnk) + at;
+    uint16_t* ca = (uint16_t*)(b->mem + l.a0) + at;
+    uint8_t* cd = b->mem + l.d01 + at;
+    uint8_t* cc = b->mem + l.d0s + at;
+    for (uint64_t k = 0; k < head; k++) ci[k] = cs[k] = NAN;
+    memset(ca, 0, (size_t)head * 2);
+    memset(cd, 0, (size_t)head);
+    memset(cc, 0, (size_t)head);
+    if (n) {
+        copy_col(ring, SR_COL_I, 4, lo, n, (uint8_t*)(ci + head));
+        copy_col(ring, SR_COL_ISNK, 4, lo, n, (uint8_t*)(cs + head));
+        copy_col(ring, SR_COL_A0, 2, lo, n, (uint8_t*)(ca + head));
+        copy_col(ring, SR_COL_D01, 1, lo, n, cd + head);
+        copy_col(ring, SR_COL_D0S, 1, lo, n, cc + head);
+    }
+
+    // the producer may have lapped the window while it was copied
+    mp_fence_acquire();
+    uint64_t claim = mp_load_acquire_u64(&ring->claim);
+    if (claim > ring->capacity && claim - ring->capacity > lo) flags |= REC_EVENT_TRUNCATED;
+
+    seqcap_seg_t* e = (seqcap_seg_t*)(b->mem + l.segs) + b->fill;
+    memset(e, 0, sizeof(*e));
+    e->trigger_seq = s->trig_seq;
+    e->host_ns = s->trig_ns;
+    e->trigger = s->trig_idx;
+    e->flags = flags;
+
+    const uint64_t now = mp_now_ns();
+    mp_mutex_lock(&s->mx);
+    e->number = s->st.segments++;
+    if (flags) s->st.truncated++;
+    if (s->prev_trig != UINT64_MAX) {
+        uint64_t d = s->trig_seq - s->prev_trig;
+        if (s->st.min_interval == 0 || d < s->st.min_interval) s->st.min_interval = d;
+    }
+    s->prev_trig = s->trig_seq;
+    if (!s->st.first_ns) s->st.first_ns = now;
+    s->st.last_ns = now;
+    s->st.fill = ++b->fill;
+    if (b->fill == s->cfg.segments) {
+        b->state = SEQCAP_BUF_READY;
+        s->cur = -1;
+        s->st.fill = 0;
+        s->st.sequences++;
+        s->st.ready++;
+        if (!(s->cfg.flags & SEQCAP_CONTINUOUS)) s->st.armed = 0;
+        mp_cond_broadcast(&s->cv);
+    }
+    mp_mutex_unlock(&s->mx);
+}
+
+// One contiguous ring segment [seq, seq + n)
+static void scan(seqcap_t* s, uint64_t seq, size_t n) {
+    sample_ring_t* ring = s->ring;
+    size_t off = (size_t)(seq & ring->mask);
+    const float* ci = (const float*)ring->col[SR_COL_I] + off;
+    const float* cs = (const float*)ring->col[SR_COL_ISNK] + off;
+    const uint8_t* cd = (const uint8_t*)ring->col[SR_COL_D01] + off;
+    const uint8_t* cc = (const uint8_t*)ring->col[SR_COL_D0S] + off;
+
+    size_t k = 0;
+    while (k < n) {
+        if (s->pending) {
+            uint64_t end = s->trig_seq + s->cfg.post;
+            if (end > seq + n) break;
+            if (s->slot_buf >= 0) write_segment(s);
+            s->pending = 0;
+            k = end > seq ? (size_t)(end - seq) : 0;   // re-armed from the end of the window
+            continue;
+        }
+
+        size_t hit = n;
+        uint16_t idx = 0;
+        for (uint32_t t = 0; t < s->cfg.n_trig; t++) {
+            size_t h = rec_trig_find(&s->cfg.trig[t], ci, cs, cd, cc, &s->last, k, hit);
+            if (h < hit) { hit = h; idx = (uint16_t)t; }
+        }
+        if (hit == n) break;
+
+        int armed;
+        mp_mutex_lock(&s->mx);
+        armed = s->st.armed;
+        s->slot_buf = take_slot(s);
+        if (armed && s->slot_buf < 0) s->st.missed++;
+        mp_mutex_unlock(&s->mx);
+        if (armed) {
+            s->trig_seq = seq + hit;
+            s->trig_idx = idx;
+            s->trig_ns = mp_unix_ns();
+            s->pending = 1;
+        }
+        k = hit + 1;
+    }
+
+    s->last.i = ci[n - 1];
+    s->last.isnk = cs[n - 1];
+    s->last.d01 = cd[n - 1];
+    s->last.d0s = cc[n - 1];
+    s->last.have = 1;
+}
+
+// Process everything readable now
+static void drain(seqcap_t* s) {
+    sample_ring_t* ring = s->ring;
+    uint64_t start;
+    uint64_t n = sample_ring_poll(ring, s->cons, &start);
+    if (n == 0) return;
+    const uint64_t t0 = mp_now_ns();
+    if (start != s->st.seq) {
+        // lapped: samples skipped, the pending window (if any) comes out truncated
+        mp_mutex_lock(&s->mx);
+        s->st.lost += start - s->st.seq;
+        mp_mutex_unlock(&s->mx);
+        s->last.have = 0;
+    }
+
+    uint64_t p = start, end = start + n;
+    while (p < end) {
+        uint64_t off = p & ring->mask;
+        uint64_t len = ring->capacity - off < end - p ? ring->capacity - off : end - p;
+        scan(s, p, (size_t)len);
+        p += len;
+    }
+    mp_mutex_lock(&s->mx);
+    s->st.seq = end;
+    s->st.busy_ns += mp_now_ns() - t0;
+    mp_mutex_unlock(&s->mx);
+    (void)sample_ring_commit(ring, s->cons, n);
+}
+
+static void* seqcap_thread(void* param) {
+    seqcap_t* s = (seqcap_t*)param;
+    sample_ring_t* ring = s->ring;
+
+    while (s->alive) {
+        if (sample_ring_wait(ring, s->cons, SEQCAP_WAKE, 100) == 0) {
+            if (ring->closed) mp_sleep_ms(10);
+            continue;
+        }
+        drain(s);
+    }
+    drain(s);   // what arrived up to the stop
+    return NULL;
+}
+
+// ----------------- Control -----------------
+
+int seqcap_start(seqcap_t* s, sample_ring_t* ring, const seqcap_cfg_t* cfg) {
+    seqcap_stop(s);
+    if (!sample_ring_enabled(ring) || cfg->n_trig == 0 || cfg->n_trig > REC_MAX_TRIGGERS || cfg->post == 0
+        || cfg->segments == 0 || cfg->segments > SEQCAP_MAX_SEGMENTS
+        || (uint64_t)cfg->pre + cfg->post > ring->capacity / 2) {
+        return -1;
+    }
+
+    // one sequence for a single capture, a spare to fill while the other is taken
+    const int nb = (cfg->flags & SEQCAP_CONTINUOUS) ? SEQCAP_BUFS : 1;
+    const size_t bytes = seqcap_bytes(cfg);
+    uint8_t* mem[SEQCAP_BUFS] = { NULL, NULL };
+    for (int b = 0; b < nb; b++) {
+        mem[b] = (uint8_t*)malloc(bytes);
+        if (!mem[b]) {
+            for (int k = 0; k < b; k++) free(mem[k]);
+            return -2;
+        }
+    }
+
+    mp_mutex_lock(&s->mx);
+    free_bufs(s);
+    for (int b = 0; b < nb; b++) s->buf[b].mem = mem[b];
+    s->bytes = bytes;
+    mp_mutex_unlock(&s->mx);
+
+    s->cons = sample_ring_attach(ring, "seqcap", SR_POLICY_OVERWRITE, SEQCAP_WAKE);
+    if (s->cons < 0) {
+        mp_mutex_lock(&s->mx);
+        free_bufs(s);
+        mp_mutex_unlock(&s->mx);
+        return -3;
+    }
+
+    s->ring = ring;
+    s->cfg = *cfg;
+    s->last.have = 0;
+    s->pending = 0;
+    s->cur = -1;
+    s->prev_trig = UINT64_MAX;
+    uint64_t start;
+    (void)sample_ring_poll(ring, s->cons, &start);
+
+    mp_mutex_lock(&s->mx);
+    memset(&s->st, 0, sizeof(s->st));
+    s->st.running = 1;
+    s->st.armed = 1;
+    s->st.pre = cfg->pre;
+    s->st.post = cfg->post;
+    s->st.slots = cfg->segments;
+    s->st.start_seq = start;
+    s->st.seq = start;
+    s->st.bytes = bytes;
+    mp_mutex_unlock(&s->mx);
+
+    s->alive = 1;
+    if (mp_thread_start(&s->th, seqcap_thread, s) != 0) {
+        s->alive = 0;
+        sample_ring_detach(ring, s->cons);
+        s->cons = -1;
+        mp_mutex_lock(&s->mx);
+        free_bufs(s);
+        s->st.running = 0;
+        s->st.armed = 0;
+        mp_mutex_unlock(&s->mx);
+        return -4;
+    }
+    return 0;
+}
+
+void seqcap_stop(seqcap_t* s) {
+    if (s->cons < 0) return;
+    s->alive = 0;
+    mp_thread_join(&s->th);
+    sample_ring_detach(s->ring, s->cons);
+    s->cons = -1;
+
+    mp_mutex_lock(&s->mx);
+    if (s->cur >= 0) {
+        seqcap_buf_t* b = &s->buf[s->cur];
+        if (b->fill) {
+            b->state = SEQCAP_BUF_READY;
+            s->st.sequences++;
+            s->st.ready++;
+        } else {
+            b->state = SEQCAP_BUF_FREE;
+        }
+        s->cur = -1;
+    }
+    s->st.fill = 0;
+    s->st.running = 0;
+    s->st.armed = 0;
+    mp_cond_broadcast(&s->cv);
+    mp_mutex_unlock(&s->mx);
+}
+
+// ----------------- Readers -----------------
+
+int seqcap_wait(seqcap_t* s, unsigned timeout_ms) {
+    const uint64_t deadline = mp_now_ms() + timeout_ms;
+    mp_mutex_lock(&s->mx);
+    while (!s->st.ready && s->st.running) {
+        uint64_t now = mp_now_ms();
+        if (now >= deadline) break;
+        mp_cond_wait_ms(&s->cv, &s->mx, (unsigned)(deadline - now));
+    }
+    int ready = s->st.ready != 0;
+    mp_mutex_unlock(&s->mx);
+    return ready;
+}
+
+int seqcap_take(seqcap_t* s, uint8_t* out, size_t cap, uint64_t* number, uint32_t* segments) {
+    int rv = 0;
+    mp_mutex_lock(&s->mx);
+    int pick = -1;
+    for (int b = 0; b < SEQCAP_BUFS; b++) {
+        if (s->buf[b].mem && s->buf[b].state == SEQCAP_BUF_READY
+            && (pick < 0 || s->buf[b].number < s->buf[pick].number)) {
+            pick = b;
+        }
+    }
+    if (pick >= 0 && cap < s->bytes) {
+        rv = -1;
+    } else if (pick >= 0) {
+        // copied under the lock: the capture thread only waits for it on its next trigger
+        seqcap_buf_t* b = &s->buf[pick];
+        memcpy(out, b->mem, s->bytes);
+        *number = b->number;
+        *segments = b->fill;
+        b->state = SEQCAP_BUF_FREE;
+        b->fill = 0;
+        s->st.ready--;
+        s->st.taken++;
+        rv = 1;
+    }
+    mp_mutex_unlock(&s->mx);
+    return rv;
+}
@@ -0,0 +1,140 @@
+// seqcap.h
+// Segmented memory (sequence) capture for high trigger rates.
+//
+// Like the recorder, a native thread follows the sample ring as an overwrite consumer,
+// the ring being the pre-trigger buffer, and evaluates the triggers (rec_trig_find(),
+// OR-ed) at full rate in place.  Each trigger's [trigger - pre, trigger + post) window is
+// copied into the next of `segments` equal slots of a preallocated sequence, and the
+// triggers re-arm right at the end of the window: there is no per trigger callback,
+// allocation or buffer refill, the dead time between segments is the window itself.
+// A full sequence is handed over as one block (seqcap_take()).  Two sequences are
+// preallocated so that with SEQCAP_CONTINUOUS capture goes on into the other one while
+// the first is taken; triggers while neither is free are counted as missed.
+//
+// Sequence block, n = segments, w = pre + post, columns segment-major:
+//   i <f4[n * w], isnk <f4[n * w] (mA), a0 <u2[n * w], d01 u1[n * w], d0s u1[n * w],
+//   padding to 8, n x seqcap_seg_t
+// Sample pre of every segment is its trigger.  Samples not available (before the start
+// or overwritten in the ring before they were copied) are NaN in i/isnk and 0 in the
+// other columns, and the segment is flagged REC_EVENT_TRUNCATED.
+#ifndef MP_SERIAL_SEQCAP_H
+#define MP_SERIAL_SEQCAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mp_platform.h"
+#include "sample_ring.h"
+#include "recording.h"
+#include "recorder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SEQCAP_WAKE          256        // samples per capture thread wake-up
+#define SEQCAP_BUFS          2          // preallocated sequences
+#define SEQCAP_MAX_SEGMENTS  65536u
+
+#define SEQCAP_CONTINUOUS    0x0001u    // seqcap_cfg_t.flags: capture sequences until stopped
+
+typedef struct {
+    uint32_t      pre;          // samples before the trigger
+    uint32_t      post;         // samples from the trigger on
+    uint32_t      segments;     // per sequence
+    uint32_t      flags;        // SEQCAP_*
+    uint32_t      n_trig;
+    rec_trigger_t trig[REC_MAX_TRIGGERS];
+} seqcap_cfg_t;
+
+typedef struct {                // 32 bytes, read by Python
+    uint64_t trigger_seq;       // sample index of the trigger
+    uint64_t host_ns;           // wall clock when the trigger was seen
+    uint64_t number;            // segment number since the start
+    uint16_t trigger;           // index into seqcap_cfg_t.trig
+    uint16_t flags;             // REC_EVENT_TRUNCATED
+    uint32_t reserved;
+} seqcap_seg_t;
+
+typedef struct {
+    int      running;
+    int      armed;             // a free sequence takes the next trigger
+    uint32_t pre, post;         // configuration of the sequences
+    uint32_t slots;             // segments per sequence
+    uint64_t start_seq;
+    uint64_t seq;               // next sample to scan
+    uint64_t segments;          // captured
+    uint64_t sequences;         // completed (full, or partial at the stop)
+    uint64_t taken;
+    uint64_t missed;            // triggers while no sequence was free
+    uint64_t truncated;
+    uint64_t lost;              // samples overwritten before the thread saw them
+    uint32_t fill;              // segments in the sequence being filled
+    uint32_t ready;             // sequences waiting to be taken
+    uint64_t min_interval;      // fewest samples between two captured triggers, 0 none yet
+    uint64_t first_ns;          // monotonic time of the first and the last captured segment
+    uint64_t last_ns;
+    uint64_t busy_ns;           // capture thread time spent scanning and copying
+    uint64_t bytes;             // one sequence block
+} seqcap_stats_t;
+
+typedef struct {
+    uint8_t* mem;
+    int      state;             // SEQCAP_BUF_* (seqcap.c)
+    uint64_t number;            // sequence number
+    uint32_t fill;
+} seqcap_buf_t;
+
+typedef struct {
+    sample_ring_t*  ring;
+    int             cons;
+    seqcap_cfg_t    cfg;
+    mp_thread_t     th;
+    volatile int    alive;
+    size_t          bytes;
+    seqcap_buf_t    buf[SEQCAP_BUFS];
+
+    // capture thread only
+    rec_last_t      last;
+    int             pending;      // trigger seen, waiting for the post-trigger samples
+    int             slot_buf;     // sequence the pending window goes to, -1 missed
+    uint64_t        trig_seq;
+    uint16_t        trig_idx;
+    uint64_t        trig_ns;
+    uint64_t        prev_trig;    // last captured trigger, UINT64_MAX none
+    int             cur;          // sequence being filled, -1 none
+
+    mp_mutex_t      mx;           // buffer states + stats
+    mp_cond_t       cv;           // a sequence became ready
+    seqcap_stats_t  st;
+} seqcap_t;
+
+void   seqcap_init(seqcap_t* s);
+void   seqcap_free(seqcap_t* s);      // stops first
+
+// Bytes of one sequence block for cfg
+size_t seqcap_bytes(const seqcap_cfg_t* cfg);
+
+// Allocate the sequences, attach to the ring and start the thread.  0 on success,
+// -1 bad configuration, -2 allocation, -3 no free ring consumer, -4 thread
+int    seqcap_start(seqcap_t* s, sample_ring_t* ring, const seqcap_cfg_t* cfg);
+
+// Stop the thread; a partly filled sequence becomes ready.  The sequences are kept for
+// seqcap_take() until the next start.  No-op when not running
+void   seqcap_stop(seqcap_t* s);
+
+void   seqcap_stats(seqcap_t* s, seqcap_stats_t* out);
+
+// Block until a sequence is ready or timeout; 1 ready, 0 timeout
+int    seqcap_wait(seqcap_t* s, unsigned timeout_ms);
+
+// Copy the oldest ready sequence to out (seqcap_bytes() long) and release it for capture.
+// *number is the sequence number, *segments the segments in it.  1 taken, 0 none ready,
+// -1 cap too small
+int    seqcap_take(seqcap_t* s, uint8_t* out, size_t cap, uint64_t* number, uint32_t* segments);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_SEQCAP_H
@@ -1,15 +1,47 @@
 # setup.py
+import sys
 from setuptools import setup, Extension
 
+libraries = []
+if sys.platform == "win32":
+    libraries += ["ws2_32"]
+elif sys.platform.startswith("linux"):
+    libraries += ["rt"]  # shm_open on older glibc
+
 ext = Extension(
     "mp_serial_ext",
-    sources=["mp_serial_ext.c"],
+    sources=[
+        "mp_serial_ext.c",
+        "p1150.c",
+        "stats_page.c",
+        "prom_export.c",
+        "hotplug.c",
+        "adc_frame.c",
+        "pressure.c",
+        "sample_ring.c",
+        "digital.c",
+        "gated.c",
+        "current_hist.c",
+        "history.c",
+        "segment.c",
+        "recorder.c",
+        "rec_search.c",
+        "seqcap.c",
+        "sweep.c",
+        "plot.c",
+        "sample_clock.c",
+        "derived.c",
+        "mask.c",
+        "control.c",
+        "decode_pool.c",
+    ],
+    libraries=libraries,
     extra_compile_args=[],
     extra_link_args=[],
 )
 
 setup(
     name="mp_serial_ext",
-    version="0.2.0",
+    version="0.3.0",
     ext_modules=[ext],
 )
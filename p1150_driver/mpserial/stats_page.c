@@ -0,0 +1,151 @@
+// stats_page.c
+#include "stats_page.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #include <windows.h>
+  #define SP_BARRIER() MemoryBarrier()
+#else
+  #include <unistd.h>
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #define SP_BARRIER() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+typedef char stats_page_fits[(sizeof(stats_page_t) <= STATS_PAGE_BYTES) ? 1 : -1];
+
+int stats_shm_open(stats_shm_t* shm, const char* name) {
+    memset(shm, 0, sizeof(*shm));
+#ifndef _WIN32
+    shm->fd = -1;
+#endif
+
+    if (!name || !name[0]) {
+        shm->page = (stats_page_t*)calloc(1, STATS_PAGE_BYTES);
+        return shm->page ? 0 : -1;
+    }
+    strncpy(shm->name, name, sizeof(shm->name) - 1);
+
+#ifdef _WIN32
+    HANDLE h = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                  0, STATS_PAGE_BYTES, name);
+    if (!h) {
+        fprintf(stderr, "CreateFileMapping failed for %s, err=%lu\n", name, GetLastError());
+        return -1;
+    }
+    void* p = MapViewOfFile(h, FILE_MAP_ALL_ACCESS, 0, 0, STATS_PAGE_BYTES);
+    if (!p) {
+        fprintf(stderr, "MapViewOfFile failed for %s, err=%lu\n", name, GetLastError());
+        CloseHandle(h);
+        return -1;
+    }
+    shm->h_map = h;
+    shm->page = (stats_page_t*)p;
+#else
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        perror("shm_open");
+        return -1;
+    }
+    if (ftruncate(fd, STATS_PAGE_BYTES) != 0) {
+        perror("ftruncate");
+        close(fd);
+        return -1;
+    }
+    void* p = mmap(NULL, STATS_PAGE_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        perror("mmap");
+        close(fd);
+        return -1;
+    }
+    shm->fd = fd;
+    shm->page = (stats_page_t*)p;
+#endif
+    return 0;
+}
+
+void stats_shm_close(stats_shm_t* shm) {
+    if (!shm->page) return;
+
+    if (!shm->name[0]) {
+        free(shm->page);
+        shm->page = NULL;
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(shm->page);
+    if (shm->h_map) CloseHandle((HANDLE)shm->h_map);
+    shm->h_map = NULL;
+#else
+    munmap(shm->page, STATS_PAGE_BYTES);
+    if (shm->fd >= 0) close(shm->fd);
+    shm->fd = -1;
+    shm_unlink(shm->name);
+#endif
+    shm->page = NULL;
+}
+
+void stats_page_init(stats_page_t* page, const char* port) {
+    memset(page, 0, sizeof(*page));
+    page->version = STATS_PAGE_VERSION;
+#ifdef _WIN32
+    page->pid = (uint32_t)GetCurrentProcessId();
+#else
+    page->pid = (uint32_t)getpid();
+#endif
+    if (port) strncpy(page->port, port, sizeof(page->port) - 1);
+    SP_BARRIER();
+    // magic last, readers ignore the page until it is set
+    page->magic = STATS_PAGE_MAGIC;
+}
+
+void stats_page_write_begin(stats_page_t* page) {
+    page->seq++;
+    SP_BARRIER();
+    page->n_entries = 0;
+    page->n_hists = 0;
+}
+
+void stats_page_write_end(stats_page_t* page) {
+    page->publish_count++;
+    SP_BARRIER();
+    page->seq++;
+}
+
+int stats_page_snapshot(const stats_page_t* page, stats_page_t* out) {
+    for (int tries = 0; tries < 1000; tries++) {
+        uint32_t s1 = page->seq;
+        SP_BARRIER();
+        if (s1 & 1u) continue;
+        memcpy(out, (const void*)page, sizeof(*out));
+        SP_BARRIER();
+        if (page->seq == s1 && out->magic == STATS_PAGE_MAGIC) return 0;
+    }
+    return -1;
+}
+
+int stats_page_set(stats_page_t* page, const char* name, uint32_t kind, double value) {
+    if (page->n_entries >= STATS_MAX_ENTRIES) return -1;
+    int k = (int)page->n_entries++;
+    stats_entry_t* e = &page->entries[k];
+    strncpy(e->name, name, STATS_NAME_LEN - 1);
+    e->name[STATS_NAME_LEN - 1] = 0;
+    e->kind = kind;
+    e->value = value;
+    return k;
+}
+
+int stats_page_set_hist(stats_page_t* page, const char* name, const log2_hist_t* h) {
+    if (page->n_hists >= STATS_MAX_HISTS) return -1;
+    int k = (int)page->n_hists++;
+    stats_hist_t* sh = &page->hists[k];
+    strncpy(sh->name, name, STATS_NAME_LEN - 1);
+    sh->name[STATS_NAME_LEN - 1] = 0;
+    sh->h = *h;
+    return k;
+}
@@ -0,0 +1,115 @@
+// stats_page.h
+// Shared-memory stats page published by mp_serial_ext, protected by a seqlock.
+//
+// Layout is fixed and versioned so that processes other than the one owning the
+// serial port (dashboards, exporters, test harness monitors) can map the page
+// read-only and take consistent snapshots without touching the Python interpreter.
+//
+// Writer:  stats_page_write_begin() ... update fields ... stats_page_write_end()
+// Reader:  stats_page_snapshot() retries until it sees an even, unchanged sequence.
+#ifndef MP_SERIAL_STATS_PAGE_H
+#define MP_SERIAL_STATS_PAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STATS_PAGE_MAGIC        0x50313135u  // "P115"
+#define STATS_PAGE_VERSION      1u
+#define STATS_PAGE_BYTES        8192u
+
+#define STATS_NAME_LEN          40
+#define STATS_MAX_ENTRIES       64
+#define STATS_MAX_HISTS         8
+#define STATS_HIST_BUCKETS      32
+
+#define STATS_KIND_COUNTER      0u
+#define STATS_KIND_GAUGE        1u
+
+// log2 histogram: bucket k counts values v with 2^(k-1) <= v < 2^k (bucket 0 is v == 0),
+// the last bucket absorbs everything larger.
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t buckets[STATS_HIST_BUCKETS];
+} log2_hist_t;
+
+typedef struct {
+    char     name[STATS_NAME_LEN];
+    uint32_t kind;
+    uint32_t _pad;
+    double   value;
+} stats_entry_t;
+
+typedef struct {
+    char        name[STATS_NAME_LEN];
+    log2_hist_t h;
+} stats_hist_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    volatile uint32_t seq;       // odd while the writer is updating
+    uint32_t n_entries;
+    uint32_t n_hists;
+    uint32_t pid;
+    uint64_t update_ms;          // monotonic ms of last publish
+    uint64_t publish_count;
+    char     port[64];
+    stats_entry_t entries[STATS_MAX_ENTRIES];
+    stats_hist_t  hists[STATS_MAX_HISTS];
+} stats_page_t;
+
+// Handle for a mapped page (owner side)
+typedef struct {
+    stats_page_t* page;
+    char          name[128];
+#ifdef _WIN32
+    void*         h_map;
+#else
+    int           fd;
+#endif
+} stats_shm_t;
+
+static inline unsigned log2_hist_bucket(uint64_t v) {
+    unsigned k = 0;
+    while (v && k < STATS_HIST_BUCKETS - 1) { v >>= 1; k++; }
+    return k;
+}
+
+static inline void log2_hist_add(log2_hist_t* h, uint64_t v) {
+    h->count++;
+    h->sum += v;
+    h->buckets[log2_hist_bucket(v)]++;
+}
+
+// Upper bound (exclusive) of bucket k, used for Prometheus "le" labels
+static inline uint64_t log2_hist_upper(unsigned k) {
+    return (k >= 63) ? UINT64_MAX : ((uint64_t)1 << k);
+}
+
+// Create (or re-open) the named shared memory page; name=NULL keeps a private heap page.
+// Returns 0 on success.
+int  stats_shm_open(stats_shm_t* shm, const char* name);
+void stats_shm_close(stats_shm_t* shm);
+
+void stats_page_init(stats_page_t* page, const char* port);
+void stats_page_write_begin(stats_page_t* page);
+void stats_page_write_end(stats_page_t* page);
+
+// Consistent copy of the page into *out. Returns 0 on success, -1 if the
+// writer kept the page busy for too many retries.
+int  stats_page_snapshot(const stats_page_t* page, stats_page_t* out);
+
+// Helpers used between write_begin/write_end; return the slot index or -1 when full.
+int  stats_page_set(stats_page_t* page, const char* name, uint32_t kind, double value);
+int  stats_page_set_hist(stats_page_t* page, const char* name, const log2_hist_t* h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_STATS_PAGE_H
@@ -0,0 +1,250 @@
+// sweep.c
+#include "sweep.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static int active(int state) { return state >= SWEEP_SEND && state <= SWEEP_WINDOW; }
+
+void sweep_init(sweep_t* s, ctl_emit_fn emit, void* ctx) {
+    memset(s, 0, sizeof(*s));
+    s->emit = emit;
+    s->ctx = ctx;
+    mp_mutex_init(&s->mx);
+    mp_cond_init(&s->cv);
+}
+
+static void free_steps(sweep_t* s) {
+    free(s->cmd);
+    free(s->cmd_off);
+    free(s->steps);
+    s->cmd = NULL;
+    s->cmd_off = NULL;
+    s->steps = NULL;
+    s->n_steps = 0;
+}
+
+void sweep_free(sweep_t* s) {
+    free_steps(s);
+    mp_cond_destroy(&s->cv);
+    mp_mutex_destroy(&s->mx);
+}
+
+int sweep_start(sweep_t* s, const sweep_cfg_t* cfg, const uint8_t* const* cmd, const size_t* len,
+                const uint32_t* mv, uint32_t n, const char* ack) {
+    if (n == 0 || n > SWEEP_MAX_STEPS || cfg->window == 0 || cfg->ack_timeout == 0
+        || !ack || strlen(ack) >= SWEEP_ACK_MAX) {
+        return -1;
+    }
+    size_t total = 0;
+    for (uint32_t k = 0; k < n; k++) {
+        if (len[k] == 0 || len[k] > CTL_ACTION_MAX) return -1;
+        total += len[k];
+    }
+
+    // built outside the lock, the reader thread may be running the previous sweep
+    uint8_t* buf = (uint8_t*)malloc(total);
+    uint32_t* off = (uint32_t*)malloc(((size_t)n + 1) * sizeof(uint32_t));
+    sweep_step_t* steps = (sweep_step_t*)calloc(n, sizeof(sweep_step_t));
+    if (!buf || !off || !steps) {
+        free(buf); free(off); free(steps);
+        return -2;
+    }
+    size_t at = 0;
+    for (uint32_t k = 0; k < n; k++) {
+        off[k] = (uint32_t)at;
+        memcpy(buf + at, cmd[k], len[k]);
+        at += len[k];
+        steps[k].mv = mv ? mv[k] : 0;
+    }
+    off[n] = (uint32_t)at;
+
+    mp_mutex_lock(&s->mx);
+    free_steps(s);
+    s->cfg = *cfg;
+    s->cmd = buf;
+    s->cmd_off = off;
+    s->steps = steps;
+    s->n_steps = n;
+    snprintf(s->ack, sizeof(s->ack), "%s", ack);
+    s->cur = 0;
+    memset(&s->st, 0, sizeof(s->st));
+    s->st.n_steps = n;
+    s->state = s->st.state = SWEEP_SEND;
+    mp_mutex_unlock(&s->mx);
+    return 0;
+}
+
+void sweep_abort(sweep_t* s) {
+    mp_mutex_lock(&s->mx);
+    if (active(s->state)) {
+        s->state = s->st.state = SWEEP_ABORTED;
+        s->st.end_ns = mp_now_ns();
+        mp_cond_broadcast(&s->cv);
+    }
+    mp_mutex_unlock(&s->mx);
+}
+
+// ----------------- Steps (reader thread, lock held) -----------------
+
+// Write the command of step cur, stream position seq
+static void send_step(sweep_t* s, uint64_t seq) {
+    sweep_step_t* p = &s->steps[s->cur];
+    p->sent = seq;
+    p->ack = UINT64_MAX;
+    p->sent_ns = mp_now_ns();
+    if (s->cur == 0) s->st.start_ns = p->sent_ns;
+
+    const uint32_t o = s->cmd_off[s->cur];
+    if (s->emit(s->ctx, s->cmd + o, s->cmd_off[s->cur + 1] - o, NULL) != 0) {
+        // nothing to wait for, the window shows what the supply did
+        p->flags |= SWEEP_STEP_UNSENT;
+        s->st.noack++;
+        s->from = seq;
+        s->state = SWEEP_SETTLE;
+        return;
+    }
+    s->state = SWEEP_ACK;
+}
+
+static void close_step(sweep_t* s) {
+    sweep_step_t* p = &s->steps[s->cur];
+    const double n = (double)s->n;
+    p->n = s->n;
+    p->i_mean = s->i_sum / n;
+    p->i_rms = sqrt(s->i_sumsq / n);
+    p->isnk_mean = s->isnk_sum / n;
+    p->charge_uc = s->i_sum * 1000.0 / ADC_SAMPLE_RATE_HZ;
+    p->i_min = s->i_min;
+    p->i_max = s->i_max;
+    p->a0_mean = (float)(s->a0_sum / n);
+
+    s->st.done = ++s->cur;
+    if (s->cur < s->n_steps) {
+        s->state = SWEEP_SEND;
+    } else {
+        s->state = SWEEP_DONE;
+        s->st.end_ns = mp_now_ns();
+        mp_cond_broadcast(&s->cv);
+    }
+}
+
+// Fold samples [a, b) of the frame at base into the window
+static void fold(sweep_t* s, uint64_t base, const adc_frame_t* f, uint64_t a, uint64_t b) {
+    const int has_s = (f->present & ADC_HAS_ISNK) != 0;
+    const int has_a0 = (f->present & ADC_HAS_A0) != 0;
+    for (uint64_t q = a; q < b; q++) {
+        const size_t k = (size_t)(q - base);
+        float v = 0.0f, w = 0.0f;
+        uint16_t a0 = 0;
+        if ((k + 1) * 4 <= f->i.n) memcpy(&v, f->i.p + k * 4, 4);
+        if (has_s && (k + 1) * 4 <= f->isnk.n) memcpy(&w, f->isnk.p + k * 4, 4);
+        if (has_a0 && (k + 1) * 2 <= f->a0.n) memcpy(&a0, f->a0.p + k * 2, 2);
+        const float i = (float)((double)v / 1000000.0);
+
+        if (s->n == 0 || i < s->i_min) s->i_min = i;
+        if (s->n == 0 || i > s->i_max) s->i_max = i;
+        s->i_sum += i;
+        s->i_sumsq += (double)i * i;
+        s->isnk_sum += (double)w / 1000000.0;
+        s->a0_sum += a0;
+        s->n++;
+    }
+}
+
+void sweep_feed(sweep_t* s, uint64_t base, const adc_frame_t* f) {
+    if (!active(s->state)) return;
+    const uint64_t end = base + adc_frame_samples(f);
+
+    mp_mutex_lock(&s->mx);
+    for (int more = 1; more;) {
+        sweep_step_t* p = &s->steps[s->cur];
+        switch (s->state) {
+        case SWEEP_SEND:
+            // the previous window closed in this frame, the command goes out now
+            send_step(s, end);
+            more = 0;
+            break;
+        case SWEEP_ACK:
+            if (end - p->sent < s->cfg.ack_timeout) {
+                more = 0;
+                break;
+            }
+            p->flags |= SWEEP_STEP_NOACK;
+            s->st.noack++;
+            s->from = p->sent + s->cfg.ack_timeout;
+            s->state = SWEEP_SETTLE;
+            break;
+        case SWEEP_SETTLE:
+            p->start = s->from + s->cfg.settle;
+            s->n = 0;
+            s->i_sum = s->i_sumsq = s->isnk_sum = s->a0_sum = 0.0;
+            s->state = SWEEP_WINDOW;
+            break;
+        case SWEEP_WINDOW: {
+            const uint64_t wend = p->start + s->cfg.window;
+            const uint64_t a = p->start + s->n > base ? p->start + s->n : base;
+            const uint64_t b = wend < end ? wend : end;
+            if (a < b) fold(s, base, f, a, b);
+            if (p->start + s->n < wend) {
+                more = 0;
+                break;
+            }
+            close_step(s);
+            break;
+        }
+        default:
+            more = 0;
+            break;
+        }
+    }
+    s->st.state = s->state;
+    mp_mutex_unlock(&s->mx);
+}
+
+void sweep_response(sweep_t* s, const cmd_response_t* r, uint64_t seq) {
+    if (s->state != SWEEP_ACK) return;
+    mp_mutex_lock(&s->mx);
+    if (s->state == SWEEP_ACK && r->f.n == strlen(s->ack) && memcmp(r->f.p, s->ack, r->f.n) == 0) {
+        sweep_step_t* p = &s->steps[s->cur];
+        p->ack = seq;
+        p->ack_ns = mp_now_ns();
+        if (r->s == 0) {
+            p->flags |= SWEEP_STEP_NAK;
+            s->st.noack++;
+        }
+        s->from = seq;
+        s->state = s->st.state = SWEEP_SETTLE;
+    }
+    mp_mutex_unlock(&s->mx);
+}
+
+// ----------------- Readers -----------------
+
+void sweep_status(sweep_t* s, sweep_status_t* out) {
+    mp_mutex_lock(&s->mx);
+    *out = s->st;
+    mp_mutex_unlock(&s->mx);
+}
+
+int sweep_wait(sweep_t* s, unsigned timeout_ms) {
+    const uint64_t deadline = mp_now_ms() + timeout_ms;
+    mp_mutex_lock(&s->mx);
+    while (active(s->state)) {
+        uint64_t now = mp_now_ms();
+        if (now >= deadline) break;
+        mp_cond_wait_ms(&s->cv, &s->mx, (unsigned)(deadline - now));
+    }
+    int over = !active(s->state);
+    mp_mutex_unlock(&s->mx);
+    return over;
+}
+
+size_t sweep_results(sweep_t* s, uint32_t since, sweep_step_t* out, size_t cap) {
+    size_t cnt = 0;
+    mp_mutex_lock(&s->mx);
+    for (uint32_t k = since; k < s->st.done && cnt < cap; k++) out[cnt++] = s->steps[k];
+    mp_mutex_unlock(&s->mx);
+    return cnt;
+}
@@ -0,0 +1,125 @@
+// sweep.h
+// Native VOUT sweep sequencer with capture windows sliced out of the stream.
+//
+// A supply characterisation runs as one native sequence instead of a Python loop of
+// set_vout(), sleep and single acquisitions.  For every step the reader thread
+//   - writes the step's command (cmd_vout, CBOR encoded and framed once by Python) the
+//     moment the previous step's window closed, and notes the stream sample index,
+//   - notes the stream sample index at which the firmware response ({"f": ack, "s": ...}
+//     on port 0) arrived, in stream order with the ADC frames,
+//   - skips `settle` samples after the response and folds the next `window` samples of
+//     i, isnk and a0 into the step's statistics.
+// A step whose response does not come within ack_timeout samples is flagged and its
+// window is taken from there.  Nothing is started, stopped or copied per step: the steps
+// are slices of the continuous stream, which paces the sequencer (the ADC stream must run).
+#ifndef MP_SERIAL_SWEEP_H
+#define MP_SERIAL_SWEEP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mp_platform.h"
+#include "adc_frame.h"
+#include "control.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SWEEP_MAX_STEPS    65536u
+#define SWEEP_ACK_MAX      32          // response "f" name
+
+enum { SWEEP_IDLE, SWEEP_SEND, SWEEP_ACK, SWEEP_SETTLE, SWEEP_WINDOW, SWEEP_DONE, SWEEP_ABORTED };
+
+#define SWEEP_STEP_NOACK   0x0001u     // no response within ack_timeout
+#define SWEEP_STEP_NAK     0x0002u     // the response had "s": false
+#define SWEEP_STEP_UNSENT  0x0004u     // the command could not be written (link down)
+
+typedef struct {
+    uint32_t settle;            // samples from the response to the window
+    uint32_t window;            // samples per step, > 0
+    uint32_t ack_timeout;       // samples to wait for the response, > 0
+} sweep_cfg_t;
+
+typedef struct {                // 104 bytes, read by Python
+    uint64_t sent;              // stream sample index when the command was written
+    uint64_t ack;               // ... when the response arrived, UINT64_MAX none
+    uint64_t start;             // window [start, start + n)
+    uint64_t n;
+    uint64_t sent_ns;           // monotonic
+    uint64_t ack_ns;
+    double   i_mean;            // mA
+    double   i_rms;
+    double   isnk_mean;
+    double   charge_uc;
+    float    i_min;
+    float    i_max;
+    float    a0_mean;
+    uint32_t mv;                // the step's value, as given
+    uint16_t flags;             // SWEEP_STEP_*
+    uint16_t reserved;
+    uint32_t reserved2;
+} sweep_step_t;
+
+typedef struct {
+    int      state;             // SWEEP_*
+    uint32_t n_steps;
+    uint32_t done;              // steps with a closed window
+    uint32_t noack;             // steps flagged NOACK, NAK or UNSENT
+    uint64_t start_ns;          // monotonic, first command written
+    uint64_t end_ns;            // last window closed
+} sweep_status_t;
+
+typedef struct {
+    sweep_cfg_t   cfg;
+    uint32_t      n_steps;
+    uint8_t*      cmd;            // framed commands back to back
+    uint32_t*     cmd_off;        // n_steps + 1 offsets into cmd
+    sweep_step_t* steps;
+    char          ack[SWEEP_ACK_MAX];
+    ctl_emit_fn   emit;
+    void*         ctx;
+
+    volatile int  state;
+    uint32_t      cur;
+    uint64_t      from;           // settle starts here (response or timeout)
+
+    // window in progress
+    uint64_t      n;
+    double        i_sum, i_sumsq, isnk_sum, a0_sum;
+    float         i_min, i_max;
+
+    sweep_status_t st;
+    mp_mutex_t    mx;             // reader thread runs the steps, Python starts/reads
+    mp_cond_t     cv;             // the sweep is over
+} sweep_t;
+
+void sweep_init(sweep_t* s, ctl_emit_fn emit, void* ctx);
+void sweep_free(sweep_t* s);
+
+// Replace any sweep and start a new one with the first ADC frame: n framed commands
+// cmd[k] of len[k] bytes, mv[k] recorded with each step, ack the response "f" that
+// acknowledges them.  0 on success, -1 bad arguments, -2 allocation
+int  sweep_start(sweep_t* s, const sweep_cfg_t* cfg, const uint8_t* const* cmd, const size_t* len,
+                 const uint32_t* mv, uint32_t n, const char* ack);
+void sweep_abort(sweep_t* s);
+
+// Reader thread: one ADC frame starting at stream sample index base
+void sweep_feed(sweep_t* s, uint64_t base, const adc_frame_t* f);
+
+// Reader thread: a command response that arrived before stream sample index seq
+void sweep_response(sweep_t* s, const cmd_response_t* r, uint64_t seq);
+
+void   sweep_status(sweep_t* s, sweep_status_t* out);
+
+// Block until the sweep is over (done, aborted, none started) or timeout; 1 over, 0 timeout
+int    sweep_wait(sweep_t* s, unsigned timeout_ms);
+
+// Completed steps numbered since and later, at most cap; returns the count
+size_t sweep_results(sweep_t* s, uint32_t since, sweep_step_t* out, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP_SERIAL_SWEEP_H
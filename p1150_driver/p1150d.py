@@ -0,0 +1,552 @@
+# -*- coding: utf-8 -*-
+"""
+MIT License
+
+Copyright (c) 2024-2025 sistemicorp
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+P1150 daemon: owns P1150 devices and keeps them connected and calibrated, test
+scripts talk to it over a local Unix socket instead of constructing P1150 each run.
+
+    python -m p1150_driver.p1150d --sn FE823374 [--sn ...] [--socket /tmp/p1150d.sock]
+
+    from p1150_driver.p1150d import P1150Client
+    p = P1150Client("FE823374")
+    ok, r = p.set_vout(3300)             # any P1150 method, same (success, result)
+    p.subscribe(stream=True)              # several clients may subscribe to one device
+    kind, item = p.next(timeout=1.0)      # ("data", {...}) / ("acq", {...})
+
+Wire format, every message is
+    <u32 length> <u8 type> <payload>      little-endian, length counts type + payload
+    MSG_CALL    client -> daemon  CBOR {"id", "dev", "m", "a", "k"}   P1150 method call
+    MSG_RESULT  daemon -> client  CBOR {"id", "ok", "r"}              its (success, result)
+    MSG_SUB     client -> daemon  CBOR {"id", "dev", "stream", "acq", "wake", "policy"}
+    MSG_UNSUB   client -> daemon  CBOR {"id", "sub"}
+    MSG_DATA    daemon -> client  <u32 sub, u64 seq, u32 n, u32 overrun> then the columns
+                                  i <f4[n], isnk <f4[n], a0 <u2[n], d01 u1[n], d0s S1[n]
+    MSG_ACQ     daemon -> client  CBOR {"sub", "dev", "d"}            acquisition callback data
+numpy arrays in CBOR payloads are tag ND_TAG [dtype, shape, bytes].  dev None addresses
+the daemon itself ("devices", "ping").
+"""
+import io
+import os
+import socket
+import struct
+import threading
+import queue
+import logging
+import cbor2
+import numpy as np
+
+MSG_CALL = 1
+MSG_RESULT = 2
+MSG_SUB = 3
+MSG_UNSUB = 4
+MSG_DATA = 5
+MSG_ACQ = 6
+
+ND_TAG = 40100
+DEFAULT_SOCKET = os.path.join(os.environ.get("XDG_RUNTIME_DIR", "/tmp"), "p1150d.sock")
+
+_HDR = struct.Struct("<IB")
+_DATA = struct.Struct("<IQII")
+_COLS = (("i", "<f4"), ("isnk", "<f4"), ("a0", "<u2"), ("d01", "u1"), ("d0s", "S1"))
+_MAX_MSG = 64 << 20
+
+# P1150 methods clients may not call: they would close or re-open the shared device,
+# or return objects that only live in the daemon
+_DENY = {"close", "uclog_close", "ez_connect", "stream_consumer"}
+
+
+def _default(enc, o):
+    if isinstance(o, np.ndarray):
+        if o.dtype == object:
+            enc.encode(o.tolist())
+        else:
+            enc.encode(cbor2.CBORTag(ND_TAG, [o.dtype.str, list(o.shape), np.ascontiguousarray(o).tobytes()]))
+    elif isinstance(o, np.generic):
+        enc.encode(o.item())
+    elif isinstance(o, dict):
+        enc.encode(dict(o))
+    else:
+        raise cbor2.CBOREncodeTypeError(f"cannot send {type(o).__name__}")
+
+
+def _tag_hook(*args):
+    # (decoder, tag) in cbor2 5.x, (tag, immutable) in 6.x
+    tag = next(a for a in args if isinstance(a, cbor2.CBORTag))
+    if tag.tag == ND_TAG:
+        dt, shape, raw = tag.value
+        return np.frombuffer(raw, dtype=dt).reshape(shape)
+    return tag
+
+
+def _dumps(o) -> bytes:
+    return cbor2.dumps(o, default=_default)
+
+
+def _loads(b: bytes):
+    return cbor2.loads(b, tag_hook=_tag_hook)
+
+
+def _recv_exact(sock, n: int) -> bytes | None:
+    buf = bytearray()
+    while len(buf) < n:
+        b = sock.recv(n - len(buf))
+        if not b:
+            return None
+        buf += b
+    return bytes(buf)
+
+
+def _recv_msg(sock) -> tuple[int, bytes] | None:
+    hdr = _recv_exact(sock, _HDR.size)
+    if hdr is None:
+        return None
+    length, typ = _HDR.unpack(hdr)
+    if length < 1 or length > _MAX_MSG:
+        raise ValueError(f"bad message length {length}")
+    payload = _recv_exact(sock, length - 1)
+    if payload is None:
+        return None
+    return typ, payload
+
+
+def _msg(typ: int, payload: bytes) -> bytes:
+    return _HDR.pack(len(payload) + 1, typ) + payload
+
+
+# ----------------------------------------------------------------- daemon side
+
+class _Connection:
+    """ One client connection: reader thread for requests, writer thread for replies """
+
+    QUEUE_MSGS = 256
+
+    def __init__(self, daemon, sock, number: int):
+        self.daemon = daemon
+        self.sock = sock
+        self.number = number
+        self.alive = True
+        self.out = queue.Queue(maxsize=self.QUEUE_MSGS)
+        self.subs = {}        # sub id -> {"dev", "consumer", "thread", "acq"}
+        self.next_sub = 1
+        self.dropped = 0      # acquisition messages dropped, client too slow
+        self.lock = threading.Lock()
+        self.reader = threading.Thread(target=self._read, name=f"p1150d-r{number}", daemon=True)
+        self.writer = threading.Thread(target=self._write, name=f"p1150d-w{number}", daemon=True)
+
+    def start(self):
+        self.writer.start()
+        self.reader.start()
+
+    def send(self, typ: int, payload: bytes, block: bool = True) -> bool:
+        if not self.alive:
+            return False
+        try:
+            self.out.put(_msg(typ, payload), block=block, timeout=1.0 if block else None)
+            return True
+        except queue.Full:
+            self.dropped += 1
+            return False
+
+    def close(self):
+        if not self.alive:
+            return
+        self.alive = False
+        with self.lock:
+            subs, self.subs = self.subs, {}
+        for s in subs.values():
+            self._end_sub(s)
+        try:
+            self.sock.shutdown(socket.SHUT_RDWR)
+        except OSError:
+            pass
+        self.out.put(None)
+        self.daemon._forget(self)
+
+    def _write(self):
+        while True:
+            m = self.out.get()
+            if m is None:
+                break
+            try:
+                self.sock.sendall(m)
+            except OSError:
+                break
+        self.sock.close()
+
+    def _read(self):
+        try:
+            while self.alive:
+                m = _recv_msg(self.sock)
+                if m is None:
+                    break
+                typ, payload = m
+                req = _loads(payload)
+                if typ == MSG_CALL:
+                    ok, r = self.daemon._call(req.get("dev"), req.get("m", ""), req.get("a", []), req.get("k", {}))
+                elif typ == MSG_SUB:
+                    ok, r = self._subscribe(req)
+                elif typ == MSG_UNSUB:
+                    ok, r = self._unsubscribe(req.get("sub"))
+                else:
+                    ok, r = False, {"ERROR": f"unknown message type {typ}"}
+                try:
+                    body = _dumps({"id": req.get("id"), "ok": ok, "r": r})
+                except (cbor2.CBOREncodeError, TypeError) as e:
+                    body = _dumps({"id": req.get("id"), "ok": False, "r": {"ERROR": str(e)}})
+                self.send(MSG_RESULT, body)
+        except (OSError, ValueError, cbor2.CBORDecodeError) as e:
+            self.daemon.logger.warning(f"p1150d client {self.number}: {e}")
+        finally:
+            self.close()
+
+    def _subscribe(self, req: dict) -> tuple[bool, dict]:
+        dev = self.daemon.devices.get(req.get("dev"))
+        if dev is None:
+            return False, {"ERROR": f"unknown device {req.get('dev')!r}"}
+        with self.lock:
+            sid = self.next_sub
+            self.next_sub += 1
+        sub = {"id": sid, "dev": req["dev"], "consumer": None, "thread": None, "acq": bool(req.get("acq"))}
+        if req.get("stream", True):
+            ok, c = dev["p1150"].stream_consumer(f"p1150d-{self.number}.{sid}", req.get("policy", "overwrite"),
+                                                 int(req.get("wake", 1250)))
+            if not ok:
+                return False, c
+            sub["consumer"] = c
+            sub["thread"] = threading.Thread(target=self._stream, args=(sub,), name=f"p1150d-s{self.number}.{sid}",
+                                             daemon=True)
+        with self.lock:
+            self.subs[sid] = sub
+        if sub["thread"]:
+            sub["thread"].start()
+        return True, {"sub": sid}
+
+    def _unsubscribe(self, sid) -> tuple[bool, dict | None]:
+        with self.lock:
+            sub = self.subs.pop(sid, None)
+        if sub is None:
+            return False, {"ERROR": f"unknown subscription {sid!r}"}
+        self._end_sub(sub)
+        return True, None
+
+    def _end_sub(self, sub: dict):
+        sub["stop"] = True
+        if sub["thread"] and sub["thread"] is not threading.current_thread():
+            sub["thread"].join(timeout=2.0)
+
+    def _stream(self, sub: dict):
+        c = sub["consumer"]
+        try:
+            while self.alive and not sub.get("stop"):
+                if not c.wait(0, 0.25):
+                    continue
+                for seq, cols in c.peek(1 << 16):
+                    n = len(cols["i"])
+                    body = b"".join(cols[k].tobytes() for k, _ in _COLS)
+                    over = c.commit(n)
+                    if not self.send(MSG_DATA, _DATA.pack(sub["id"], seq, n, over) + body):
+                        return
+        finally:
+            c.close()
+
+    def acquisition(self, name: str, body_for):
+        with self.lock:
+            subs = [s for s in self.subs.values() if s["acq"] and s["dev"] == name]
+        for s in subs:
+            self.send(MSG_ACQ, body_for(s["id"]), block=False)
+
+
+class P1150Daemon:
+    """ Owns P1150 devices and serves them on a Unix socket
+
+    :param devices: {name: {"sn": <serial number>, "port": <port or None>}}, clients address
+                    devices by name
+    :param path: socket path
+    :param kw: passed to every P1150 (sample_ring_log2, digital_log2, ...)
+    """
+
+    def __init__(self, devices: dict, path: str = DEFAULT_SOCKET, logger=None, **kw):
+        self.path = path
+        self.logger = logger or logging.getLogger("p1150d")
+        self.kw = kw
+        self.devices = {name: {"sn": d.get("sn"), "port": d.get("port"), "p1150": None, "connected": False}
+                        for name, d in devices.items()}
+        self._conns = set()
+        self._conns_lock = threading.Lock()
+        self._n = 0
+        self._sock = None
+        self._alive = False
+
+    def connect(self) -> bool:
+        """ Connect (firmware upload and calibration if needed) every device once """
+        from . import P1150
+        ok_all = True
+        for name, dev in self.devices.items():
+            port = dev["port"] or P1150.get_port_from_sn(dev["sn"])
+            if port is None:
+                self.logger.error(f"p1150d {name}: device {dev['sn']} not found")
+                ok_all = False
+                continue
+            p = P1150.P1150(port=port, logger=self.logger,
+                            cb_acquisition_get_data=lambda d, n=name: self._acquisition(n, d), **self.kw)
+            ok, r = p.ez_connect(dev["sn"])
+            if not ok:
+                self.logger.error(f"p1150d {name}: connect failed {r}")
+                p.close()
+                ok_all = False
+                continue
+            dev.update(p1150=p, port=port, connected=True)
+            self.logger.info(f"p1150d {name}: connected on {port}")
+        return ok_all
+
+    def serve_forever(self) -> None:
+        """ Accept clients until close() """
+        if os.path.exists(self.path):
+            os.unlink(self.path)
+        self._sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self._sock.bind(self.path)
+        self._sock.listen(16)
+        self._alive = True
+        self.logger.info(f"p1150d listening on {self.path}")
+        while self._alive:
+            try:
+                s, _ = self._sock.accept()
+            except OSError:
+                break
+            self._n += 1
+            c = _Connection(self, s, self._n)
+            with self._conns_lock:
+                self._conns.add(c)
+            c.start()
+
+    def close(self) -> None:
+        self._alive = False
+        if self._sock:
+            try:
+                self._sock.shutdown(socket.SHUT_RDWR)
+            except OSError:
+                pass
+            self._sock.close()
+            self._sock = None
+            if os.path.exists(self.path):
+                os.unlink(self.path)
+        with self._conns_lock:
+            conns = list(self._conns)
+        for c in conns:
+            c.close()
+        for dev in self.devices.values():
+            if dev["p1150"]:
+                dev["p1150"].close()
+                dev.update(p1150=None, connected=False)
+
+    def _forget(self, conn) -> None:
+        with self._conns_lock:
+            self._conns.discard(conn)
+
+    def _call(self, dev_name, method: str, args, kwargs) -> tuple[bool, object]:
+        if dev_name is None:
+            if method == "ping":
+                return True, {"devices": list(self.devices), "clients": len(self._conns)}
+            if method == "devices":
+                return True, {n: {"sn": d["sn"], "port": d["port"], "connected": d["connected"]}
+                              for n, d in self.devices.items()}
+            return False, {"ERROR": f"unknown daemon method {method!r}"}
+
+        dev = self.devices.get(dev_name)
+        if dev is None or dev["p1150"] is None:
+            return False, {"ERROR": f"device {dev_name!r} not connected"}
+        if method.startswith("_") or method in _DENY:
+            return False, {"ERROR": f"{method} not available through the daemon"}
+        f = getattr(dev["p1150"], method, None)
+        if not callable(f):
+            return False, {"ERROR": f"unknown method {method!r}"}
+        try:
+            r = f(*args, **kwargs)
+        except Exception as e:
+            return False, {"ERROR": f"{type(e).__name__}: {e}"}
+        if isinstance(r, tuple) and len(r) == 2 and isinstance(r[0], bool):
+            return r
+        return True, r
+
+    def _acquisition(self, name: str, d: dict) -> None:
+        # P1150 streaming thread: encode once, fan out without blocking on slow clients
+        if hasattr(d, "compute"):
+            d.compute()
+        data = _dumps(dict(d))
+        with self._conns_lock:
+            conns = list(self._conns)
+        for c in conns:
+            c.acquisition(name, lambda sid: _dumps({"sub": sid, "dev": name}) + data)
+
+
+# ----------------------------------------------------------------- client side
+
+class P1150Client:
+    """ P1150 served by p1150d, any P1150 method is called the same way
+
+    :param dev: device name given to the daemon (default: its only/first device)
+    :param path: daemon socket path
+    """
+
+    def __init__(self, dev: str | None = None, path: str = DEFAULT_SOCKET, timeout: float = 30.0):
+        self._sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self._sock.connect(path)
+        self._timeout = timeout
+        self._lock = threading.Lock()
+        self._id = 0
+        self._pending = {}
+        self._items = queue.Queue()
+        self._alive = True
+        self._rx = threading.Thread(target=self._read, name="p1150client", daemon=True)
+        self._rx.start()
+        if dev is None:
+            ok, r = self.daemon("ping")
+            if not ok or not r["devices"]:
+                raise RuntimeError(f"p1150d has no devices: {r}")
+            dev = r["devices"][0]
+        self.dev = dev
+
+    def __getattr__(self, name):
+        if name.startswith("_"):
+            raise AttributeError(name)
+        return lambda *a, **k: self.call(name, *a, **k)
+
+    def close(self) -> None:
+        self._alive = False
+        try:
+            self._sock.shutdown(socket.SHUT_RDWR)
+        except OSError:
+            pass
+        self._sock.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def _request(self, typ: int, body: dict) -> tuple[bool, object]:
+        with self._lock:
+            self._id += 1
+            rid = self._id
+            q = queue.Queue(maxsize=1)
+            self._pending[rid] = q
+            body["id"] = rid
+            self._sock.sendall(_msg(typ, _dumps(body)))
+        try:
+            r = q.get(timeout=self._timeout)
+        except queue.Empty:
+            return False, {"ERROR": "p1150d timeout"}
+        finally:
+            with self._lock:
+                self._pending.pop(rid, None)
+        return r["ok"], r["r"]
+
+    def call(self, method: str, *args, **kwargs) -> tuple[bool, object]:
+        return self._request(MSG_CALL, {"dev": self.dev, "m": method, "a": list(args), "k": kwargs})
+
+    def daemon(self, method: str) -> tuple[bool, object]:
+        """ daemon level request: "ping", "devices" """
+        return self._request(MSG_CALL, {"dev": None, "m": method, "a": [], "k": {}})
+
+    def subscribe(self, stream: bool = True, acq: bool = False, wake: int = 1250,
+                  policy: str = "overwrite") -> tuple[bool, dict]:
+        """ Receive the sample stream (own ring consumer in the daemon) and/or acquisitions,
+            items are returned by next() """
+        return self._request(MSG_SUB, {"dev": self.dev, "stream": stream, "acq": acq, "wake": wake,
+                                       "policy": policy})
+
+    def unsubscribe(self, sub: int) -> tuple[bool, dict | None]:
+        return self._request(MSG_UNSUB, {"sub": sub})
+
+    def next(self, timeout: float | None = None) -> tuple[str, dict] | None:
+        """ next subscribed item, ("data", {"sub", "seq", "overrun", "i", "isnk", "a0", "d01", "d0s"})
+            or ("acq", {"sub", "dev", "d"}), None on timeout """
+        try:
+            return self._items.get(timeout=timeout)
+        except queue.Empty:
+            return None
+
+    def _read(self):
+        try:
+            while self._alive:
+                m = _recv_msg(self._sock)
+                if m is None:
+                    break
+                typ, payload = m
+                if typ == MSG_RESULT:
+                    r = _loads(payload)
+                    with self._lock:
+                        q = self._pending.get(r.get("id"))
+                    if q is not None:
+                        q.put(r)
+                elif typ == MSG_DATA:
+                    sid, seq, n, over = _DATA.unpack_from(payload, 0)
+                    item, off = {"sub": sid, "seq": seq, "overrun": over}, _DATA.size
+                    for k, dt in _COLS:
+                        a = np.frombuffer(payload, dtype=dt, count=n, offset=off)
+                        item[k] = a
+                        off += a.nbytes
+                    self._items.put(("data", item))
+                elif typ == MSG_ACQ:
+                    # two CBOR items back to back: header then the acquisition
+                    dec = cbor2.CBORDecoder(io.BytesIO(payload), tag_hook=_tag_hook)
+                    hdr = dec.decode()
+                    hdr["d"] = dec.decode()
+                    self._items.put(("acq", hdr))
+        except (OSError, ValueError):
+            pass
+        finally:
+            with self._lock:
+                pending = list(self._pending.values())
+            for q in pending:
+                q.put({"ok": False, "r": {"ERROR": "p1150d connection closed"}})
+
+
+def main():
+    import argparse
+    ap = argparse.ArgumentParser(description="P1150 daemon, serves P1150 devices on a Unix socket")
+    ap.add_argument("--sn", action="append", default=[], help="device serial number, repeat for several")
+    ap.add_argument("--port", action="append", default=[], help="serial port of the matching --sn")
+    ap.add_argument("--socket", default=DEFAULT_SOCKET)
+    ap.add_argument("--sample-ring-log2", type=int, default=20)
+    args = ap.parse_args()
+    if not args.sn:
+        ap.error("at least one --sn is required")
+
+    logging.basicConfig(level=logging.INFO, format="%(asctime)s %(levelname)-5.5s %(message)s")
+    ports = args.port + [None] * (len(args.sn) - len(args.port))
+    d = P1150Daemon({sn: {"sn": sn, "port": port} for sn, port in zip(args.sn, ports)}, path=args.socket,
+                    sample_ring_log2=args.sample_ring_log2)
+    if not d.connect():
+        logging.warning("p1150d: not all devices connected")
+    try:
+        d.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        d.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -21,6 +21,8 @@ import time
 import logging
 import cbor2
 import cobs
+import hashlib
+import os
 
 from .logdata import LogData, TARGET_DIGIT_SHIFT, LOG_TYPE_PORT
 
@@ -63,6 +65,10 @@ class MuxDecode(object):
     # garbage data, and this instance check avoid choking on the garbage data.
     # BECAUSE the STM32 problem is in the bootloader (A51) and devices are
     # already in the field, this check is required.
+    if isinstance(frame, DecodedFrame):
+      if frame.port in self.on_data:
+        self.on_data[frame.port](frame.item)
+      return
     if not isinstance(frame, bytes) or len(frame) == 0:
       return
     p, t = divmod(int(frame[0]),4)
@@ -108,10 +114,10 @@ class LogDecode(object):
 
 
 from multiprocessing import Queue
-from .mp_serial import MySerialManager
+from .mp_serial import MySerialManager, DecodedFrame, expand_decoded
 
 class Serial(threading.Thread):
-  def __init__(self, dev):
+  def __init__(self, dev, **kw):
     threading.Thread.__init__(self)
     self.dev = dev
     self.on_data = None
@@ -120,7 +126,7 @@ class Serial(threading.Thread):
     self.q_in = Queue()
 
     logging.info("MySerialManager creating instance")
-    self.msm = MySerialManager(self.dev, self.q_in, self.q_out)
+    self.msm = MySerialManager(self.dev, self.q_in, self.q_out, **kw)
     logging.info("MySerialManager starting threads")
     self.msm.start()
     logging.info(f"MySerialManager is_running: {self.msm.is_running()}")
@@ -169,12 +175,18 @@ class Serial(threading.Thread):
       while self.alive and self.msm.is_running():
         try:
           frame = self.q_out.get(timeout=0.01)
+          if isinstance(frame, tuple):
+            frame = expand_decoded(frame)   # decode_workers: batch decoded natively
           if self.on_data:
             if isinstance(frame, list):
               for f in frame:
                 self.on_data(f)
             else:
               self.on_data(frame)
+          # consumer side of the native backlog telemetry
+          msm = self.msm
+          if msm:
+            msm.consumed(len(frame) if isinstance(frame, list) else 1)
 
         except queue.Empty:
           pass
@@ -199,11 +211,11 @@ def chain(items):
 
 
 class Target(threading.Thread):
-  def __init__(self, target):
+  def __init__(self, target, **serial_kw):
     threading.Thread.__init__(self)
     self.threads = {}
     self.alive = True
-    self.threads['serial'] = Serial(target)
+    self.threads['serial'] = Serial(target, **serial_kw)
     self.init()
     self.start()
 
@@ -227,10 +239,10 @@ class Target(threading.Thread):
 
 
 class LogClientServer(Target):
-  def __init__(self, target, decoders, rx):
+  def __init__(self, target, decoders, rx, **serial_kw):
     self.decoders = decoders
     self.rx = rx
-    Target.__init__(self, target)
+    Target.__init__(self, target, **serial_kw)
 
   def start(self):
     try:
@@ -256,7 +268,85 @@ class LogClientServer(Target):
     return self.tx[key]
 
 
+# Process-wide registry of LogData decoders, keyed by the SHA-256 of the .logdata file
+# content.  Every device of a process (one LogClientServer each) uses the same firmware
+# images, so the symbol tables are loaded and held once however many devices there are.
+# The shared instances are never modified after loading: their tables are read-only and
+# DeviceLogData decodes with count= so the instance's own message counter is not touched
+# either.  decode() runs under the GIL, so any thread of any device may use them.
+_logdata_lock = threading.Lock()
+_logdata = {}          # content hash -> LogData
+_logdata_paths = {}    # (path, mtime_ns, size) -> content hash, skips re-hashing unchanged files
+_logdata_stats = {"loads": 0, "hits": 0, "load_s": 0.0}
+
+
+def _logdata_key(fname):
+  st = os.stat(fname)
+  pkey = (os.path.realpath(fname), st.st_mtime_ns, st.st_size)
+  key = _logdata_paths.get(pkey)
+  if key is None:
+    with open(fname, 'rb') as f:
+      key = hashlib.sha256(f.read()).hexdigest()
+    _logdata_paths[pkey] = key
+  return key
+
+
+def shared_logdata(fname):
+  """ The registry's LogData for the content of fname, loaded on first use """
+  with _logdata_lock:
+    key = _logdata_key(fname)
+    d = _logdata.get(key)
+    if d is None:
+      t0 = time.perf_counter()
+      d = LogData(fname)
+      _logdata_stats["load_s"] += time.perf_counter() - t0
+      _logdata_stats["loads"] += 1
+      _logdata[key] = d
+    else:
+      _logdata_stats["hits"] += 1
+    return d
+
+
+def logdata_registry_info():
+  """ {"decoders", "loads", "hits", "load_s", "files": {hash: filename}} """
+  with _logdata_lock:
+    return dict(_logdata_stats, decoders=len(_logdata),
+                files={k: d.filename for k, d in _logdata.items()})
+
+
+def logdata_registry_clear():
+  """ Drop the registry; decoders in use stay valid, later ones are loaded again """
+  with _logdata_lock:
+    _logdata.clear()
+    _logdata_paths.clear()
+
+
+class DeviceLogData(object):
+  """ One device's view of a shared LogData: its own message count and time origin
+  - relies on LogData.decode() returning (count, ts, level, file, line, text): the count
+    is passed in (count=, the shared counter stays untouched) and ts is replaced by this
+    device's monotonic time, the rest is passed through
+  """
+  __slots__ = ('logdata', 'count', 'start')
+
+  def __init__(self, logdata):
+    self.logdata = logdata
+    self.count = 0
+    self.start = time.monotonic()
+
+  def target(self):
+    return self.logdata.target()
+
+  def decode(self, item):
+    self.count += 1
+    r = self.logdata.decode(item, count=self.count)
+    return (r[0], time.monotonic() - self.start) + tuple(r[2:])
+
+  def __repr__(self):
+    return f"DeviceLogData({self.logdata!r})"
+
+
 def decoders(fnames):
-  dec = [LogData(f) for f in fnames]
+  dec = [DeviceLogData(shared_logdata(f)) for f in fnames]
   return {d.target(): d for d in dec}
 